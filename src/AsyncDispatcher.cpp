@@ -0,0 +1,213 @@
+/*
+ * AsyncDispatcher.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "AsyncDispatcher.h"
+#include "QueuedModbusDevice.h"
+#include "ModbusDeviceLogging.h"
+
+namespace modbus {
+
+AsyncDispatcher::AsyncDispatcher() {
+    mutex = createMutex(mutexStorage);
+    ready = createQueue(MODBUS_DISPATCHER_MAX_DEVICES + 1, readyStorage);
+    if (!mutex || !ready) {
+        MODBUSD_LOG_E("Failed to create async dispatcher resources");
+    }
+}
+
+AsyncDispatcher::~AsyncDispatcher() {
+    stop();
+
+    for (auto* device : devices) {
+        if (device) {
+            removeDevice(*device);
+        }
+    }
+    if (ready) {
+        vQueueDelete(ready);
+    }
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+}
+
+ModbusResult<void> AsyncDispatcher::addDevice(QueuedModbusDevice& device) {
+    if (!mutex || !ready) {
+        return ModbusResult<void>::error(ModbusError::RESOURCE_CREATION_FAILED);
+    }
+    if (!device.isAsyncEnabled()) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    AsyncDispatcher* owner = device.dispatcher.load();
+    if (owner) {
+        xSemaphoreGive(mutex);
+        return owner == this ? ModbusResult<void>::ok()
+                             : ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+
+    size_t slot = 0;
+    while (slot < MODBUS_DISPATCHER_MAX_DEVICES && devices[slot]) {
+        slot++;
+    }
+    if (slot == MODBUS_DISPATCHER_MAX_DEVICES) {
+        xSemaphoreGive(mutex);
+        return ModbusResult<void>::error(ModbusError::QUEUE_FULL);
+    }
+
+    devices[slot] = &device;
+    deviceCount++;
+    device.dispatchSlot = static_cast<uint8_t>(slot);
+    device.dispatchSignalled = false;
+    device.dispatcher.store(this, std::memory_order_release);
+    xSemaphoreGive(mutex);
+
+    // Responses queued before the device joined
+    if (device.getQueueDepth() > 0) {
+        device.notifyDispatcher();
+    }
+    return ModbusResult<void>::ok();
+}
+
+void AsyncDispatcher::removeDevice(QueuedModbusDevice& device) {
+    if (!mutex || device.dispatcher.load() != this) {
+        return;
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (devices[device.dispatchSlot] == &device) {
+        devices[device.dispatchSlot] = nullptr;
+        deviceCount--;
+    }
+    device.dispatcher.store(nullptr, std::memory_order_release);
+    xSemaphoreGive(mutex);
+    // A token still queued for the slot finds it empty (or its next owner) and is dropped
+}
+
+bool AsyncDispatcher::start(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+    if (task.isRunning()) {
+        return true;
+    }
+    if (!mutex || !ready) {
+        return false;
+    }
+    if (!task.start("ModbusDisp", taskEntry, this, stackSize, priority, core)) {
+        return false;
+    }
+
+    MODBUSD_LOG_I("Async dispatcher started with %d devices", deviceCount);
+    return true;
+}
+
+void AsyncDispatcher::stop() {
+    const bool wasRunning = task.requestStop();
+
+    // From an onAsyncResponse() callback the task exits after this dispatch;
+    // the next start() or stop() reaps it
+    if (wasRunning && !task.isCurrentTask()) {
+        uint8_t token = STOP_TOKEN;
+        xQueueSend(ready, &token, portMAX_DELAY);
+    }
+    task.join();
+    if (wasRunning && !task.isCurrentTask()) {
+        MODBUSD_LOG_I("Async dispatcher stopped");
+    }
+}
+
+void AsyncDispatcher::signal(uint8_t slot) {
+    // One token per device at most, so the queue has room by construction
+    xQueueSend(ready, &slot, 0);
+}
+
+size_t AsyncDispatcher::dispatch(TickType_t wait) {
+    size_t delivered = 0;
+    uint8_t slot = STOP_TOKEN;
+
+    if (ready && xQueueReceive(ready, &slot, wait) == pdTRUE) {
+        wakes++;
+        // Serve every device that is ready now; one that still has packets
+        // after its batch re-queues itself behind the others
+        size_t rounds = 0;
+        do {
+            if (slot != STOP_TOKEN) {
+                delivered += drain(slot);
+            }
+        } while (++rounds <= MODBUS_DISPATCHER_MAX_DEVICES && xQueueReceive(ready, &slot, 0) == pdTRUE);
+    }
+
+    TickType_t now = xTaskGetTickCount();
+    if (now - lastExpire >= pdMS_TO_TICKS(MODBUS_DISPATCHER_EXPIRE_MS)) {
+        lastExpire = now;
+        expireAll();
+    }
+    return delivered;
+}
+
+size_t AsyncDispatcher::drain(uint8_t slot) {
+    if (slot >= MODBUS_DISPATCHER_MAX_DEVICES ||
+        xSemaphoreTake(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return 0;
+    }
+
+    size_t delivered = 0;
+    QueuedModbusDevice* device = devices[slot];
+    if (device) {
+        // Cleared before receiving, so a packet queued from here on posts a new token
+        device->dispatchSignalled = false;
+        delivered = device->deliverQueued(MODBUS_DISPATCHER_BATCH);
+        if (delivered == MODBUS_DISPATCHER_BATCH && device->getQueueDepth() > 0) {
+            device->notifyDispatcher();
+        }
+    }
+    xSemaphoreGive(mutex);
+
+    dispatched += delivered;
+    return delivered;
+}
+
+void AsyncDispatcher::expireAll() {
+    if (xSemaphoreTake(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return;
+    }
+    for (auto* device : devices) {
+        if (device) {
+            device->expireAsyncRequests();
+        }
+    }
+    xSemaphoreGive(mutex);
+}
+
+void AsyncDispatcher::taskEntry(void* param) {
+    static_cast<AsyncDispatcher*>(param)->run();
+}
+
+void AsyncDispatcher::run() {
+    while (task.isRunning()) {
+        dispatch(pdMS_TO_TICKS(MODBUS_DISPATCHER_EXPIRE_MS));
+    }
+}
+
+} // namespace modbus
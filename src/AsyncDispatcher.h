@@ -0,0 +1,193 @@
+/*
+ * AsyncDispatcher.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef ASYNCDISPATCHER_H
+#define ASYNCDISPATCHER_H
+
+/**
+ * @file AsyncDispatcher.h
+ * @brief One task delivering queued responses for many QueuedModbusDevices
+ *
+ * Without it every QueuedModbusDevice needs someone to call processQueue(),
+ * i.e. a polling task per device or a loop over all of them. The dispatcher
+ * blocks on a single ready queue instead: a device posts its slot index when
+ * its response queue goes from idle to non-empty, and the dispatcher drains
+ * that device in batches on its own task.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+#include "ModbusTask.h"
+
+// Devices one dispatcher can serve
+#ifndef MODBUS_DISPATCHER_MAX_DEVICES
+#define MODBUS_DISPATCHER_MAX_DEVICES 32
+#endif
+
+// Packets delivered per device before moving on to the next ready device
+#ifndef MODBUS_DISPATCHER_BATCH
+#define MODBUS_DISPATCHER_BATCH 8
+#endif
+
+// How often the dispatcher runs expireAsyncRequests() on its devices
+#ifndef MODBUS_DISPATCHER_EXPIRE_MS
+#define MODBUS_DISPATCHER_EXPIRE_MS 20
+#endif
+
+#ifndef MODBUS_DISPATCHER_STACK_SIZE
+#define MODBUS_DISPATCHER_STACK_SIZE 4096
+#endif
+
+#ifndef MODBUS_DISPATCHER_TASK_PRIORITY
+#define MODBUS_DISPATCHER_TASK_PRIORITY 4
+#endif
+
+#ifndef MODBUS_DISPATCHER_CORE
+#define MODBUS_DISPATCHER_CORE tskNO_AFFINITY
+#endif
+
+namespace modbus {
+
+class QueuedModbusDevice;
+
+/**
+ * @class AsyncDispatcher
+ * @brief Drains the response queues of many async devices from one task
+ *
+ * Devices must have async mode enabled before they are added. Once added,
+ * their onAsyncResponse() runs on the dispatcher task (or inside dispatch()
+ * when driven by hand), so do not also call processQueue() on them. The
+ * dispatcher also runs their async deadlines every MODBUS_DISPATCHER_EXPIRE_MS.
+ *
+ * Each device has at most one entry in the ready queue at a time, so the
+ * queue never overflows regardless of how many responses are pending.
+ * Callbacks run with the device table locked: they may submit requests but
+ * must not add or remove devices. Remove a device (or stop the dispatcher)
+ * before its derived class is destroyed.
+ *
+ * @code
+ * static AsyncDispatcher dispatcher;
+ * for (auto* sensor : sensors) {
+ *     sensor->enableAsync();
+ *     dispatcher.addDevice(*sensor);
+ * }
+ * dispatcher.start();
+ * @endcode
+ */
+class AsyncDispatcher {
+public:
+    AsyncDispatcher();
+    ~AsyncDispatcher();
+
+    AsyncDispatcher(const AsyncDispatcher&) = delete;
+    AsyncDispatcher& operator=(const AsyncDispatcher&) = delete;
+
+    /**
+     * @brief Serve a device's response queue from this dispatcher
+     * @return NOT_INITIALIZED if async mode is off, INVALID_PARAMETER if the
+     *         device belongs to another dispatcher, QUEUE_FULL if the table is full
+     */
+    [[nodiscard]] ModbusResult<void> addDevice(QueuedModbusDevice& device);
+
+    /**
+     * @brief Stop serving a device; waits for a delivery in progress to finish
+     */
+    void removeDevice(QueuedModbusDevice& device);
+
+    size_t getDeviceCount() const { return deviceCount; }
+
+    /**
+     * @brief Start the dispatcher task
+     * @param stackSize Task stack (at most MODBUS_DISPATCHER_STACK_SIZE with
+     *        MODBUSDEVICE_STATIC_ALLOCATION)
+     * @return true if the task is running
+     */
+    bool start(uint32_t stackSize = MODBUS_DISPATCHER_STACK_SIZE,
+               UBaseType_t priority = MODBUS_DISPATCHER_TASK_PRIORITY,
+               BaseType_t core = MODBUS_DISPATCHER_CORE);
+
+    /**
+     * @brief Stop the task; queued responses stay in the device queues
+     */
+    void stop();
+
+    bool isRunning() const { return task.isRunning(); }
+
+    /**
+     * @brief Wait up to `wait` for a ready device, then deliver everything ready
+     *
+     * This is the task's loop body; call it directly to drive the dispatcher
+     * from an existing task instead of start().
+     * @return Number of responses delivered
+     */
+    size_t dispatch(TickType_t wait);
+
+    /**
+     * @brief Responses delivered since construction
+     */
+    uint32_t getDispatchedCount() const { return dispatched; }
+
+    /**
+     * @brief Times dispatch() woke with at least one ready device
+     */
+    uint32_t getWakeCount() const { return wakes; }
+
+private:
+    friend class QueuedModbusDevice;
+
+    static constexpr uint8_t STOP_TOKEN = 0xFF;
+    static_assert(MODBUS_DISPATCHER_MAX_DEVICES < STOP_TOKEN, "slot indices must fit below STOP_TOKEN");
+
+    /**
+     * @brief Post a device's slot to the ready queue (called by the device)
+     */
+    void signal(uint8_t slot);
+
+    size_t drain(uint8_t slot);
+    void expireAll();
+
+    static void taskEntry(void* param);
+    void run();
+
+    QueuedModbusDevice* devices[MODBUS_DISPATCHER_MAX_DEVICES] = {};
+    size_t deviceCount = 0;
+    SemaphoreHandle_t mutex = nullptr;   ///< Guards devices[] and delivery
+    QueueHandle_t ready = nullptr;       ///< Slot indices of devices with packets
+    TickType_t lastExpire = 0;
+    std::atomic<uint32_t> dispatched{0};
+    std::atomic<uint32_t> wakes{0};
+
+    SemaphoreStorage mutexStorage;
+    QueueStorage<MODBUS_DISPATCHER_MAX_DEVICES + 1, sizeof(uint8_t)> readyStorage;
+    ModbusTask<MODBUS_DISPATCHER_STACK_SIZE> task;
+};
+
+} // namespace modbus
+
+#endif // ASYNCDISPATCHER_H
@@ -0,0 +1,632 @@
+/*
+ * BusScheduler.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "BusScheduler.h"
+#include "ModbusDevice.h"
+#include "ModbusDeviceLogging.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusPollBudget.h"
+#include "ModbusTrace.h"
+#include <algorithm>
+#include <cstring>
+#include <esp_timer.h>
+
+namespace modbus {
+
+BusScheduler::BusScheduler(ModbusBus* schedulerBus)
+    : bus(schedulerBus ? schedulerBus : &ModbusRegistry::getInstance().getDefaultBus()) {}
+
+BusScheduler::~BusScheduler() {
+    stop();
+
+    for (auto& q : queues) {
+        if (q) {
+            vQueueDelete(q);
+            q = nullptr;
+        }
+    }
+    if (pending) {
+        vSemaphoreDelete(pending);
+    }
+    if (lifecycle) {
+        vSemaphoreDelete(lifecycle);
+    }
+    for (auto& wait : syncWaits) {
+        if (wait.done) {
+            vSemaphoreDelete(wait.done);
+        }
+    }
+}
+
+bool BusScheduler::start(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+    if (worker.isRunning()) {
+        return true;
+    }
+
+    // One worker per bus: synchronous calls are routed to it by the bus
+    if (!bus->setWorker(this)) {
+        MODBUSD_LOG_E("Bus %u already has a worker", bus->getId());
+        return false;
+    }
+
+    for (size_t cls = 0; cls < PRIORITY_CLASSES; cls++) {
+        QueueHandle_t& q = queues[cls];
+        if (!q) {
+            q = createQueue(MODBUS_SCHEDULER_QUEUE_DEPTH, queueStorage[cls]);
+            if (!q) {
+                MODBUSD_LOG_E("Failed to create scheduler queue");
+                bus->clearWorker(this);
+                return false;
+            }
+        }
+    }
+    if (!pending) {
+        pending = createCountingSemaphore(PRIORITY_CLASSES * MODBUS_SCHEDULER_QUEUE_DEPTH, 0, pendingStorage);
+    }
+    if (!lifecycle) {
+        lifecycle = createMutex(lifecycleStorage);
+    }
+    bool waitsReady = true;
+    for (auto& wait : syncWaits) {
+        if (!wait.done) {
+            wait.done = createBinarySemaphore(wait.doneStorage);
+        }
+        waitsReady = waitsReady && wait.done;
+    }
+    if (!pending || !lifecycle || !waitsReady) {
+        MODBUSD_LOG_E("Failed to create scheduler semaphore");
+        bus->clearWorker(this);
+        return false;
+    }
+
+    if (!worker.start("ModbusSched", taskEntry, this, stackSize, priority, core)) {
+        bus->clearWorker(this);
+        return false;
+    }
+
+    MODBUSD_LOG_I("Bus scheduler started on bus %u (core %d)", bus->getId(), (int)core);
+    return true;
+}
+
+void BusScheduler::stop() {
+    bool wasRunning = false;
+    if (lifecycle) {
+        // A submit() that saw the worker running has queued its job by now;
+        // the worker drains the queues after it sees the flag cleared
+        xSemaphoreTake(lifecycle, portMAX_DELAY);
+        wasRunning = worker.requestStop();
+        if (wasRunning) {
+            // New synchronous calls go back to the bus mutex path; the reply
+            // to a job still in flight keeps coming here
+            bus->retireWorker(this);
+            xSemaphoreGive(pending);  // Wake the worker
+        }
+        xSemaphoreGive(lifecycle);
+    }
+
+    // From a completion callback this returns at once and the worker exits
+    // after the current job; the next start() or stop() reaps it
+    worker.join();
+    bus->clearWorker(this);
+    if (wasRunning && !worker.isCurrentTask()) {
+        MODBUSD_LOG_I("Bus scheduler stopped");
+    }
+}
+
+ModbusResult<uint32_t> BusScheduler::submit(const Job& job) {
+    if (!worker.isRunning()) {
+        return ModbusResult<uint32_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    ModbusError err = validate(job);
+    if (err != ModbusError::SUCCESS) {
+        return ModbusResult<uint32_t>::error(err);
+    }
+
+    Job queued = job;
+    queued.id = nextJobId.fetch_add(1);
+    if (queued.id == 0) {
+        queued.id = nextJobId.fetch_add(1);  // 0 is reserved for "no job"
+    }
+
+    // Checked again under the lock stop() clears it with: a worker that is
+    // already past its final drain would leave the job queued forever
+    xSemaphoreTake(lifecycle, portMAX_DELAY);
+    if (!worker.isRunning()) {
+        xSemaphoreGive(lifecycle);
+        return ModbusResult<uint32_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+    if (xQueueSend(queues[classIndex(job.priority)], &queued, 0) != pdTRUE) {
+        xSemaphoreGive(lifecycle);
+        return ModbusResult<uint32_t>::error(ModbusError::QUEUE_FULL);
+    }
+    xSemaphoreGive(pending);
+    xSemaphoreGive(lifecycle);
+
+    return ModbusResult<uint32_t>::ok(queued.id);
+}
+
+size_t BusScheduler::getPendingCount() const {
+    size_t count = 0;
+    for (const auto& q : queues) {
+        if (q) {
+            count += uxQueueMessagesWaiting(q);
+        }
+    }
+    return count;
+}
+
+void BusScheduler::taskEntry(void* context) {
+    static_cast<BusScheduler*>(context)->run();
+}
+
+void BusScheduler::run() {
+    while (worker.isRunning()) {
+        if (xSemaphoreTake(pending, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (!worker.isRunning()) {
+            break;
+        }
+
+        Job job;
+        if (!takeNextJob(job)) {
+            continue;
+        }
+
+        if (!bus->acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, job.priority)) {
+            complete(job, ModbusError::MUTEX_ERROR, 0);
+            continue;
+        }
+
+        // Run queued jobs back to back; only the remaining inter-frame gap
+        // separates them. The burst limit lets direct callers in between,
+        // and a more urgent direct caller ends the burst early.
+        size_t burst = 0;
+        for (;;) {
+            execute(job);
+            burst++;
+
+            if (!worker.isRunning() || burst >= MODBUS_SCHEDULER_MAX_BURST) break;
+            if (bus->shouldYield(job.priority)) break;
+            if (xSemaphoreTake(pending, 0) != pdTRUE) break;
+            if (!takeNextJob(job)) break;
+        }
+
+        bus->releaseBusMutex();
+
+        // User callbacks run without the bus, so they may call the sync API
+        // (which takes the bus mutex from this task) or submit more jobs
+        for (size_t i = 0; i < finishedCount; i++) {
+            complete(finished[i].job, finished[i].error, finished[i].decoded);
+        }
+        finishedCount = 0;
+    }
+
+    // Fail whatever is still queued so no caller waits forever
+    Job job;
+    while (takeNextJob(job)) {
+        complete(job, ModbusError::NOT_INITIALIZED, 0);
+    }
+}
+
+bool BusScheduler::takeNextJob(Job& job) {
+    for (auto& q : queues) {
+        if (q && xQueueReceive(q, &job, 0) == pdTRUE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void BusScheduler::execute(Job& job) {
+    // A synchronous caller that gave up has withdrawn its buffers
+    if (job.callback == &syncComplete && !startSync(job)) {
+        finish(job, ModbusError::MUTEX_ERROR, 0);
+        return;
+    }
+
+    uint16_t* data = nullptr;
+    uint16_t singleValue = 0;
+    bool bitRead = false;
+
+    switch (job.functionCode) {
+        case 0x03:
+        case 0x04:
+            break;
+        case 0x01:
+        case 0x02:
+            bitRead = true;
+            break;
+        case 0x05:
+            singleValue = (job.bits[0] & 0x01) ? 1 : 0;
+            data = &singleValue;
+            break;
+        case 0x06:
+        case 0x10:
+            data = job.registers;
+            break;
+        case 0x0F: {
+            size_t words = (job.count + 15) / 16;
+            std::fill(coilWords, coilWords + words, 0);
+            for (uint16_t i = 0; i < job.count; i++) {
+                if (job.bits[i / 8] & (1 << (i % 8))) {
+                    coilWords[i / 16] |= (1 << (i % 16));
+                }
+            }
+            data = coilWords;
+            break;
+        }
+    }
+
+    // An open breaker fails the job without spending bus time on it
+    ModbusLinkPolicy* policy = job.device->linkPolicy;
+    if (policy && !policy->allowRequest(job.device->serverAddress)) {
+        finish(job, ModbusError::DEVICE_NOT_FOUND, 0);
+        return;
+    }
+
+    // 0 lets transactLocked() use the device's link policy timeout (or 1 s)
+    TickType_t timeout = job.timeoutMs ? pdMS_TO_TICKS(job.timeoutMs) : 0;
+
+    bus->waitInterFrameGap();
+    size_t decoded = 0;
+    ModbusError error = runInFlight(job, data, timeout, decoded);
+    bus->markFrameEnd();
+
+    if (bitRead) {
+        decoded = std::min<size_t>(decoded * 8, job.count);
+    }
+
+    finish(job, error, decoded);
+}
+
+void BusScheduler::finish(const Job& job, ModbusError error, size_t decoded) {
+    // Waking a synchronous caller is safe with the bus held; it only queues
+    // its next job. Everything else waits until the burst has released the bus.
+    if (!job.callback || job.callback == &syncComplete || finishedCount >= MODBUS_SCHEDULER_MAX_BURST) {
+        complete(job, error, decoded);
+        return;
+    }
+    Finished& entry = finished[finishedCount++];
+    entry.job = job;
+    entry.error = error;
+    entry.decoded = decoded;
+}
+
+ModbusError BusScheduler::runInFlight(const Job& job, uint16_t* data, TickType_t timeout, size_t& decoded) {
+    ModbusDevice* device = job.device;
+    const uint8_t address = device->serverAddress;
+    ModbusLinkPolicy* policy = device->linkPolicy;
+    const uint32_t wireUs =
+        policy ? ModbusPollBudget::estimateTransactionUs(job.functionCode, job.count, bus->getBaudRate()) : 0;
+    uint32_t rtuTimeoutMs = 0;   // 0 = the bus default
+    if (timeout == 0) {
+        rtuTimeoutMs = policy ? policy->getTimeoutMs(address, wireUs) : 0;
+        timeout = policy ? policy->getTimeout(address, wireUs) : pdMS_TO_TICKS(1000);
+    }
+
+    // Responses reach the worker through the bus address table
+    if (!bus->getDevice(address)) {
+        (void)device->registerDevice();
+    }
+
+    inFlightJob = &job;
+    inFlightDecoded = 0;
+    inFlightError = ModbusError::SUCCESS;
+    inFlightDevice.store(device, std::memory_order_relaxed);
+    inFlightFc.store(job.functionCode, std::memory_order_relaxed);
+    const uint32_t txn = device->newTransactionId();
+    inFlightTxn.store(txn, std::memory_order_relaxed);
+    inFlightId.store(job.id, std::memory_order_release);
+
+    // As in transactLocked(): the RTU gives up at the adaptive timeout too
+    if (rtuTimeoutMs) {
+        bus->setTransactionTimeout(rtuTimeoutMs);
+    }
+    const int64_t sendUs = esp_timer_get_time();
+    ModbusError error;
+    if (device->dispatchRequest(job.functionCode, job.address, job.count, job.priority, data, txn) != ESP_OK &&
+        releaseInFlight(job.id)) {
+        error = ModbusError::COMMUNICATION_ERROR;
+    } else {
+        error = waitInFlight(job.id, timeout);
+    }
+    if (rtuTimeoutMs) {
+        bus->setTransactionTimeout(0);
+    }
+    const uint32_t roundTripUs = static_cast<uint32_t>(esp_timer_get_time() - sendUs);
+
+    decoded = (error == ModbusError::SUCCESS) ? inFlightDecoded : 0;
+
+    // Same bookkeeping as ModbusDevice::transactLocked()
+    if (error == ModbusError::SUCCESS) {
+        device->successfulRequests++;
+    } else if (error == ModbusError::TIMEOUT) {
+        device->timeouts++;
+        device->lastError = ModbusError::TIMEOUT;
+    } else if (error == ModbusError::CRC_ERROR) {
+        device->crcErrors++;
+    }
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    device->recordLatency(LatencyPhase::ROUND_TRIP, roundTripUs);
+#endif
+#ifdef MODBUSDEVICE_TRACE
+    // Queue time is not arbitration; the worker already holds the bus
+    traceTransaction(TraceKind::SCHEDULED, bus->getId(), address, job.functionCode, job.address,
+                     job.count, error, static_cast<uint8_t>(job.priority), sendUs, 0, roundTripUs);
+#endif
+    if (policy) {
+        policy->recordResult(address, error,
+                             error == ModbusError::COMMUNICATION_ERROR ? 0 : roundTripUs, wireUs);
+    }
+    return error;
+}
+
+ModbusError BusScheduler::waitInFlight(uint32_t id, TickType_t timeout) {
+    const TickType_t start = xTaskGetTickCount();
+    bool claimed = false;  // The callback owns the result; its notification is on the way
+
+    for (;;) {
+        TickType_t wait = portMAX_DELAY;
+        if (!claimed) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            wait = (elapsed < timeout) ? timeout - elapsed : 0;
+        }
+
+        uint32_t value = 0;
+        if (xTaskNotifyWait(0, UINT32_MAX, &value, wait) == pdTRUE) {
+            if (value == id) {
+                return inFlightError;
+            }
+            continue;  // Not ours
+        }
+
+        if (!claimed) {
+            if (releaseInFlight(id)) {
+                return ModbusError::TIMEOUT;
+            }
+            claimed = true;
+        }
+    }
+}
+
+bool BusScheduler::releaseInFlight(uint32_t id) {
+    return inFlightId.compare_exchange_strong(id, 0, std::memory_order_acq_rel);
+}
+
+bool BusScheduler::completeResponse(ModbusDevice* device, uint32_t txn, uint8_t functionCode,
+                                    const uint8_t* data, size_t length) {
+    uint32_t id = inFlightId.load(std::memory_order_acquire);
+    if (id == 0 || inFlightDevice.load(std::memory_order_relaxed) != device ||
+        inFlightFc.load(std::memory_order_relaxed) != functionCode) {
+        return false;
+    }
+    if (txn != 0 && txn != inFlightTxn.load(std::memory_order_relaxed)) {
+        return false;  // Late frame of a transaction that already timed out
+    }
+
+    const bool read = functionCode <= 0x04;
+    if (read && (!data || length == 0)) {
+        return false;  // Not a usable reply; the worker keeps waiting
+    }
+    if (!inFlightId.compare_exchange_strong(id, 0, std::memory_order_acq_rel)) {
+        return false;  // The worker timed out first
+    }
+
+    const Job& job = *inFlightJob;
+    size_t n = 0;
+    if (functionCode == 0x03 || functionCode == 0x04) {
+        // Decode big-endian registers straight into the job buffer
+        n = std::min<size_t>(length / 2, job.count);
+        for (size_t i = 0; i < n; i++) {
+            job.registers[i] = (static_cast<uint16_t>(data[i * 2]) << 8) | data[i * 2 + 1];
+        }
+    } else if (read) {
+        // Modbus already packs bits LSB-first; copy as-is
+        n = std::min<size_t>(length, (job.count + 7) / 8);
+        std::memcpy(job.bits, data, n);
+    }
+    inFlightDecoded = n;
+    inFlightError = ModbusError::SUCCESS;
+
+    xTaskNotify(worker.getHandle(), id, eSetValueWithOverwrite);
+    return true;
+}
+
+bool BusScheduler::completeError(ModbusDevice* device, uint32_t txn, ModbusError error) {
+    // Error frames carry no FC or address: the device's FIFO names the transaction
+    uint32_t id = inFlightId.load(std::memory_order_acquire);
+    if (id == 0 || inFlightDevice.load(std::memory_order_relaxed) != device ||
+        (txn != 0 && txn != inFlightTxn.load(std::memory_order_relaxed))) {
+        return false;
+    }
+    if (!inFlightId.compare_exchange_strong(id, 0, std::memory_order_acq_rel)) {
+        return false;
+    }
+
+    inFlightError = error;
+    xTaskNotify(worker.getHandle(), id, eSetValueWithOverwrite);
+    return true;
+}
+
+ModbusError BusScheduler::runSync(Job job, size_t& decoded) {
+    const TickType_t start = xTaskGetTickCount();
+    const TickType_t deadline = pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS);
+
+    // A full queue or waiter table is back-pressure, not failure: retry for
+    // as long as a direct caller would have waited for the bus mutex
+    SyncWait* wait = nullptr;
+    ModbusResult<uint32_t> submitted = ModbusResult<uint32_t>::error(ModbusError::QUEUE_FULL);
+    for (;;) {
+        for (size_t i = 0; !wait && i < MODBUS_SCHEDULER_SYNC_WAITERS; i++) {
+            uint8_t expected = SYNC_FREE;
+            if (syncWaits[i].state.compare_exchange_strong(expected, SYNC_QUEUED)) {
+                wait = &syncWaits[i];
+            }
+        }
+        if (wait) {
+            job.callback = &BusScheduler::syncComplete;
+            job.context = wait;
+            job.notifyTask = nullptr;
+            submitted = submit(job);
+            if (!submitted.isOk()) {
+                wait->state.store(SYNC_FREE);
+                wait = nullptr;
+            }
+        }
+        if (submitted.isOk() || submitted.error() != ModbusError::QUEUE_FULL ||
+            xTaskGetTickCount() - start >= deadline) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    if (!submitted.isOk()) {
+        return submitted.error();
+    }
+
+    // Every queued job completes (response, timeout, or NOT_INITIALIZED on
+    // stop); the deadline only covers a worker that never gets to it.
+    // The slot's own semaphore: the caller's notifications stay untouched.
+    [[maybe_unused]] const uint32_t id = submitted.value();
+    for (;;) {
+        const TickType_t waited = xTaskGetTickCount() - start;
+        const bool queued = wait->state.load() == SYNC_QUEUED;
+        if (xSemaphoreTake(wait->done, !queued ? portMAX_DELAY
+                                               : (waited < deadline ? deadline - waited : 0)) == pdTRUE) {
+            break;
+        }
+        uint8_t expected = SYNC_QUEUED;
+        if (queued && xTaskGetTickCount() - start >= deadline &&
+            wait->state.compare_exchange_strong(expected, SYNC_ABANDONED)) {
+            MODBUSD_LOG_W("Bus %u worker did not start job %lu in time", bus->getId(), (unsigned long)id);
+            return ModbusError::MUTEX_ERROR;   // The worker frees the slot
+        }
+    }
+
+    decoded = wait->decoded;
+    const ModbusError error = wait->error;
+    wait->state.store(SYNC_FREE);
+    return error;
+}
+
+bool BusScheduler::startSync(const Job& job) {
+    auto* wait = static_cast<SyncWait*>(job.context);
+    uint8_t expected = SYNC_QUEUED;
+    return wait->state.compare_exchange_strong(expected, SYNC_RUNNING);
+}
+
+void BusScheduler::syncComplete(const Completion& completion) {
+    auto* wait = static_cast<SyncWait*>(completion.context);
+    wait->error = completion.error;
+    wait->decoded = completion.decoded;
+
+    // Queued (drained on stop) or running; the waiter may have withdrawn a queued job
+    uint8_t state = wait->state.load();
+    do {
+        if (state == SYNC_ABANDONED) {
+            wait->state.store(SYNC_FREE);
+            return;
+        }
+    } while (!wait->state.compare_exchange_weak(state, SYNC_DONE));
+
+    // The waiter frees the slot once it has the result; the semaphore outlives it
+    xSemaphoreGive(wait->done);
+}
+
+void BusScheduler::complete(const Job& job, ModbusError error, size_t decoded) {
+    if (job.callback) {
+        Completion completion;
+        completion.jobId = job.id;
+        completion.device = job.device;
+        completion.functionCode = job.functionCode;
+        completion.address = job.address;
+        completion.count = job.count;
+        completion.error = error;
+        completion.decoded = decoded;
+        completion.context = job.context;
+        job.callback(completion);
+    } else if (job.notifyTask) {
+        xTaskNotify(job.notifyTask, static_cast<uint32_t>(error), eSetValueWithOverwrite);
+    }
+}
+
+size_t BusScheduler::classIndex(esp32Modbus::ModbusPriority priority) {
+    switch (priority) {
+        case esp32Modbus::EMERGENCY: return 0;
+        case esp32Modbus::SENSOR:    return 1;
+        case esp32Modbus::RELAY:     return 2;
+        case esp32Modbus::STATUS:    return 3;
+        default:                     return 2;
+    }
+}
+
+ModbusError BusScheduler::validate(const Job& job) const {
+    if (!job.device) {
+        return ModbusError::NULL_POINTER;
+    }
+    if (&job.device->getBus() != bus) {
+        return ModbusError::INVALID_PARAMETER;
+    }
+
+    switch (job.functionCode) {
+        case 0x03:
+        case 0x04:
+            if (job.count == 0 || job.count > MODBUS_MAX_REGISTER_COUNT) return ModbusError::INVALID_PARAMETER;
+            if (!job.registers) return ModbusError::NULL_POINTER;
+            if (job.capacity < job.count) return ModbusError::INVALID_DATA_LENGTH;
+            return ModbusError::SUCCESS;
+
+        case 0x06:
+            if (job.count != 1) return ModbusError::INVALID_PARAMETER;
+            if (!job.registers) return ModbusError::NULL_POINTER;
+            return ModbusError::SUCCESS;
+
+        case 0x10:
+            if (job.count == 0 || job.count > MODBUS_MAX_WRITE_REGISTER_COUNT) return ModbusError::INVALID_PARAMETER;
+            if (!job.registers) return ModbusError::NULL_POINTER;
+            if (job.capacity < job.count) return ModbusError::INVALID_DATA_LENGTH;
+            return ModbusError::SUCCESS;
+
+        case 0x01:
+        case 0x02:
+            if (job.count == 0 || job.count > MODBUS_MAX_COIL_COUNT) return ModbusError::INVALID_PARAMETER;
+            if (!job.bits) return ModbusError::NULL_POINTER;
+            if (job.capacity < static_cast<size_t>((job.count + 7) / 8)) return ModbusError::INVALID_DATA_LENGTH;
+            return ModbusError::SUCCESS;
+
+        case 0x05:
+            if (job.count != 1) return ModbusError::INVALID_PARAMETER;
+            if (!job.bits) return ModbusError::NULL_POINTER;
+            return ModbusError::SUCCESS;
+
+        case 0x0F:
+            if (job.count == 0 || job.count > MODBUS_MAX_WRITE_COIL_COUNT) return ModbusError::INVALID_PARAMETER;
+            if (!job.bits) return ModbusError::NULL_POINTER;
+            if (job.capacity < static_cast<size_t>((job.count + 7) / 8)) return ModbusError::INVALID_DATA_LENGTH;
+            return ModbusError::SUCCESS;
+
+        default:
+            return ModbusError::NOT_SUPPORTED;
+    }
+}
+
+} // namespace modbus
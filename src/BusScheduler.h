@@ -0,0 +1,312 @@
+/*
+ * BusScheduler.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef BUSSCHEDULER_H
+#define BUSSCHEDULER_H
+
+/**
+ * @file BusScheduler.h
+ * @brief Dispatcher task that owns one Modbus bus
+ *
+ * Instead of every caller taking the bus mutex for a whole round trip and
+ * sleeping the inter-frame delay before releasing it, callers submit jobs
+ * and one worker task issues them back to back, waiting only for the part
+ * of the 3.5 character gap that has not yet elapsed (see
+ * ModbusBus::waitInterFrameGap()).
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <esp32ModbusRTU.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+#include "ModbusTask.h"
+
+// Jobs per priority class the scheduler can hold
+#ifndef MODBUS_SCHEDULER_QUEUE_DEPTH
+#define MODBUS_SCHEDULER_QUEUE_DEPTH 16
+#endif
+
+// Max jobs run back to back before the bus mutex is released to direct callers
+#ifndef MODBUS_SCHEDULER_MAX_BURST
+#define MODBUS_SCHEDULER_MAX_BURST 16
+#endif
+
+#ifndef MODBUS_SCHEDULER_STACK_SIZE
+#define MODBUS_SCHEDULER_STACK_SIZE 4096
+#endif
+
+#ifndef MODBUS_SCHEDULER_TASK_PRIORITY
+#define MODBUS_SCHEDULER_TASK_PRIORITY 5
+#endif
+
+// Core the worker is pinned to (tskNO_AFFINITY = let the scheduler pick)
+#ifndef MODBUS_SCHEDULER_CORE
+#define MODBUS_SCHEDULER_CORE tskNO_AFFINITY
+#endif
+
+// Synchronous callers that can wait on the worker at the same time
+#ifndef MODBUS_SCHEDULER_SYNC_WAITERS
+#define MODBUS_SCHEDULER_SYNC_WAITERS 8
+#endif
+
+namespace modbus {
+
+class ModbusBus;
+class ModbusDevice;
+
+/**
+ * @class BusScheduler
+ * @brief Dispatches Modbus jobs for all devices on one bus
+ *
+ * Jobs are queued per esp32Modbus::ModbusPriority class and served strictly
+ * by priority (EMERGENCY first), FIFO within a class. The worker holds the
+ * bus mutex across a burst of jobs, so devices that are not driven by the
+ * scheduler keep working unchanged and simply wait for the burst to end.
+ *
+ * Results are delivered either through Job::callback (called from the
+ * scheduler task once the burst has released the bus, so a callback may
+ * use the synchronous ModbusDevice API) or, when no callback is set, by
+ * notifying Job::notifyTask with the resulting ModbusError as notification
+ * value.
+ *
+ * Buffers referenced by a job must stay valid until it completes.
+ *
+ * A scheduler serves one ModbusBus; jobs for devices bound to another bus
+ * are rejected. Run one scheduler per bus to drive several UARTs in parallel.
+ *
+ * While running, the scheduler is the bus worker: synchronous ModbusDevice
+ * calls on its bus are queued as jobs instead of taking the bus mutex, and
+ * block on a binary semaphore of the scheduler's until the worker completes
+ * their job; the caller's task notifications are left alone. The RTU
+ * callback hands each response straight to the worker by transaction id,
+ * so no per-device semaphore or mutex is involved and a
+ * contended lock can no longer drop a response. Pin the worker to the
+ * protocol core with start()'s core argument.
+ *
+ * @code
+ * static BusScheduler scheduler;
+ * scheduler.start();
+ *
+ * uint16_t regs[4];
+ * BusScheduler::Job job;
+ * job.device = &sensor;
+ * job.functionCode = 0x03;
+ * job.address = 0x0010;
+ * job.count = 4;
+ * job.registers = regs;
+ * job.capacity = 4;
+ * job.priority = esp32Modbus::SENSOR;
+ * job.notifyTask = xTaskGetCurrentTaskHandle();
+ * if (scheduler.submit(job).isOk()) {
+ *     uint32_t err;
+ *     xTaskNotifyWait(0, 0, &err, portMAX_DELAY);
+ * }
+ * @endcode
+ */
+class BusScheduler {
+public:
+    /**
+     * @struct Completion
+     * @brief Outcome of a job, passed to Job::callback
+     */
+    struct Completion {
+        uint32_t jobId = 0;
+        ModbusDevice* device = nullptr;
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        ModbusError error = ModbusError::SUCCESS;
+        size_t decoded = 0;        ///< Registers or coils decoded into the job buffer
+        void* context = nullptr;   ///< Job::context
+    };
+
+    using Callback = void (*)(const Completion& completion);
+
+    /**
+     * @struct Job
+     * @brief One read or write transaction
+     *
+     * Register functions (0x03, 0x04, 0x06, 0x10) use `registers`; bit
+     * functions (0x01, 0x02, 0x05, 0x0F) use `bits` as a packed bitset
+     * (bit i = bits[i / 8] >> (i % 8)). For reads the buffer is the
+     * destination, for writes the source; `capacity` is in registers or
+     * bytes respectively.
+     */
+    struct Job {
+        ModbusDevice* device = nullptr;   ///< Target device (provides address + routing)
+        uint8_t functionCode = 0x03;
+        uint16_t address = 0;
+        uint16_t count = 1;
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY;
+        uint16_t* registers = nullptr;
+        uint8_t* bits = nullptr;
+        size_t capacity = 0;
+        uint32_t timeoutMs = 0;           ///< Response timeout, 0 = device default
+        Callback callback = nullptr;
+        void* context = nullptr;
+        TaskHandle_t notifyTask = nullptr;
+        uint32_t id = 0;                  ///< Assigned by submit()
+    };
+
+    /**
+     * @brief Create a scheduler for a bus
+     * @param bus Bus to serve, or nullptr for ModbusRegistry::getDefaultBus()
+     */
+    explicit BusScheduler(ModbusBus* bus = nullptr);
+    ~BusScheduler();
+
+    BusScheduler(const BusScheduler&) = delete;
+    BusScheduler& operator=(const BusScheduler&) = delete;
+
+    /**
+     * @brief Create queues and start the worker task
+     * @param stackSize Worker stack size in bytes
+     * @param priority Worker task priority
+     * @param core Core to pin the worker to, or tskNO_AFFINITY
+     * @return true if the scheduler is running (false if the bus already has a worker)
+     */
+    bool start(uint32_t stackSize = MODBUS_SCHEDULER_STACK_SIZE,
+               UBaseType_t priority = MODBUS_SCHEDULER_TASK_PRIORITY,
+               BaseType_t core = MODBUS_SCHEDULER_CORE);
+
+    /**
+     * @brief Stop the worker; queued jobs complete with NOT_INITIALIZED
+     */
+    void stop();
+
+    bool isRunning() const { return worker.isRunning(); }
+
+    ModbusBus& getBus() const { return *bus; }
+
+    /**
+     * @brief Whether the calling task is this scheduler's worker
+     */
+    bool isWorkerTask() const { return worker.isCurrentTask(); }
+
+    /**
+     * @brief Queue a job
+     * @param job Job description (copied)
+     * @return Result containing the job id, or error
+     */
+    [[nodiscard]] ModbusResult<uint32_t> submit(const Job& job);
+
+    /**
+     * @brief Number of jobs waiting in all priority queues
+     */
+    size_t getPendingCount() const;
+
+private:
+    friend class ModbusBus;
+    friend class ModbusDevice;
+
+    static constexpr size_t PRIORITY_CLASSES = 4;
+
+    static void taskEntry(void* context);
+    void run();
+    bool takeNextJob(Job& job);
+    void execute(Job& job);
+    void finish(const Job& job, ModbusError error, size_t decoded);
+    void complete(const Job& job, ModbusError error, size_t decoded);
+    static size_t classIndex(esp32Modbus::ModbusPriority priority);
+
+    // Worker side of one transaction (bus mutex held)
+    ModbusError runInFlight(const Job& job, uint16_t* data, TickType_t timeout, size_t& decoded);
+    ModbusError waitInFlight(uint32_t id, TickType_t timeout);
+    bool releaseInFlight(uint32_t id);
+
+    // RTU callback side; true if the frame finished the in-flight transaction
+    // txn is the device's transaction id of the frame, 0 if it was not recorded
+    bool completeResponse(ModbusDevice* device, uint32_t txn, uint8_t functionCode,
+                          const uint8_t* data, size_t length);
+    bool completeError(ModbusDevice* device, uint32_t txn, ModbusError error);
+
+    /**
+     * @brief Queue a job for a synchronous caller and block until it completes
+     *
+     * A job the worker has not started within MODBUS_MUTEX_TIMEOUT_MS is
+     * withdrawn and fails with MUTEX_ERROR, like a direct caller that did not
+     * get the bus. Once started it runs to completion: it writes the
+     * caller's buffers, so the caller waits for it.
+     *
+     * @param job Job description (callback/context are overwritten)
+     * @param decoded Registers or bytes decoded into the job buffer
+     * @return Job result
+     */
+    ModbusError runSync(Job job, size_t& decoded);
+    static void syncComplete(const Completion& completion);
+    static bool startSync(const Job& job);
+    ModbusError validate(const Job& job) const;
+
+    ModbusBus* bus;
+    SemaphoreHandle_t lifecycle = nullptr;   ///< Orders submit() against stop(): no job is queued after the final drain
+    SemaphoreStorage lifecycleStorage;
+    QueueHandle_t queues[PRIORITY_CLASSES] = {};
+    SemaphoreHandle_t pending = nullptr;   ///< Counts queued jobs, wakes the worker
+    QueueStorage<MODBUS_SCHEDULER_QUEUE_DEPTH, sizeof(Job)> queueStorage[PRIORITY_CLASSES];
+    SemaphoreStorage pendingStorage;
+    ModbusTask<MODBUS_SCHEDULER_STACK_SIZE> worker;
+    std::atomic<uint32_t> nextJobId{1};
+
+    // Transaction the worker waits for. The RTU callback claims it by swapping
+    // inFlightId to 0 and the worker does the same on timeout, so exactly one
+    // side finishes it. inFlightJob is only read by the side that claimed it.
+    std::atomic<uint32_t> inFlightId{0};
+    std::atomic<ModbusDevice*> inFlightDevice{nullptr};
+    std::atomic<uint8_t> inFlightFc{0};
+    std::atomic<uint32_t> inFlightTxn{0};   ///< Device transaction id of the frame
+    const Job* inFlightJob = nullptr;
+    size_t inFlightDecoded = 0;
+    ModbusError inFlightError = ModbusError::SUCCESS;
+
+    // Jobs of the current burst whose callbacks run once the bus is released
+    struct Finished {
+        Job job;
+        ModbusError error;
+        size_t decoded;
+    };
+    Finished finished[MODBUS_SCHEDULER_MAX_BURST];
+    size_t finishedCount = 0;
+
+    // Where a synchronous caller waits. Owned by the scheduler, not the
+    // caller's stack, so a caller that withdrew its job leaves the slot to
+    // the worker, which frees it when it dequeues the job.
+    enum SyncState : uint8_t { SYNC_FREE, SYNC_QUEUED, SYNC_RUNNING, SYNC_DONE, SYNC_ABANDONED };
+    struct SyncWait {
+        std::atomic<uint8_t> state{SYNC_FREE};
+        SemaphoreHandle_t done = nullptr;   ///< Given once the job is SYNC_DONE
+        SemaphoreStorage doneStorage;
+        ModbusError error = ModbusError::SUCCESS;
+        size_t decoded = 0;
+    };
+    SyncWait syncWaits[MODBUS_SCHEDULER_SYNC_WAITERS];
+
+    // FC0F source packed from Job::bits into the word layout sendRequest expects
+    uint16_t coilWords[(MODBUS_MAX_WRITE_COIL_COUNT + 15) / 16] = {};
+};
+
+} // namespace modbus
+
+#endif // BUSSCHEDULER_H
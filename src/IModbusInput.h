@@ -25,6 +25,7 @@
 #include <cstdint>
 #include <vector>
 #include "ModbusTypes.h"
+#include "ModbusSubscription.h"
 
 namespace modbus {
 
@@ -135,6 +136,60 @@ public:
      * @return true if range is defined
      */
     virtual bool getRange(size_t channel, float& min, float& max) const = 0;
+
+    /**
+     * @brief Be notified when a channel moves by at least a deadband
+     *
+     * The callback runs on the task that lands new data (update() or the
+     * async response handler). The first value is reported with
+     * ChangeEvent::initial set unless reportInitial is false.
+     * @return Handle for unsubscribe(); QUEUE_FULL once MODBUS_SUBSCRIPTION_MAX are in use
+     */
+    ModbusResult<uint32_t> subscribe(size_t channel, const Deadband& deadband,
+                                     ChangeCallback callback, void* context = nullptr,
+                                     bool reportInitial = true) {
+        if (channel > UINT16_MAX) {
+            return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+        }
+        SubscriptionTable::Target target;
+        target.callback = callback;
+        target.context = context;
+        return subscriptions.addAnalog(static_cast<uint16_t>(channel), deadband, target, reportInitial);
+    }
+
+    /**
+     * @brief Same, posting a ChangeEvent to `queue` (item size sizeof(ChangeEvent)) without waiting
+     */
+    ModbusResult<uint32_t> subscribe(size_t channel, const Deadband& deadband, QueueHandle_t queue,
+                                     bool reportInitial = true) {
+        if (channel > UINT16_MAX) {
+            return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+        }
+        SubscriptionTable::Target target;
+        target.queue = queue;
+        return subscriptions.addAnalog(static_cast<uint16_t>(channel), deadband, target, reportInitial);
+    }
+
+    bool unsubscribe(uint32_t handle) { return subscriptions.remove(handle); }
+
+    /**
+     * @brief Change events dropped because a subscriber queue was full
+     */
+    uint32_t getDroppedChangeEvents() const { return subscriptions.getDropped(); }
+
+protected:
+    /**
+     * @brief Hand a freshly read, scaled value to the subscribers of `channel`
+     *
+     * Implementations call this whenever new data lands; it returns at once
+     * when nobody is subscribed.
+     */
+    void publishValue(size_t channel, float value) {
+        subscriptions.publishAnalog(this, static_cast<uint16_t>(channel), value);
+    }
+
+private:
+    LazySubscriptionTable subscriptions;  ///< Created by the first subscribe()
 };
 
 /**
@@ -143,6 +198,10 @@ public:
  * 
  * Provides convenient methods for devices that read digital states
  * like switches, alarms, status bits, etc.
+ *
+ * No class in this library implements it, so edge subscriptions only fire
+ * if the implementation calls publishState() for every channel it reads,
+ * each time new states land (update() or onAsyncResponse()).
  */
 class IModbusDigitalInput : public IModbusInput {
 public:
@@ -172,6 +231,59 @@ public:
      * @return Vector of active alarm/error codes
      */
     virtual std::vector<uint16_t> getActiveAlarms() const = 0;
+
+    /**
+     * @brief Be notified on rising and/or falling edges of a channel
+     *
+     * Runs on the task that lands new data; the first state is reported with
+     * ChangeEvent::initial set unless reportInitial is false.
+     * @return Handle for unsubscribe(); QUEUE_FULL once MODBUS_SUBSCRIPTION_MAX are in use
+     */
+    ModbusResult<uint32_t> subscribe(size_t channel, Edge edge, ChangeCallback callback,
+                                     void* context = nullptr, bool reportInitial = true) {
+        if (channel > UINT16_MAX) {
+            return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+        }
+        SubscriptionTable::Target target;
+        target.callback = callback;
+        target.context = context;
+        return subscriptions.addDigital(static_cast<uint16_t>(channel), edge, target, reportInitial);
+    }
+
+    /**
+     * @brief Same, posting a ChangeEvent to `queue` (item size sizeof(ChangeEvent)) without waiting
+     */
+    ModbusResult<uint32_t> subscribe(size_t channel, Edge edge, QueueHandle_t queue,
+                                     bool reportInitial = true) {
+        if (channel > UINT16_MAX) {
+            return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+        }
+        SubscriptionTable::Target target;
+        target.queue = queue;
+        return subscriptions.addDigital(static_cast<uint16_t>(channel), edge, target, reportInitial);
+    }
+
+    bool unsubscribe(uint32_t handle) { return subscriptions.remove(handle); }
+
+    /**
+     * @brief Change events dropped because a subscriber queue was full
+     */
+    uint32_t getDroppedChangeEvents() const { return subscriptions.getDropped(); }
+
+protected:
+    /**
+     * @brief Hand a freshly read state to the subscribers of `channel`
+     *
+     * Implementations must call this for each channel whenever new states
+     * land; nothing else feeds digital subscribers. It returns at once when
+     * nobody is subscribed.
+     */
+    void publishState(size_t channel, bool state) {
+        subscriptions.publishDigital(this, static_cast<uint16_t>(channel), state);
+    }
+
+private:
+    LazySubscriptionTable subscriptions;  ///< Created by the first subscribe()
 };
 
 } // namespace modbus
@@ -23,6 +23,7 @@
 #define ISENSORINSTANCE_H
 
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 
 /**
  * @brief Interface for sensor instances that provide data acquisition
@@ -99,6 +100,22 @@ public:
      * @return SemaphoreHandle_t the mutex handle, or nullptr if not available
      */
     virtual SemaphoreHandle_t getMutexInstance() const = 0;
+
+    /**
+     * @brief Signal request completion through an event group bit
+     *
+     * Optional. A sensor that supports it sets @p bit in @p group once the
+     * request started by requestData() has completed or failed, so that
+     * waitForData() no longer blocks. modbus::SensorGroup uses this to wait
+     * for many sensors at once; passing nullptr detaches the sensor again.
+     *
+     * @return true if the sensor will set the bit, false if unsupported
+     */
+    virtual bool setDataReadyEvent(EventGroupHandle_t group, EventBits_t bit) {
+        (void)group;
+        (void)bit;
+        return false;
+    }
 };
 
 #endif // ISENSORINSTANCE_H
@@ -0,0 +1,902 @@
+/*
+ * ModbusBus.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusBus.h"
+#include "BusScheduler.h"
+#include "ModbusBusScanner.h"
+#include "ModbusDevice.h"
+#include "ModbusDeviceLogging.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusPollBudget.h"
+#include "ModbusRegisterCache.h"
+#include "ModbusRegistry.h"
+#include "ModbusTrace.h"
+#include "MutexGuard.h"
+#include <esp_timer.h>
+#include <algorithm>
+#include <utility>
+
+namespace modbus {
+
+namespace {
+
+// esp32ModbusRTU takes plain function pointers, so each bus gets its own
+// pair of handlers that forwards to the bus with the matching id.
+template<size_t Id>
+void busDataHandler(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
+                    uint16_t startingAddress, const uint8_t* data, size_t length) {
+    ModbusRegistry::getInstance().getBus(Id)->handleData(serverAddress, fc, startingAddress, data, length);
+}
+
+template<size_t Id>
+void busErrorHandler(uint8_t serverAddress, esp32Modbus::Error error) {
+    ModbusRegistry::getInstance().getBus(Id)->handleError(serverAddress, error);
+}
+
+using DataHandler = void (*)(uint8_t, esp32Modbus::FunctionCode, uint16_t, const uint8_t*, size_t);
+using ErrorHandler = void (*)(uint8_t, esp32Modbus::Error);
+
+template<size_t... Ids>
+constexpr void fillHandlers(DataHandler* data, ErrorHandler* error, std::index_sequence<Ids...>) {
+    ((data[Ids] = &busDataHandler<Ids>, error[Ids] = &busErrorHandler<Ids>), ...);
+}
+
+struct HandlerTable {
+    DataHandler data[MODBUS_MAX_BUSES] = {};
+    ErrorHandler error[MODBUS_MAX_BUSES] = {};
+
+    constexpr HandlerTable() {
+        fillHandlers(data, error, std::make_index_sequence<MODBUS_MAX_BUSES>{});
+    }
+};
+
+constexpr HandlerTable handlers;
+
+static_assert(ModbusBus::PRIORITY_CLASSES == 4, "one latency budget macro per esp32Modbus::ModbusPriority");
+
+// Marks the calling task as the RTU task for the duration of one frame
+class DeliveryScope {
+public:
+    explicit DeliveryScope(std::atomic<TaskHandle_t>& task)
+        : task_(task), previous_(task.exchange(xTaskGetCurrentTaskHandle())) {}
+    ~DeliveryScope() { task_.store(previous_); }
+
+private:
+    std::atomic<TaskHandle_t>& task_;
+    TaskHandle_t previous_;
+};
+
+} // namespace
+
+ModbusBus::ModbusBus() {
+    mutex_ = createMutex(mutexStorage_);
+    if (!mutex_) {
+        MODBUSD_LOG_E("Failed to create ModbusBus mutex");
+        return;
+    }
+
+    busMutex_ = createMutex(busMutexStorage_);
+    if (!busMutex_) {
+        MODBUSD_LOG_E("Failed to create ModbusBus bus mutex");
+        vSemaphoreDelete(mutex_);
+        mutex_ = nullptr;
+        return;
+    }
+
+    // A bus without its arbiter fails acquireBusMutex() cleanly
+    arbiterLock_ = createMutex(arbiterLockStorage_);
+    bool created = arbiterLock_ != nullptr;
+    for (size_t cls = 0; cls < PRIORITY_CLASSES; cls++) {
+        grant_[cls] = createBinarySemaphore(grantStorage_[cls]);
+        created = created && grant_[cls];
+    }
+    if (!created) {
+        MODBUSD_LOG_E("Failed to create ModbusBus arbiter");
+        if (arbiterLock_) {
+            vSemaphoreDelete(arbiterLock_);
+            arbiterLock_ = nullptr;
+        }
+    }
+
+    broadcastDone_ = createBinarySemaphore(broadcastDoneStorage_);
+    if (!broadcastDone_) {
+        MODBUSD_LOG_E("Failed to create ModbusBus broadcast semaphore");
+    }
+}
+
+ModbusBus::~ModbusBus() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+    if (busMutex_) {
+        vSemaphoreDelete(busMutex_);
+    }
+    if (arbiterLock_) {
+        vSemaphoreDelete(arbiterLock_);
+    }
+    for (auto grant : grant_) {
+        if (grant) {
+            vSemaphoreDelete(grant);
+        }
+    }
+    if (broadcastDone_) {
+        vSemaphoreDelete(broadcastDone_);
+    }
+}
+
+void ModbusBus::setModbusRTU(esp32ModbusRTU* rtu) {
+    modbusRTU_.store(rtu, std::memory_order_release);
+    MODBUSD_LOG_I("ModbusRTU instance set on bus %u", id_);
+}
+
+void ModbusBus::attach(esp32ModbusRTU& rtu) {
+    rtu.onData(handlers.data[id_]);
+    rtu.onError(handlers.error[id_]);
+    setModbusRTU(&rtu);
+}
+
+bool ModbusBus::registerDevice(uint8_t address, ModbusDevice* device) {
+    if (!device || address == 0 || address > MODBUS_MAX_SLAVE_ADDRESS) {
+        return false;
+    }
+
+    if (!mutex_) {
+        MODBUSD_LOG_E("Bus %u registry mutex not initialized", id_);
+        return false;
+    }
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) {
+        return false;
+    }
+
+    // Writers are serialized by the mutex; readers only see the atomic slot
+    ModbusDevice* previous = devices_[address].exchange(device, std::memory_order_acq_rel);
+    if (!previous) {
+        deviceCount_.fetch_add(1, std::memory_order_relaxed);
+    }
+    MODBUSD_LOG_I("Device registered at address %d on bus %u", address, id_);
+    return true;
+}
+
+bool ModbusBus::unregisterDevice(uint8_t address) {
+    if (address == 0 || address > MODBUS_MAX_SLAVE_ADDRESS || !mutex_) {
+        return false;
+    }
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) {
+        return false;
+    }
+
+    if (devices_[address].exchange(nullptr, std::memory_order_acq_rel)) {
+        deviceCount_.fetch_sub(1, std::memory_order_relaxed);
+        MODBUSD_LOG_I("Device unregistered from address %d on bus %u", address, id_);
+        return true;
+    }
+
+    return false;
+}
+
+bool ModbusBus::unregisterDevice(uint8_t address, ModbusDevice* device) {
+    if (!device || address == 0 || address > MODBUS_MAX_SLAVE_ADDRESS || !mutex_) {
+        return false;
+    }
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) {
+        return false;
+    }
+
+    // Leave the slot alone if another device took the address since
+    ModbusDevice* expected = device;
+    if (devices_[address].compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel)) {
+        deviceCount_.fetch_sub(1, std::memory_order_relaxed);
+        MODBUSD_LOG_I("Device unregistered from address %d on bus %u", address, id_);
+        return true;
+    }
+
+    return false;
+}
+
+ModbusDevice* ModbusBus::getDevice(uint8_t address) const noexcept {
+    if (address == 0 || address > MODBUS_MAX_SLAVE_ADDRESS) {
+        return nullptr;
+    }
+    return devices_[address].load(std::memory_order_acquire);
+}
+
+size_t ModbusBus::classOf(esp32Modbus::ModbusPriority priority) noexcept {
+    size_t cls = static_cast<size_t>(priority);
+    return (cls < PRIORITY_CLASSES) ? cls : PRIORITY_CLASSES - 1;
+}
+
+bool ModbusBus::acquireBusMutex(uint32_t timeoutMs, esp32Modbus::ModbusPriority priority) {
+    if (!busMutex_ || !arbiterLock_) {
+        MODBUSD_LOG_E("Bus %u mutex not initialized", id_);
+        return false;
+    }
+
+    const size_t cls = classOf(priority);
+    const TickType_t timeout = pdMS_TO_TICKS(timeoutMs);
+    const TickType_t startTick = xTaskGetTickCount();
+    const int64_t startUs = esp_timer_get_time();
+
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    const bool contended = busy_;
+    if (!contended) {
+        busy_ = true;
+    } else if (waiting_[cls]++ == 0) {
+        waitingSince_[cls] = startTick;
+    }
+    xSemaphoreGive(arbiterLock_);
+
+    if (contended) {
+        bool granted = xSemaphoreTake(grant_[cls], timeout) == pdTRUE;
+        if (!granted) {
+            // The releaser may have picked this class just as the wait expired;
+            // it already dequeued us then, so take the grant instead of leaking it
+            xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+            granted = xSemaphoreTake(grant_[cls], 0) == pdTRUE;
+            if (!granted) {
+                if (--waiting_[cls] == 0) {
+                    waitingSince_[cls] = 0;
+                }
+                stats_[cls].timeouts++;
+            }
+            xSemaphoreGive(arbiterLock_);
+        }
+        if (!granted) {
+            MODBUSD_LOG_W("Bus %u arbiter timeout after %lu ms (priority %u)", id_,
+                          (unsigned long)timeoutMs, (unsigned)cls);
+            return false;
+        }
+    }
+
+    // The bus is ours; the mutex is only contended by direct getBusMutex() users
+    const TickType_t elapsed = xTaskGetTickCount() - startTick;
+    if (xSemaphoreTake(busMutex_, elapsed < timeout ? timeout - elapsed : 0) != pdTRUE) {
+        MODBUSD_LOG_W("Bus %u mutex timeout after %lu ms", id_, (unsigned long)timeoutMs);
+        passOwnership();
+        return false;
+    }
+
+    const uint64_t waitUs = static_cast<uint64_t>(esp_timer_get_time() - startUs);
+    grantWaitUs_ = static_cast<uint32_t>(waitUs);
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    ArbiterStats& stats = stats_[cls];
+    stats.grants++;
+    stats.totalWaitUs += waitUs;
+    if (contended) {
+        stats.contended++;
+    }
+    if (waitUs > stats.maxWaitUs) {
+        stats.maxWaitUs = static_cast<uint32_t>(waitUs);
+    }
+    if (budgetMs_[cls] != 0 && waitUs > static_cast<uint64_t>(budgetMs_[cls]) * 1000) {
+        stats.budgetMisses++;
+    }
+    xSemaphoreGive(arbiterLock_);
+
+    // PRECISE timing: the previous holder only recorded when its frame ended,
+    // so wait out whatever is left of the gap before our frame goes out.
+    // A broadcast's turnaround is waited out the same way in either mode.
+    if (interFrameTiming_ == InterFrameTiming::PRECISE || quietUntilUs_ != 0) {
+        waitInterFrameGap();
+    }
+    heldSinceUs_ = esp_timer_get_time();
+    return true;
+}
+
+void ModbusBus::releaseBusMutex() noexcept {
+    if (!busMutex_ || !arbiterLock_) {
+        return;
+    }
+    busyUs_ += static_cast<uint32_t>(esp_timer_get_time() - heldSinceUs_);
+    if (interFrameTiming_ == InterFrameTiming::PRECISE) {
+        // Record the frame end; the next acquirer waits only the remaining gap
+        markFrameEnd();
+    } else {
+        // Enforce Modbus RTU inter-frame delay (3.5 character times) before releasing.
+        // This prevents bus collisions when another device immediately acquires the mutex.
+        // Without this delay, the next transmission may start before the bus has settled.
+        vTaskDelay(pdMS_TO_TICKS(interFrameDelayMs_.load()));
+    }
+    xSemaphoreGive(busMutex_);
+    passOwnership();
+}
+
+void ModbusBus::passOwnership() noexcept {
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    const TickType_t now = xTaskGetTickCount();
+    int cls = selectClass(now);
+    if (cls < 0) {
+        busy_ = false;
+    } else {
+        // busy_ stays set: ownership moves straight to one waiter of the class
+        waitingSince_[cls] = (--waiting_[cls] != 0) ? now : 0;
+        xSemaphoreGive(grant_[cls]);
+    }
+    xSemaphoreGive(arbiterLock_);
+}
+
+// Lower rank is served first: overdue classes, then aged priority, then priority
+uint32_t ModbusBus::rankOf(size_t cls, TickType_t now) const noexcept {
+    const uint32_t waitedMs = static_cast<uint32_t>(now - waitingSince_[cls]) * portTICK_PERIOD_MS;
+    const bool overdue = budgetMs_[cls] != 0 && waitedMs >= budgetMs_[cls];
+    const uint32_t aging = agingMs_;
+    const uint32_t aged = aging ? std::min<uint32_t>(cls, waitedMs / aging) : 0;
+    const uint32_t effective = static_cast<uint32_t>(cls) - aged;
+    return (overdue ? 0 : PRIORITY_CLASSES * PRIORITY_CLASSES) + effective * PRIORITY_CLASSES + cls;
+}
+
+int ModbusBus::selectClass(TickType_t now) const noexcept {
+    int best = -1;
+    uint32_t bestRank = 0;
+    for (size_t cls = 0; cls < PRIORITY_CLASSES; cls++) {
+        if (waiting_[cls] == 0) {
+            continue;
+        }
+        uint32_t rank = rankOf(cls, now);
+        if (best < 0 || rank < bestRank) {
+            best = static_cast<int>(cls);
+            bestRank = rank;
+        }
+    }
+    return best;
+}
+
+bool ModbusBus::shouldYield(esp32Modbus::ModbusPriority priority) const {
+    if (!arbiterLock_) {
+        return false;
+    }
+    const size_t own = classOf(priority);
+    // The holder's class as a fresh waiter: not overdue, not aged
+    const uint32_t ownRank = PRIORITY_CLASSES * PRIORITY_CLASSES + own * PRIORITY_CLASSES + own;
+
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    const TickType_t now = xTaskGetTickCount();
+    bool yield = false;
+    for (size_t cls = 0; cls < PRIORITY_CLASSES && !yield; cls++) {
+        yield = waiting_[cls] != 0 && rankOf(cls, now) < ownRank;
+    }
+    xSemaphoreGive(arbiterLock_);
+    return yield;
+}
+
+size_t ModbusBus::getWaiterCount(esp32Modbus::ModbusPriority priority) const {
+    if (!arbiterLock_) {
+        return 0;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    size_t count = waiting_[classOf(priority)];
+    xSemaphoreGive(arbiterLock_);
+    return count;
+}
+
+void ModbusBus::setLatencyBudget(esp32Modbus::ModbusPriority priority, uint32_t budgetMs) {
+    if (!arbiterLock_) {
+        return;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    budgetMs_[classOf(priority)] = budgetMs;
+    xSemaphoreGive(arbiterLock_);
+}
+
+uint32_t ModbusBus::getLatencyBudget(esp32Modbus::ModbusPriority priority) const {
+    if (!arbiterLock_) {
+        return 0;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    uint32_t budget = budgetMs_[classOf(priority)];
+    xSemaphoreGive(arbiterLock_);
+    return budget;
+}
+
+ModbusBus::ArbiterStats ModbusBus::getArbiterStats(esp32Modbus::ModbusPriority priority) const {
+    ArbiterStats stats;
+    if (!arbiterLock_) {
+        return stats;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    stats = stats_[classOf(priority)];
+    xSemaphoreGive(arbiterLock_);
+    return stats;
+}
+
+void ModbusBus::resetArbiterStats() {
+    if (!arbiterLock_) {
+        return;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    for (auto& stats : stats_) {
+        stats = ArbiterStats();
+    }
+    xSemaphoreGive(arbiterLock_);
+}
+
+bool ModbusBus::dispatch(uint8_t slave, uint8_t fc, uint16_t address, uint16_t count,
+                         esp32Modbus::ModbusPriority priority, const uint16_t* data) {
+    auto* rtu = getModbusRTU();
+    if (!rtu) {
+        MODBUSD_LOG_E("ModbusRTU not set on bus %u", id_);
+        return false;
+    }
+
+    switch (fc) {
+        case 0x03:
+            return rtu->readHoldingRegistersWithPriority(slave, address, count, priority);
+        case 0x04:
+            return rtu->readInputRegistersWithPriority(slave, address, count, priority);
+        case 0x01:
+            return rtu->readCoilsWithPriority(slave, address, count, priority);
+        case 0x02:
+            return rtu->readDiscreteInputsWithPriority(slave, address, count, priority);
+        case 0x06:
+            return data && rtu->writeSingleHoldingRegisterWithPriority(slave, address, data[0], priority);
+        case 0x10:
+            if (data && count > 0 && count <= MODBUS_MAX_WRITE_REGISTER_COUNT) {
+                // FC10 only goes out under the bus mutex, which guards the scratch
+                uint8_t* byteData = writeScratch_.bytes;
+                for (uint16_t i = 0; i < count; i++) {
+                    byteData[i * 2] = (data[i] >> 8) & 0xFF;
+                    byteData[i * 2 + 1] = data[i] & 0xFF;
+                }
+                return rtu->writeMultHoldingRegistersWithPriority(slave, address, count, byteData, priority);
+            }
+            return false;
+        case 0x05:
+            return data && rtu->writeSingleCoilWithPriority(slave, address, data[0] != 0, priority);
+        case 0x0F:
+            if (data && count > 0 && count <= MODBUS_MAX_WRITE_COIL_COUNT) {
+                bool* boolData = writeScratch_.bits;
+                for (uint16_t i = 0; i < count; i++) {
+                    uint16_t wordIndex = i / 16;
+                    uint16_t bitIndex = i % 16;
+                    boolData[i] = (data[wordIndex] & (1 << bitIndex)) != 0;
+                }
+                return rtu->writeMultipleCoilsWithPriority(slave, address, count, boolData, priority);
+            }
+            return false;
+        default:
+            return false;
+    }
+}
+
+ModbusBus::AsyncGrant ModbusBus::beginAsync(esp32Modbus::ModbusPriority priority, bool wait) {
+    if (!arbiterLock_) {
+        return AsyncGrant::NONE;
+    }
+
+    AsyncGrant grant = AsyncGrant::NONE;
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    if (asyncHosted_) {
+        grant = AsyncGrant::HOSTED;
+    } else if (asyncFrames_ > 0) {
+        // Joining while someone queues for the bus would keep it from them
+        bool waiters = false;
+        for (size_t cls = 0; cls < PRIORITY_CLASSES; cls++) {
+            waiters = waiters || waiting_[cls] != 0;
+        }
+        if (!waiters) {
+            asyncFrames_++;
+            grant = AsyncGrant::LEASED;
+        }
+    }
+    xSemaphoreGive(arbiterLock_);
+    if (grant != AsyncGrant::NONE) {
+        return grant;
+    }
+
+    // The bus stays ours until the RTU reported the frame; the mutex is
+    // only held by tasks that send, and the lease ends on the RTU task
+    if (!acquireBusMutex(wait ? MODBUS_MUTEX_TIMEOUT_MS : 0, priority)) {
+        return AsyncGrant::NONE;
+    }
+    xSemaphoreGive(busMutex_);
+    setTransactionTimeout(0);
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    asyncFrames_ = 1;
+    xSemaphoreGive(arbiterLock_);
+    return AsyncGrant::LEASED;
+}
+
+void ModbusBus::endAsync() noexcept {
+    if (!arbiterLock_) {
+        return;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    const bool last = asyncFrames_ > 0 && --asyncFrames_ == 0;
+    xSemaphoreGive(arbiterLock_);
+    if (!last) {
+        return;
+    }
+
+    // Usually runs on the RTU task, which must not sleep the tick delay:
+    // the next holder waits out the gap in either timing mode
+    const int64_t now = esp_timer_get_time();
+    busyUs_ += static_cast<uint32_t>(now - heldSinceUs_);
+    quietUntilUs_ = std::max<int64_t>(quietUntilUs_, now + interFrameDelayUs_.load());
+    passOwnership();
+}
+
+void ModbusBus::hostAsync(bool hosted) noexcept {
+    if (!arbiterLock_) {
+        return;
+    }
+    xSemaphoreTake(arbiterLock_, portMAX_DELAY);
+    asyncHosted_ = hosted;
+    xSemaphoreGive(arbiterLock_);
+}
+
+bool ModbusBus::isDeliveryTask() const noexcept {
+    TaskHandle_t task = deliveryTask_.load();
+    return task && task == xTaskGetCurrentTaskHandle();
+}
+
+bool ModbusBus::isValidWrite(uint8_t fc, uint16_t count, const uint16_t* data) noexcept {
+    if (!data) {
+        return false;
+    }
+    switch (fc) {
+        case 0x05:
+        case 0x06:
+            return count == 1;
+        case 0x0F:
+            return count > 0 && count <= MODBUS_MAX_WRITE_COIL_COUNT;
+        case 0x10:
+            return count > 0 && count <= MODBUS_MAX_WRITE_REGISTER_COUNT;
+        default:
+            return false;
+    }
+}
+
+ModbusResult<void> ModbusBus::broadcastWrite(uint8_t fc, uint16_t address, uint16_t count,
+                                             const uint16_t* data, esp32Modbus::ModbusPriority priority,
+                                             uint32_t turnaroundMs) {
+    if (!isValidWrite(fc, count, data)) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (!broadcastDone_) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, priority)) {
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    // The RTU waits for a reply to address 0 like to any other; let that
+    // wait end at once and keep the bus until the RTU is done with the frame
+    setTransactionTimeout(MODBUS_BROADCAST_RTU_TIMEOUT_MS);
+    xSemaphoreTake(broadcastDone_, 0);   // Drop a report that came after a previous wait
+    broadcastPending_ = true;
+
+#ifdef MODBUSDEVICE_TRACE
+    const int64_t sentUs = esp_timer_get_time();
+#endif
+    const bool sent = dispatch(0, fc, address, count, priority, data);
+    bool reported = false;
+    if (sent) {
+        const uint32_t wireMs = (ModbusPollBudget::estimateTransactionUs(fc, count, baudRate_) + 999) / 1000;
+        reported = xSemaphoreTake(broadcastDone_, pdMS_TO_TICKS(wireMs + turnaroundMs) + 1) == pdTRUE;
+    }
+    broadcastPending_ = false;
+    setTransactionTimeout(0);
+#ifdef MODBUSDEVICE_TRACE
+    traceTransaction(TraceKind::BROADCAST, id_, 0, fc, address, count,
+                     sent ? ModbusError::SUCCESS : ModbusError::COMMUNICATION_ERROR,
+                     static_cast<uint8_t>(priority), sentUs, grantWaitUs_,
+                     static_cast<uint32_t>(esp_timer_get_time() - sentUs));
+#endif
+    if (reported) {
+        // The slaves get the turnaround delay to act on the frame, but it is
+        // the next bus holder that waits it out. Without a report the wait
+        // above already covered it.
+        quietUntilUs_ = esp_timer_get_time() + static_cast<int64_t>(turnaroundMs) * 1000;
+    }
+    releaseBusMutex();
+
+    if (!sent) {
+        MODBUSD_LOG_W("Bus %u broadcast FC%02X at 0x%04X not queued", id_, fc, address);
+        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
+    }
+
+    // Nobody acknowledged, so cached copies of the range can no longer be trusted
+    if (fc == 0x06 || fc == 0x10) {
+        for (uint16_t addr = 1; addr <= MODBUS_MAX_SLAVE_ADDRESS; addr++) {
+            ModbusDevice* device = getDevice(static_cast<uint8_t>(addr));
+            if (device && device->registerCache) {
+                device->registerCache->invalidate(fc, address, count);
+            }
+        }
+    }
+    return ModbusResult<void>::ok();
+}
+
+ModbusResult<void> ModbusBus::writeGroup(ModbusDevice* const* devices, size_t deviceCount,
+                                         uint8_t fc, uint16_t address, uint16_t count,
+                                         const uint16_t* data, ModbusError* results,
+                                         esp32Modbus::ModbusPriority priority) {
+    if (!devices || deviceCount == 0 || deviceCount > MODBUS_WRITE_GROUP_MAX ||
+        !isValidWrite(fc, count, data)) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (!devices[i] || devices[i]->bus != this) {
+            return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+        }
+    }
+
+    ModbusError outcome[MODBUS_WRITE_GROUP_MAX];
+    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, priority)) {
+        for (size_t i = 0; results && i < deviceCount; i++) {
+            results[i] = ModbusError::MUTEX_ERROR;
+        }
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    ModbusDevice::SyncSink sink;
+    sink.type = ModbusDevice::SyncSink::Type::NONE;
+
+    // The frames share one RTU timeout: the longest adaptive timeout of the
+    // group, or the bus default as soon as one device has no policy. Every
+    // frame is the same size, so each one adds the same wire time.
+    const uint32_t wireUs = ModbusPollBudget::estimateTransactionUs(fc, count, baudRate_);
+    uint32_t rtuTimeoutMs = 0;
+    for (size_t i = 0; i < deviceCount; i++) {
+        ModbusLinkPolicy* policy = devices[i]->linkPolicy;
+        if (!policy) {
+            rtuTimeoutMs = 0;
+            break;
+        }
+        rtuTimeoutMs = std::max(rtuTimeoutMs, policy->getTimeoutMs(devices[i]->serverAddress, wireUs));
+    }
+    if (rtuTimeoutMs) {
+        setTransactionTimeout(rtuTimeoutMs);
+    }
+
+    // Queue every request first; each reply completes its device's armed sync context
+    for (size_t i = 0; i < deviceCount; i++) {
+        ModbusDevice* device = devices[i];
+        ModbusLinkPolicy* policy = device->linkPolicy;
+        if (policy && !policy->allowRequest(device->serverAddress)) {
+            outcome[i] = ModbusError::DEVICE_NOT_FOUND;
+            continue;
+        }
+
+        device->ensureSyncReady(sink);
+        if (device->syncContext) {
+            device->syncContext->expectedFc = fc;
+        }
+        if (device->dispatchRequest(fc, address, count, priority, data) == ESP_OK) {
+            outcome[i] = ModbusError::SUCCESS;
+        } else {
+            device->disarmSyncSink();
+            outcome[i] = ModbusError::COMMUNICATION_ERROR;
+            if (policy) {
+                policy->recordResult(device->serverAddress, ModbusError::COMMUNICATION_ERROR, 0);
+            }
+        }
+    }
+
+    // Replies arrive in request order, so each device's round trip is
+    // measured from the previous completion
+    int64_t previousUs = esp_timer_get_time();
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (outcome[i] != ModbusError::SUCCESS) {
+            continue;
+        }
+        ModbusDevice* device = devices[i];
+        ModbusLinkPolicy* policy = device->linkPolicy;
+        TickType_t timeout = policy ? policy->getTimeout(device->serverAddress, wireUs) : pdMS_TO_TICKS(1000);
+
+        auto result = device->waitForCompletion(timeout);
+        const int64_t completedUs = esp_timer_get_time();
+        device->disarmSyncSink();
+
+        outcome[i] = result.isOk() ? ModbusError::SUCCESS : result.error();
+#ifdef MODBUSDEVICE_TRACE
+        // Only the first device waited for the grant; the rest were queued behind it
+        traceTransaction(TraceKind::GROUP, id_, device->serverAddress, fc, address, count, outcome[i],
+                         static_cast<uint8_t>(priority), previousUs, i == 0 ? grantWaitUs_ : 0,
+                         static_cast<uint32_t>(completedUs - previousUs));
+#endif
+        if (policy) {
+            policy->recordResult(device->serverAddress, outcome[i],
+                                 static_cast<uint32_t>(completedUs - previousUs), wireUs);
+        }
+        previousUs = completedUs;
+
+        if (device->registerCache && (fc == 0x06 || fc == 0x10)) {
+            if (result.isOk()) {
+                device->registerCache->store(fc, address, count, data);
+            } else {
+                device->registerCache->invalidate(fc, address, count);
+            }
+        }
+    }
+
+    if (rtuTimeoutMs) {
+        setTransactionTimeout(0);
+    }
+    releaseBusMutex();
+
+    ModbusError first = ModbusError::SUCCESS;
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (results) {
+            results[i] = outcome[i];
+        }
+        if (first == ModbusError::SUCCESS) {
+            first = outcome[i];
+        }
+    }
+    if (first != ModbusError::SUCCESS) {
+        return ModbusResult<void>::error(first);
+    }
+    return ModbusResult<void>::ok();
+}
+
+void ModbusBus::setBaudRate(uint32_t baud) {
+    if (baud == 0) {
+        return;
+    }
+    baudRate_ = baud;
+    // 3.5 chars x 11 bits; tick mode keeps the +1 ms margin of MODBUS_INTER_FRAME_DELAY_MS
+    interFrameDelayUs_ = 38500000UL / baud;
+    interFrameDelayMs_ = (38500UL / baud) + 1;
+    MODBUSD_LOG_I("Bus %u baud rate %lu, inter-frame gap %lu us", id_,
+                  (unsigned long)baud, (unsigned long)interFrameDelayUs_.load());
+}
+
+void ModbusBus::setResponseTimeout(uint32_t timeoutMs) {
+    responseTimeoutMs_ = timeoutMs;
+    if (auto* rtu = getModbusRTU()) {
+        rtu->setTimeOutValue(timeoutMs);
+    }
+}
+
+void ModbusBus::setTransactionTimeout(uint32_t timeoutMs) noexcept {
+    if (auto* rtu = getModbusRTU()) {
+        rtu->setTimeOutValue(timeoutMs ? timeoutMs : responseTimeoutMs_.load());
+    }
+}
+
+void ModbusBus::markFrameEnd() noexcept {
+    lastFrameEndUs_ = esp_timer_get_time();
+}
+
+void ModbusBus::waitInterFrameGap() noexcept {
+    lastGapWaitUs_ = 0;
+    int64_t deadline = quietUntilUs_;
+    quietUntilUs_ = 0;
+    if (lastFrameEndUs_ != 0) {
+        deadline = std::max<int64_t>(deadline, lastFrameEndUs_ + interFrameDelayUs_.load());
+    }
+    if (deadline == 0) {
+        return;
+    }
+
+    const int64_t start = esp_timer_get_time();
+    int64_t remaining = deadline - start;
+    if (remaining <= 0) {
+        return;
+    }
+
+    // Sleep the whole ticks, spin only for the sub-tick remainder
+    const int64_t tickUs = static_cast<int64_t>(portTICK_PERIOD_MS) * 1000;
+    if (remaining > tickUs) {
+        vTaskDelay(static_cast<TickType_t>(remaining / tickUs));
+    }
+    int64_t now;
+    while ((now = esp_timer_get_time()) < deadline) {
+        // busy-wait
+    }
+    lastGapWaitUs_ = static_cast<uint32_t>(now - start);
+}
+
+bool ModbusBus::setWorker(BusScheduler* worker) noexcept {
+    // A stopping worker keeps the bus until its in-flight reply is in
+    BusScheduler* expected = nullptr;
+    if (!responder_.compare_exchange_strong(expected, worker, std::memory_order_acq_rel) &&
+        expected != worker) {
+        return false;
+    }
+    worker_.store(worker, std::memory_order_release);
+    return true;
+}
+
+void ModbusBus::retireWorker(BusScheduler* worker) noexcept {
+    BusScheduler* expected = worker;
+    worker_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+void ModbusBus::clearWorker(BusScheduler* worker) noexcept {
+    retireWorker(worker);
+    BusScheduler* expected = worker;
+    responder_.compare_exchange_strong(expected, nullptr, std::memory_order_acq_rel);
+}
+
+void ModbusBus::handleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
+                           uint16_t startingAddress, const uint8_t* data, size_t length) {
+    DeliveryScope delivery(deliveryTask_);
+    ModbusBusScanner* scanner = scanner_.load(std::memory_order_acquire);
+    if (scanner && scanner->completeProbe(serverAddress, static_cast<uint8_t>(fc), ModbusError::SUCCESS)) {
+        return;
+    }
+
+    ModbusDevice* device = getDevice(serverAddress);
+    if (!device) {
+        return;
+    }
+
+    ModbusDevice::Outstanding request;
+    const ModbusDevice::Outstanding* match =
+        device->takeOutstanding(static_cast<uint8_t>(fc), startingAddress, false, request) ? &request : nullptr;
+
+    BusScheduler* worker = responder_.load(std::memory_order_acquire);
+    if (worker && !(match && match->async) &&
+        worker->completeResponse(device, match ? match->txn : 0, static_cast<uint8_t>(fc), data, length)) {
+        device->handleModbusResponse(static_cast<uint8_t>(fc), startingAddress, data, length);
+        return;
+    }
+    device->handleData(fc, startingAddress, data, length, match);
+    if (match && match->leased) {
+        endAsync();   // After the callback, so a request it submits can still join
+    }
+}
+
+void ModbusBus::handleError(uint8_t serverAddress, esp32Modbus::Error error) {
+    DeliveryScope delivery(deliveryTask_);
+    if (serverAddress == 0) {
+        // The RTU gave up waiting for a reply to a broadcast
+        if (broadcastPending_.load()) {
+            xSemaphoreGive(broadcastDone_);
+        }
+        return;
+    }
+
+    ModbusBusScanner* scanner = scanner_.load(std::memory_order_acquire);
+    if (scanner && scanner->completeProbe(serverAddress, 0, ModbusDevice::mapError(error))) {
+        return;
+    }
+
+    ModbusDevice* device = getDevice(serverAddress);
+    if (!device) {
+        return;
+    }
+
+    ModbusDevice::Outstanding request;
+    const ModbusDevice::Outstanding* match = device->takeOutstanding(0, 0, true, request) ? &request : nullptr;
+
+    BusScheduler* worker = responder_.load(std::memory_order_acquire);
+    if (worker && !(match && match->async)) {
+        ModbusError modbusError = ModbusDevice::mapError(error);
+        if (worker->completeError(device, match ? match->txn : 0, modbusError)) {
+            device->handleModbusError(modbusError);
+            return;
+        }
+    }
+    device->handleError(error, match);
+    if (match && match->leased) {
+        endAsync();
+    }
+}
+
+} // namespace modbus
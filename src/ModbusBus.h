@@ -0,0 +1,632 @@
+/*
+ * ModbusBus.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSBUS_H
+#define MODBUSBUS_H
+
+/**
+ * @file ModbusBus.h
+ * @brief One RS485 port: RTU instance, bus mutex, timing and address table
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <esp32ModbusRTU.h>
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+
+// Buses (UARTs) the registry manages; bus 0 is the default bus
+#ifndef MODBUS_MAX_BUSES
+#define MODBUS_MAX_BUSES 3
+#endif
+
+// Default time slaves get to act on a broadcast before the next request
+// (Modbus spec: 100-200 ms); broadcastWrite() takes it per call
+#ifndef MODBUS_BROADCAST_TURNAROUND_MS
+#define MODBUS_BROADCAST_TURNAROUND_MS 100
+#endif
+
+// RTU response timeout while a broadcast goes out: nobody answers, it only ends the RTU's wait
+#ifndef MODBUS_BROADCAST_RTU_TIMEOUT_MS
+#define MODBUS_BROADCAST_RTU_TIMEOUT_MS 1
+#endif
+
+// Devices one writeGroup() call can address
+#ifndef MODBUS_WRITE_GROUP_MAX
+#define MODBUS_WRITE_GROUP_MAX 32
+#endif
+
+// Bus arbiter: a waiting class moves up one priority class per aging period
+#ifndef MODBUS_ARBITER_AGING_MS
+#define MODBUS_ARBITER_AGING_MS 500
+#endif
+
+// Bus arbiter latency budgets per priority class (0 = no budget)
+#ifndef MODBUS_ARBITER_BUDGET_EMERGENCY_MS
+#define MODBUS_ARBITER_BUDGET_EMERGENCY_MS 20
+#endif
+
+#ifndef MODBUS_ARBITER_BUDGET_SENSOR_MS
+#define MODBUS_ARBITER_BUDGET_SENSOR_MS 1000
+#endif
+
+#ifndef MODBUS_ARBITER_BUDGET_RELAY_MS
+#define MODBUS_ARBITER_BUDGET_RELAY_MS 100
+#endif
+
+#ifndef MODBUS_ARBITER_BUDGET_STATUS_MS
+#define MODBUS_ARBITER_BUDGET_STATUS_MS 5000
+#endif
+
+// Response timeout the RTU master runs with; holders that shorten it for their
+// frames restore it through ModbusBus::setTransactionTimeout(0). Change it
+// through ModbusBus::setResponseTimeout().
+#ifndef MODBUS_RTU_RESPONSE_TIMEOUT_MS
+#define MODBUS_RTU_RESPONSE_TIMEOUT_MS 1000
+#endif
+
+namespace modbus {
+
+class BusScheduler;
+class ModbusBusScanner;
+class ModbusDevice;
+
+/**
+ * @class ModbusBus
+ * @brief State of one Modbus RTU bus
+ *
+ * Each bus owns its esp32ModbusRTU instance, its bus mutex, its inter-frame
+ * timing and its own slave address table, so devices on different UARTs
+ * never wait for each other and the same slave address can be used on
+ * every port. Devices bind to a bus with ModbusDevice::setBus(); unbound
+ * devices use the default bus (ModbusRegistry::getDefaultBus()).
+ *
+ * Buses are owned by ModbusRegistry and obtained with
+ * ModbusRegistry::getBus(). attach() installs per-bus response handlers
+ * on the RTU instance so its frames only reach devices of this bus:
+ *
+ * @code
+ * esp32ModbusRTU boilerPort(&Serial1);
+ * esp32ModbusRTU heatPumpPort(&Serial2);
+ *
+ * auto& registry = modbus::ModbusRegistry::getInstance();
+ * registry.getBus(0)->attach(boilerPort);
+ * registry.getBus(1)->attach(heatPumpPort);
+ *
+ * static MyDevice heatPump(1);
+ * heatPump.setBus(*registry.getBus(1));
+ * @endcode
+ *
+ * Bus ownership is arbitrated by esp32Modbus::ModbusPriority instead of
+ * the FIFO order of one mutex. Each class has its own waiter queue; on
+ * release the bus is handed to the best waiting class:
+ *  1. classes that waited longer than their latency budget, most urgent first
+ *  2. otherwise by priority, where a class that has not been served for
+ *     n x MODBUS_ARBITER_AGING_MS ranks n classes higher
+ *
+ * A transaction in flight is never interrupted, so the worst-case wait of a
+ * class is its budget plus one transaction (response timeout) of whoever
+ * holds the bus. The priority values follow esp32ModbusRTU (EMERGENCY,
+ * SENSOR, RELAY, STATUS), so safety writes belong in EMERGENCY or rely
+ * on the short RELAY budget.
+ */
+class ModbusBus {
+public:
+    /**
+     * @enum InterFrameTiming
+     * @brief How the 3.5 character gap between transactions is enforced
+     */
+    enum class InterFrameTiming : uint8_t {
+        TICK_DELAY,  ///< Sleep the full delay (ms, rounded up) before releasing the bus
+        PRECISE      ///< Record frame end, wait only the remaining gap on next acquire
+    };
+
+    /// Arbiter classes, one per esp32Modbus::ModbusPriority value
+    static constexpr size_t PRIORITY_CLASSES = esp32Modbus::STATUS + 1;
+
+    /**
+     * @struct ArbiterStats
+     * @brief Bus acquisitions of one priority class
+     */
+    struct ArbiterStats {
+        uint32_t grants = 0;         ///< Successful acquisitions
+        uint32_t contended = 0;      ///< Acquisitions that had to queue
+        uint32_t timeouts = 0;       ///< Waits that gave up
+        uint32_t budgetMisses = 0;   ///< Acquisitions that waited longer than the budget
+        uint32_t maxWaitUs = 0;
+        uint64_t totalWaitUs = 0;
+    };
+
+    /**
+     * @brief Wire-format scratch for FC10 (big-endian bytes) and FC0F (bool per coil)
+     *
+     * The RTU layer copies the data into its own request before returning,
+     * so the scratch is only live during one dispatch. FC10/FC0F are only
+     * dispatched by the bus mutex holder, which makes one buffer per bus safe.
+     */
+    union WriteScratch {
+        uint8_t bytes[MODBUS_MAX_WRITE_REGISTER_COUNT * 2];
+        bool bits[MODBUS_MAX_WRITE_COIL_COUNT];
+    };
+
+    ModbusBus(const ModbusBus&) = delete;
+    ModbusBus& operator=(const ModbusBus&) = delete;
+
+    /**
+     * @brief Index of this bus in the registry (0 = default bus)
+     */
+    uint8_t getId() const noexcept { return id_; }
+
+    /**
+     * @brief Set the RTU instance used to send requests
+     *
+     * Response handlers are left alone; use attach() to route responses
+     * per bus, or keep wiring the RTU to the global mainHandleData() /
+     * handleError() for a single-bus setup.
+     *
+     * @param rtu RTU instance, or nullptr
+     */
+    void setModbusRTU(esp32ModbusRTU* rtu);
+
+    esp32ModbusRTU* getModbusRTU() const noexcept { return modbusRTU_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Use an RTU instance and route its responses to this bus
+     *
+     * Sets the RTU as with setModbusRTU() and installs onData/onError
+     * handlers that look devices up in this bus's address table only.
+     * Call before rtu.begin().
+     *
+     * @param rtu RTU instance driving this bus's UART
+     */
+    void attach(esp32ModbusRTU& rtu);
+
+    /**
+     * @brief Register a device at an address on this bus
+     * @param address Modbus address (1-247)
+     * @param device Device to route responses to
+     * @return true if registered
+     */
+    bool registerDevice(uint8_t address, ModbusDevice* device);
+
+    /**
+     * @brief Remove whatever device is registered at an address
+     * @param address Modbus address
+     * @return true if a device was removed
+     */
+    bool unregisterDevice(uint8_t address);
+
+    /**
+     * @brief Remove a device only if it is the one registered at the address
+     * @param address Modbus address
+     * @param device Expected device
+     * @return true if the device was removed
+     */
+    bool unregisterDevice(uint8_t address, ModbusDevice* device);
+
+    /**
+     * @brief Look up the device at an address
+     * @param address Modbus address
+     * @return Device, or nullptr
+     * @note Wait-free; safe to call from the RTU callback task
+     */
+    ModbusDevice* getDevice(uint8_t address) const noexcept;
+
+    bool hasDevice(uint8_t address) const noexcept { return getDevice(address) != nullptr; }
+
+    size_t getDeviceCount() const noexcept { return deviceCount_; }
+
+    /**
+     * @brief Get the registration mutex of this bus
+     */
+    SemaphoreHandle_t getMutex() const noexcept { return mutex_; }
+
+    /**
+     * @brief Get the bus mutex serialising transactions on this bus
+     */
+    SemaphoreHandle_t getBusMutex() const noexcept { return busMutex_; }
+
+    /**
+     * @brief Take the bus for one or more transactions
+     *
+     * Waits in the queue of the given priority class while the bus is
+     * owned, then takes the bus mutex. In PRECISE timing this also waits
+     * out what is left of the previous frame's inter-frame gap.
+     *
+     * @param timeoutMs Timeout in milliseconds
+     * @param priority Arbiter class to queue in
+     * @return true if acquired
+     */
+    bool acquireBusMutex(uint32_t timeoutMs = MODBUS_MUTEX_TIMEOUT_MS,
+                         esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY);
+
+    /**
+     * @brief Release the bus and hand it to the best waiting class
+     *
+     * TICK_DELAY timing sleeps the inter-frame delay before releasing;
+     * PRECISE timing records the frame end for the next acquirer instead.
+     */
+    void releaseBusMutex() noexcept;
+
+    /**
+     * @brief Check whether a waiter would be served before the given class
+     *
+     * Lets a bus holder running a batch (scans, scheduler bursts) give the
+     * bus up between transactions when more urgent work is queued.
+     *
+     * @param priority Class of the holder's next transaction
+     */
+    bool shouldYield(esp32Modbus::ModbusPriority priority) const;
+
+    /**
+     * @brief Tasks currently queued for the bus in a class
+     */
+    size_t getWaiterCount(esp32Modbus::ModbusPriority priority) const;
+
+    /**
+     * @brief Set the latency budget of a class
+     * @param priority Class
+     * @param budgetMs Maximum intended wait, 0 = none
+     */
+    void setLatencyBudget(esp32Modbus::ModbusPriority priority, uint32_t budgetMs);
+
+    uint32_t getLatencyBudget(esp32Modbus::ModbusPriority priority) const;
+
+    /**
+     * @brief Set how long a class may go unserved before it ranks one class higher
+     * @param agingMs Aging period, 0 = strict priority
+     */
+    void setAgingMs(uint32_t agingMs) noexcept { agingMs_ = agingMs; }
+
+    uint32_t getAgingMs() const noexcept { return agingMs_; }
+
+    /**
+     * @brief Get the acquisition statistics of a class
+     */
+    ArbiterStats getArbiterStats(esp32Modbus::ModbusPriority priority) const;
+
+    void resetArbiterStats();
+
+    /**
+     * @brief Microseconds the bus mutex has been held, summed over all holders
+     *
+     * Counts from the grant (after any inter-frame wait) to the release, so
+     * it covers request, turnaround and response but not the trailing gap.
+     * Wraps after ~71 minutes; use differences between two samples.
+     */
+    uint32_t getBusyTimeUs() const noexcept { return busyUs_; }
+
+    /**
+     * @brief Send a write to every slave on the bus (address 0)
+     *
+     * Slaves do not answer broadcasts. The RTU master still waits for a
+     * reply, so the bus is held with its response timeout set to
+     * MODBUS_BROADCAST_RTU_TIMEOUT_MS until it reports the frame (as a
+     * timeout for address 0), or at most the frame's wire time plus
+     * turnaroundMs. The next bus holder then waits out turnaroundMs so the
+     * slaves can act on it first. Success means the request went out, not
+     * that any slave applied it; register caches of this bus's devices are
+     * invalidated for the written range.
+     *
+     * @param fc 0x05, 0x06, 0x0F or 0x10
+     * @param address First coil/register
+     * @param count Number of coils/registers (1 for FC05/FC06)
+     * @param data Register values, or for FC05/FC0F coils packed 16 per word
+     *             (coil i = data[i / 16] bit i % 16; FC05 uses data[0] != 0)
+     * @param priority Arbiter class to queue in
+     * @param turnaroundMs Time the slaves need to act on the frame; the
+     *        spec's 100-200 ms fits slow slaves, known fast ones need less
+     */
+    [[nodiscard]] ModbusResult<void> broadcastWrite(uint8_t fc, uint16_t address, uint16_t count,
+                                                    const uint16_t* data,
+                                                    esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+                                                    uint32_t turnaroundMs = MODBUS_BROADCAST_TURNAROUND_MS);
+
+    /** @see broadcastWrite() */
+    [[nodiscard]] ModbusResult<void> broadcastWriteRegister(uint16_t address, uint16_t value,
+                                                            esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+                                                            uint32_t turnaroundMs = MODBUS_BROADCAST_TURNAROUND_MS) {
+        return broadcastWrite(0x06, address, 1, &value, priority, turnaroundMs);
+    }
+
+    /** @see broadcastWrite() */
+    [[nodiscard]] ModbusResult<void> broadcastWriteCoil(uint16_t address, bool value,
+                                                        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+                                                        uint32_t turnaroundMs = MODBUS_BROADCAST_TURNAROUND_MS) {
+        const uint16_t word = value ? 1 : 0;
+        return broadcastWrite(0x05, address, 1, &word, priority, turnaroundMs);
+    }
+
+    /**
+     * @brief Send the same write to a set of devices back to back
+     *
+     * Takes the bus once, queues one request per device in the RTU and then
+     * collects the acknowledgements, so a bank costs its wire time plus one
+     * inter-frame delay instead of N mutex round trips and N delays. Each
+     * device's link policy (breaker, timeout, statistics) still applies.
+     * Devices must be distinct and bound to this bus.
+     *
+     * @param devices Target devices
+     * @param deviceCount Number of devices (<= MODBUS_WRITE_GROUP_MAX)
+     * @param fc 0x05, 0x06, 0x0F or 0x10
+     * @param address First coil/register
+     * @param count Number of coils/registers (1 for FC05/FC06)
+     * @param data Same layout as broadcastWrite()
+     * @param results Optional per-device outcome (deviceCount entries)
+     * @param priority Arbiter class to queue in
+     * @return Ok if every device acknowledged, else the first failure
+     */
+    [[nodiscard]] ModbusResult<void> writeGroup(ModbusDevice* const* devices, size_t deviceCount,
+                                                uint8_t fc, uint16_t address, uint16_t count,
+                                                const uint16_t* data, ModbusError* results = nullptr,
+                                                esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY);
+
+    /**
+     * @brief Set the baud rate used to derive the inter-frame gap
+     * @param baud Baud rate in bit/s
+     */
+    void setBaudRate(uint32_t baud);
+
+    uint32_t getBaudRate() const noexcept { return baudRate_; }
+
+    /**
+     * @brief Set the RTU master's response timeout
+     *
+     * Forwards to esp32ModbusRTU::setTimeOutValue() and remembers the value
+     * so components that shorten it temporarily (setTransactionTimeout()) can
+     * put it back. Set it through here rather than on the RTU directly.
+     *
+     * @param timeoutMs Response timeout in milliseconds
+     */
+    void setResponseTimeout(uint32_t timeoutMs);
+
+    uint32_t getResponseTimeout() const noexcept { return responseTimeoutMs_; }
+
+    /**
+     * @brief RTU response timeout for the frame the bus holder sends next
+     *
+     * The bus is the one owner of the RTU timeout: ModbusLinkPolicy
+     * timeouts, broadcasts, ModbusBusScanner slices and ModbusInitOrchestrator
+     * probes all go through here, so a dead slave holds the RTU master for
+     * the holder's timeout instead of getResponseTimeout(). Caller holds the
+     * bus and calls it again with 0 once its frames completed, which
+     * restores getResponseTimeout().
+     *
+     * @param timeoutMs Timeout in milliseconds, 0 = getResponseTimeout()
+     */
+    void setTransactionTimeout(uint32_t timeoutMs) noexcept;
+
+    /**
+     * @brief Let async requests through while the caller holds the bus
+     *
+     * Async requests (ModbusDevice::readHoldingRegistersAsync() and friends)
+     * normally take the bus until the RTU has reported them, so they never
+     * run at a timeout another holder set. A holder that sends async
+     * requests itself, and sets the RTU timeout for them, hosts them instead:
+     * while hosted they go straight into the RTU queue at whatever timeout
+     * the holder set. ModbusInitOrchestrator hosts its bring-up this way.
+     *
+     * @param hosted true after acquireBusMutex(), false before releaseBusMutex()
+     * @note Caller must hold the bus mutex
+     */
+    void hostAsync(bool hosted) noexcept;
+
+    /**
+     * @brief Select how the inter-frame gap is enforced
+     * @param mode TICK_DELAY (default) or PRECISE
+     */
+    void setInterFrameTiming(InterFrameTiming mode) noexcept { interFrameTiming_ = mode; }
+
+    InterFrameTiming getInterFrameTiming() const noexcept { return interFrameTiming_; }
+
+    /**
+     * @brief Get the 3.5 character gap in microseconds (no safety margin)
+     */
+    uint32_t getInterFrameDelayUs() const noexcept { return interFrameDelayUs_; }
+
+    /**
+     * @brief Get the tick-mode delay in milliseconds (includes +1 ms margin)
+     */
+    uint32_t getInterFrameDelayMs() const noexcept { return interFrameDelayMs_; }
+
+    /**
+     * @brief Record that a frame just finished on the bus
+     * @note Caller must hold the bus mutex
+     */
+    void markFrameEnd() noexcept;
+
+    /**
+     * @brief Wait until the inter-frame gap since markFrameEnd() has passed
+     *
+     * Also waits out the turnaround of a preceding broadcast.
+     *
+     * Sleeps whole ticks while enough time remains and busy-waits the
+     * sub-tick rest. Returns immediately if the gap already elapsed.
+     *
+     * @note Caller must hold the bus mutex
+     */
+    void waitInterFrameGap() noexcept;
+
+    /**
+     * @brief Microseconds the last waitInterFrameGap() call spent waiting
+     * @note Only meaningful to the current bus mutex holder
+     */
+    uint32_t getLastGapWaitUs() const noexcept { return lastGapWaitUs_; }
+
+    /**
+     * @brief Microseconds the current holder waited in acquireBusMutex() for its grant
+     * @note Only meaningful to the current bus mutex holder; excludes the gap wait
+     */
+    uint32_t getGrantWaitUs() const noexcept { return grantWaitUs_; }
+
+    /**
+     * @brief FC10/FC0F conversion buffer
+     * @note Caller must hold the bus mutex
+     */
+    WriteScratch& getWriteScratch() noexcept { return writeScratch_; }
+
+    /**
+     * @brief Running BusScheduler that owns this bus, or nullptr
+     *
+     * While set, synchronous device calls on this bus are queued to it.
+     */
+    BusScheduler* getWorker() const noexcept { return worker_.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Route a response frame to the device registered at its address
+     *
+     * A reply to a ModbusBusScanner probe goes to the scanner, also for
+     * addresses without a device. Otherwise the device's outstanding FIFO
+     * names the request the frame answers: an async one completes its
+     * handle, one of the worker's in-flight transaction goes to the worker
+     * directly, anything else to the device's sync matching.
+     */
+    void handleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
+                    uint16_t startingAddress, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Route an error to the device registered at its address
+     */
+    void handleError(uint8_t serverAddress, esp32Modbus::Error error);
+
+private:
+    friend class ModbusRegistry;
+    friend class BusScheduler;
+    friend class ModbusDevice;
+    friend class ModbusBusScanner;
+
+    ModbusBus();
+    ~ModbusBus();
+
+    bool setWorker(BusScheduler* worker) noexcept;
+    void retireWorker(BusScheduler* worker) noexcept;   ///< Sync calls stop queueing; replies still reach it
+    void clearWorker(BusScheduler* worker) noexcept;
+
+    /// How an async request got onto the bus
+    enum class AsyncGrant : uint8_t {
+        NONE,     ///< Bus not available
+        HOSTED,   ///< The bus holder hosts async requests (hostAsync())
+        LEASED    ///< Counted in the async lease; endAsync() once the RTU reported it
+    };
+
+    /**
+     * @brief Admit one async frame
+     *
+     * Joins the async frames in flight when nobody waits for the bus,
+     * otherwise takes the bus like acquireBusMutex() and keeps it (without
+     * the bus mutex) until the last frame is reported. The RTU then runs at
+     * getResponseTimeout() for all of them.
+     *
+     * @param wait false on the RTU callback task: join or take a free bus, never block
+     */
+    AsyncGrant beginAsync(esp32Modbus::ModbusPriority priority, bool wait);
+
+    /**
+     * @brief The RTU reported a leased frame (or it was never queued)
+     *
+     * The last one hands the bus on; the next holder waits out the gap.
+     */
+    void endAsync() noexcept;
+
+    /**
+     * @brief Whether the calling task is delivering a frame of this bus
+     */
+    bool isDeliveryTask() const noexcept;
+
+    static size_t classOf(esp32Modbus::ModbusPriority priority) noexcept;
+
+    static bool isValidWrite(uint8_t fc, uint16_t count, const uint16_t* data) noexcept;
+
+    /**
+     * @brief Encode one request and queue it in the RTU
+     * @param slave Server address, 0 for broadcast
+     * @param data Source of writes (FC05/FC0F: coils packed 16 per word)
+     * @return true if the RTU accepted the request
+     * @note FC10/FC0F use the write scratch; caller must hold the bus mutex
+     */
+    bool dispatch(uint8_t slave, uint8_t fc, uint16_t address, uint16_t count,
+                  esp32Modbus::ModbusPriority priority, const uint16_t* data);
+
+    // Arbiter helpers; caller holds arbiterLock_
+    uint32_t rankOf(size_t cls, TickType_t now) const noexcept;
+    int selectClass(TickType_t now) const noexcept;
+    void passOwnership() noexcept;
+
+    uint8_t id_ = 0;
+
+    // Indexed by slave address (0 and > MODBUS_MAX_SLAVE_ADDRESS stay empty)
+    std::atomic<ModbusDevice*> devices_[MODBUS_MAX_SLAVE_ADDRESS + 1] = {};
+    std::atomic<size_t> deviceCount_{0};
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+    SemaphoreHandle_t busMutex_ = nullptr;
+    SemaphoreStorage mutexStorage_;
+    SemaphoreStorage busMutexStorage_;
+    std::atomic<esp32ModbusRTU*> modbusRTU_{nullptr};
+    std::atomic<BusScheduler*> worker_{nullptr};
+    std::atomic<BusScheduler*> responder_{nullptr};   ///< Worker taking replies; outlives worker_ until its task exited
+    std::atomic<ModbusBusScanner*> scanner_{nullptr};   ///< Set by the bus holder while probing
+
+    // Arbiter state, guarded by arbiterLock_. busy_ stays set while the bus
+    // is handed from one owner to the next through grant_[cls].
+    mutable SemaphoreHandle_t arbiterLock_ = nullptr;
+    SemaphoreHandle_t grant_[PRIORITY_CLASSES] = {};
+    SemaphoreStorage arbiterLockStorage_;
+    SemaphoreStorage grantStorage_[PRIORITY_CLASSES];
+
+    // Given by handleError() when the RTU reports the broadcast in flight
+    SemaphoreHandle_t broadcastDone_ = nullptr;
+    SemaphoreStorage broadcastDoneStorage_;
+    std::atomic<bool> broadcastPending_{false};
+    bool busy_ = false;
+    bool asyncHosted_ = false;
+    uint16_t asyncFrames_ = 0;     ///< Leased async frames the RTU has not reported yet
+    uint16_t waiting_[PRIORITY_CLASSES] = {};
+    TickType_t waitingSince_[PRIORITY_CLASSES] = {};   ///< Since the class was last served
+    uint32_t budgetMs_[PRIORITY_CLASSES] = {
+        MODBUS_ARBITER_BUDGET_EMERGENCY_MS, MODBUS_ARBITER_BUDGET_SENSOR_MS,
+        MODBUS_ARBITER_BUDGET_RELAY_MS, MODBUS_ARBITER_BUDGET_STATUS_MS};
+    std::atomic<uint32_t> agingMs_{MODBUS_ARBITER_AGING_MS};
+    ArbiterStats stats_[PRIORITY_CLASSES];
+
+    // Inter-frame timing; lastFrameEndUs_ is only touched by the bus mutex holder
+    std::atomic<uint32_t> baudRate_{MODBUS_BAUD_RATE};
+    std::atomic<uint32_t> interFrameDelayUs_{MODBUS_INTER_FRAME_DELAY_US};
+    std::atomic<uint32_t> interFrameDelayMs_{MODBUS_INTER_FRAME_DELAY_MS};
+    std::atomic<InterFrameTiming> interFrameTiming_{InterFrameTiming::TICK_DELAY};
+    std::atomic<uint32_t> responseTimeoutMs_{MODBUS_RTU_RESPONSE_TIMEOUT_MS};
+    int64_t lastFrameEndUs_ = 0;
+    int64_t quietUntilUs_ = 0;     ///< Broadcast turnaround or async lease gap end, 0 = none
+    uint32_t lastGapWaitUs_ = 0;
+    uint32_t grantWaitUs_ = 0;
+    int64_t heldSinceUs_ = 0;      ///< When the current holder got the bus
+    std::atomic<uint32_t> busyUs_{0};
+    std::atomic<TaskHandle_t> deliveryTask_{nullptr};   ///< Task inside handleData()/handleError()
+
+    WriteScratch writeScratch_;
+};
+
+} // namespace modbus
+
+#endif // MODBUSBUS_H
@@ -0,0 +1,442 @@
+/*
+ * ModbusBusScanner.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+
+#include "ModbusBusScanner.h"
+#include "ModbusBus.h"
+#include "ModbusDevice.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusPollBudget.h"
+#include "ModbusRegistry.h"
+#include "ModbusTrace.h"
+#include "ModbusDeviceLogging.h"
+#include "MutexGuard.h"
+#include <esp_timer.h>
+
+namespace modbus {
+
+namespace {
+
+// Data and exception replies both prove a slave sits at the address
+bool answered(ModbusError error) {
+    return error == ModbusError::SUCCESS ||
+           (error >= ModbusError::ILLEGAL_FUNCTION && error <= ModbusError::SLAVE_DEVICE_FAILURE);
+}
+
+bool garbled(ModbusError error) {
+    return error == ModbusError::CRC_ERROR || error == ModbusError::INVALID_RESPONSE;
+}
+
+} // namespace
+
+ModbusBusScanner::ModbusBusScanner(ModbusBus* bus)
+    : bus(bus ? bus : &ModbusRegistry::getInstance().getDefaultBus()) {
+    mutex = createMutex(mutexStorage);
+    done = createBinarySemaphore(doneStorage);
+    if (!mutex || !done) {
+        MODBUSD_LOG_E("Failed to create bus scanner semaphores");
+    }
+    restartPass();
+}
+
+ModbusBusScanner::~ModbusBusScanner() {
+    stop();
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+    if (done) {
+        vSemaphoreDelete(done);
+    }
+}
+
+bool ModbusBusScanner::setConfig(const Config& newConfig) {
+    if (newConfig.firstAddress == 0 || newConfig.lastAddress > MODBUS_MAX_SLAVE_ADDRESS ||
+        newConfig.firstAddress > newConfig.lastAddress ||
+        (newConfig.functionCode != 0x03 && newConfig.functionCode != 0x04)) {
+        return false;
+    }
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return false;
+    }
+    config = newConfig;
+    restartPass();
+    return true;
+}
+
+bool ModbusBusScanner::addCandidates(uint8_t firstAddress, uint8_t lastAddress) {
+    if (firstAddress == 0 || lastAddress > MODBUS_MAX_SLAVE_ADDRESS || firstAddress > lastAddress) {
+        return false;
+    }
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return false;
+    }
+    for (uint16_t a = firstAddress; a <= lastAddress; a++) {
+        candidates[a / 32] |= 1u << (a % 32);
+    }
+    return true;
+}
+
+void ModbusBusScanner::clearCandidates() {
+    MutexGuard lock(mutex);
+    if (lock.hasLock()) {
+        for (auto& word : candidates) {
+            word = 0;
+        }
+    }
+}
+
+void ModbusBusScanner::setChangeCallback(ChangeCallback callback, void* context) {
+    MutexGuard lock(mutex);
+    if (lock.hasLock()) {
+        changeCallback = callback;
+        changeContext = context;
+    }
+}
+
+void ModbusBusScanner::restartPass() {
+    for (auto& word : probed) {
+        word = 0;
+    }
+    cursor = config.firstAddress;
+    candidatePhase = true;
+    lookahead = 0;
+    passComplete = false;
+}
+
+uint8_t ModbusBusScanner::nextAddress() {
+    if (lookahead) {
+        uint8_t address = lookahead;
+        lookahead = 0;
+        return address;
+    }
+    for (;;) {
+        while (cursor <= config.lastAddress) {
+            const uint8_t address = static_cast<uint8_t>(cursor++);
+            if (testBit(probed, address)) continue;
+            if (candidatePhase && !testBit(candidates, address)) continue;
+            return address;
+        }
+        if (!candidatePhase) {
+            return 0;
+        }
+        candidatePhase = false;
+        cursor = config.firstAddress;
+    }
+}
+
+uint32_t ModbusBusScanner::getProbeTimeoutMs() const {
+    if (config.probeTimeoutMs) {
+        return config.probeTimeoutMs;
+    }
+    const uint32_t wireUs = ModbusPollBudget::estimateTransactionUs(config.functionCode, 1, bus->getBaudRate());
+    return (wireUs + 999) / 1000 + MODBUS_SCAN_TURNAROUND_MS;
+}
+
+bool ModbusBusScanner::beginSlice(uint32_t timeoutMs) {
+    if (!bus->acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, config.priority)) {
+        return false;
+    }
+    // Async requests wait for the bus too, so only the probes run at this
+    // timeout and empty addresses cost the probe timeout only
+    bus->setTransactionTimeout(timeoutMs);
+    bus->scanner_.store(this, std::memory_order_release);
+    return true;
+}
+
+void ModbusBusScanner::endSlice() {
+    bus->scanner_.store(nullptr, std::memory_order_release);
+    bus->setTransactionTimeout(0);
+    bus->releaseBusMutex();
+}
+
+ModbusError ModbusBusScanner::probeLocked(uint8_t address, uint32_t timeoutMs, uint32_t& roundTripUs) {
+    ModbusError error = ModbusError::TIMEOUT;
+    for (uint8_t attempt = 0; attempt <= config.retries; attempt++) {
+        bus->waitInterFrameGap();
+
+        xSemaphoreTake(done, 0);   // Drop a completion that raced a previous timeout
+        pendingFc.store(config.functionCode, std::memory_order_relaxed);
+        pendingAddress.store(address, std::memory_order_release);
+
+        const int64_t sentUs = esp_timer_get_time();
+        if (!bus->dispatch(address, config.functionCode, config.probeRegister, 1, config.priority, nullptr)) {
+            pendingAddress.store(0, std::memory_order_release);
+            bus->markFrameEnd();
+            return ModbusError::COMMUNICATION_ERROR;
+        }
+
+        // The RTU reports its own timeout first; the extra turnaround only covers a late callback
+        if (xSemaphoreTake(done, pdMS_TO_TICKS(timeoutMs + MODBUS_SCAN_TURNAROUND_MS)) == pdTRUE) {
+            error = pendingResult;
+        } else {
+            uint8_t expected = address;
+            if (pendingAddress.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+                error = ModbusError::TIMEOUT;
+            } else {
+                // Completed between the wait timing out and the claim
+                xSemaphoreTake(done, portMAX_DELAY);
+                error = pendingResult;
+            }
+        }
+        roundTripUs = static_cast<uint32_t>(esp_timer_get_time() - sentUs);
+        bus->markFrameEnd();
+
+#ifdef MODBUSDEVICE_TRACE
+        traceTransaction(TraceKind::PROBE, bus->getId(), address, config.functionCode, config.probeRegister, 1,
+                         error, static_cast<uint8_t>(config.priority), sentUs,
+                         attempt == 0 ? bus->getGrantWaitUs() : 0, roundTripUs);
+#endif
+        if (!garbled(error)) {
+            break;
+        }
+    }
+    return error;
+}
+
+bool ModbusBusScanner::completeProbe(uint8_t address, uint8_t fc, ModbusError error) {
+    if (pendingAddress.load(std::memory_order_acquire) != address) {
+        return false;
+    }
+    if (fc != 0 && fc != pendingFc.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    uint8_t expected = address;
+    if (!pendingAddress.compare_exchange_strong(expected, 0, std::memory_order_acq_rel)) {
+        return false;
+    }
+    pendingResult = error;
+    xSemaphoreGive(done);
+    return true;
+}
+
+bool ModbusBusScanner::recordProbe(uint8_t address, bool isPresent, uint32_t roundTripUs) {
+    const uint32_t mask = 1u << (address % 32);
+    uint32_t before;
+    if (isPresent) {
+        rttUs[address].store(roundTripUs ? roundTripUs : 1, std::memory_order_relaxed);
+        before = present[address / 32].fetch_or(mask, std::memory_order_relaxed);
+    } else {
+        before = present[address / 32].fetch_and(~mask, std::memory_order_relaxed);
+    }
+    return ((before & mask) != 0) != isPresent;
+}
+
+void ModbusBusScanner::notifyChanges(const uint32_t (&changed)[BITMAP_WORDS]) {
+    ChangeCallback callback;
+    void* context;
+    {
+        MutexGuard lock(mutex);
+        callback = changeCallback;
+        context = changeContext;
+    }
+    for (uint16_t a = 1; a <= MODBUS_MAX_SLAVE_ADDRESS; a++) {
+        if (!testBit(changed, static_cast<uint8_t>(a))) continue;
+        const uint8_t address = static_cast<uint8_t>(a);
+        const bool nowPresent = isPresent(address);
+        MODBUSD_LOG_I("Bus %u address %u %s", bus->getId(), address, nowPresent ? "responding" : "gone");
+
+        // A replaced device must not sit out its breaker backoff
+        ModbusDevice* device = bus->getDevice(address);
+        ModbusLinkPolicy* policy = device ? device->getLinkPolicy() : nullptr;
+        if (nowPresent && policy && policy->getState() != ModbusLinkPolicy::BreakerState::CLOSED) {
+            policy->reset();
+        }
+        if (callback) {
+            callback(*this, address, nowPresent, context);
+        }
+    }
+}
+
+ModbusResult<size_t> ModbusBusScanner::step(size_t maxProbes) {
+    if (!mutex || !done) {
+        return ModbusResult<size_t>::error(ModbusError::RESOURCE_ERROR);
+    }
+    if (!bus->getModbusRTU()) {
+        return ModbusResult<size_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+    if (maxProbes == 0) {
+        maxProbes = config.probesPerSlice ? config.probesPerSlice : 1;
+    }
+
+    uint32_t changed[BITMAP_WORDS] = {};
+    size_t sent = 0;
+    {
+        MutexGuard lock(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS));
+        if (!lock.hasLock()) {
+            return ModbusResult<size_t>::error(ModbusError::MUTEX_ERROR);
+        }
+        if (passComplete) {
+            restartPass();
+        }
+
+        const uint32_t timeoutMs = getProbeTimeoutMs();
+        if (!beginSlice(timeoutMs)) {
+            return ModbusResult<size_t>::error(ModbusError::MUTEX_ERROR);
+        }
+        for (;;) {
+            const uint8_t address = nextAddress();
+            if (!address) {
+                passComplete = true;
+                passCount++;
+                break;
+            }
+            // Give the bus up after the slice or as soon as more urgent work waits
+            if (sent >= maxProbes || (sent > 0 && bus->shouldYield(config.priority))) {
+                lookahead = address;
+                break;
+            }
+            probed[address / 32] |= 1u << (address % 32);
+
+            uint32_t roundTripUs = 0;
+            const ModbusError error = probeLocked(address, timeoutMs, roundTripUs);
+            sent++;
+            if (recordProbe(address, answered(error), roundTripUs)) {
+                changed[address / 32] |= 1u << (address % 32);
+            }
+        }
+        endSlice();
+    }
+
+    notifyChanges(changed);
+    return ModbusResult<size_t>::ok(sent);
+}
+
+ModbusResult<size_t> ModbusBusScanner::scan() {
+    {
+        MutexGuard lock(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS));
+        if (!lock.hasLock()) {
+            return ModbusResult<size_t>::error(ModbusError::MUTEX_ERROR);
+        }
+        restartPass();
+    }
+    do {
+        auto result = step();
+        if (result.isError()) {
+            return ModbusResult<size_t>::error(result.error());
+        }
+    } while (!passComplete);
+    return ModbusResult<size_t>::ok(getPresentCount());
+}
+
+ModbusResult<uint32_t> ModbusBusScanner::probe(uint8_t address) {
+    if (address == 0 || address > MODBUS_MAX_SLAVE_ADDRESS) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_ADDRESS);
+    }
+    if (!mutex || !done) {
+        return ModbusResult<uint32_t>::error(ModbusError::RESOURCE_ERROR);
+    }
+    if (!bus->getModbusRTU()) {
+        return ModbusResult<uint32_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    uint32_t changed[BITMAP_WORDS] = {};
+    uint32_t roundTripUs = 0;
+    ModbusError error;
+    {
+        MutexGuard lock(mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS));
+        const uint32_t timeoutMs = getProbeTimeoutMs();
+        if (!lock.hasLock() || !beginSlice(timeoutMs)) {
+            return ModbusResult<uint32_t>::error(ModbusError::MUTEX_ERROR);
+        }
+        error = probeLocked(address, timeoutMs, roundTripUs);
+        endSlice();
+        if (recordProbe(address, answered(error), roundTripUs)) {
+            changed[address / 32] |= 1u << (address % 32);
+        }
+    }
+
+    notifyChanges(changed);
+    if (!answered(error)) {
+        return ModbusResult<uint32_t>::error(error);
+    }
+    return ModbusResult<uint32_t>::ok(roundTripUs);
+}
+
+bool ModbusBusScanner::isPresent(uint8_t address) const {
+    return (present[address / 32].load(std::memory_order_relaxed) >> (address % 32)) & 1u;
+}
+
+uint32_t ModbusBusScanner::getRttUs(uint8_t address) const {
+    return address <= MODBUS_MAX_SLAVE_ADDRESS ? rttUs[address].load(std::memory_order_relaxed) : 0;
+}
+
+size_t ModbusBusScanner::getPresentCount() const {
+    size_t count = 0;
+    for (const auto& word : present) {
+        count += static_cast<size_t>(__builtin_popcount(word.load(std::memory_order_relaxed)));
+    }
+    return count;
+}
+
+void ModbusBusScanner::getPresence(uint32_t (&bitmap)[BITMAP_WORDS]) const {
+    for (size_t i = 0; i < BITMAP_WORDS; i++) {
+        bitmap[i] = present[i].load(std::memory_order_relaxed);
+    }
+}
+
+bool ModbusBusScanner::start(uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+    if (task.isRunning()) {
+        return true;
+    }
+    if (!mutex || !done) {
+        return false;
+    }
+    return task.start("ModbusScan", taskEntry, this, stackSize, priority, core);
+}
+
+void ModbusBusScanner::stop() {
+    const bool wasRunning = task.requestStop();
+    task.join();
+    if (wasRunning && !task.isCurrentTask()) {
+        MODBUSD_LOG_I("Bus scanner stopped");
+    }
+}
+
+void ModbusBusScanner::taskEntry(void* param) {
+    static_cast<ModbusBusScanner*>(param)->run();
+}
+
+void ModbusBusScanner::run() {
+    while (task.isRunning()) {
+        auto result = step();
+        if (result.isError()) {
+            MODBUSD_LOG_W("Bus scan step failed: %d", static_cast<int>(result.error()));
+        }
+
+        uint32_t pauseMs = MODBUS_SCAN_SLICE_INTERVAL_MS;
+        if (passComplete) {
+            if (config.passIntervalMs == 0) {
+                task.requestStop();   // One pass only; the next start() or stop() reaps this task
+                break;
+            }
+            pauseMs = config.passIntervalMs;
+        }
+        // Sleep in slice-sized chunks so stop() does not wait out a whole pass interval
+        for (uint32_t slept = 0; task.isRunning() && slept < pauseMs; slept += MODBUS_SCAN_SLICE_INTERVAL_MS) {
+            vTaskDelay(pdMS_TO_TICKS(MODBUS_SCAN_SLICE_INTERVAL_MS));
+        }
+    }
+}
+
+} // namespace modbus
@@ -0,0 +1,287 @@
+/*
+ * ModbusBusScanner.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSBUSSCANNER_H
+#define MODBUSBUSSCANNER_H
+
+/**
+ * @file ModbusBusScanner.h
+ * @brief Address scan that finds which slaves on a bus respond
+ *
+ * Probing empty addresses with a device read costs the full response
+ * timeout each, minutes for 1-247. The scanner sends one register read per
+ * address with a timeout derived from the baud rate (a few tens of ms),
+ * records presence and round-trip time, and can run a pass in small slices
+ * at low bus priority so it coexists with normal polling.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <esp32ModbusRTU.h>
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+#include "ModbusTask.h"
+
+// Slave turnaround allowed on top of the probe's wire time
+#ifndef MODBUS_SCAN_TURNAROUND_MS
+#define MODBUS_SCAN_TURNAROUND_MS 20
+#endif
+
+// Extra probes of an address whose reply was garbled (CRC, malformed)
+#ifndef MODBUS_SCAN_RETRIES
+#define MODBUS_SCAN_RETRIES 1
+#endif
+
+// Probes per bus hold in step() and the background task
+#ifndef MODBUS_SCAN_SLICE_PROBES
+#define MODBUS_SCAN_SLICE_PROBES 8
+#endif
+
+// Pause between background slices
+#ifndef MODBUS_SCAN_SLICE_INTERVAL_MS
+#define MODBUS_SCAN_SLICE_INTERVAL_MS 50
+#endif
+
+// Pause between background passes (0 = stop after one pass)
+#ifndef MODBUS_SCAN_PASS_INTERVAL_MS
+#define MODBUS_SCAN_PASS_INTERVAL_MS 60000
+#endif
+
+#ifndef MODBUS_SCAN_STACK_SIZE
+#define MODBUS_SCAN_STACK_SIZE 3072
+#endif
+
+#ifndef MODBUS_SCAN_TASK_PRIORITY
+#define MODBUS_SCAN_TASK_PRIORITY 1
+#endif
+
+#ifndef MODBUS_SCAN_CORE
+#define MODBUS_SCAN_CORE tskNO_AFFINITY
+#endif
+
+namespace modbus {
+
+class ModbusBus;
+
+/**
+ * @class ModbusBusScanner
+ * @brief Presence scan over an address range of one bus
+ *
+ * A pass probes the candidate addresses (addCandidates()) first, then the
+ * rest of the range. An address is present if it answered at all: data or
+ * a Modbus exception both count, so the probe register need not exist.
+ * A garbled reply is retried; a timeout marks the address absent.
+ *
+ * While probing, the scanner holds the bus at its configured priority
+ * (STATUS by default) for at most probesPerSlice probes and gives it up
+ * early when bus->shouldYield() says more urgent work waits. The RTU
+ * master's response timeout is lowered to the probe timeout for the slice
+ * and set back to ModbusBus::getResponseTimeout() afterwards; async
+ * requests other tasks queue meanwhile run with the short timeout too.
+ *
+ * Presence changes are reported to the change callback, which is the place
+ * to re-initialise a replaced device. A registered device that answers
+ * again after being absent also has its link policy breaker reset.
+ *
+ * @code
+ * static modbus::ModbusBusScanner scanner;
+ * scanner.addCandidates(1, 16);            // where our devices usually live
+ * auto found = scanner.scan();             // blocking full pass
+ * for (uint8_t a = 1; a <= 247; a++) {
+ *     if (scanner.isPresent(a)) printf("%u: %lu us\n", a, scanner.getRttUs(a));
+ * }
+ * scanner.start();                         // keep re-scanning in the background
+ * @endcode
+ */
+class ModbusBusScanner {
+public:
+    static constexpr size_t BITMAP_WORDS = (MODBUS_MAX_SLAVE_ADDRESS + 32) / 32;
+
+    struct Config {
+        uint8_t firstAddress = 1;
+        uint8_t lastAddress = MODBUS_MAX_SLAVE_ADDRESS;
+        uint8_t functionCode = 0x03;          ///< 0x03 or 0x04, count 1
+        uint16_t probeRegister = 0;
+        uint32_t probeTimeoutMs = 0;          ///< 0 = wire time at the bus baud rate + MODBUS_SCAN_TURNAROUND_MS
+        uint8_t retries = MODBUS_SCAN_RETRIES;
+        uint8_t probesPerSlice = MODBUS_SCAN_SLICE_PROBES;
+        uint32_t passIntervalMs = MODBUS_SCAN_PASS_INTERVAL_MS;
+        esp32Modbus::ModbusPriority priority = esp32Modbus::STATUS;
+    };
+
+    using ChangeCallback = void (*)(ModbusBusScanner& scanner, uint8_t address, bool present, void* context);
+
+    /**
+     * @param bus Bus to scan (nullptr = default bus)
+     */
+    explicit ModbusBusScanner(ModbusBus* bus = nullptr);
+    ~ModbusBusScanner();
+
+    ModbusBusScanner(const ModbusBusScanner&) = delete;
+    ModbusBusScanner& operator=(const ModbusBusScanner&) = delete;
+
+    /**
+     * @return false (config unchanged) for an empty range or an FC other than 0x03/0x04
+     */
+    bool setConfig(const Config& config);
+    const Config& getConfig() const { return config; }
+
+    /**
+     * @brief Probe an address range first in every pass
+     */
+    bool addCandidates(uint8_t firstAddress, uint8_t lastAddress);
+    void clearCandidates();
+
+    void setChangeCallback(ChangeCallback callback, void* context = nullptr);
+
+    /**
+     * @brief Run one full pass, restarting any pass in progress
+     * @return Number of addresses present after the pass
+     */
+    ModbusResult<size_t> scan();
+
+    /**
+     * @brief Probe the next addresses of the current pass
+     *
+     * Starts a new pass after the previous one completed.
+     *
+     * @param maxProbes Probes in this bus hold (0 = config.probesPerSlice)
+     * @return Probes sent; MUTEX_ERROR if the bus could not be taken
+     */
+    ModbusResult<size_t> step(size_t maxProbes = 0);
+
+    /**
+     * @brief Probe one address now
+     * @return Round trip in microseconds; TIMEOUT if nothing answered
+     */
+    ModbusResult<uint32_t> probe(uint8_t address);
+
+    /**
+     * @brief Whether the last step() finished a pass
+     */
+    bool isPassComplete() const { return passComplete; }
+
+    uint32_t getPassCount() const { return passCount; }
+
+    bool isPresent(uint8_t address) const;
+
+    /**
+     * @brief Round trip of the last answered probe (0 if never answered)
+     */
+    uint32_t getRttUs(uint8_t address) const;
+
+    size_t getPresentCount() const;
+
+    /**
+     * @brief Copy the presence bitmap (bit a % 32 of word a / 32 = address a)
+     */
+    void getPresence(uint32_t (&bitmap)[BITMAP_WORDS]) const;
+
+    /**
+     * @brief Probe timeout in use (configured, or derived from the bus baud rate)
+     */
+    uint32_t getProbeTimeoutMs() const;
+
+    /**
+     * @brief Scan in slices on a low-priority task
+     * @param stackSize Task stack (at most MODBUS_SCAN_STACK_SIZE with
+     *        MODBUSDEVICE_STATIC_ALLOCATION)
+     * @return true if the task is running
+     */
+    bool start(uint32_t stackSize = MODBUS_SCAN_STACK_SIZE,
+               UBaseType_t priority = MODBUS_SCAN_TASK_PRIORITY, BaseType_t core = MODBUS_SCAN_CORE);
+
+    /**
+     * @brief Stop the task after its current slice
+     */
+    void stop();
+
+    bool isRunning() const { return task.isRunning(); }
+
+    /**
+     * @brief Hand a probe reply to the scanner
+     *
+     * Called by ModbusBus for every frame while the scanner holds the bus.
+     *
+     * @param fc Function code of a data reply, 0 for an error
+     * @return true if the frame answered the pending probe
+     */
+    bool completeProbe(uint8_t address, uint8_t fc, ModbusError error);
+
+private:
+    /// Next address of the current pass, 0 when the pass is done
+    uint8_t nextAddress();
+    void restartPass();
+
+    // Take the bus with the short RTU timeout and route replies here; endSlice() undoes both
+    bool beginSlice(uint32_t timeoutMs);
+    void endSlice();
+    ModbusError probeLocked(uint8_t address, uint32_t timeoutMs, uint32_t& roundTripUs);
+
+    /// @return true if the address's presence changed
+    bool recordProbe(uint8_t address, bool isPresent, uint32_t roundTripUs);
+    void notifyChanges(const uint32_t (&changed)[BITMAP_WORDS]);
+    static bool testBit(const uint32_t* bitmap, uint8_t address) {
+        return (bitmap[address / 32] >> (address % 32)) & 1u;
+    }
+
+    static void taskEntry(void* param);
+    void run();
+
+    ModbusBus* bus;
+    Config config;
+    ChangeCallback changeCallback = nullptr;
+    void* changeContext = nullptr;
+
+    // Pass state; guarded by mutex
+    uint32_t candidates[BITMAP_WORDS] = {};
+    uint32_t probed[BITMAP_WORDS] = {};
+    uint16_t cursor = 0;
+    bool candidatePhase = true;
+    uint8_t lookahead = 0;   ///< Address taken from the pass but left for the next slice
+    std::atomic<bool> passComplete{false};
+    std::atomic<uint32_t> passCount{0};
+
+    // Results; written under mutex, readable from any task
+    std::atomic<uint32_t> present[BITMAP_WORDS] = {};
+    std::atomic<uint32_t> rttUs[MODBUS_MAX_SLAVE_ADDRESS + 1] = {};
+
+    // Pending probe, completed from the RTU callback task
+    std::atomic<uint8_t> pendingAddress{0};
+    std::atomic<uint8_t> pendingFc{0};
+    ModbusError pendingResult = ModbusError::SUCCESS;
+    SemaphoreHandle_t done = nullptr;
+
+    SemaphoreHandle_t mutex = nullptr;
+
+    SemaphoreStorage mutexStorage;
+    SemaphoreStorage doneStorage;
+    ModbusTask<MODBUS_SCAN_STACK_SIZE> task;
+};
+
+} // namespace modbus
+
+#endif // MODBUSBUSSCANNER_H
@@ -21,23 +21,35 @@
 
 #include "ModbusDevice.h"
 #include "ModbusRegistry.h"
+#include "BusScheduler.h"
+#include "ModbusRegisterCache.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusPollBudget.h"
+#include "ModbusTrace.h"
 #include <cstring>
 #include <algorithm>
 #include <new>  // for std::nothrow
+#include <esp_timer.h>
 
-// Static mutex is now just a convenience pointer to the registry's bus mutex
-SemaphoreHandle_t modbus::ModbusDevice::modbusMutex = nullptr;
 
 namespace modbus {
 
 // Constructor
 ModbusDevice::ModbusDevice(uint8_t serverAddr)
-    : serverAddress(serverAddr) {
+    : serverAddress(serverAddr), bus(&ModbusRegistry::getInstance().getDefaultBus()) {
     // Validate address
     if (serverAddr == 0 || serverAddr > MODBUS_MAX_SLAVE_ADDRESS) {
         MODBUSD_LOG_W("Invalid Modbus address %d, using 1", serverAddr);
         serverAddress = 1;
     }
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    // The slots live inside this object; fill them now so the lazy paths
+    // below never race to initialize the same storage
+    createSyncResources();
+    getWriteBuffer();
+    getReadFlight();
+    asyncMutex = createMutex(asyncMutexStorage);
+#endif
     MODBUSD_LOG_D("ModbusDevice constructed for address %d", serverAddress);
 }
 
@@ -45,14 +57,30 @@ ModbusDevice::ModbusDevice(uint8_t serverAddr)
 ModbusDevice::~ModbusDevice() {
     // Unregister if still registered
     unregisterDevice();
+
+    // Reports of our frames can no longer reach us; give their lease back
+    for (uint8_t i = 0; i < outstandingCount; i++) {
+        if (outstanding[i].leased) {
+            bus->endAsync();
+        }
+    }
     
     // Clean up sync resources if allocated
     if (syncContext && syncContext->semaphore) {
         vSemaphoreDelete(syncContext->semaphore);
     }
+    syncSlot.release(syncContext);
     if (syncMutex) {
         vSemaphoreDelete(syncMutex);
     }
+    if (asyncMutex) {
+        vSemaphoreDelete(asyncMutex);
+    }
+    if (writeBuffer && writeBuffer->mutex) {
+        vSemaphoreDelete(writeBuffer->mutex);
+    }
+    writeSlot.release(writeBuffer);
+    readSlot.release(readFlight.load());
 }
 
 // Set server address
@@ -78,9 +106,30 @@ ModbusResult<void> ModbusDevice::setServerAddress(uint8_t address) {
     return ModbusResult<void>::ok();
 }
 
+// Move the device to another bus
+ModbusResult<void> ModbusDevice::setBus(ModbusBus& newBus) {
+    if (&newBus == bus) {
+        return ModbusResult<void>::ok();
+    }
+
+    // Follow the registration over so responses keep reaching us
+    const bool wasRegistered = bus->getDevice(serverAddress) == this;
+    if (wasRegistered) {
+        bus->unregisterDevice(serverAddress, this);
+    }
+    bus = &newBus;
+    if (wasRegistered) {
+        ModbusError err = registerDevice();
+        if (err != ModbusError::SUCCESS) {
+            return ModbusResult<void>::error(err);
+        }
+    }
+    return ModbusResult<void>::ok();
+}
+
 // Register device
 ModbusError ModbusDevice::registerDevice() {
-    if (ModbusRegistry::getInstance().registerDevice(serverAddress, this)) {
+    if (bus->registerDevice(serverAddress, this)) {
         return ModbusError::SUCCESS;
     }
     return ModbusError::MUTEX_ERROR;
@@ -88,32 +137,49 @@ ModbusError ModbusDevice::registerDevice() {
 
 // Unregister device
 ModbusError ModbusDevice::unregisterDevice() {
-    ModbusRegistry::getInstance().unregisterDevice(serverAddress);
+    bus->unregisterDevice(serverAddress, this);
     return ModbusError::SUCCESS;
 }
 
 // Ensure sync resources are ready
 void ModbusDevice::ensureSyncReady() {
+    ensureSyncReady(SyncSink());
+}
+
+bool ModbusDevice::createSyncResources() {
     if (!syncContext) {
-        syncContext = std::make_unique<SyncContext>();
-        syncContext->semaphore = xSemaphoreCreateBinary();
-        if (!syncContext->semaphore) {
+        SyncContext* context = syncSlot.acquire();
+        if (!context) {
+            MODBUSD_LOG_E("Failed to allocate sync context");
+            return false;
+        }
+        context->semaphore = createBinarySemaphore(context->semaphoreStorage);
+        if (!context->semaphore) {
             MODBUSD_LOG_E("Failed to create sync semaphore");
-            syncContext.reset();
-            return;
+            syncSlot.release(context);
+            return false;
         }
+        syncContext = context;
     }
     if (!syncMutex) {
-        syncMutex = xSemaphoreCreateMutex();
+        syncMutex = createMutex(syncMutexStorage);
         if (!syncMutex) {
             MODBUSD_LOG_E("Failed to create sync mutex");
         }
     }
+    return syncMutex != nullptr;
+}
 
-    // CRITICAL: Register with ModbusRegistry before any sync requests
-    // Without registration, responses are silently dropped by mainHandleData()
+void ModbusDevice::ensureSyncReady(const SyncSink& sink) {
+    createSyncResources();
+    if (!syncContext) {
+        return;
+    }
+
+    // CRITICAL: Register with the bus before any sync requests
+    // Without registration, responses are silently dropped by the bus handlers
     // causing spurious timeouts during device initialization
-    if (!ModbusRegistry::getInstance().getDevice(serverAddress)) {
+    if (!bus->getDevice(serverAddress)) {
         registerDevice();
     }
 
@@ -128,7 +194,9 @@ void ModbusDevice::ensureSyncReady() {
         if (xSemaphoreTake(syncMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
             syncContext->responseReceived = false;
             syncContext->errorOccurred = false;
-            syncContext->responseData.clear();
+            syncContext->responseLength = 0;
+            syncContext->sink = sink;
+            syncContext->decodedCount = 0;
             while (xSemaphoreTake(syncContext->semaphore, 0) == pdTRUE) {
                 // drain stale tokens
             }
@@ -137,32 +205,33 @@ void ModbusDevice::ensureSyncReady() {
     }
 }
 
-// Acquire bus mutex
-bool ModbusDevice::acquireBusMutex(uint32_t timeoutMs) {
-    // Lazy initialization from registry's bus mutex
-    if (!modbusMutex) {
-        modbusMutex = ModbusRegistry::getInstance().getBusMutex();
-        if (!modbusMutex) {
-            MODBUSD_LOG_E("Modbus mutex not initialized");
-            return false;
-        }
+// Detach caller buffer after a transaction
+void ModbusDevice::disarmSyncSink() {
+    if (!syncContext) {
+        return;
     }
-    if (xSemaphoreTake(modbusMutex, pdMS_TO_TICKS(timeoutMs)) != pdTRUE) {
-        MODBUSD_LOG_W("Bus mutex timeout after %lu ms", (unsigned long)timeoutMs);
-        return false;
+    if (syncContext->sink.buffer == nullptr) {
+        return;
     }
-    return true;
+    // Must not return while handleData() may still be writing into the caller's
+    // (typically stack) buffer, so wait for syncMutex without a timeout; the
+    // callback only holds it for the duration of one decode.
+    if (syncMutex && xSemaphoreTake(syncMutex, portMAX_DELAY) == pdTRUE) {
+        syncContext->sink = SyncSink{};
+        xSemaphoreGive(syncMutex);
+    } else {
+        syncContext->sink = SyncSink{};
+    }
+}
+
+// Acquire bus mutex (PRECISE timing also waits out the remaining gap)
+bool ModbusDevice::acquireBusMutex(uint32_t timeoutMs, esp32Modbus::ModbusPriority priority) {
+    return bus->acquireBusMutex(timeoutMs, priority);
 }
 
 // Release bus mutex with inter-frame delay
 void ModbusDevice::releaseBusMutex() {
-    if (modbusMutex) {
-        // Enforce Modbus RTU inter-frame delay (3.5 character times) before releasing.
-        // This prevents bus collisions when another device immediately acquires the mutex.
-        // Without this delay, the next transmission may start before the bus has settled.
-        vTaskDelay(pdMS_TO_TICKS(MODBUS_INTER_FRAME_DELAY_MS));
-        xSemaphoreGive(modbusMutex);
-    }
+    bus->releaseBusMutex();
 }
 
 // Send request (legacy - acquires mutex, for backward compatibility)
@@ -178,7 +247,7 @@ esp_err_t ModbusDevice::sendRequest(uint8_t fc, uint16_t addr, uint16_t count, u
     return result;
 }
 
-// Send request internal (caller must hold modbusMutex)
+// Send request internal (caller must hold the bus mutex)
 esp_err_t ModbusDevice::sendRequestInternal(uint8_t fc, uint16_t addr, uint16_t count, uint16_t* data) {
     // Default to RELAY priority for backward compatibility
     return sendRequestWithPriority(fc, addr, count, esp32Modbus::RELAY, data);
@@ -187,12 +256,6 @@ esp_err_t ModbusDevice::sendRequestInternal(uint8_t fc, uint16_t addr, uint16_t
 esp_err_t ModbusDevice::sendRequestWithPriority(uint8_t fc, uint16_t addr, uint16_t count,
                                                 esp32Modbus::ModbusPriority priority,
                                                 uint16_t* data) {
-    auto* rtu = ModbusRegistry::getInstance().getModbusRTU();
-    if (!rtu) {
-        MODBUSD_LOG_E("ModbusRTU not set in registry");
-        return ESP_FAIL;
-    }
-
     // F18: record the function code of the in-flight request so handleData() can
     // reject a response whose FC does not match (e.g. a stale/late frame from a
     // prior transaction of a different type accepted as this one's reply).
@@ -200,80 +263,125 @@ esp_err_t ModbusDevice::sendRequestWithPriority(uint8_t fc, uint16_t addr, uint1
         syncContext->expectedFc = fc;
     }
 
-    esp_err_t result = ESP_FAIL;
+    return dispatchRequest(fc, addr, count, priority, data);
+}
 
-    switch (fc) {
-        case 0x03:
-            result = rtu->readHoldingRegistersWithPriority(serverAddress, addr, count, priority) ? ESP_OK : ESP_FAIL;
-            break;
-        case 0x04:
-            result = rtu->readInputRegistersWithPriority(serverAddress, addr, count, priority) ? ESP_OK : ESP_FAIL;
-            break;
-        case 0x01:
-            result = rtu->readCoilsWithPriority(serverAddress, addr, count, priority) ? ESP_OK : ESP_FAIL;
-            break;
-        case 0x02:
-            result = rtu->readDiscreteInputsWithPriority(serverAddress, addr, count, priority) ? ESP_OK : ESP_FAIL;
-            break;
-        case 0x06:
-            if (data) {
-                result = rtu->writeSingleHoldingRegisterWithPriority(serverAddress, addr, data[0], priority) ? ESP_OK : ESP_FAIL;
-            }
-            break;
-        case 0x10:
-            if (data && count > 0) {
-                uint8_t* byteData = new (std::nothrow) uint8_t[count * 2];
-                if (!byteData) {
-                    MODBUSD_LOG_E("Failed to allocate %u bytes for FC10", count * 2);
-                    result = ESP_ERR_NO_MEM;
-                    break;
-                }
-                for (uint16_t i = 0; i < count; i++) {
-                    byteData[i * 2] = (data[i] >> 8) & 0xFF;
-                    byteData[i * 2 + 1] = data[i] & 0xFF;
-                }
-                result = rtu->writeMultHoldingRegistersWithPriority(serverAddress, addr, count, byteData, priority) ? ESP_OK : ESP_FAIL;
-                delete[] byteData;
-            }
-            break;
-        case 0x05:
-            if (data) {
-                result = rtu->writeSingleCoilWithPriority(serverAddress, addr, data[0] != 0, priority) ? ESP_OK : ESP_FAIL;
-            }
-            break;
-        case 0x0F:
-            if (data && count > 0) {
-                bool* boolData = new (std::nothrow) bool[count];
-                if (!boolData) {
-                    MODBUSD_LOG_E("Failed to allocate %u bools for FC15", count);
-                    result = ESP_ERR_NO_MEM;
-                    break;
-                }
-                for (uint16_t i = 0; i < count; i++) {
-                    uint16_t wordIndex = i / 16;
-                    uint16_t bitIndex = i % 16;
-                    boolData[i] = (data[wordIndex] & (1 << bitIndex)) != 0;
-                }
-                result = rtu->writeMultipleCoilsWithPriority(serverAddress, addr, count, boolData, priority) ? ESP_OK : ESP_FAIL;
-                delete[] boolData;
-            }
-            break;
+esp_err_t ModbusDevice::dispatchRequest(uint8_t fc, uint16_t addr, uint16_t count,
+                                        esp32Modbus::ModbusPriority priority,
+                                        const uint16_t* data, uint32_t txn, bool async, bool leased) {
+    Outstanding request;
+    request.txn = txn ? txn : newTransactionId();
+    request.functionCode = fc;
+    request.address = addr;
+    request.async = async;
+    request.leased = leased;
+    request.priority = priority;
+    if (!async && syncContext) {
+        syncContext->expectedTxn = request.txn;
+    }
+    // Recorded first: the RTU may answer before dispatch() returns. An
+    // async request is only reachable through its entry, so it needs one.
+    if (!pushOutstanding(request) && async) {
+        lastError = ModbusError::MUTEX_ERROR;
+        return ESP_FAIL;
     }
 
+    esp_err_t result = bus->dispatch(serverAddress, fc, addr, count, request.priority, data) ? ESP_OK : ESP_FAIL;
+
     totalRequests++;
     if (result != ESP_OK) {
+        dropOutstanding(request.txn);
         lastError = ModbusError::COMMUNICATION_ERROR;
     }
 
     return result;
 }
 
-// Wait for response
-ModbusResult<std::vector<uint8_t>> ModbusDevice::waitForResponse(TickType_t timeout) {
+bool ModbusDevice::createAsyncMutex() {
+    if (!asyncMutex) {
+        asyncMutex = createMutex(asyncMutexStorage);
+        if (!asyncMutex) {
+            MODBUSD_LOG_E("Failed to create async mutex");
+        }
+    }
+    return asyncMutex != nullptr;
+}
+
+uint32_t ModbusDevice::newTransactionId() {
+    uint32_t txn = nextTransaction.fetch_add(1);
+    if (txn == 0) {
+        txn = nextTransaction.fetch_add(1);  // 0 is reserved for "no request"
+    }
+    return txn;
+}
+
+bool ModbusDevice::pushOutstanding(Outstanding& request) {
+    if (!createAsyncMutex() || xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;  // Untracked: the frame is matched by FC alone, as before the FIFO
+    }
+    if (outstandingCount > 0) {
+        // Same RTU priority as the frames ahead of it, or it could overtake them
+        request.priority = outstanding[0].priority;
+    }
+    bool lostLease = false;
+    if (outstandingCount == MODBUS_DEVICE_MAX_OUTSTANDING) {
+        // The RTU reports every request it queued, so the oldest entry was lost
+        MODBUSD_LOG_W("Device %d: outstanding request %lu never completed", serverAddress,
+                      (unsigned long)outstanding[0].txn);
+        lostLease = outstanding[0].leased;
+        std::memmove(outstanding, outstanding + 1, (outstandingCount - 1) * sizeof(Outstanding));
+        outstandingCount--;
+    }
+    outstanding[outstandingCount++] = request;
+    xSemaphoreGive(asyncMutex);
+
+    if (lostLease) {
+        bus->endAsync();   // Its report will not come to end it
+    }
+    return true;
+}
+
+void ModbusDevice::dropOutstanding(uint32_t txn) {
+    if (!asyncMutex || xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return;
+    }
+    for (uint8_t i = 0; i < outstandingCount; i++) {
+        if (outstanding[i].txn == txn) {
+            std::memmove(outstanding + i, outstanding + i + 1, (outstandingCount - i - 1) * sizeof(Outstanding));
+            outstandingCount--;
+            break;
+        }
+    }
+    xSemaphoreGive(asyncMutex);
+}
+
+bool ModbusDevice::takeOutstanding(uint8_t fc, uint16_t address, bool anyRequest, Outstanding& out) {
+    if (!asyncMutex || xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
+    }
+
+    // Oldest first: with the priority pinned the RTU answers in queue order
+    bool found = false;
+    for (uint8_t i = 0; i < outstandingCount; i++) {
+        if (anyRequest || (outstanding[i].functionCode == fc && outstanding[i].address == address)) {
+            out = outstanding[i];
+            std::memmove(outstanding + i, outstanding + i + 1, (outstandingCount - i - 1) * sizeof(Outstanding));
+            outstandingCount--;
+            found = true;
+            break;
+        }
+    }
+
+    xSemaphoreGive(asyncMutex);
+    return found;
+}
+
+// Wait for completion (payload stays in the armed sink)
+ModbusResult<void> ModbusDevice::waitForCompletion(TickType_t timeout) {
     if (!syncContext || !syncContext->semaphore) {
-        return ModbusResult<std::vector<uint8_t>>::error(ModbusError::NOT_INITIALIZED);
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
     }
-    
+
     // F17: do NOT clear the flags here - they were reset in ensureSyncReady()
     // BEFORE the request was sent. Clearing after the request is in flight (as
     // before) reopened the race where a fast response landing between send and
@@ -282,210 +390,604 @@ ModbusResult<std::vector<uint8_t>> ModbusDevice::waitForResponse(TickType_t time
     // Wait for response
     if (xSemaphoreTake(syncContext->semaphore, timeout) == pdTRUE) {
         if (syncContext->errorOccurred) {
-            return ModbusResult<std::vector<uint8_t>>::error(syncContext->error);
+            return ModbusResult<void>::error(syncContext->error);
         }
         if (syncContext->responseReceived) {
             successfulRequests++;
-            // Copy the payload under syncMutex so a late handleData mutating the
-            // vector cannot race this read.
-            std::vector<uint8_t> payload;
-            if (syncMutex && xSemaphoreTake(syncMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
-                payload = syncContext->responseData;
-                xSemaphoreGive(syncMutex);
-            } else {
-                payload = syncContext->responseData;
-            }
-            return ModbusResult<std::vector<uint8_t>>::ok(payload);
+            return ModbusResult<void>::ok();
         }
     }
-    
+
     timeouts++;
     lastError = ModbusError::TIMEOUT;
-    return ModbusResult<std::vector<uint8_t>>::error(ModbusError::TIMEOUT);
+    return ModbusResult<void>::error(ModbusError::TIMEOUT);
 }
 
-// Read holding registers
-ModbusResult<std::vector<uint16_t>> ModbusDevice::readHoldingRegisters(uint16_t address, uint16_t count) {
-    // Default to RELAY priority for backward compatibility
-    return readHoldingRegistersWithPriority(address, count, esp32Modbus::RELAY);
+// Wait for response
+ModbusResult<std::vector<uint8_t>> ModbusDevice::waitForResponse(TickType_t timeout) {
+    auto result = waitForCompletion(timeout);
+    if (!result.isOk()) {
+        return ModbusResult<std::vector<uint8_t>>::error(result.error());
+    }
+
+    // Copy the payload under syncMutex so a late handleData mutating the
+    // vector cannot race this read.
+    const uint8_t* data = syncContext->responseData;
+    std::vector<uint8_t> payload;
+    if (syncMutex && xSemaphoreTake(syncMutex, pdMS_TO_TICKS(50)) == pdTRUE) {
+        payload.assign(data, data + syncContext->responseLength);
+        xSemaphoreGive(syncMutex);
+    } else {
+        payload.assign(data, data + syncContext->responseLength);
+    }
+    return ModbusResult<std::vector<uint8_t>>::ok(payload);
 }
 
-ModbusResult<std::vector<uint16_t>> ModbusDevice::readHoldingRegistersWithPriority(uint16_t address, uint16_t count, esp32Modbus::ModbusPriority priority) {
-    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::INVALID_PARAMETER);
+// Run one transaction (request + response) while holding the bus mutex
+ModbusResult<void> ModbusDevice::transact(uint8_t fc, uint16_t address, uint16_t count,
+                                          esp32Modbus::ModbusPriority priority, uint16_t* data,
+                                          const SyncSink& sink, [[maybe_unused]] const char* opName,
+                                          size_t* decoded) {
+    // A running bus worker owns the bus; queue to it instead of taking the mutex.
+    // Its completion callbacks run after it released the bus and take the
+    // direct path below (queueing to itself would never complete).
+    BusScheduler* worker = bus->getWorker();
+    if (worker && !worker->isWorkerTask()) {
+        return transactViaWorker(*worker, fc, address, count, priority, data, sink, decoded);
     }
 
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for readHoldingRegisters");
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::MUTEX_ERROR);
+    // An open breaker fails fast without waiting for the bus
+    ModbusLinkPolicy* policy = linkPolicy;
+    if (policy && !policy->allowRequest(serverAddress)) {
+        return ModbusResult<void>::error(ModbusError::DEVICE_NOT_FOUND);
     }
 
-    ensureSyncReady();
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    const int64_t startUs = esp_timer_get_time();
+#endif
 
-    if (sendRequestWithPriority(0x03, address, count, priority) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::COMMUNICATION_ERROR);
+    // Acquire bus mutex for entire transaction (request + response)
+    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, priority)) {
+        MODBUSD_LOG_W("Failed to acquire bus mutex for %s", opName);
+        if (policy) {
+            policy->recordResult(serverAddress, ModbusError::MUTEX_ERROR, 0);
+        }
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
     }
 
-    auto result = waitForResponse();
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    // In PRECISE mode acquireBusMutex() also waited out the previous frame's gap
+    const bool precise = bus->getInterFrameTiming() == ModbusBus::InterFrameTiming::PRECISE;
+    const uint32_t gapUs = precise ? bus->getLastGapWaitUs() : 0;
+    recordLatency(LatencyPhase::MUTEX_WAIT, esp_timer_get_time() - startUs - gapUs);
+#endif
+
+    auto result = transactLocked(fc, address, count, priority, data, sink, 0, decoded);
+
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    const int64_t releaseUs = esp_timer_get_time();
+#endif
 
     releaseBusMutex();  // Release after response received
 
-    if (!result.isOk()) {
-        return ModbusResult<std::vector<uint16_t>>::error(result.error());
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    const int64_t endUs = esp_timer_get_time();
+    recordLatency(LatencyPhase::INTER_FRAME, precise ? gapUs : endUs - releaseUs);
+    recordLatency(LatencyPhase::TOTAL, endUs - startUs);
+    ModbusLatencyStats::recordTransaction(fc, static_cast<uint32_t>(endUs - startUs));
+#endif
+
+    return result;
+}
+
+// Request + response without touching the bus mutex (caller holds it)
+ModbusResult<void> ModbusDevice::transactLocked(uint8_t fc, uint16_t address, uint16_t count,
+                                                esp32Modbus::ModbusPriority priority, uint16_t* data,
+                                                const SyncSink& sink, TickType_t timeout, size_t* decoded) {
+    ModbusLinkPolicy* policy = linkPolicy;
+    // The policy learns slave time; this request's frames come on top
+    const uint32_t wireUs = policy ? ModbusPollBudget::estimateTransactionUs(fc, count, bus->getBaudRate()) : 0;
+    uint32_t rtuTimeoutMs = 0;   // 0 = the bus default
+    if (timeout == 0) {
+        rtuTimeoutMs = policy ? policy->getTimeoutMs(serverAddress, wireUs) : 0;
+        timeout = policy ? policy->getTimeout(serverAddress, wireUs) : pdMS_TO_TICKS(1000);
+    }
+
+    ensureSyncReady(sink);
+
+    // The RTU gives up at the adaptive timeout too; a reply that still
+    // arrives later is dropped by transaction id
+    if (rtuTimeoutMs) {
+        bus->setTransactionTimeout(rtuTimeoutMs);
+    }
+
+#if defined(MODBUSDEVICE_LATENCY_STATS) || defined(MODBUSDEVICE_TRACE)
+    const int64_t sendUs = esp_timer_get_time();
+#endif
+
+    if (sendRequestWithPriority(fc, address, count, priority, data) != ESP_OK) {
+        disarmSyncSink();
+        if (rtuTimeoutMs) {
+            bus->setTransactionTimeout(0);
+        }
+#ifdef MODBUSDEVICE_TRACE
+        traceTransaction(TraceKind::SYNC, bus->getId(), serverAddress, fc, address, count,
+                         ModbusError::COMMUNICATION_ERROR, priority, sendUs, bus->getGrantWaitUs(), 0);
+#endif
+        if (policy) {
+            policy->recordResult(serverAddress, ModbusError::COMMUNICATION_ERROR, 0);
+        }
+        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
     }
 
-    // Convert bytes to uint16_t
-    std::vector<uint16_t> values;
-    const auto& data = result.value();
-    for (size_t i = 0; i + 1 < data.size(); i += 2) {
-        values.push_back((static_cast<uint16_t>(data[i]) << 8) | data[i + 1]);
+    const int64_t sentUs = esp_timer_get_time();
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    recordLatency(LatencyPhase::SEND, sentUs - sendUs);
+#endif
+
+    auto result = waitForCompletion(timeout);
+    const int64_t completedUs = esp_timer_get_time();
+
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    recordLatency(LatencyPhase::ROUND_TRIP, completedUs - sentUs);
+#endif
+
+    disarmSyncSink();
+    if (rtuTimeoutMs) {
+        bus->setTransactionTimeout(0);
     }
 
-    return ModbusResult<std::vector<uint16_t>>::ok(values);
+#ifdef MODBUSDEVICE_TRACE
+    traceTransaction(TraceKind::SYNC, bus->getId(), serverAddress, fc, address, count,
+                     result.isOk() ? ModbusError::SUCCESS : result.error(), priority,
+                     sendUs, bus->getGrantWaitUs(), static_cast<uint32_t>(completedUs - sendUs));
+#endif
+
+    if (policy) {
+        policy->recordResult(serverAddress, result.isOk() ? ModbusError::SUCCESS : result.error(),
+                             static_cast<uint32_t>(completedUs - sentUs), wireUs);
+    }
+    if (decoded) {
+        *decoded = (result.isOk() && syncContext) ? syncContext->decodedCount : 0;
+    }
+
+    return result;
 }
 
-// Read input registers
-ModbusResult<std::vector<uint16_t>> ModbusDevice::readInputRegisters(uint16_t address, uint16_t count) {
-    // Default to RELAY priority for backward compatibility
-    return readInputRegistersWithPriority(address, count, esp32Modbus::RELAY);
+// Hand the transaction to the bus worker and sleep until it notifies us
+ModbusResult<void> ModbusDevice::transactViaWorker(BusScheduler& worker, uint8_t fc, uint16_t address,
+                                                   uint16_t count, esp32Modbus::ModbusPriority priority,
+                                                   uint16_t* data, const SyncSink& sink, size_t* decoded) {
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    const int64_t startUs = esp_timer_get_time();
+#endif
+
+    BusScheduler::Job job;
+    job.device = this;
+    job.functionCode = fc;
+    job.address = address;
+    job.count = count;
+    job.priority = priority;
+
+    // Jobs take bit writes as a byte-packed bitset; transact() gets 16 per word
+    uint8_t bits[(MODBUS_MAX_WRITE_COIL_COUNT + 7) / 8];
+    switch (fc) {
+        case 0x03:
+        case 0x04:
+            job.registers = static_cast<uint16_t*>(sink.buffer);
+            job.capacity = sink.capacity;
+            break;
+        case 0x01:
+        case 0x02:
+            job.bits = static_cast<uint8_t*>(sink.buffer);
+            job.capacity = sink.capacity;
+            break;
+        case 0x05:
+            bits[0] = (data && data[0]) ? 1 : 0;
+            job.bits = bits;
+            job.capacity = 1;
+            break;
+        case 0x06:
+        case 0x10:
+            job.registers = data;
+            job.capacity = count;
+            break;
+        case 0x0F:
+            if (data && count <= MODBUS_MAX_WRITE_COIL_COUNT) {
+                for (size_t i = 0; i < static_cast<size_t>((count + 7) / 8); i++) {
+                    bits[i] = static_cast<uint8_t>(data[i / 2] >> ((i % 2) * 8));
+                }
+                job.bits = bits;
+                job.capacity = (count + 7) / 8;
+            }
+            break;
+        default:
+            break;
+    }
+
+    size_t n = 0;
+    ModbusError error = worker.runSync(job, n);
+
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    const int64_t endUs = esp_timer_get_time();
+    recordLatency(LatencyPhase::TOTAL, endUs - startUs);
+    ModbusLatencyStats::recordTransaction(fc, static_cast<uint32_t>(endUs - startUs));
+#endif
+
+    if (decoded) {
+        // Jobs report bits for bit reads; callers here count bytes like SyncContext
+        *decoded = (fc == 0x01 || fc == 0x02) ? (n + 7) / 8 : n;
+    }
+    if (error != ModbusError::SUCCESS) {
+        return ModbusResult<void>::error(error);
+    }
+    return ModbusResult<void>::ok();
 }
 
-ModbusResult<std::vector<uint16_t>> ModbusDevice::readInputRegistersWithPriority(uint16_t address, uint16_t count, esp32Modbus::ModbusPriority priority) {
+// Read a register block into caller storage
+ModbusResult<size_t> ModbusDevice::readRegisterBlock(uint8_t fc, uint16_t address, uint16_t count,
+                                                     uint16_t* dest, size_t capacity,
+                                                     esp32Modbus::ModbusPriority priority,
+                                                     const char* opName) {
     if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::INVALID_PARAMETER);
+        return ModbusResult<size_t>::error(ModbusError::INVALID_PARAMETER);
     }
-
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for readInputRegisters");
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::MUTEX_ERROR);
+    if (!dest) {
+        return ModbusResult<size_t>::error(ModbusError::NULL_POINTER);
+    }
+    if (capacity < count) {
+        return ModbusResult<size_t>::error(ModbusError::INVALID_DATA_LENGTH);
     }
 
-    ensureSyncReady();
+    ModbusRegisterCache* cache = registerCache;
+    if (cache) {
+        if (cache->lookup(fc, address, count, dest)) {
+            return ModbusResult<size_t>::ok(count);  // Fresh hit, bus untouched
+        }
+
+        // Read-through: refresh the whole covering range so neighbours hit too
+        uint16_t rangeAddress = 0;
+        uint16_t rangeCount = 0;
+        if (cache->findRange(fc, address, count, rangeAddress, rangeCount) &&
+            (rangeAddress != address || rangeCount != count)) {
+            uint16_t block[MODBUS_MAX_REGISTER_COUNT];
+            size_t decoded = 0;
+            auto result = sharedRead(fc, rangeAddress, rangeCount, block, priority, opName, &decoded);
+            if (!result.isOk()) {
+                return ModbusResult<size_t>::error(result.error());
+            }
+            cache->store(fc, rangeAddress, static_cast<uint16_t>(decoded), block);
 
-    if (sendRequestWithPriority(0x04, address, count, priority) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::COMMUNICATION_ERROR);
+            size_t offset = address - rangeAddress;
+            size_t n = (decoded > offset) ? std::min<size_t>(decoded - offset, count) : 0;
+            std::memcpy(dest, block + offset, n * sizeof(uint16_t));
+            return ModbusResult<size_t>::ok(n);
+        }
     }
 
-    auto result = waitForResponse();
+    size_t decoded = 0;
+    auto result = sharedRead(fc, address, count, dest, priority, opName, &decoded);
+    if (!result.isOk()) {
+        return ModbusResult<size_t>::error(result.error());
+    }
+    if (cache) {
+        cache->store(fc, address, static_cast<uint16_t>(decoded), dest);
+    }
+    return ModbusResult<size_t>::ok(decoded);
+}
 
-    releaseBusMutex();  // Release after response received
+ModbusDevice::ReadFlight::~ReadFlight() {
+    for (auto& waiter : waiters) {
+        if (waiter.wake) {
+            vSemaphoreDelete(waiter.wake);
+        }
+    }
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+}
 
-    if (!result.isOk()) {
-        return ModbusResult<std::vector<uint16_t>>::error(result.error());
+// Flight state is created on the first read; concurrent first readers race
+// on the pointer and the loser frees its copy
+ModbusDevice::ReadFlight* ModbusDevice::getReadFlight() {
+    ReadFlight* flight = readFlight.load(std::memory_order_acquire);
+    if (flight) {
+        return flight;
     }
 
-    // Convert bytes to uint16_t
-    std::vector<uint16_t> values;
-    const auto& data = result.value();
-    for (size_t i = 0; i + 1 < data.size(); i += 2) {
-        values.push_back((static_cast<uint16_t>(data[i]) << 8) | data[i + 1]);
+    ReadFlight* created = readSlot.acquire();
+    if (!created) {
+        return nullptr;
+    }
+    bool ready = (created->mutex = createMutex(created->mutexStorage)) != nullptr;
+    for (auto& waiter : created->waiters) {
+        ready = ready && (waiter.wake = createBinarySemaphore(waiter.wakeStorage)) != nullptr;
+    }
+    if (!ready) {
+        MODBUSD_LOG_W("Read dedup unavailable: no memory for flight semaphores");
+        readSlot.release(created);
+        return nullptr;
     }
 
-    return ModbusResult<std::vector<uint16_t>>::ok(values);
+    if (readFlight.compare_exchange_strong(flight, created, std::memory_order_acq_rel)) {
+        return created;
+    }
+    readSlot.release(created);
+    return flight;  // Another reader installed its copy first
 }
 
-// Write single register
-ModbusResult<void> ModbusDevice::writeSingleRegister(uint16_t address, uint16_t value) {
-    // Default to RELAY priority for backward compatibility
-    return writeSingleRegisterWithPriority(address, value, esp32Modbus::RELAY);
-}
+// Read registers, joining a read in flight that already covers the range.
+// The first reader leads: it sends the request and, when the response is in,
+// copies each joined reader's slice out of its own buffer.
+ModbusResult<void> ModbusDevice::sharedRead(uint8_t fc, uint16_t address, uint16_t count,
+                                            uint16_t* dest, esp32Modbus::ModbusPriority priority,
+                                            const char* opName, size_t* decoded) {
+    SyncSink sink;
+    sink.type = SyncSink::Type::REGISTERS;
+    sink.buffer = dest;
+    sink.capacity = count;
+
+    ReadFlight* flight = readDedup ? getReadFlight() : nullptr;
+    if (!flight || xSemaphoreTake(flight->mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return transact(fc, address, count, priority, nullptr, sink, opName, decoded);
+    }
+
+    if (flight->active) {
+        ReadFlight::Waiter* waiter = nullptr;
+        // The leader may still be queued for the bus at its own class; a more
+        // urgent reader sends its own frame rather than wait behind it
+        if (flight->functionCode == fc && priority >= flight->priority && address >= flight->address &&
+            address + count <= flight->address + flight->count) {
+            for (auto& candidate : flight->waiters) {
+                if (!candidate.used) {
+                    waiter = &candidate;
+                    break;
+                }
+            }
+        }
+        if (!waiter) {
+            // Different range, more urgent, or too many readers already joined: send our own
+            xSemaphoreGive(flight->mutex);
+            return transact(fc, address, count, priority, nullptr, sink, opName, decoded);
+        }
 
-ModbusResult<void> ModbusDevice::writeSingleRegisterWithPriority(uint16_t address, uint16_t value, esp32Modbus::ModbusPriority priority) {
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for writeSingleRegister");
-        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+        waiter->used = true;
+        waiter->done = false;
+        waiter->dest = dest;
+        waiter->offset = address - flight->address;
+        waiter->count = count;
+        xSemaphoreGive(flight->mutex);
+        dedupedReads++;
+
+        // The leader may itself wait for the bus before its response timeout runs
+        TickType_t wait = pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS + MODBUS_LINK_MAX_TIMEOUT_MS);
+        bool woken = xSemaphoreTake(waiter->wake, wait) == pdTRUE;
+
+        xSemaphoreTake(flight->mutex, portMAX_DELAY);
+        if (!woken && waiter->done) {
+            woken = xSemaphoreTake(waiter->wake, 0) == pdTRUE;  // Completed as we timed out
+        }
+        ModbusError error = woken ? waiter->error : ModbusError::TIMEOUT;
+        if (woken && decoded) {
+            *decoded = waiter->decoded;
+        }
+        waiter->used = false;
+        waiter->done = false;
+        xSemaphoreGive(flight->mutex);
+
+        if (error != ModbusError::SUCCESS) {
+            return ModbusResult<void>::error(error);
+        }
+        return ModbusResult<void>::ok();
     }
 
-    ensureSyncReady();
+    flight->active = true;
+    flight->functionCode = fc;
+    flight->address = address;
+    flight->count = count;
+    flight->priority = priority;
+    xSemaphoreGive(flight->mutex);
 
-    uint16_t data = value;
-    if (sendRequestWithPriority(0x06, address, 1, priority, &data) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
+    size_t n = 0;
+    auto result = transact(fc, address, count, priority, nullptr, sink, opName, &n);
+
+    xSemaphoreTake(flight->mutex, portMAX_DELAY);
+    for (auto& waiter : flight->waiters) {
+        if (!waiter.used || waiter.done) {
+            continue;  // Free, or a previous flight's reader that has not collected yet
+        }
+        size_t copied = (result.isOk() && n > waiter.offset)
+                            ? std::min<size_t>(n - waiter.offset, waiter.count) : 0;
+        std::memcpy(waiter.dest, dest + waiter.offset, copied * sizeof(uint16_t));
+        waiter.decoded = copied;
+        waiter.error = result.isOk() ? ModbusError::SUCCESS : result.error();
+        waiter.done = true;
+        xSemaphoreGive(waiter.wake);
     }
+    flight->active = false;
+    xSemaphoreGive(flight->mutex);
 
-    auto result = waitForResponse();
+    if (decoded) {
+        *decoded = n;
+    }
+    return result;
+}
 
-    releaseBusMutex();  // Release after response received
+// Read a coil/discrete-input block into a caller bitset
+ModbusResult<size_t> ModbusDevice::readBitBlock(uint8_t fc, uint16_t address, uint16_t count,
+                                                uint8_t* bits, size_t capacityBytes,
+                                                const char* opName, esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > MODBUS_MAX_COIL_COUNT) {
+        return ModbusResult<size_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (!bits) {
+        return ModbusResult<size_t>::error(ModbusError::NULL_POINTER);
+    }
+    size_t byteCount = (count + 7) / 8;
+    if (capacityBytes < byteCount) {
+        return ModbusResult<size_t>::error(ModbusError::INVALID_DATA_LENGTH);
+    }
 
+    SyncSink sink;
+    sink.type = SyncSink::Type::BITS;
+    sink.buffer = bits;
+    sink.capacity = byteCount;
+
+    size_t decodedBytes = 0;
+    auto result = transact(fc, address, count, priority, nullptr, sink, opName, &decodedBytes);
     if (!result.isOk()) {
-        return ModbusResult<void>::error(result.error());
+        return ModbusResult<size_t>::error(result.error());
     }
 
-    return ModbusResult<void>::ok();
+    size_t decoded = decodedBytes * 8;
+    return ModbusResult<size_t>::ok(decoded < count ? decoded : count);
 }
 
-// Write multiple registers
-ModbusResult<void> ModbusDevice::writeMultipleRegisters(uint16_t address, const std::vector<uint16_t>& values) {
-    if (values.empty() || values.size() > MODBUS_MAX_WRITE_REGISTER_COUNT) {
-        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+// Read holding registers
+ModbusResult<std::vector<uint16_t>> ModbusDevice::readHoldingRegisters(uint16_t address, uint16_t count) {
+    // Default to RELAY priority for backward compatibility
+    return readHoldingRegistersWithPriority(address, count, esp32Modbus::RELAY);
+}
+
+ModbusResult<std::vector<uint16_t>> ModbusDevice::readHoldingRegistersWithPriority(uint16_t address, uint16_t count, esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::INVALID_PARAMETER);
     }
 
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for writeMultipleRegisters");
-        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    std::vector<uint16_t> values(count);
+    auto result = readHoldingRegistersWithPriority(address, count, values.data(), values.size(), priority);
+    if (!result.isOk()) {
+        return ModbusResult<std::vector<uint16_t>>::error(result.error());
     }
 
-    ensureSyncReady();
+    values.resize(result.value());
+    return ModbusResult<std::vector<uint16_t>>::ok(std::move(values));
+}
 
-    uint16_t* data = const_cast<uint16_t*>(values.data());
-    if (sendRequestInternal(0x10, address, static_cast<uint16_t>(values.size()), data) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
-    }
+ModbusResult<size_t> ModbusDevice::readHoldingRegisters(uint16_t address, uint16_t count,
+                                                        uint16_t* dest, size_t capacity) {
+    return readHoldingRegistersWithPriority(address, count, dest, capacity, esp32Modbus::RELAY);
+}
 
-    auto result = waitForResponse();
+ModbusResult<size_t> ModbusDevice::readHoldingRegistersWithPriority(uint16_t address, uint16_t count,
+                                                                    uint16_t* dest, size_t capacity,
+                                                                    esp32Modbus::ModbusPriority priority) {
+    return readRegisterBlock(0x03, address, count, dest, capacity, priority, "readHoldingRegisters");
+}
 
-    releaseBusMutex();  // Release after response received
+// Read input registers
+ModbusResult<std::vector<uint16_t>> ModbusDevice::readInputRegisters(uint16_t address, uint16_t count) {
+    // Default to RELAY priority for backward compatibility
+    return readInputRegistersWithPriority(address, count, esp32Modbus::RELAY);
+}
 
+ModbusResult<std::vector<uint16_t>> ModbusDevice::readInputRegistersWithPriority(uint16_t address, uint16_t count, esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        return ModbusResult<std::vector<uint16_t>>::error(ModbusError::INVALID_PARAMETER);
+    }
+
+    std::vector<uint16_t> values(count);
+    auto result = readInputRegistersWithPriority(address, count, values.data(), values.size(), priority);
     if (!result.isOk()) {
-        return ModbusResult<void>::error(result.error());
+        return ModbusResult<std::vector<uint16_t>>::error(result.error());
     }
 
-    return ModbusResult<void>::ok();
+    values.resize(result.value());
+    return ModbusResult<std::vector<uint16_t>>::ok(std::move(values));
 }
 
-// Read coils
-ModbusResult<std::vector<bool>> ModbusDevice::readCoils(uint16_t address, uint16_t count) {
-    if (count == 0 || count > MODBUS_MAX_COIL_COUNT) {
-        return ModbusResult<std::vector<bool>>::error(ModbusError::INVALID_PARAMETER);
+ModbusResult<size_t> ModbusDevice::readInputRegisters(uint16_t address, uint16_t count,
+                                                      uint16_t* dest, size_t capacity) {
+    return readInputRegistersWithPriority(address, count, dest, capacity, esp32Modbus::RELAY);
+}
+
+ModbusResult<size_t> ModbusDevice::readInputRegistersWithPriority(uint16_t address, uint16_t count,
+                                                                  uint16_t* dest, size_t capacity,
+                                                                  esp32Modbus::ModbusPriority priority) {
+    return readRegisterBlock(0x04, address, count, dest, capacity, priority, "readInputRegisters");
+}
+
+// Write single register
+ModbusResult<void> ModbusDevice::writeSingleRegister(uint16_t address, uint16_t value) {
+    // Default to RELAY priority for backward compatibility
+    return writeSingleRegisterWithPriority(address, value, esp32Modbus::RELAY);
+}
+
+ModbusResult<void> ModbusDevice::writeSingleRegisterWithPriority(uint16_t address, uint16_t value, esp32Modbus::ModbusPriority priority) {
+    uint16_t data = value;
+    return writeRegisterRun(address, 1, &data, priority, "writeSingleRegister");
+}
+
+// FC06 for one register, FC10 for more
+ModbusResult<void> ModbusDevice::writeRegisterRun(uint16_t address, uint16_t count, uint16_t* data,
+                                                  esp32Modbus::ModbusPriority priority, const char* opName,
+                                                  uint8_t fc) {
+    SyncSink sink;
+    sink.type = SyncSink::Type::NONE;
+
+    if (fc == 0) {
+        fc = (count == 1) ? 0x06 : 0x10;
+    }
+    auto result = transact(fc, address, count, priority, data, sink, opName);
+    if (registerCache) {
+        // Write-through on success; on failure the device state is unknown
+        if (result.isOk()) {
+            registerCache->store(fc, address, count, data);
+        } else {
+            registerCache->invalidate(fc, address, count);
+        }
     }
+    return result;
+}
 
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for readCoils");
-        return ModbusResult<std::vector<bool>>::error(ModbusError::MUTEX_ERROR);
+// Write multiple registers
+ModbusResult<void> ModbusDevice::writeMultipleRegisters(uint16_t address, const std::vector<uint16_t>& values) {
+    if (values.empty() || values.size() > MODBUS_MAX_WRITE_REGISTER_COUNT) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
     }
 
-    ensureSyncReady();
+    SyncSink sink;
+    sink.type = SyncSink::Type::NONE;
 
-    if (sendRequestInternal(0x01, address, count) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<std::vector<bool>>::error(ModbusError::COMMUNICATION_ERROR);
+    uint16_t* data = const_cast<uint16_t*>(values.data());
+    uint16_t count = static_cast<uint16_t>(values.size());
+    auto result = transact(0x10, address, count, esp32Modbus::RELAY,
+                           data, sink, "writeMultipleRegisters");
+    if (registerCache) {
+        // Always FC10 here, even for one value, as callers asked for it
+        if (result.isOk()) {
+            registerCache->store(0x10, address, count, data);
+        } else {
+            registerCache->invalidate(0x10, address, count);
+        }
     }
+    return result;
+}
 
-    auto result = waitForResponse();
-
-    releaseBusMutex();  // Release after response received
+// Read coils
+ModbusResult<std::vector<bool>> ModbusDevice::readCoils(uint16_t address, uint16_t count) {
+    if (count == 0 || count > MODBUS_MAX_COIL_COUNT) {
+        return ModbusResult<std::vector<bool>>::error(ModbusError::INVALID_PARAMETER);
+    }
 
+    uint8_t bits[(MODBUS_MAX_COIL_COUNT + 7) / 8];
+    auto result = readCoils(address, count, bits, sizeof(bits));
     if (!result.isOk()) {
         return ModbusResult<std::vector<bool>>::error(result.error());
     }
 
     // Convert bytes to bool vector
-    std::vector<bool> values;
-    const auto& data = result.value();
-    for (uint16_t i = 0; i < count && i / 8 < data.size(); i++) {
-        values.push_back((data[i / 8] & (1 << (i % 8))) != 0);
+    std::vector<bool> values(result.value());
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = (bits[i / 8] & (1 << (i % 8))) != 0;
     }
 
-    return ModbusResult<std::vector<bool>>::ok(values);
+    return ModbusResult<std::vector<bool>>::ok(std::move(values));
+}
+
+ModbusResult<size_t> ModbusDevice::readCoils(uint16_t address, uint16_t count,
+                                             uint8_t* bits, size_t capacityBytes) {
+    return readBitBlock(0x01, address, count, bits, capacityBytes, "readCoils");
 }
 
 // Read discrete inputs
@@ -494,35 +996,24 @@ ModbusResult<std::vector<bool>> ModbusDevice::readDiscreteInputs(uint16_t addres
         return ModbusResult<std::vector<bool>>::error(ModbusError::INVALID_PARAMETER);
     }
 
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for readDiscreteInputs");
-        return ModbusResult<std::vector<bool>>::error(ModbusError::MUTEX_ERROR);
-    }
-
-    ensureSyncReady();
-
-    if (sendRequestInternal(0x02, address, count) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<std::vector<bool>>::error(ModbusError::COMMUNICATION_ERROR);
-    }
-
-    auto result = waitForResponse();
-
-    releaseBusMutex();  // Release after response received
-
+    uint8_t bits[(MODBUS_MAX_COIL_COUNT + 7) / 8];
+    auto result = readDiscreteInputs(address, count, bits, sizeof(bits));
     if (!result.isOk()) {
         return ModbusResult<std::vector<bool>>::error(result.error());
     }
 
     // Convert bytes to bool vector
-    std::vector<bool> values;
-    const auto& data = result.value();
-    for (uint16_t i = 0; i < count && i / 8 < data.size(); i++) {
-        values.push_back((data[i / 8] & (1 << (i % 8))) != 0);
+    std::vector<bool> values(result.value());
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = (bits[i / 8] & (1 << (i % 8))) != 0;
     }
 
-    return ModbusResult<std::vector<bool>>::ok(values);
+    return ModbusResult<std::vector<bool>>::ok(std::move(values));
+}
+
+ModbusResult<size_t> ModbusDevice::readDiscreteInputs(uint16_t address, uint16_t count,
+                                                      uint8_t* bits, size_t capacityBytes) {
+    return readBitBlock(0x02, address, count, bits, capacityBytes, "readDiscreteInputs");
 }
 
 // Write single coil
@@ -532,71 +1023,459 @@ ModbusResult<void> ModbusDevice::writeSingleCoil(uint16_t address, bool value) {
 }
 
 ModbusResult<void> ModbusDevice::writeSingleCoilWithPriority(uint16_t address, bool value, esp32Modbus::ModbusPriority priority) {
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for writeSingleCoil");
+    SyncSink sink;
+    sink.type = SyncSink::Type::NONE;
+
+    uint16_t data = value ? 1 : 0;
+    return transact(0x05, address, 1, priority, &data, sink, "writeSingleCoil");
+}
+
+// Write multiple coils
+ModbusResult<void> ModbusDevice::writeMultipleCoils(uint16_t address, const std::vector<bool>& values) {
+    if (values.empty() || values.size() > MODBUS_MAX_WRITE_COIL_COUNT) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+
+    // Pack into the word layout dispatchRequest() expects (stack, no heap)
+    uint16_t packedData[(MODBUS_MAX_WRITE_COIL_COUNT + 15) / 16] = {};
+    for (size_t i = 0; i < values.size(); i++) {
+        if (values[i]) {
+            packedData[i / 16] |= static_cast<uint16_t>(1u << (i % 16));
+        }
+    }
+
+    SyncSink sink;
+    sink.type = SyncSink::Type::NONE;
+
+    return transact(0x0F, address, static_cast<uint16_t>(values.size()), esp32Modbus::RELAY,
+                    packedData, sink, "writeMultipleCoils");
+}
+
+// ===== Write combining =====
+
+ModbusResult<void> ModbusDevice::stageCoil(uint16_t address, bool value) {
+    return stageWrite(true, address, value ? 1 : 0);
+}
+
+ModbusResult<void> ModbusDevice::stageRegister(uint16_t address, uint16_t value) {
+    return stageWrite(false, address, value);
+}
+
+ModbusDevice::WriteBuffer* ModbusDevice::getWriteBuffer() {
+    if (writeBuffer) {
+        return writeBuffer;
+    }
+    WriteBuffer* buffer = writeSlot.acquire();
+    if (!buffer) {
+        return nullptr;
+    }
+    buffer->mutex = createMutex(buffer->mutexStorage);
+    if (!buffer->mutex) {
+        MODBUSD_LOG_E("Failed to create write buffer mutex");
+        writeSlot.release(buffer);
+        return nullptr;
+    }
+    writeBuffer = buffer;
+    return writeBuffer;
+}
+
+ModbusResult<void> ModbusDevice::stageWrite(bool coil, uint16_t address, uint16_t value) {
+    if (!getWriteBuffer()) {
+        return ModbusResult<void>::error(ModbusError::RESOURCE_CREATION_FAILED);
+    }
+
+    WriteBuffer& wb = *writeBuffer;
+    if (xSemaphoreTake(wb.mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
         return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
     }
 
-    ensureSyncReady();
+    WriteBuffer::Entry* entries = coil ? wb.coils : wb.registers;
+    uint8_t& count = coil ? wb.coilCount : wb.registerCount;
 
-    uint16_t data = value ? 1 : 0;
-    if (sendRequestWithPriority(0x05, address, 1, priority, &data) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
+    ModbusError err = ModbusError::SUCCESS;
+    uint8_t i = 0;
+    while (i < count && entries[i].address != address) i++;
+    if (i < count) {
+        entries[i].value = value;  // Restaged: last value wins
+    } else if (count < MODBUS_WRITE_BUFFER_ENTRIES) {
+        entries[count].address = address;
+        entries[count].value = value;
+        count++;
+    } else {
+        err = ModbusError::QUEUE_FULL;
     }
 
-    auto result = waitForResponse();
+    xSemaphoreGive(wb.mutex);
+    return (err == ModbusError::SUCCESS) ? ModbusResult<void>::ok() : ModbusResult<void>::error(err);
+}
 
-    releaseBusMutex();  // Release after response received
+ModbusResult<void> ModbusDevice::flushStagedWrites(esp32Modbus::ModbusPriority priority) {
+    if (!writeBuffer) {
+        return ModbusResult<void>::ok();
+    }
 
+    auto result = flushStagedRuns(true, priority);
     if (!result.isOk()) {
-        return ModbusResult<void>::error(result.error());
+        return result;
+    }
+    return flushStagedRuns(false, priority);
+}
+
+ModbusResult<void> ModbusDevice::flushStagedRuns(bool coil, esp32Modbus::ModbusPriority priority) {
+    WriteBuffer& wb = *writeBuffer;
+    WriteBuffer::Entry pending[MODBUS_WRITE_BUFFER_ENTRIES];
+
+    // Snapshot under the lock; the bus I/O below runs without it
+    if (xSemaphoreTake(wb.mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+    uint8_t count = coil ? wb.coilCount : wb.registerCount;
+    std::memcpy(pending, coil ? wb.coils : wb.registers, count * sizeof(WriteBuffer::Entry));
+    xSemaphoreGive(wb.mutex);
+
+    std::sort(pending, pending + count, [](const WriteBuffer::Entry& a, const WriteBuffer::Entry& b) {
+        return a.address < b.address;
+    });
+
+    const size_t maxRun = coil ? MODBUS_MAX_WRITE_COIL_COUNT : MODBUS_MAX_WRITE_REGISTER_COUNT;
+    uint16_t values[MODBUS_WRITE_BUFFER_ENTRIES];
+
+    size_t start = 0;
+    while (start < count) {
+        size_t end = start + 1;
+        while (end < count && end - start < maxRun &&
+               pending[end].address == pending[end - 1].address + 1) {
+            end++;
+        }
+        uint16_t runAddress = pending[start].address;
+        uint16_t runCount = static_cast<uint16_t>(end - start);
+
+        ModbusResult<void> result = ModbusResult<void>::ok();
+        if (coil) {
+            SyncSink sink;
+            sink.type = SyncSink::Type::NONE;
+            if (runCount == 1) {
+                values[0] = pending[start].value;
+                result = transact(0x05, runAddress, 1, priority, values, sink, "flushStagedWrites");
+            } else {
+                // FC0F source layout: bit i of the run = values[i / 16] bit (i % 16)
+                std::fill(values, values + (runCount + 15) / 16, 0);
+                for (uint16_t i = 0; i < runCount; i++) {
+                    if (pending[start + i].value) {
+                        values[i / 16] |= static_cast<uint16_t>(1u << (i % 16));
+                    }
+                }
+                result = transact(0x0F, runAddress, runCount, priority, values, sink, "flushStagedWrites");
+            }
+        } else {
+            for (uint16_t i = 0; i < runCount; i++) {
+                values[i] = pending[start + i].value;
+            }
+            result = writeRegisterRun(runAddress, runCount, values, priority, "flushStagedWrites");
+        }
+
+        if (!result.isOk()) {
+            return result;  // This run and the rest stay staged
+        }
+
+        // Drop what was sent unless it was restaged with a new value meanwhile
+        if (xSemaphoreTake(wb.mutex, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) == pdTRUE) {
+            WriteBuffer::Entry* entries = coil ? wb.coils : wb.registers;
+            uint8_t& staged = coil ? wb.coilCount : wb.registerCount;
+            for (size_t r = start; r < end; r++) {
+                for (uint8_t i = 0; i < staged; i++) {
+                    if (entries[i].address == pending[r].address) {
+                        if (entries[i].value == pending[r].value) {
+                            entries[i] = entries[--staged];
+                        }
+                        break;
+                    }
+                }
+            }
+            xSemaphoreGive(wb.mutex);
+        }
+
+        start = end;
     }
 
     return ModbusResult<void>::ok();
 }
 
-// Write multiple coils
-ModbusResult<void> ModbusDevice::writeMultipleCoils(uint16_t address, const std::vector<bool>& values) {
-    if (values.empty() || values.size() > MODBUS_MAX_WRITE_COIL_COUNT) {
-        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+bool ModbusDevice::hasStagedWrites() const {
+    // Counts are single bytes; a racy read is only ever briefly stale
+    return writeBuffer && (writeBuffer->coilCount > 0 || writeBuffer->registerCount > 0);
+}
+
+void ModbusDevice::discardStagedWrites() {
+    if (!writeBuffer) {
+        return;
     }
+    if (xSemaphoreTake(writeBuffer->mutex, portMAX_DELAY) == pdTRUE) {
+        writeBuffer->coilCount = 0;
+        writeBuffer->registerCount = 0;
+        xSemaphoreGive(writeBuffer->mutex);
+    }
+}
 
-    // Acquire bus mutex for entire transaction (request + response)
-    if (!acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS)) {
-        MODBUSD_LOG_W("Failed to acquire bus mutex for writeMultipleCoils");
-        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+// ===== Async API =====
+
+ModbusResult<uint32_t> ModbusDevice::readHoldingRegistersAsync(uint16_t address, uint16_t count,
+                                                               AsyncCallback callback, void* context,
+                                                               esp32Modbus::ModbusPriority priority,
+                                                               uint32_t timeoutMs) {
+    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
     }
+    return submitAsync(0x03, address, count, nullptr, callback, context, priority, timeoutMs);
+}
 
-    ensureSyncReady();
+ModbusResult<uint32_t> ModbusDevice::readInputRegistersAsync(uint16_t address, uint16_t count,
+                                                             AsyncCallback callback, void* context,
+                                                             esp32Modbus::ModbusPriority priority,
+                                                             uint32_t timeoutMs) {
+    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    return submitAsync(0x04, address, count, nullptr, callback, context, priority, timeoutMs);
+}
 
-    // Pack bool vector into uint16_t array
-    size_t wordCount = (values.size() + 15) / 16;
-    std::vector<uint16_t> packedData(wordCount, 0);
+ModbusResult<uint32_t> ModbusDevice::readCoilsAsync(uint16_t address, uint16_t count,
+                                                    AsyncCallback callback, void* context,
+                                                    esp32Modbus::ModbusPriority priority,
+                                                    uint32_t timeoutMs) {
+    if (count == 0 || count > MODBUS_MAX_COIL_COUNT) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    return submitAsync(0x01, address, count, nullptr, callback, context, priority, timeoutMs);
+}
 
-    for (size_t i = 0; i < values.size(); i++) {
-        if (values[i]) {
-            size_t wordIndex = i / 16;
-            size_t bitIndex = i % 16;
-            packedData[wordIndex] |= (1 << bitIndex);
+ModbusResult<uint32_t> ModbusDevice::readDiscreteInputsAsync(uint16_t address, uint16_t count,
+                                                             AsyncCallback callback, void* context,
+                                                             esp32Modbus::ModbusPriority priority,
+                                                             uint32_t timeoutMs) {
+    if (count == 0 || count > MODBUS_MAX_COIL_COUNT) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    return submitAsync(0x02, address, count, nullptr, callback, context, priority, timeoutMs);
+}
+
+ModbusResult<uint32_t> ModbusDevice::writeSingleRegisterAsync(uint16_t address, uint16_t value,
+                                                              AsyncCallback callback, void* context,
+                                                              esp32Modbus::ModbusPriority priority,
+                                                              uint32_t timeoutMs) {
+    return submitAsync(0x06, address, 1, &value, callback, context, priority, timeoutMs);
+}
+
+ModbusResult<uint32_t> ModbusDevice::writeSingleCoilAsync(uint16_t address, bool value,
+                                                          AsyncCallback callback, void* context,
+                                                          esp32Modbus::ModbusPriority priority,
+                                                          uint32_t timeoutMs) {
+    uint16_t data = value ? 1 : 0;
+    return submitAsync(0x05, address, 1, &data, callback, context, priority, timeoutMs);
+}
+
+ModbusResult<uint32_t> ModbusDevice::submitAsync(uint8_t fc, uint16_t address, uint16_t count,
+                                                 uint16_t* data, AsyncCallback callback, void* context,
+                                                 esp32Modbus::ModbusPriority priority,
+                                                 uint32_t timeoutMs) {
+    if (!createAsyncMutex()) {
+        return ModbusResult<uint32_t>::error(ModbusError::RESOURCE_CREATION_FAILED);
+    }
+
+    // Same requirement as the sync path: unregistered devices never see responses
+    if (!bus->getDevice(serverAddress)) {
+        registerDevice();
+    }
+
+    // Reclaim slots of requests whose response never came
+    expireAsyncRequests();
+
+    const uint32_t handle = newTransactionId();
+
+    // Claim the slot before sending so a fast response always finds it
+    if (xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(10)) != pdTRUE) {
+        return ModbusResult<uint32_t>::error(ModbusError::MUTEX_ERROR);
+    }
+    AsyncSlot* slot = nullptr;
+    for (auto& candidate : asyncSlots) {
+        if (!candidate.used) {
+            slot = &candidate;
+            break;
+        }
+    }
+    if (slot) {
+        slot->used = true;
+        slot->handle = handle;
+        slot->functionCode = fc;
+        slot->address = address;
+        slot->count = count;
+        slot->value = (fc == 0x06 && data) ? data[0] : 0;
+        slot->sentTick = xTaskGetTickCount();
+#ifdef MODBUSDEVICE_TRACE
+        slot->sentUs = esp_timer_get_time();
+        slot->priority = static_cast<uint8_t>(priority);
+#endif
+        slot->timeoutTicks = pdMS_TO_TICKS(timeoutMs);
+        slot->callback = callback;
+        slot->context = context;
+        asyncPending++;
+    }
+    xSemaphoreGive(asyncMutex);
+
+    if (!slot) {
+        return ModbusResult<uint32_t>::error(ModbusError::QUEUE_FULL);
+    }
+
+    // Other bus holders change the RTU timeout; the bus stays ours (or the
+    // holder's, if it hosts async requests) until the RTU reported the frame
+    const ModbusBus::AsyncGrant grant = bus->beginAsync(priority, !bus->isDeliveryTask());
+    if (grant == ModbusBus::AsyncGrant::NONE) {
+        cancelAsync(handle);
+        return ModbusResult<uint32_t>::error(ModbusError::MUTEX_ERROR);
+    }
+    const bool leased = grant == ModbusBus::AsyncGrant::LEASED;
+
+    if (dispatchRequest(fc, address, count, priority, data, handle, true, leased) != ESP_OK) {
+        if (leased) {
+            bus->endAsync();
         }
+        cancelAsync(handle);
+        return ModbusResult<uint32_t>::error(ModbusError::COMMUNICATION_ERROR);
     }
 
-    if (sendRequestInternal(0x0F, address, static_cast<uint16_t>(values.size()), packedData.data()) != ESP_OK) {
-        releaseBusMutex();
-        return ModbusResult<void>::error(ModbusError::COMMUNICATION_ERROR);
+    return ModbusResult<uint32_t>::ok(handle);
+}
+
+bool ModbusDevice::cancelAsync(uint32_t handle) {
+    if (!asyncMutex || handle == 0) {
+        return false;
     }
 
-    auto result = waitForResponse();
+    bool found = false;
+    if (xSemaphoreTake(asyncMutex, portMAX_DELAY) == pdTRUE) {
+        for (auto& slot : asyncSlots) {
+            if (slot.used && slot.handle == handle) {
+                slot.used = false;
+                asyncPending--;
+                found = true;
+                break;
+            }
+        }
+        xSemaphoreGive(asyncMutex);
+    }
+    return found;
+}
 
-    releaseBusMutex();  // Release after response received
+size_t ModbusDevice::getPendingAsyncCount() const {
+    return asyncPending.load();
+}
 
-    if (!result.isOk()) {
-        return ModbusResult<void>::error(result.error());
+bool ModbusDevice::takeAsyncSlot(uint32_t handle, AsyncSlot& out) {
+    if (!asyncMutex || asyncPending.load() == 0) {
+        return false;
+    }
+    if (xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+        return false;
     }
 
-    return ModbusResult<void>::ok();
+    bool found = false;
+    for (auto& slot : asyncSlots) {
+        if (slot.used && slot.handle == handle) {
+            out = slot;
+            slot.used = false;
+            asyncPending--;
+            found = true;
+            break;
+        }
+    }
+
+    xSemaphoreGive(asyncMutex);
+    return found;
+}
+
+void ModbusDevice::finishAsync(const AsyncSlot& slot, ModbusError error,
+                               const uint8_t* data, size_t length) {
+#ifdef MODBUSDEVICE_TRACE
+    // Async requests do not wait for the bus; the RTU queue does the ordering
+    traceTransaction(TraceKind::ASYNC, bus->getId(), serverAddress, slot.functionCode, slot.address,
+                     slot.count, error, slot.priority, slot.sentUs, 0,
+                     static_cast<uint32_t>(esp_timer_get_time() - slot.sentUs));
+#endif
+    if (error == ModbusError::SUCCESS) {
+        successfulRequests++;
+    } else {
+        lastError = error;
+        if (error == ModbusError::TIMEOUT) {
+            timeouts++;
+        }
+    }
+
+    if (registerCache && slot.functionCode == 0x06) {
+        // Same write-through as writeRegisterRun(); on failure the device state is unknown
+        if (error == ModbusError::SUCCESS) {
+            registerCache->store(0x06, slot.address, 1, &slot.value);
+        } else {
+            registerCache->invalidate(0x06, slot.address, 1);
+        }
+    }
+
+    if (!slot.callback) {
+        return;
+    }
+
+    AsyncResult result;
+    result.handle = slot.handle;
+    result.functionCode = slot.functionCode;
+    result.address = slot.address;
+    result.count = slot.count;
+    result.error = error;
+    result.data = data;
+    result.length = length;
+    result.context = slot.context;
+    slot.callback(*this, result);
+}
+
+ModbusDevice::AsyncMatch ModbusDevice::completeAsyncResponse(uint32_t handle, const uint8_t* data,
+                                                             size_t length) {
+    AsyncSlot slot;
+    if (!takeAsyncSlot(handle, slot)) {
+        return AsyncMatch::NONE;
+    }
+
+    finishAsync(slot, ModbusError::SUCCESS, data, length);
+    return slot.callback ? AsyncMatch::CONSUMED : AsyncMatch::FORWARD;
+}
+
+size_t ModbusDevice::expireAsyncRequests() {
+    if (!asyncMutex || asyncPending.load() == 0) {
+        return 0;
+    }
+
+    AsyncSlot expired[MODBUS_ASYNC_MAX_PENDING];
+    size_t count = 0;
+
+    if (xSemaphoreTake(asyncMutex, pdMS_TO_TICKS(10)) == pdTRUE) {
+        // The request stays in the outstanding FIFO until the RTU reports it,
+        // so its late frame is dropped by handle instead of taking a newer slot
+        TickType_t now = xTaskGetTickCount();
+        for (auto& slot : asyncSlots) {
+            if (slot.used && (now - slot.sentTick) >= slot.timeoutTicks) {
+                expired[count++] = slot;
+                slot.used = false;
+                asyncPending--;
+            }
+        }
+        xSemaphoreGive(asyncMutex);
+    }
+
+    // Callbacks run outside the mutex so they may submit again
+    for (size_t i = 0; i < count; i++) {
+        finishAsync(expired[i], ModbusError::TIMEOUT, nullptr, 0);
+        if (!expired[i].callback) {
+            handleModbusError(ModbusError::TIMEOUT);
+        }
+    }
+    return count;
 }
 
 // Get statistics
@@ -618,9 +1497,31 @@ void ModbusDevice::resetStatistics() {
     crcErrors = 0;
 }
 
+ModbusResult<LatencyStats> ModbusDevice::getLatencyStats() const {
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    LatencyStats stats;
+    for (size_t i = 0; i < LATENCY_PHASE_COUNT; i++) {
+        stats.phases[i] = latencyHistograms[i].summarize();
+    }
+    return ModbusResult<LatencyStats>::ok(stats);
+#else
+    return ModbusResult<LatencyStats>::error(ModbusError::NOT_SUPPORTED);
+#endif
+}
+
+void ModbusDevice::resetLatencyStats() {
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    for (auto& histogram : latencyHistograms) {
+        histogram.reset();
+    }
+#endif
+}
+
 // Handle Modbus response
-void ModbusDevice::handleModbusResponse(uint8_t functionCode, uint16_t address,
-                                        const uint8_t* data, size_t length) {
+void ModbusDevice::handleModbusResponse([[maybe_unused]] uint8_t functionCode,
+                                        [[maybe_unused]] uint16_t address,
+                                        [[maybe_unused]] const uint8_t* data,
+                                        [[maybe_unused]] size_t length) {
     // During CONFIGURING phase, this is expected and normal
     if (initPhase == InitPhase::CONFIGURING) {
         MODBUSD_LOG_D("Response during config phase: FC=%02X, Addr=%04X", functionCode, address);
@@ -642,11 +1543,28 @@ void ModbusDevice::handleModbusError(ModbusError error) {
 }
 
 // Internal data handler
-void ModbusDevice::handleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
-                               uint16_t startingAddress, const uint8_t* data, size_t length) {
-    // Check for sync response
-    if (syncContext && syncMutex) {
-        if (xSemaphoreTake(syncMutex, 0) == pdTRUE) {
+void ModbusDevice::handleData(esp32Modbus::FunctionCode fc, uint16_t startingAddress,
+                              const uint8_t* data, size_t length, const Outstanding* request) {
+    if (request && request->async) {
+        AsyncMatch asyncMatch = completeAsyncResponse(request->txn, data, length);
+        if (asyncMatch == AsyncMatch::NONE) {
+            // Expired or cancelled; its callback already ran or never will
+            MODBUSD_LOG_D("Device %d: late reply to async request %lu dropped", serverAddress,
+                          (unsigned long)request->txn);
+        }
+        if (asyncMatch != AsyncMatch::FORWARD) {
+            return;
+        }
+    } else if (request && syncContext && request->txn != syncContext->expectedTxn.load()) {
+        // Reply to a sync request that already timed out: never a newer request's answer
+        MODBUSD_LOG_D("Device %d: late reply to request %lu dropped", serverAddress,
+                      (unsigned long)request->txn);
+    } else if (syncContext && syncMutex) {
+        // Sync response. syncMutex is only held for short copies; a zero wait
+        // here dropped replies that raced one and left the caller to time out
+        if (xSemaphoreTake(syncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+            MODBUSD_LOG_W("Device %d: sync state busy, response dropped", serverAddress);
+        } else {
             // F18: cross-check the response FC against the in-flight request's FC.
             // A mismatch means this frame belongs to a different (likely stale)
             // transaction and must not be delivered as this request's reply.
@@ -661,9 +1579,38 @@ void ModbusDevice::handleData(uint8_t serverAddress, esp32Modbus::FunctionCode f
 
                 // Accept empty responses for write operations
                 if (length > 0 || isWriteOp) {
-                    syncContext->responseData.clear();
-                    if (length > 0) {
-                        syncContext->responseData.insert(syncContext->responseData.end(), data, data + length);
+                    SyncSink& sink = syncContext->sink;
+                    switch (sink.type) {
+                        case SyncSink::Type::REGISTERS: {
+                            // Decode big-endian registers straight into caller storage
+                            uint16_t* dest = static_cast<uint16_t*>(sink.buffer);
+                            size_t n = std::min(length / 2, sink.capacity);
+                            for (size_t i = 0; dest && i < n; i++) {
+                                dest[i] = (static_cast<uint16_t>(data[i * 2]) << 8) | data[i * 2 + 1];
+                            }
+                            syncContext->decodedCount = dest ? n : 0;
+                            break;
+                        }
+                        case SyncSink::Type::BITS: {
+                            // Modbus already packs bits LSB-first; copy as-is
+                            size_t n = std::min(length, sink.capacity);
+                            if (sink.buffer && n > 0) {
+                                std::memcpy(sink.buffer, data, n);
+                            }
+                            syncContext->decodedCount = sink.buffer ? n : 0;
+                            break;
+                        }
+                        case SyncSink::Type::NONE:
+                            syncContext->decodedCount = 0;
+                            break;
+                        case SyncSink::Type::BYTES:
+                        default:
+                            syncContext->decodedCount = 0;
+                            syncContext->responseLength = std::min<size_t>(length, MODBUS_MAX_READ_SIZE);
+                            if (length > 0) {
+                                std::memcpy(syncContext->responseData, data, syncContext->responseLength);
+                            }
+                            break;
                     }
                     syncContext->responseReceived = true;
                     xSemaphoreGive(syncContext->semaphore);
@@ -678,12 +1625,30 @@ void ModbusDevice::handleData(uint8_t serverAddress, esp32Modbus::FunctionCode f
 }
 
 // Internal error handler
-void ModbusDevice::handleError(esp32Modbus::Error error) {
+void ModbusDevice::handleError(esp32Modbus::Error error, const Outstanding* request) {
     ModbusError modbusError = mapError(error);
-    
-    // Update sync context if waiting
-    if (syncContext && syncMutex) {
-        if (xSemaphoreTake(syncMutex, 0) == pdTRUE) {
+
+    // Error frames carry no FC/address; the outstanding FIFO says whose they are
+    if (request && request->async) {
+        AsyncSlot asyncSlot;
+        if (modbusError == ModbusError::CRC_ERROR) {
+            crcErrors++;
+        }
+        if (takeAsyncSlot(request->txn, asyncSlot)) {
+            finishAsync(asyncSlot, modbusError, nullptr, 0);
+        }
+        handleModbusError(modbusError);
+        return;
+    }
+
+    // Update sync context if waiting (not for the error of a request it gave up on)
+    const bool late = request && syncContext && request->txn != syncContext->expectedTxn.load();
+    if (!late && syncContext && syncMutex) {
+        // Same bounded wait as handleData(): a dropped error leaves the caller
+        // blocked for its whole timeout instead of failing fast
+        if (xSemaphoreTake(syncMutex, pdMS_TO_TICKS(100)) != pdTRUE) {
+            MODBUSD_LOG_W("Device %d: sync state busy, error dropped", serverAddress);
+        } else {
             if (!syncContext->responseReceived && !syncContext->errorOccurred) {
                 syncContext->error = modbusError;
                 syncContext->errorOccurred = true;
@@ -725,20 +1690,15 @@ ModbusError ModbusDevice::mapError(esp32Modbus::Error error) {
 
 } // namespace modbus
 
-// Global callback functions (outside namespace)
+// Global callback functions (outside namespace); route to the default bus
 void mainHandleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
                     uint16_t startingAddress, const uint8_t* data, size_t length) {
-    auto* device = modbus::ModbusRegistry::getInstance().getDevice(serverAddress);
-    if (device) {
-        device->handleData(serverAddress, fc, startingAddress, data, length);
-    }
+    modbus::ModbusRegistry::getInstance().getDefaultBus().handleData(serverAddress, fc, startingAddress,
+                                                                      data, length);
 }
 
 void handleError(uint8_t serverAddress, esp32Modbus::Error error) {
-    auto* device = modbus::ModbusRegistry::getInstance().getDevice(serverAddress);
-    if (device) {
-        device->handleError(error);
-    }
+    modbus::ModbusRegistry::getInstance().getDefaultBus().handleError(serverAddress, error);
 }
 
 // Helper function (outside namespace for global access)
@@ -34,14 +34,20 @@
 #include "freertos/event_groups.h"
 #include <MutexGuard.h>
 #include "ModbusTypes.h"
+#include "ModbusLatencyStats.h"
+#include "ModbusStaticAlloc.h"
 
-// Forward declare global callback functions (legacy - use ModbusRegistry instead)
+// Global callback functions routing to the default bus (see ModbusBus::attach() for per-bus routing)
 void mainHandleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
                    uint16_t startingAddress, const uint8_t* data, size_t length);
 void handleError(uint8_t serverAddress, esp32Modbus::Error error);
 
 namespace modbus {
 
+class BusScheduler;
+class ModbusRegisterCache;
+class ModbusLinkPolicy;
+
 /**
  * @class ModbusDevice
  * @brief Base class for Modbus RTU devices
@@ -105,10 +111,289 @@ public:
     [[nodiscard]] ModbusResult<void> writeSingleRegisterWithPriority(uint16_t address, uint16_t value, esp32Modbus::ModbusPriority priority);
     [[nodiscard]] ModbusResult<void> writeSingleCoilWithPriority(uint16_t address, bool value, esp32Modbus::ModbusPriority priority);
 
+    // ===== Buffer API (decodes into caller storage, no heap allocation) =====
+
+    /**
+     * @brief Read holding registers (FC 0x03) into a caller-provided buffer
+     *
+     * Registers are decoded straight from the RTU callback into dest; the
+     * steady-state read path performs no heap allocation.
+     *
+     * @param address Starting register address
+     * @param count Number of registers to read
+     * @param dest Destination buffer
+     * @param capacity Capacity of dest in registers (must be >= count)
+     * @return Result containing the number of registers decoded, or error
+     */
+    [[nodiscard]] ModbusResult<size_t> readHoldingRegisters(uint16_t address, uint16_t count,
+                                                            uint16_t* dest, size_t capacity);
+
+    /**
+     * @brief Read input registers (FC 0x04) into a caller-provided buffer
+     * @see readHoldingRegisters(uint16_t, uint16_t, uint16_t*, size_t)
+     */
+    [[nodiscard]] ModbusResult<size_t> readInputRegisters(uint16_t address, uint16_t count,
+                                                          uint16_t* dest, size_t capacity);
+
+    [[nodiscard]] ModbusResult<size_t> readHoldingRegistersWithPriority(uint16_t address, uint16_t count,
+                                                                        uint16_t* dest, size_t capacity,
+                                                                        esp32Modbus::ModbusPriority priority);
+    [[nodiscard]] ModbusResult<size_t> readInputRegistersWithPriority(uint16_t address, uint16_t count,
+                                                                      uint16_t* dest, size_t capacity,
+                                                                      esp32Modbus::ModbusPriority priority);
+
+    /**
+     * @brief Read coils (FC 0x01) into a packed bitset
+     *
+     * Bit i of the result is (bits[i / 8] >> (i % 8)) & 1, i.e. the Modbus
+     * wire format, copied without unpacking.
+     *
+     * @param address Starting coil address
+     * @param count Number of coils to read
+     * @param bits Destination bitset
+     * @param capacityBytes Size of bits in bytes (must be >= (count + 7) / 8)
+     * @return Result containing the number of coils decoded, or error
+     */
+    [[nodiscard]] ModbusResult<size_t> readCoils(uint16_t address, uint16_t count,
+                                                 uint8_t* bits, size_t capacityBytes);
+
+    /**
+     * @brief Read discrete inputs (FC 0x02) into a packed bitset
+     * @see readCoils(uint16_t, uint16_t, uint8_t*, size_t)
+     */
+    [[nodiscard]] ModbusResult<size_t> readDiscreteInputs(uint16_t address, uint16_t count,
+                                                          uint8_t* bits, size_t capacityBytes);
+
+    // ===== Async API (returns immediately, completes via callback) =====
+
+    /**
+     * @struct AsyncResult
+     * @brief Outcome of an async request, passed to AsyncCallback
+     *
+     * `data` points at the raw response payload and is only valid for the
+     * duration of the callback.
+     */
+    struct AsyncResult {
+        uint32_t handle = 0;
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        ModbusError error = ModbusError::SUCCESS;
+        const uint8_t* data = nullptr;
+        size_t length = 0;
+        void* context = nullptr;
+
+        bool isOk() const { return error == ModbusError::SUCCESS; }
+        size_t getRegisterCount() const { return length / 2; }
+        uint16_t getRegister(size_t i) const {
+            return (static_cast<uint16_t>(data[i * 2]) << 8) | data[i * 2 + 1];
+        }
+        bool getBit(size_t i) const { return (data[i / 8] >> (i % 8)) & 0x01; }
+    };
+
+    /**
+     * @brief Async completion callback
+     *
+     * Runs in the RTU callback task (response/error) or in the task calling
+     * expireAsyncRequests() (deadline). Keep it short; it may submit new
+     * async requests.
+     */
+    using AsyncCallback = void (*)(ModbusDevice& device, const AsyncResult& result);
+
+    /**
+     * @brief Start a holding register read (FC 0x03) without blocking
+     *
+     * The request waits for the bus like a sync call, but not for its reply.
+     * The bus stays taken until the RTU has reported the frame, so no other
+     * holder can change the RTU timeout under it; async frames run at
+     * ModbusBus::getResponseTimeout(). A request submitted while earlier ones
+     * are in flight and nobody else waits for the bus joins them, so one task
+     * can keep several devices in flight. From a completion callback the
+     * request never blocks: it joins or fails with MUTEX_ERROR. A bus holder
+     * that sends async requests itself hosts them (ModbusBus::hostAsync()).
+     *
+     * The response is matched by function code and address. Without a
+     * callback it is delivered through handleModbusResponse() instead (i.e.
+     * the QueuedModbusDevice queue).
+     *
+     * @param address Starting register address
+     * @param count Number of registers (1-125)
+     * @param callback Completion callback, or nullptr
+     * @param context Passed back in AsyncResult::context
+     * @param priority Request priority
+     * @param timeoutMs Deadline enforced by expireAsyncRequests()
+     * @return Result containing the request handle, QUEUE_FULL if
+     *         MODBUS_ASYNC_MAX_PENDING requests are in flight, MUTEX_ERROR
+     *         if the bus was not free in time, or error
+     */
+    [[nodiscard]] ModbusResult<uint32_t> readHoldingRegistersAsync(
+        uint16_t address, uint16_t count, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /** @see readHoldingRegistersAsync() */
+    [[nodiscard]] ModbusResult<uint32_t> readInputRegistersAsync(
+        uint16_t address, uint16_t count, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /** @see readHoldingRegistersAsync() */
+    [[nodiscard]] ModbusResult<uint32_t> readCoilsAsync(
+        uint16_t address, uint16_t count, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /** @see readHoldingRegistersAsync() */
+    [[nodiscard]] ModbusResult<uint32_t> readDiscreteInputsAsync(
+        uint16_t address, uint16_t count, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /** @see readHoldingRegistersAsync() */
+    [[nodiscard]] ModbusResult<uint32_t> writeSingleRegisterAsync(
+        uint16_t address, uint16_t value, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /** @see readHoldingRegistersAsync() */
+    [[nodiscard]] ModbusResult<uint32_t> writeSingleCoilAsync(
+        uint16_t address, bool value, AsyncCallback callback = nullptr, void* context = nullptr,
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY,
+        uint32_t timeoutMs = MODBUS_ASYNC_TIMEOUT_MS);
+
+    /**
+     * @brief Forget a pending async request; its callback will not run
+     * @param handle Handle returned by a *Async call
+     * @return true if the request was still pending
+     */
+    bool cancelAsync(uint32_t handle);
+
+    /**
+     * @brief Complete every async request past its deadline with TIMEOUT
+     *
+     * Called on each async submit and by QueuedModbusDevice::processQueue();
+     * call it periodically if neither happens regularly.
+     *
+     * @return Number of requests expired
+     */
+    size_t expireAsyncRequests();
+
+    /**
+     * @brief Number of async requests in flight
+     */
+    size_t getPendingAsyncCount() const;
+
+    // ===== Read deduplication =====
+
+    /**
+     * @brief Let register reads join an identical or covering read in flight
+     *
+     * While one task waits for an FC03/FC04 response, another task asking for
+     * the same function code and a range inside the in-flight one gets a copy
+     * of that response instead of sending its own frame. Up to
+     * MODBUS_READ_DEDUP_WAITERS readers can join one request. Enabled by default.
+     */
+    void setReadDeduplication(bool enabled) { readDedup = enabled; }
+    bool isReadDeduplicationEnabled() const { return readDedup; }
+
+    /**
+     * @brief Reads served from another task's request since construction
+     */
+    uint32_t getDedupedReadCount() const { return dedupedReads; }
+
+    // ===== Write combining (stage now, send with the fewest frames later) =====
+
+    /**
+     * @brief Stage a coil write for the next flushStagedWrites()
+     *
+     * Staging the same coil again replaces its value. Nothing is sent until
+     * flushStagedWrites(); drivers typically implement IModbusOutput::apply()
+     * with it.
+     *
+     * @param address Coil address
+     * @param value Coil state
+     * @return QUEUE_FULL if MODBUS_WRITE_BUFFER_ENTRIES coils are staged
+     */
+    [[nodiscard]] ModbusResult<void> stageCoil(uint16_t address, bool value);
+
+    /**
+     * @brief Stage a holding register write for the next flushStagedWrites()
+     * @see stageCoil()
+     */
+    [[nodiscard]] ModbusResult<void> stageRegister(uint16_t address, uint16_t value);
+
+    /**
+     * @brief Send all staged writes with as few frames as possible
+     *
+     * Staged coils, then registers, are sorted by address and consecutive
+     * addresses are merged into one FC0F/FC10 request (up to
+     * MODBUS_MAX_WRITE_COIL_COUNT / MODBUS_MAX_WRITE_REGISTER_COUNT); a lone
+     * address uses FC05/FC06. Only contiguous runs are merged since the
+     * registers in a gap have no staged value.
+     *
+     * Stops at the first failed frame; it and everything not yet sent stay
+     * staged for a retry. Values restaged while the flush runs are kept.
+     *
+     * @param priority Request priority for all frames
+     * @return Result of the first failed frame, or success
+     */
+    [[nodiscard]] ModbusResult<void> flushStagedWrites(esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY);
+
+    /**
+     * @brief Check whether writes are staged
+     */
+    bool hasStagedWrites() const;
+
+    /**
+     * @brief Drop all staged writes without sending them
+     */
+    void discardStagedWrites();
+
     bool isConnected() const noexcept override { return lastError == ModbusError::SUCCESS && initPhase == InitPhase::READY; }
     ModbusError getLastError() const noexcept override { return lastError; }
     [[nodiscard]] Statistics getStatistics() const override;
     void resetStatistics() override;
+
+    /**
+     * @brief Attach a register cache (caller keeps ownership)
+     *
+     * Register reads inside a cached range are served from memory while the
+     * range is fresh; writes update the cached values. Pass nullptr to detach.
+     *
+     * @param cache Cache for this device, or nullptr
+     */
+    void setRegisterCache(ModbusRegisterCache* cache) { registerCache = cache; }
+
+    ModbusRegisterCache* getRegisterCache() const { return registerCache; }
+
+    /**
+     * @brief Attach an adaptive timeout / circuit breaker policy (caller keeps ownership)
+     *
+     * With a policy, synchronous transactions use its adaptive response
+     * timeout (learned slave time plus the request's wire time) and fail
+     * fast with DEVICE_NOT_FOUND while its breaker is open. Pass nullptr to
+     * return to the fixed 1 s timeout.
+     *
+     * @param policy Policy for this device, or nullptr
+     */
+    void setLinkPolicy(ModbusLinkPolicy* policy) { linkPolicy = policy; }
+
+    ModbusLinkPolicy* getLinkPolicy() const { return linkPolicy; }
+
+    /**
+     * @brief Get per-phase transaction latency of this device
+     *
+     * Requires a build with -DMODBUSDEVICE_LATENCY_STATS; see
+     * ModbusLatencyStats::getFunctionCodeStats() for per-FC totals.
+     *
+     * @return Latency summaries, or NOT_SUPPORTED when compiled out
+     */
+    [[nodiscard]] ModbusResult<LatencyStats> getLatencyStats() const;
+
+    /**
+     * @brief Clear this device's latency histograms
+     */
+    void resetLatencyStats();
     
     /**
      * @brief Get current initialization phase
@@ -149,13 +434,26 @@ public:
     EventBits_t getErrorBit() const { return errorBit; }
 
     /**
-     * @brief Register device globally for callback routing
+     * @brief Bind the device to a bus (default: ModbusRegistry::getDefaultBus())
+     *
+     * Call during setup, before the device has transactions in flight. A
+     * registered device is moved to the new bus's address table.
+     *
+     * @param bus Bus the device is wired to
+     * @return Result indicating success or error
+     */
+    [[nodiscard]] ModbusResult<void> setBus(ModbusBus& bus);
+
+    ModbusBus& getBus() const noexcept { return *bus; }
+
+    /**
+     * @brief Register device on its bus for callback routing
      * @return ModbusError indicating success or error
      */
     ModbusError registerDevice();
     
     /**
-     * @brief Unregister device from global map
+     * @brief Unregister device from its bus
      * @return ModbusError indicating success or error
      */
     ModbusError unregisterDevice();
@@ -194,7 +492,7 @@ protected:
     esp_err_t sendRequest(uint8_t fc, uint16_t addr, uint16_t count, uint16_t* data = nullptr);
 
     /**
-     * @brief Send Modbus request without acquiring mutex (caller must hold modbusMutex)
+     * @brief Send Modbus request without acquiring mutex (caller must hold the bus mutex)
      * @param fc Function code
      * @param addr Register/coil address
      * @param count Number of items
@@ -217,16 +515,18 @@ protected:
                                       uint16_t* data = nullptr);
 
     /**
-     * @brief Acquire the global Modbus bus mutex
+     * @brief Acquire the mutex of the bus this device is bound to
      * @param timeoutMs Timeout in milliseconds
+     * @param priority Arbiter class to queue in (see ModbusBus)
      * @return true if mutex acquired, false on timeout
      */
-    static bool acquireBusMutex(uint32_t timeoutMs = 2000);
+    bool acquireBusMutex(uint32_t timeoutMs = 2000,
+                         esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY);
 
     /**
-     * @brief Release the global Modbus bus mutex
+     * @brief Release the mutex of the bus this device is bound to
      */
-    static void releaseBusMutex();
+    void releaseBusMutex();
     
     /**
      * @brief Wait for synchronous response
@@ -234,13 +534,22 @@ protected:
      * @return Result containing response data or error
      */
     ModbusResult<std::vector<uint8_t>> waitForResponse(TickType_t timeout = pdMS_TO_TICKS(1000));
+
+    /**
+     * @brief Wait for synchronous completion without copying the payload
+     * @param timeout Timeout in ticks
+     * @return Result indicating success or error
+     */
+    ModbusResult<void> waitForCompletion(TickType_t timeout = pdMS_TO_TICKS(1000));
     
 private:
-    friend void ::mainHandleData(uint8_t, esp32Modbus::FunctionCode, uint16_t, const uint8_t*, size_t);
-    friend void ::handleError(uint8_t, esp32Modbus::Error);
+    friend class ModbusBus;
+    friend class BusScheduler;
+    friend class ModbusTcpGateway;
     
     // Core members
     uint8_t serverAddress;
+    ModbusBus* bus;
     std::atomic<InitPhase> initPhase{InitPhase::UNINITIALIZED};
     std::atomic<ModbusError> lastError{ModbusError::SUCCESS};
     
@@ -249,43 +558,306 @@ private:
     std::atomic<uint32_t> successfulRequests{0};
     std::atomic<uint32_t> timeouts{0};
     std::atomic<uint32_t> crcErrors{0};
+
+#ifdef MODBUSDEVICE_LATENCY_STATS
+    LatencyHistogram latencyHistograms[LATENCY_PHASE_COUNT];
+
+    void recordLatency(LatencyPhase phase, int64_t us) noexcept {
+        latencyHistograms[static_cast<size_t>(phase)].record(us > 0 ? static_cast<uint32_t>(us) : 0);
+    }
+#endif
     
     // Synchronous operation support
+
+    /**
+     * @brief Where handleData() puts the payload of a sync response
+     */
+    struct SyncSink {
+        enum class Type : uint8_t {
+            BYTES,      ///< Copy raw bytes into SyncContext::responseData (legacy)
+            REGISTERS,  ///< Decode big-endian registers into a uint16_t buffer
+            BITS,       ///< Copy the packed bitset into a uint8_t buffer
+            NONE        ///< Discard payload (write echoes)
+        };
+        Type type = Type::BYTES;
+        void* buffer = nullptr;
+        size_t capacity = 0;  ///< Registers for REGISTERS, bytes for BITS
+    };
+
     struct SyncContext {
-        std::vector<uint8_t> responseData;
+        uint8_t responseData[MODBUS_MAX_READ_SIZE];  ///< Legacy byte sink payload
+        size_t responseLength{0};
+        SyncSink sink;
+        size_t decodedCount{0};  ///< Registers/bytes written to sink.buffer
         std::atomic<bool> responseReceived{false};
         std::atomic<bool> errorOccurred{false};
         ModbusError error{ModbusError::SUCCESS};
         SemaphoreHandle_t semaphore{nullptr};
+        SemaphoreStorage semaphoreStorage;
         std::atomic<uint8_t> expectedFc{0};  // F18: FC of the in-flight request, for response cross-check
+        std::atomic<uint32_t> expectedTxn{0}; ///< Transaction of the in-flight request; older frames are late
+    };
+    SyncContext* syncContext{nullptr};
+    LazySlot<SyncContext> syncSlot;
+
+    /**
+     * @struct WriteBuffer
+     * @brief Staged coil and register writes, allocated on first stage call
+     */
+    struct WriteBuffer {
+        struct Entry {
+            uint16_t address;
+            uint16_t value;
+        };
+        Entry coils[MODBUS_WRITE_BUFFER_ENTRIES];
+        Entry registers[MODBUS_WRITE_BUFFER_ENTRIES];
+        uint8_t coilCount = 0;
+        uint8_t registerCount = 0;
+        SemaphoreHandle_t mutex = nullptr;
+        SemaphoreStorage mutexStorage;
+    };
+    WriteBuffer* writeBuffer{nullptr};
+    LazySlot<WriteBuffer> writeSlot;
+
+    WriteBuffer* getWriteBuffer();
+
+    /**
+     * @struct ReadFlight
+     * @brief The register read in flight and the readers waiting on its response
+     */
+    struct ReadFlight {
+        struct Waiter {
+            uint16_t* dest = nullptr;
+            uint16_t offset = 0;   ///< First register within the in-flight block
+            uint16_t count = 0;
+            size_t decoded = 0;
+            ModbusError error = ModbusError::SUCCESS;
+            bool used = false;
+            bool done = false;
+            SemaphoreHandle_t wake = nullptr;
+            SemaphoreStorage wakeStorage;
+        };
+        SemaphoreHandle_t mutex = nullptr;
+        SemaphoreStorage mutexStorage;
+        bool active = false;
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        esp32Modbus::ModbusPriority priority = esp32Modbus::STATUS;   ///< Leader's class; only as urgent or less joins
+        Waiter waiters[MODBUS_READ_DEDUP_WAITERS];
+
+        ~ReadFlight();
     };
-    std::unique_ptr<SyncContext> syncContext;
+    std::atomic<ReadFlight*> readFlight{nullptr};
+    LazySlot<ReadFlight> readSlot;
+    std::atomic<bool> readDedup{true};
+    std::atomic<uint32_t> dedupedReads{0};
+
+    ReadFlight* getReadFlight();
+
+    /**
+     * @brief FC03/FC04 transaction into a register buffer, shared with concurrent readers
+     */
+    ModbusResult<void> sharedRead(uint8_t fc, uint16_t address, uint16_t count, uint16_t* dest,
+                                  esp32Modbus::ModbusPriority priority, const char* opName,
+                                  size_t* decoded);
+
+    ModbusResult<void> stageWrite(bool coil, uint16_t address, uint16_t value);
+    ModbusResult<void> flushStagedRuns(bool coil, esp32Modbus::ModbusPriority priority);
+
+    /**
+     * @brief FC06/FC10 transaction with register cache write-through
+     * @param fc 0 = FC06 for one register and FC10 for more, or a forced 0x10
+     */
+    ModbusResult<void> writeRegisterRun(uint16_t address, uint16_t count, uint16_t* data,
+                                        esp32Modbus::ModbusPriority priority, const char* opName,
+                                        uint8_t fc = 0);
     SemaphoreHandle_t syncMutex{nullptr};
-    
+    SemaphoreStorage syncMutexStorage;
+
+    /**
+     * @brief Create the sync context and mutex if not done yet
+     * @return true if both exist
+     */
+    bool createSyncResources();
+
     /**
-     * @brief Ensure sync resources are ready
+     * @brief Ensure sync resources are ready (legacy byte sink)
      */
     void ensureSyncReady();
+
+    /**
+     * @brief Ensure sync resources are ready and arm the response sink
+     * @param sink Destination for the next sync response payload
+     */
+    void ensureSyncReady(const SyncSink& sink);
+
+    /**
+     * @brief Detach the caller's buffer so a late response cannot write to it
+     */
+    void disarmSyncSink();
+
+    /**
+     * @brief Run one synchronous transaction
+     *
+     * Queued to the bus worker when one is running (see BusScheduler),
+     * otherwise run under the bus mutex.
+     *
+     * @param fc Function code
+     * @param address Starting address
+     * @param count Number of items
+     * @param priority Request priority
+     * @param data Optional data for write operations
+     * @param sink Destination for the response payload (REGISTERS, BITS or NONE)
+     * @param opName Operation name for log messages
+     * @param decoded Optional: registers or bytes written to sink.buffer
+     * @return Result indicating success or error
+     */
+    ModbusResult<void> transact(uint8_t fc, uint16_t address, uint16_t count,
+                                esp32Modbus::ModbusPriority priority, uint16_t* data,
+                                const SyncSink& sink, const char* opName,
+                                size_t* decoded = nullptr);
+
+    /**
+     * @brief Run one transaction; caller must already hold the bus mutex
+     * @param timeout Response timeout in ticks, 0 = link policy timeout or 1 s
+     * @see transact()
+     */
+    ModbusResult<void> transactLocked(uint8_t fc, uint16_t address, uint16_t count,
+                                      esp32Modbus::ModbusPriority priority, uint16_t* data,
+                                      const SyncSink& sink, TickType_t timeout = 0,
+                                      size_t* decoded = nullptr);
+
+    /**
+     * @brief transact() through the bus worker's queue
+     */
+    ModbusResult<void> transactViaWorker(BusScheduler& worker, uint8_t fc, uint16_t address,
+                                         uint16_t count, esp32Modbus::ModbusPriority priority,
+                                         uint16_t* data, const SyncSink& sink, size_t* decoded);
+
+    ModbusResult<size_t> readRegisterBlock(uint8_t fc, uint16_t address, uint16_t count,
+                                           uint16_t* dest, size_t capacity,
+                                           esp32Modbus::ModbusPriority priority, const char* opName);
+
+    ModbusResult<size_t> readBitBlock(uint8_t fc, uint16_t address, uint16_t count,
+                                      uint8_t* bits, size_t capacityBytes, const char* opName,
+                                      esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY);
+
+    // Async request support
+    struct AsyncSlot {
+        bool used = false;
+        uint32_t handle = 0;
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        uint16_t value = 0;         ///< Register written by FC06, for the cache write-through
+        TickType_t sentTick = 0;
+        TickType_t timeoutTicks = 0;
+        AsyncCallback callback = nullptr;
+        void* context = nullptr;
+#ifdef MODBUSDEVICE_TRACE
+        int64_t sentUs = 0;
+        uint8_t priority = 0;
+#endif
+    };
+
+    enum class AsyncMatch : uint8_t {
+        NONE,       ///< No pending async request took the frame
+        CONSUMED,   ///< Delivered to an async callback
+        FORWARD     ///< Async request without callback; pass to handleModbusResponse()
+    };
+
+    /**
+     * @struct Outstanding
+     * @brief A request queued in the RTU for this device
+     *
+     * Every path (sync, worker, write group, async) records its frame here
+     * before handing it to the RTU, which answers in queue order. Each reply
+     * or error is matched against this FIFO, so an error goes to the request
+     * it belongs to and a late frame of an expired or cancelled request is
+     * recognised by its transaction id instead of completing a newer one.
+     *
+     * The RTU queue serves higher priorities first and its reports carry no
+     * request id, so while entries are outstanding a new request goes out at
+     * their priority: a device's frames stay in order, whatever class asked.
+     */
+    struct Outstanding {
+        uint32_t txn = 0;           ///< Transaction id; the handle of an async request
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        bool async = false;
+        bool leased = false;        ///< Holds the bus's async lease until reported (ModbusBus::endAsync())
+        esp32Modbus::ModbusPriority priority = esp32Modbus::SENSOR;  ///< RTU queue priority it went out at
+    };
+
+    AsyncSlot asyncSlots[MODBUS_ASYNC_MAX_PENDING];
+    Outstanding outstanding[MODBUS_DEVICE_MAX_OUTSTANDING];  ///< Oldest first
+    uint8_t outstandingCount = 0;
+    SemaphoreHandle_t asyncMutex{nullptr};   ///< Guards asyncSlots and outstanding
+    SemaphoreStorage asyncMutexStorage;
+    std::atomic<uint32_t> nextTransaction{1};
+    std::atomic<uint8_t> asyncPending{0};
+
+    bool createAsyncMutex();
+    uint32_t newTransactionId();
+    bool pushOutstanding(Outstanding& request);
+    void dropOutstanding(uint32_t txn);
+
+    /**
+     * @brief Remove the request a frame answers
+     *
+     * A reply is matched to the oldest request with its FC and address, an
+     * error (anyRequest) to the oldest request.
+     * @return false if no request is recorded for the frame
+     */
+    bool takeOutstanding(uint8_t fc, uint16_t address, bool anyRequest, Outstanding& out);
+
+    ModbusResult<uint32_t> submitAsync(uint8_t fc, uint16_t address, uint16_t count, uint16_t* data,
+                                       AsyncCallback callback, void* context,
+                                       esp32Modbus::ModbusPriority priority, uint32_t timeoutMs);
+
+    /**
+     * @brief Remove the pending async request with this handle
+     * @return false if it already expired or was cancelled
+     */
+    bool takeAsyncSlot(uint32_t handle, AsyncSlot& out);
+
+    void finishAsync(const AsyncSlot& slot, ModbusError error, const uint8_t* data, size_t length);
+
+    AsyncMatch completeAsyncResponse(uint32_t handle, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Encode and queue a request in the RTU (no sync bookkeeping)
+     * @param txn Transaction id for the outstanding FIFO, 0 to assign one
+     * @param async Request of the async API (txn is its handle)
+     * @param leased Counted in the bus's async lease (ModbusBus::beginAsync())
+     */
+    esp_err_t dispatchRequest(uint8_t fc, uint16_t addr, uint16_t count,
+                              esp32Modbus::ModbusPriority priority, const uint16_t* data,
+                              uint32_t txn = 0, bool async = false, bool leased = false);
     
     /**
      * @brief Internal callback handler
+     * @param request The outstanding request the frame answers, or nullptr
      */
-    void handleData(uint8_t serverAddress, esp32Modbus::FunctionCode fc,
-                   uint16_t startingAddress, const uint8_t* data, size_t length);
+    void handleData(esp32Modbus::FunctionCode fc, uint16_t startingAddress,
+                    const uint8_t* data, size_t length, const Outstanding* request);
     
     /**
      * @brief Internal error handler
+     * @param request The outstanding request the error belongs to, or nullptr
      */
-    void handleError(esp32Modbus::Error error);
+    void handleError(esp32Modbus::Error error, const Outstanding* request);
     
     /**
      * @brief Map esp32Modbus error to ModbusError
      */
     static ModbusError mapError(esp32Modbus::Error error);
     
-    // Static Modbus mutex for thread safety
-    static SemaphoreHandle_t modbusMutex;
-    
+    // Optional shadow cache (not owned)
+    ModbusRegisterCache* registerCache{nullptr};
+    ModbusLinkPolicy* linkPolicy{nullptr};
+
     // Event group support
     EventGroupHandle_t eventGroup{nullptr};
     EventBits_t readyBit{0};
@@ -28,51 +28,163 @@ namespace modbus {
 // Static member initialization
 ModbusErrorTracker::DeviceErrorStats ModbusErrorTracker::deviceStats[MODBUS_ERROR_TRACKER_MAX_DEVICES];
 std::atomic<uint8_t> ModbusErrorTracker::numDevices{0};
+std::atomic<uint8_t> ModbusErrorTracker::addressIndex[256] = {};
 
 ModbusErrorTracker::DeviceErrorStats* ModbusErrorTracker::findOrCreateStats(uint8_t address) {
-    // First, search for existing entry
-    uint8_t count = numDevices.load();
-    for (uint8_t i = 0; i < count; i++) {
-        if (deviceStats[i].initialized.load() && deviceStats[i].address == address) {
-            return &deviceStats[i];
-        }
+    uint8_t index = addressIndex[address].load(std::memory_order_acquire);
+    if (index != INDEX_NONE) {
+        // CLAIMING: first contact racing another task; drop this one sample
+        return (index != INDEX_CLAIMING) ? &deviceStats[index - 1] : nullptr;
+    }
+
+    // Reserve the address first so two tasks never claim two slots for it
+    uint8_t expected = INDEX_NONE;
+    if (!addressIndex[address].compare_exchange_strong(expected, INDEX_CLAIMING)) {
+        return (expected != INDEX_CLAIMING) ? &deviceStats[expected - 1] : nullptr;
     }
 
-    // Not found - try to create new entry
-    // Use compare_exchange to atomically claim a slot
-    uint8_t expected = count;
-    while (expected < MODBUS_ERROR_TRACKER_MAX_DEVICES) {
-        if (numDevices.compare_exchange_weak(expected, expected + 1)) {
-            // Successfully claimed slot 'expected'
-            DeviceErrorStats* stats = &deviceStats[expected];
+    uint8_t slot = numDevices.load();
+    while (slot < MODBUS_ERROR_TRACKER_MAX_DEVICES) {
+        if (numDevices.compare_exchange_weak(slot, slot + 1)) {
+            DeviceErrorStats* stats = &deviceStats[slot];
             stats->address = address;
-            stats->crcErrors = 0;
-            stats->timeouts = 0;
-            stats->invalidData = 0;
-            stats->deviceErrors = 0;
-            stats->otherErrors = 0;
-            stats->successCount = 0;
-            stats->lastErrorTime = 0;
+            clearStats(*stats);
             stats->initialized = true;
+            addressIndex[address].store(slot + 1, std::memory_order_release);
             return stats;
         }
-        // Another thread incremented numDevices, retry
+        // Another address claimed a slot, retry with the updated count
     }
 
     // Array full
+    addressIndex[address].store(INDEX_NONE, std::memory_order_release);
     MODBUSD_LOG_W("ModbusErrorTracker: Max devices (%d) reached, cannot track device 0x%02X",
                   MODBUS_ERROR_TRACKER_MAX_DEVICES, address);
     return nullptr;
 }
 
-const ModbusErrorTracker::DeviceErrorStats* ModbusErrorTracker::findStats(uint8_t address) {
-    uint8_t count = numDevices.load();
-    for (uint8_t i = 0; i < count; i++) {
-        if (deviceStats[i].initialized.load() && deviceStats[i].address == address) {
-            return &deviceStats[i];
+void ModbusErrorTracker::clearStats(DeviceErrorStats& stats) {
+    stats.crcErrors = 0;
+    stats.timeouts = 0;
+    stats.invalidData = 0;
+    stats.deviceErrors = 0;
+    stats.otherErrors = 0;
+    stats.successCount = 0;
+    stats.lastErrorTime = 0;
+    stats.consecutiveTimeouts = 0;
+    stats.rttUs = 0;
+    stats.rttDevUs = 0;
+    stats.rttSamples = 0;
+    for (auto& bucket : stats.shortWindow) {
+        bucket.epoch = 0;
+        bucket.successes = 0;
+        bucket.errors = 0;
+        bucket.timeouts = 0;
+        bucket.latencySamples = 0;
+        bucket.latencySumUs = 0;
+        bucket.maxLatencyUs = 0;
+    }
+    for (auto& bucket : stats.longWindow) {
+        bucket.epoch = 0;
+        bucket.successes = 0;
+        bucket.errors = 0;
+        bucket.timeouts = 0;
+        bucket.latencySamples = 0;
+        bucket.latencySumUs = 0;
+        bucket.maxLatencyUs = 0;
+    }
+}
+
+void ModbusErrorTracker::recordBucket(WindowBucket* buckets, size_t count, uint32_t bucketMs,
+                                      uint32_t now, WindowEvent event, uint32_t value) {
+    uint32_t epoch = now / bucketMs;
+    WindowBucket& bucket = buckets[epoch % count];
+
+    // First writer of a new period recycles the bucket
+    uint32_t seen = bucket.epoch.load();
+    if (seen != epoch && bucket.epoch.compare_exchange_strong(seen, epoch)) {
+        bucket.successes = 0;
+        bucket.errors = 0;
+        bucket.timeouts = 0;
+        bucket.latencySamples = 0;
+        bucket.latencySumUs = 0;
+        bucket.maxLatencyUs = 0;
+    }
+
+    switch (event) {
+        case WindowEvent::SUCCESS:
+            bucket.successes++;
+            break;
+        case WindowEvent::TIMEOUT:
+            bucket.timeouts++;
+            bucket.errors++;
+            break;
+        case WindowEvent::ERROR:
+            bucket.errors++;
+            break;
+        case WindowEvent::LATENCY: {
+            bucket.latencySamples++;
+            bucket.latencySumUs += value;
+            uint32_t max = bucket.maxLatencyUs.load();
+            while (value > max && !bucket.maxLatencyUs.compare_exchange_weak(max, value)) {
+            }
+            break;
         }
     }
-    return nullptr;
+}
+
+void ModbusErrorTracker::recordWindow(DeviceErrorStats& stats, WindowEvent event, uint32_t value) {
+    uint32_t now = millis();
+    recordBucket(stats.shortWindow, MODBUS_ERROR_TRACKER_SHORT_BUCKETS,
+                 MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS, now, event, value);
+    recordBucket(stats.longWindow, MODBUS_ERROR_TRACKER_LONG_BUCKETS,
+                 MODBUS_ERROR_TRACKER_LONG_BUCKET_MS, now, event, value);
+}
+
+ModbusErrorTracker::WindowStats ModbusErrorTracker::sumWindow(const WindowBucket* buckets, size_t count,
+                                                              uint32_t bucketMs, uint32_t now) {
+    WindowStats result;
+    uint32_t epoch = now / bucketMs;
+    uint64_t latencySum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const WindowBucket& bucket = buckets[i];
+        if (epoch - bucket.epoch.load() >= count) {
+            continue;  // Older than the window (or never written)
+        }
+        result.successes += bucket.successes.load();
+        result.errors += bucket.errors.load();
+        result.timeouts += bucket.timeouts.load();
+        result.latencySamples += bucket.latencySamples.load();
+        latencySum += bucket.latencySumUs.load();
+        uint32_t max = bucket.maxLatencyUs.load();
+        if (max > result.maxLatencyUs) {
+            result.maxLatencyUs = max;
+        }
+    }
+
+    if (result.latencySamples > 0) {
+        result.avgLatencyUs = static_cast<uint32_t>(latencySum / result.latencySamples);
+    }
+    return result;
+}
+
+ModbusErrorTracker::WindowStats ModbusErrorTracker::readWindow(const DeviceErrorStats& stats,
+                                                               Window window, uint32_t now) {
+    if (window == Window::SHORT) {
+        return sumWindow(stats.shortWindow, MODBUS_ERROR_TRACKER_SHORT_BUCKETS,
+                         MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS, now);
+    }
+    return sumWindow(stats.longWindow, MODBUS_ERROR_TRACKER_LONG_BUCKETS,
+                     MODBUS_ERROR_TRACKER_LONG_BUCKET_MS, now);
+}
+
+const ModbusErrorTracker::DeviceErrorStats* ModbusErrorTracker::findStats(uint8_t address) {
+    uint8_t index = addressIndex[address].load(std::memory_order_acquire);
+    if (index == INDEX_NONE || index == INDEX_CLAIMING) {
+        return nullptr;
+    }
+    return &deviceStats[index - 1];
 }
 
 ModbusErrorTracker::ErrorCategory ModbusErrorTracker::categorizeError(ModbusError error) {
@@ -119,6 +231,7 @@ void ModbusErrorTracker::recordError(uint8_t deviceAddress, ErrorCategory catego
             break;
         case ErrorCategory::TIMEOUT:
             stats->timeouts++;
+            stats->consecutiveTimeouts++;
             break;
         case ErrorCategory::INVALID_DATA:
             stats->invalidData++;
@@ -132,38 +245,49 @@ void ModbusErrorTracker::recordError(uint8_t deviceAddress, ErrorCategory catego
     }
 
     stats->lastErrorTime = millis();
+    recordWindow(*stats, category == ErrorCategory::TIMEOUT ? WindowEvent::TIMEOUT : WindowEvent::ERROR);
 }
 
 void ModbusErrorTracker::recordSuccess(uint8_t deviceAddress) {
     DeviceErrorStats* stats = findOrCreateStats(deviceAddress);
     if (!stats) return;
     stats->successCount++;
+    stats->consecutiveTimeouts = 0;
+    recordWindow(*stats, WindowEvent::SUCCESS);
+}
+
+void ModbusErrorTracker::recordRoundTrip(uint8_t deviceAddress, uint32_t rttUs) {
+    DeviceErrorStats* stats = findOrCreateStats(deviceAddress);
+    if (!stats) return;
+
+    // Concurrent samples for one address may race; the estimate stays
+    // within the range of recent samples, which is all the policy needs.
+    if (stats->rttSamples.fetch_add(1) == 0) {
+        stats->rttUs = rttUs;
+        stats->rttDevUs = rttUs / 2;
+    } else {
+        uint32_t srtt = stats->rttUs.load();
+        uint32_t dev = stats->rttDevUs.load();
+        uint32_t delta = (rttUs > srtt) ? rttUs - srtt : srtt - rttUs;
+        stats->rttDevUs = dev - dev / 4 + delta / 4;
+        stats->rttUs = srtt - srtt / 8 + rttUs / 8;
+    }
+    stats->consecutiveTimeouts = 0;
+    recordWindow(*stats, WindowEvent::LATENCY, rttUs);
 }
 
 void ModbusErrorTracker::resetDevice(uint8_t deviceAddress) {
     DeviceErrorStats* stats = findOrCreateStats(deviceAddress);
     if (!stats) return;
 
-    stats->crcErrors = 0;
-    stats->timeouts = 0;
-    stats->invalidData = 0;
-    stats->deviceErrors = 0;
-    stats->otherErrors = 0;
-    stats->successCount = 0;
-    stats->lastErrorTime = 0;
+    clearStats(*stats);
 }
 
 void ModbusErrorTracker::resetAll() {
     uint8_t count = numDevices.load();
     for (uint8_t i = 0; i < count; i++) {
         if (deviceStats[i].initialized.load()) {
-            deviceStats[i].crcErrors = 0;
-            deviceStats[i].timeouts = 0;
-            deviceStats[i].invalidData = 0;
-            deviceStats[i].deviceErrors = 0;
-            deviceStats[i].otherErrors = 0;
-            deviceStats[i].successCount = 0;
-            deviceStats[i].lastErrorTime = 0;
+            clearStats(deviceStats[i]);
         }
     }
 }
@@ -212,6 +336,26 @@ uint32_t ModbusErrorTracker::getLastErrorTime(uint8_t deviceAddress) {
     return stats ? stats->lastErrorTime.load() : 0;
 }
 
+uint32_t ModbusErrorTracker::getConsecutiveTimeouts(uint8_t deviceAddress) {
+    const DeviceErrorStats* stats = findStats(deviceAddress);
+    return stats ? stats->consecutiveTimeouts.load() : 0;
+}
+
+uint32_t ModbusErrorTracker::getRoundTripUs(uint8_t deviceAddress) {
+    const DeviceErrorStats* stats = findStats(deviceAddress);
+    return stats ? stats->rttUs.load() : 0;
+}
+
+uint32_t ModbusErrorTracker::getRoundTripDeviationUs(uint8_t deviceAddress) {
+    const DeviceErrorStats* stats = findStats(deviceAddress);
+    return stats ? stats->rttDevUs.load() : 0;
+}
+
+uint32_t ModbusErrorTracker::getRoundTripSamples(uint8_t deviceAddress) {
+    const DeviceErrorStats* stats = findStats(deviceAddress);
+    return stats ? stats->rttSamples.load() : 0;
+}
+
 float ModbusErrorTracker::getErrorRate(uint8_t deviceAddress) {
     const DeviceErrorStats* stats = findStats(deviceAddress);
     if (!stats) return 0.0f;
@@ -226,6 +370,46 @@ float ModbusErrorTracker::getErrorRate(uint8_t deviceAddress) {
     return (static_cast<float>(errors) / static_cast<float>(total)) * 100.0f;
 }
 
+ModbusErrorTracker::WindowStats ModbusErrorTracker::getWindowStats(uint8_t deviceAddress, Window window) {
+    const DeviceErrorStats* stats = findStats(deviceAddress);
+    return stats ? readWindow(*stats, window, millis()) : WindowStats();
+}
+
+float ModbusErrorTracker::getWindowErrorRate(uint8_t deviceAddress, Window window) {
+    return getWindowStats(deviceAddress, window).errorRate();
+}
+
+size_t ModbusErrorTracker::snapshot(DeviceSnapshot* out, size_t capacity) {
+    if (!out) return 0;
+
+    uint32_t now = millis();
+    uint8_t count = numDevices.load();
+    size_t written = 0;
+
+    for (uint8_t i = 0; i < count && written < capacity; i++) {
+        const DeviceErrorStats& stats = deviceStats[i];
+        if (!stats.initialized.load()) {
+            continue;
+        }
+
+        DeviceSnapshot& entry = out[written++];
+        entry.address = stats.address;
+        entry.crcErrors = stats.crcErrors.load();
+        entry.timeouts = stats.timeouts.load();
+        entry.invalidData = stats.invalidData.load();
+        entry.deviceErrors = stats.deviceErrors.load();
+        entry.otherErrors = stats.otherErrors.load();
+        entry.successCount = stats.successCount.load();
+        entry.lastErrorTime = stats.lastErrorTime.load();
+        entry.consecutiveTimeouts = stats.consecutiveTimeouts.load();
+        entry.rttUs = stats.rttUs.load();
+        entry.rttDevUs = stats.rttDevUs.load();
+        entry.shortWindow = readWindow(stats, Window::SHORT, now);
+        entry.longWindow = readWindow(stats, Window::LONG, now);
+    }
+    return written;
+}
+
 uint8_t ModbusErrorTracker::getTrackedDeviceCount() {
     return numDevices.load();
 }
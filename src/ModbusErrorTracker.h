@@ -22,6 +22,7 @@
 #ifndef MODBUS_ERROR_TRACKER_H
 #define MODBUS_ERROR_TRACKER_H
 
+#include <cstddef>
 #include <cstdint>
 #include <atomic>
 #include "ModbusTypes.h"
@@ -31,6 +32,23 @@
 #define MODBUS_ERROR_TRACKER_MAX_DEVICES 8
 #endif
 
+// Sliding windows: SHORT = 6 x 10 s (last minute), LONG = 10 x 60 s (last 10 minutes)
+#ifndef MODBUS_ERROR_TRACKER_SHORT_BUCKETS
+#define MODBUS_ERROR_TRACKER_SHORT_BUCKETS 6
+#endif
+
+#ifndef MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS
+#define MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS 10000
+#endif
+
+#ifndef MODBUS_ERROR_TRACKER_LONG_BUCKETS
+#define MODBUS_ERROR_TRACKER_LONG_BUCKETS 10
+#endif
+
+#ifndef MODBUS_ERROR_TRACKER_LONG_BUCKET_MS
+#define MODBUS_ERROR_TRACKER_LONG_BUCKET_MS 60000
+#endif
+
 namespace modbus {
 
 /**
@@ -41,7 +59,12 @@ namespace modbus {
  * to help distinguish bus noise (CRC errors) from device failures (timeouts).
  *
  * All methods are static and thread-safe using std::atomic counters.
- * No heap allocation - uses fixed-size static array.
+ * No heap allocation - uses fixed-size static array. A 256-entry index maps
+ * each slave address to its slot, so every record and get call is O(1).
+ *
+ * Besides lifetime counters, each device keeps two ring-buffer windows of
+ * success/error/latency counts (see Window) so rates reflect the current
+ * bus condition; snapshot() exports everything in one pass.
  *
  * Usage in device libraries:
  * @code
@@ -74,6 +97,54 @@ public:
         OTHER           ///< Unclassified errors
     };
 
+    /**
+     * @enum Window
+     * @brief Sliding time windows kept per device
+     */
+    enum class Window : uint8_t {
+        SHORT,  ///< MODBUS_ERROR_TRACKER_SHORT_BUCKETS x SHORT_BUCKET_MS (default 1 min)
+        LONG    ///< MODBUS_ERROR_TRACKER_LONG_BUCKETS x LONG_BUCKET_MS (default 10 min)
+    };
+
+    /**
+     * @struct WindowStats
+     * @brief Counts within one sliding window
+     */
+    struct WindowStats {
+        uint32_t successes = 0;
+        uint32_t errors = 0;
+        uint32_t timeouts = 0;
+        uint32_t latencySamples = 0;
+        uint32_t avgLatencyUs = 0;
+        uint32_t maxLatencyUs = 0;
+
+        /// Error rate in percent (0.0 - 100.0), 0.0 if the window is empty
+        float errorRate() const {
+            uint32_t total = successes + errors;
+            return total ? (static_cast<float>(errors) / static_cast<float>(total)) * 100.0f : 0.0f;
+        }
+    };
+
+    /**
+     * @struct DeviceSnapshot
+     * @brief All statistics of one device, as copied by snapshot()
+     */
+    struct DeviceSnapshot {
+        uint8_t address = 0;
+        uint32_t crcErrors = 0;
+        uint32_t timeouts = 0;
+        uint32_t invalidData = 0;
+        uint32_t deviceErrors = 0;
+        uint32_t otherErrors = 0;
+        uint32_t successCount = 0;
+        uint32_t lastErrorTime = 0;
+        uint32_t consecutiveTimeouts = 0;
+        uint32_t rttUs = 0;
+        uint32_t rttDevUs = 0;
+        WindowStats shortWindow;
+        WindowStats longWindow;
+    };
+
     /**
      * @brief Record an error for a device
      * @param deviceAddress Modbus device address (1-247)
@@ -87,6 +158,19 @@ public:
      */
     static void recordSuccess(uint8_t deviceAddress);
 
+    /**
+     * @brief Record the round-trip time of a successful request
+     *
+     * Feeds a smoothed RTT and mean deviation (RFC 6298 style EWMA,
+     * gains 1/8 and 1/4) and, as a response arrived, ends any run of
+     * consecutive timeouts. Does not count a success; call
+     * recordSuccess() for that.
+     *
+     * @param deviceAddress Modbus device address (1-247)
+     * @param rttUs Request sent to response complete, in microseconds
+     */
+    static void recordRoundTrip(uint8_t deviceAddress, uint32_t rttUs);
+
     /**
      * @brief Categorize a ModbusError into an ErrorCategory
      * @param error The ModbusError to categorize
@@ -163,6 +247,34 @@ public:
      */
     static uint32_t getLastErrorTime(uint8_t deviceAddress);
 
+    /**
+     * @brief Get timeouts since the last success or response
+     * @param deviceAddress Modbus device address
+     * @return Consecutive timeout count
+     */
+    static uint32_t getConsecutiveTimeouts(uint8_t deviceAddress);
+
+    /**
+     * @brief Get the smoothed round-trip time
+     * @param deviceAddress Modbus device address
+     * @return Smoothed RTT in microseconds, 0 if no sample yet
+     */
+    static uint32_t getRoundTripUs(uint8_t deviceAddress);
+
+    /**
+     * @brief Get the mean deviation of the round-trip time
+     * @param deviceAddress Modbus device address
+     * @return RTT deviation in microseconds
+     */
+    static uint32_t getRoundTripDeviationUs(uint8_t deviceAddress);
+
+    /**
+     * @brief Get the number of round-trip samples recorded
+     * @param deviceAddress Modbus device address
+     * @return Sample count
+     */
+    static uint32_t getRoundTripSamples(uint8_t deviceAddress);
+
     /**
      * @brief Calculate error rate percentage for a device
      * @param deviceAddress Modbus device address
@@ -170,6 +282,30 @@ public:
      */
     static float getErrorRate(uint8_t deviceAddress);
 
+    /**
+     * @brief Get success/error/latency counts of a sliding window
+     * @param deviceAddress Modbus device address
+     * @param window SHORT or LONG
+     * @return Window counts, all zero if the device is not tracked
+     */
+    static WindowStats getWindowStats(uint8_t deviceAddress, Window window);
+
+    /**
+     * @brief Error rate over a sliding window
+     * @param deviceAddress Modbus device address
+     * @param window SHORT or LONG
+     * @return Error rate as percentage (0.0 - 100.0), or 0.0 if no operations
+     */
+    static float getWindowErrorRate(uint8_t deviceAddress, Window window);
+
+    /**
+     * @brief Copy the statistics of all tracked devices in one pass
+     * @param out Destination array
+     * @param capacity Entries available in out
+     * @return Number of entries written
+     */
+    static size_t snapshot(DeviceSnapshot* out, size_t capacity);
+
     /**
      * @brief Get the number of currently tracked devices
      * @return Number of devices with recorded statistics
@@ -191,6 +327,26 @@ public:
     static const char* categoryToString(ErrorCategory category);
 
 private:
+    /**
+     * @struct WindowBucket
+     * @brief Counts for one bucket period; `epoch` = millis() / bucket length
+     *
+     * A bucket is recycled by the first writer that sees a stale epoch.
+     * Writers racing that reset may lose a count, which keeps the hot path
+     * lock-free at the cost of approximate windows under contention.
+     */
+    struct WindowBucket {
+        std::atomic<uint32_t> epoch{0};
+        std::atomic<uint32_t> successes{0};
+        std::atomic<uint32_t> errors{0};
+        std::atomic<uint32_t> timeouts{0};
+        std::atomic<uint32_t> latencySamples{0};
+        std::atomic<uint32_t> latencySumUs{0};
+        std::atomic<uint32_t> maxLatencyUs{0};
+    };
+
+    enum class WindowEvent : uint8_t { SUCCESS, ERROR, TIMEOUT, LATENCY };
+
     /**
      * @struct DeviceErrorStats
      * @brief Per-device error statistics (thread-safe)
@@ -204,11 +360,24 @@ private:
         std::atomic<uint32_t> otherErrors{0};
         std::atomic<uint32_t> successCount{0};
         std::atomic<uint32_t> lastErrorTime{0};
+        std::atomic<uint32_t> consecutiveTimeouts{0};
+        std::atomic<uint32_t> rttUs{0};        ///< Smoothed RTT
+        std::atomic<uint32_t> rttDevUs{0};     ///< Mean deviation of RTT
+        std::atomic<uint32_t> rttSamples{0};
         std::atomic<bool> initialized{false};
+        WindowBucket shortWindow[MODBUS_ERROR_TRACKER_SHORT_BUCKETS];
+        WindowBucket longWindow[MODBUS_ERROR_TRACKER_LONG_BUCKETS];
     };
 
+    static_assert(MODBUS_ERROR_TRACKER_MAX_DEVICES >= 1 && MODBUS_ERROR_TRACKER_MAX_DEVICES <= 253,
+                  "MODBUS_ERROR_TRACKER_MAX_DEVICES must fit the 8-bit address index");
+
+    static constexpr uint8_t INDEX_NONE = 0;        ///< Address not tracked
+    static constexpr uint8_t INDEX_CLAIMING = 0xFF; ///< Slot being set up by another task
+
     static DeviceErrorStats deviceStats[MODBUS_ERROR_TRACKER_MAX_DEVICES];
     static std::atomic<uint8_t> numDevices;
+    static std::atomic<uint8_t> addressIndex[256];  ///< Address -> slot + 1
 
     /**
      * @brief Find existing stats or create new entry for device
@@ -223,6 +392,15 @@ private:
      * @return Pointer to stats, or nullptr if not found
      */
     static const DeviceErrorStats* findStats(uint8_t address);
+
+    static void clearStats(DeviceErrorStats& stats);
+
+    static void recordWindow(DeviceErrorStats& stats, WindowEvent event, uint32_t value = 0);
+    static void recordBucket(WindowBucket* buckets, size_t count, uint32_t bucketMs, uint32_t now,
+                             WindowEvent event, uint32_t value);
+    static WindowStats sumWindow(const WindowBucket* buckets, size_t count, uint32_t bucketMs,
+                                 uint32_t now);
+    static WindowStats readWindow(const DeviceErrorStats& stats, Window window, uint32_t now);
 };
 
 } // namespace modbus
@@ -0,0 +1,324 @@
+/*
+ * ModbusInitOrchestrator.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusInitOrchestrator.h"
+#include "ModbusDeviceLogging.h"
+#include "ModbusPollBudget.h"
+
+namespace modbus {
+
+ModbusInitOrchestrator::ModbusInitOrchestrator() : ModbusInitOrchestrator(Config()) {
+}
+
+ModbusInitOrchestrator::ModbusInitOrchestrator(const Config& config) : config(config) {
+}
+
+ModbusResult<void> ModbusInitOrchestrator::addDevice(ModbusDevice& device, const InitStep* steps,
+                                                     size_t stepCount, void* context) {
+    if (!steps || stepCount == 0) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (deviceCount >= MODBUS_INIT_MAX_DEVICES) {
+        return ModbusResult<void>::error(ModbusError::QUEUE_FULL);
+    }
+
+    Entry& entry = entries[deviceCount++];
+    entry.owner = this;
+    entry.device = &device;
+    entry.steps = steps;
+    entry.stepCount = stepCount;
+    entry.context = context;
+    return ModbusResult<void>::ok();
+}
+
+void ModbusInitOrchestrator::clear() {
+    for (size_t i = 0; i < deviceCount; i++) {
+        entries[i].device = nullptr;
+        entries[i].state = State::PENDING;
+    }
+    deviceCount = 0;
+}
+
+bool ModbusInitOrchestrator::acquireBuses(ModbusBus** buses, size_t& busCount) {
+    busCount = 0;
+    for (size_t i = 0; i < deviceCount; i++) {
+        ModbusBus* bus = &entries[i].device->getBus();
+        bool seen = false;
+        for (size_t b = 0; b < busCount; b++) {
+            seen = seen || buses[b] == bus;
+        }
+        if (seen) {
+            continue;
+        }
+        if (!bus->acquireBusMutex(MODBUS_MUTEX_TIMEOUT_MS, config.priority)) {
+            releaseBuses(buses, busCount);
+            busCount = 0;
+            return false;
+        }
+        // The steps go out as async requests under our hold and timeout
+        bus->hostAsync(true);
+        buses[busCount++] = bus;
+    }
+    return true;
+}
+
+void ModbusInitOrchestrator::setRtuTimeout(ModbusBus* const* buses, size_t busCount, uint32_t timeoutMs) {
+    for (size_t b = 0; b < busCount; b++) {
+        buses[b]->setTransactionTimeout(timeoutMs);
+    }
+}
+
+void ModbusInitOrchestrator::releaseBuses(ModbusBus* const* buses, size_t busCount) {
+    for (size_t b = 0; b < busCount; b++) {
+        buses[b]->setTransactionTimeout(0);
+        buses[b]->hostAsync(false);
+        buses[b]->releaseBusMutex();
+    }
+}
+
+ModbusResult<size_t> ModbusInitOrchestrator::run(uint32_t timeoutMs) {
+    // Nothing else is sent on these buses until the bring-up is done, so
+    // the RTU timeout can follow the phase
+    ModbusBus* buses[MODBUS_INIT_MAX_DEVICES];
+    size_t busCount = 0;
+    if (!acquireBuses(buses, busCount)) {
+        MODBUSD_LOG_E("Bring-up: bus busy, no device started");
+        return ModbusResult<size_t>::error(ModbusError::MUTEX_ERROR);
+    }
+    setRtuTimeout(buses, busCount, config.probeTimeoutMs);
+    probing = true;
+
+    const TickType_t start = xTaskGetTickCount();
+    startTick = start;
+    expired = false;
+
+    for (size_t i = 0; i < deviceCount; i++) {
+        Entry& entry = entries[i];
+        entry.step = 0;
+        entry.attempts = 0;
+        entry.error = ModbusError::SUCCESS;
+        entry.doneMs = 0;
+        entry.parked = false;
+        entry.state = State::PENDING;
+        entry.device->setInitPhase(ModbusDevice::InitPhase::CONFIGURING);
+    }
+
+    // Start every device's probe before waiting for any of them
+    for (size_t i = 0; i < deviceCount; i++) {
+        Entry& entry = entries[i];
+        ModbusError registered = entry.device->registerDevice();
+        if (registered != ModbusError::SUCCESS) {
+            finish(entry, registered);
+            continue;
+        }
+        submit(entry);
+    }
+
+    // Completions chain the next steps from the RTU task; this loop ends the
+    // probe phase and enforces the per-step deadlines and the overall bound
+    for (;;) {
+        size_t pending = 0;
+        size_t parked = 0;
+        for (size_t i = 0; i < deviceCount; i++) {
+            if (entries[i].state.load() == State::PENDING) {
+                entries[i].device->expireAsyncRequests();
+                pending++;
+                if (entries[i].parked.load()) {
+                    parked++;
+                }
+            }
+        }
+        if (pending == 0) {
+            break;
+        }
+        if (probing && parked == pending) {
+            // Every probe is answered or given up; the rest runs at the step timeout
+            setRtuTimeout(buses, busCount, config.stepTimeoutMs);
+            probing = false;
+        }
+        if (!probing) {
+            // Also picks up a device that parked just as the phase ended
+            for (size_t i = 0; i < deviceCount; i++) {
+                bool wasParked = true;
+                if (entries[i].parked.compare_exchange_strong(wasParked, false)) {
+                    submit(entries[i]);
+                }
+            }
+        }
+        if (!expired && (xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeoutMs)) {
+            // In-flight steps still expire on their own deadline, then fail
+            MODBUSD_LOG_W("Bring-up timeout after %lu ms, %u devices pending",
+                          (unsigned long)timeoutMs, (unsigned)pending);
+            expired = true;
+        }
+        vTaskDelay(1);
+    }
+    probing = false;
+    releaseBuses(buses, busCount);
+
+    size_t ready = getReadyCount();
+    MODBUSD_LOG_I("Bring-up finished: %u of %u devices ready in %lu ms", (unsigned)ready,
+                  (unsigned)deviceCount,
+                  (unsigned long)((xTaskGetTickCount() - start) * portTICK_PERIOD_MS));
+    return ModbusResult<size_t>::ok(ready);
+}
+
+void ModbusInitOrchestrator::submit(Entry& entry) {
+    if (expired) {
+        finish(entry, ModbusError::TIMEOUT);
+        return;
+    }
+
+    const InitStep& step = entry.steps[entry.step];
+    const uint32_t timeoutMs = (entry.step == 0) ? config.probeTimeoutMs : config.stepTimeoutMs;
+    ModbusDevice& device = *entry.device;
+    ModbusResult<uint32_t> result = ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+
+    // The RTU runs at timeoutMs and reports the step itself; the async
+    // deadline only backs up a lost callback, so it also covers one queued
+    // request of every other device
+    const uint32_t wireMs =
+        (ModbusPollBudget::estimateTransactionUs(step.functionCode, step.count, device.getBus().getBaudRate()) + 999) / 1000;
+    const uint32_t deadlineMs = static_cast<uint32_t>(deviceCount + 1) * (timeoutMs + wireMs);
+
+    // May complete before returning (the callback then submits the next step)
+    switch (step.functionCode) {
+        case 0x01:
+            result = device.readCoilsAsync(step.address, step.count, onStepResult, &entry,
+                                           config.priority, deadlineMs);
+            break;
+        case 0x02:
+            result = device.readDiscreteInputsAsync(step.address, step.count, onStepResult, &entry,
+                                                    config.priority, deadlineMs);
+            break;
+        case 0x03:
+            result = device.readHoldingRegistersAsync(step.address, step.count, onStepResult, &entry,
+                                                      config.priority, deadlineMs);
+            break;
+        case 0x04:
+            result = device.readInputRegistersAsync(step.address, step.count, onStepResult, &entry,
+                                                    config.priority, deadlineMs);
+            break;
+        case 0x05:
+            result = device.writeSingleCoilAsync(step.address, step.value != 0, onStepResult, &entry,
+                                                 config.priority, deadlineMs);
+            break;
+        case 0x06:
+            result = device.writeSingleRegisterAsync(step.address, step.value, onStepResult, &entry,
+                                                     config.priority, deadlineMs);
+            break;
+        default:
+            break;
+    }
+
+    if (!result.isOk()) {
+        MODBUSD_LOG_E("Device %d: init step %u not sent", device.getServerAddress(),
+                      (unsigned)entry.step);
+        finish(entry, result.error());
+    }
+}
+
+void ModbusInitOrchestrator::onStepResult(ModbusDevice& device, const ModbusDevice::AsyncResult& result) {
+    Entry& entry = *static_cast<Entry*>(result.context);
+    if (entry.state.load() != State::PENDING) {
+        return;
+    }
+    ModbusInitOrchestrator& self = *entry.owner;
+
+    if (!result.isOk()) {
+        // No answer or a garbled one is worth another try; an exception is final
+        bool retryable = (result.error == ModbusError::TIMEOUT || result.error == ModbusError::CRC_ERROR);
+        uint8_t retries = (entry.step == 0) ? self.config.probeRetries : self.config.stepRetries;
+        if (retryable && entry.attempts < retries) {
+            entry.attempts++;
+            self.submit(entry);
+            return;
+        }
+        MODBUSD_LOG_W("Device %d: init step %u failed (%d)", device.getServerAddress(),
+                      (unsigned)entry.step, static_cast<int>(result.error));
+        self.finish(entry, result.error);
+        return;
+    }
+
+    const InitStep& step = entry.steps[entry.step];
+    if (step.handler && !step.handler(device, result, entry.context)) {
+        self.finish(entry, ModbusError::INVALID_RESPONSE);
+        return;
+    }
+
+    entry.attempts = 0;
+    if (++entry.step >= entry.stepCount) {
+        self.finish(entry, ModbusError::SUCCESS);
+        return;
+    }
+    if (entry.step == 1 && self.probing.load()) {
+        entry.parked = true;   // run() sends it once the probe phase ends
+        return;
+    }
+    self.submit(entry);
+}
+
+void ModbusInitOrchestrator::finish(Entry& entry, ModbusError error) {
+    entry.error = error;
+    entry.doneMs = static_cast<uint32_t>((xTaskGetTickCount() - startTick) * portTICK_PERIOD_MS);
+    if (entry.doneMs == 0) {
+        entry.doneMs = 1;  // 0 means not finished
+    }
+    bool ok = (error == ModbusError::SUCCESS);
+    entry.state = ok ? State::READY : State::FAILED;
+    entry.device->setInitPhase(ok ? ModbusDevice::InitPhase::READY : ModbusDevice::InitPhase::ERROR);
+}
+
+size_t ModbusInitOrchestrator::getReadyCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (entries[i].state.load() == State::READY) {
+            count++;
+        }
+    }
+    return count;
+}
+
+size_t ModbusInitOrchestrator::getFailedCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < deviceCount; i++) {
+        if (entries[i].state.load() == State::FAILED) {
+            count++;
+        }
+    }
+    return count;
+}
+
+ModbusError ModbusInitOrchestrator::getDeviceError(size_t i) const {
+    if (i >= deviceCount || entries[i].state.load() != State::FAILED) {
+        return ModbusError::SUCCESS;
+    }
+    return entries[i].error;
+}
+
+uint32_t ModbusInitOrchestrator::getDeviceTimeMs(size_t i) const {
+    if (i >= deviceCount || entries[i].state.load() == State::PENDING) {
+        return 0;
+    }
+    return entries[i].doneMs;
+}
+
+} // namespace modbus
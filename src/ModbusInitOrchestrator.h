@@ -0,0 +1,222 @@
+/*
+ * ModbusInitOrchestrator.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSINITORCHESTRATOR_H
+#define MODBUSINITORCHESTRATOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ModbusDevice.h"
+
+// Devices one orchestrator brings up
+#ifndef MODBUS_INIT_MAX_DEVICES
+#define MODBUS_INIT_MAX_DEVICES 16
+#endif
+
+// First step of each device doubles as presence probe: short timeout, a few tries
+#ifndef MODBUS_INIT_PROBE_TIMEOUT_MS
+#define MODBUS_INIT_PROBE_TIMEOUT_MS 100
+#endif
+
+#ifndef MODBUS_INIT_PROBE_RETRIES
+#define MODBUS_INIT_PROBE_RETRIES 2
+#endif
+
+// Remaining configuration steps of a device that answered the probe
+#ifndef MODBUS_INIT_STEP_TIMEOUT_MS
+#define MODBUS_INIT_STEP_TIMEOUT_MS 500
+#endif
+
+#ifndef MODBUS_INIT_STEP_RETRIES
+#define MODBUS_INIT_STEP_RETRIES 1
+#endif
+
+// Overall bound of run()
+#ifndef MODBUS_INIT_TIMEOUT_MS
+#define MODBUS_INIT_TIMEOUT_MS 10000
+#endif
+
+namespace modbus {
+
+/**
+ * @class ModbusInitOrchestrator
+ * @brief Brings up many devices at once instead of one after another
+ *
+ * Each device describes its CONFIGURING phase as a list of InitStep
+ * requests. run() moves every device to CONFIGURING and starts its first
+ * step through the async API; each completion runs the step handler and
+ * immediately queues the device's next step, so the RTU queue always
+ * holds the next request of every live device and their reads interleave
+ * on the bus. A device becomes READY (setting its event-group ready bit)
+ * as soon as its own last step succeeds.
+ *
+ * The first step is the presence probe: it uses a short timeout and a few
+ * retries, and a device that never answers it is set to ERROR without
+ * delaying anyone else. Later steps use the normal step timeout. Boot time
+ * therefore follows the slowest live device plus a few probe timeouts,
+ * rather than the sum of all devices.
+ *
+ * run() holds the bus of every device (ModbusBus::acquireBusMutex()) for
+ * the whole bring-up and hosts the steps' async requests on it
+ * (ModbusBus::hostAsync()), so other traffic waits behind it, and sets the RTU
+ * response timeout to the probe timeout while probes are outstanding: a
+ * dead slave costs the probe timeout on the wire, not the bus default.
+ * Devices that answered their probe wait until the last probe has been
+ * answered or given up, then the RTU timeout becomes the step timeout and
+ * the remaining steps run; ModbusBus::getResponseTimeout() is restored at
+ * the end.
+ *
+ * @code
+ * static bool parseLimits(ModbusDevice& dev, const ModbusDevice::AsyncResult& r, void* ctx) {
+ *     static_cast<MyDriver&>(dev).setLimits(r.getRegister(0), r.getRegister(1));
+ *     return true;
+ * }
+ * static const ModbusInitOrchestrator::InitStep driverSteps[] = {
+ *     {0x03, 0x0000, 1},                  // probe: firmware version
+ *     {0x03, 0x0010, 2, 0, parseLimits},  // configuration block
+ * };
+ *
+ * ModbusInitOrchestrator init;
+ * for (auto& d : drivers) (void)init.addDevice(d, driverSteps, 2);
+ * auto ready = init.run();                // returns when all are READY or ERROR
+ * @endcode
+ */
+class ModbusInitOrchestrator {
+public:
+    /**
+     * @brief Consumes a step's response
+     * @return false to fail the device with INVALID_RESPONSE
+     * @note Runs in the RTU callback task while run() holds the bus; keep it
+     *       short and do not use the sync API
+     */
+    using StepHandler = bool (*)(ModbusDevice& device, const ModbusDevice::AsyncResult& result,
+                                 void* context);
+
+    /**
+     * @struct InitStep
+     * @brief One configuration request
+     *
+     * Reads (FC01-04) use count; single writes (FC05/FC06) send value.
+     */
+    struct InitStep {
+        uint8_t functionCode = 0x03;
+        uint16_t address = 0;
+        uint16_t count = 1;
+        uint16_t value = 0;
+        StepHandler handler = nullptr;   ///< nullptr = only require a response
+    };
+
+    struct Config {
+        uint32_t probeTimeoutMs = MODBUS_INIT_PROBE_TIMEOUT_MS;
+        uint8_t probeRetries = MODBUS_INIT_PROBE_RETRIES;
+        uint32_t stepTimeoutMs = MODBUS_INIT_STEP_TIMEOUT_MS;
+        uint8_t stepRetries = MODBUS_INIT_STEP_RETRIES;
+        esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY;
+    };
+
+    ModbusInitOrchestrator();
+    explicit ModbusInitOrchestrator(const Config& config);
+
+    ModbusInitOrchestrator(const ModbusInitOrchestrator&) = delete;
+    ModbusInitOrchestrator& operator=(const ModbusInitOrchestrator&) = delete;
+
+    /**
+     * @brief Add a device to bring up
+     * @param device Device (registered by run() if needed)
+     * @param steps Configuration steps, probe first (must outlive run())
+     * @param stepCount Number of steps (>= 1)
+     * @param context Passed to every step handler
+     * @return QUEUE_FULL beyond MODBUS_INIT_MAX_DEVICES, INVALID_PARAMETER
+     *         for an empty step list
+     */
+    [[nodiscard]] ModbusResult<void> addDevice(ModbusDevice& device, const InitStep* steps,
+                                               size_t stepCount, void* context = nullptr);
+
+    /**
+     * @brief Run all added devices to READY or ERROR
+     *
+     * Blocks the calling task, which also enforces the async deadlines.
+     * Devices still configuring when timeoutMs runs out are set to ERROR
+     * with TIMEOUT.
+     *
+     * @param timeoutMs Bound of the whole bring-up
+     * @return Number of devices that reached READY, MUTEX_ERROR when a
+     *         bus could not be acquired (no device is touched then)
+     */
+    ModbusResult<size_t> run(uint32_t timeoutMs = MODBUS_INIT_TIMEOUT_MS);
+
+    /**
+     * @brief Forget all devices (only while run() is not active)
+     */
+    void clear();
+
+    size_t getDeviceCount() const { return deviceCount; }
+    size_t getReadyCount() const;
+    size_t getFailedCount() const;
+
+    /**
+     * @brief Why device i failed (SUCCESS while it is pending or ready)
+     */
+    ModbusError getDeviceError(size_t i) const;
+
+    /**
+     * @brief Milliseconds from run() start until device i finished, 0 = not finished
+     */
+    uint32_t getDeviceTimeMs(size_t i) const;
+
+    const Config& getConfig() const { return config; }
+
+private:
+    enum class State : uint8_t { PENDING, READY, FAILED };
+
+    struct Entry {
+        ModbusInitOrchestrator* owner = nullptr;
+        ModbusDevice* device = nullptr;
+        const InitStep* steps = nullptr;
+        size_t stepCount = 0;
+        void* context = nullptr;
+        size_t step = 0;
+        uint8_t attempts = 0;                   ///< Failed attempts of the current step
+        std::atomic<State> state{State::PENDING};
+        std::atomic<bool> parked{false};        ///< Probe answered, waiting for the probe phase to end
+        ModbusError error = ModbusError::SUCCESS;
+        uint32_t doneMs = 0;
+    };
+
+    static void onStepResult(ModbusDevice& device, const ModbusDevice::AsyncResult& result);
+    void submit(Entry& entry);
+    void finish(Entry& entry, ModbusError error);
+    bool acquireBuses(ModbusBus** buses, size_t& busCount);
+    static void setRtuTimeout(ModbusBus* const* buses, size_t busCount, uint32_t timeoutMs);
+    static void releaseBuses(ModbusBus* const* buses, size_t busCount);
+
+    Config config;
+    Entry entries[MODBUS_INIT_MAX_DEVICES];
+    size_t deviceCount = 0;
+    TickType_t startTick = 0;
+    std::atomic<bool> expired{false};   ///< Overall bound passed; fail instead of submitting
+    std::atomic<bool> probing{false};   ///< RTU runs at the probe timeout; answered probes park
+};
+
+} // namespace modbus
+
+#endif // MODBUSINITORCHESTRATOR_H
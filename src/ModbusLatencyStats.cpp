@@ -0,0 +1,148 @@
+/*
+ * ModbusLatencyStats.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusLatencyStats.h"
+
+namespace modbus {
+
+size_t LatencyHistogram::bucketFor(uint32_t us) noexcept {
+    // 0 -> 0, 1 -> 1, 2..3 -> 2, 4..7 -> 3, ...
+    size_t bucket = (us == 0) ? 0 : static_cast<size_t>(32 - __builtin_clz(us));
+    return bucket < MODBUS_LATENCY_BUCKETS ? bucket : MODBUS_LATENCY_BUCKETS - 1;
+}
+
+uint32_t LatencyHistogram::bucketUpperUs(size_t bucket) noexcept {
+    if (bucket == 0) return 0;
+    if (bucket >= 32) return UINT32_MAX;
+    return (1UL << bucket) - 1;
+}
+
+void LatencyHistogram::record(uint32_t us) noexcept {
+    buckets_[bucketFor(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t current = min_.load(std::memory_order_relaxed);
+    while (us < current && !min_.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+    }
+    current = max_.load(std::memory_order_relaxed);
+    while (us > current && !max_.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset() noexcept {
+    for (auto& bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    min_.store(UINT32_MAX, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t count, uint32_t permille) const noexcept {
+    // Rank of the sample at the requested percentile (1-based, rounded up)
+    uint32_t rank = static_cast<uint32_t>((static_cast<uint64_t>(count) * permille + 999) / 1000);
+    if (rank == 0) rank = 1;
+
+    uint32_t seen = 0;
+    for (size_t b = 0; b < MODBUS_LATENCY_BUCKETS; b++) {
+        seen += buckets_[b].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return bucketUpperUs(b);
+        }
+    }
+    return bucketUpperUs(MODBUS_LATENCY_BUCKETS - 1);
+}
+
+LatencySummary LatencyHistogram::summarize() const noexcept {
+    LatencySummary summary;
+    summary.count = count_.load(std::memory_order_relaxed);
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    summary.minUs = min_.load(std::memory_order_relaxed);
+    summary.maxUs = max_.load(std::memory_order_relaxed);
+
+    // Bucket bounds are coarse; never report outside the observed range
+    auto clamp = [&summary](uint32_t us) {
+        if (us < summary.minUs) return summary.minUs;
+        if (us > summary.maxUs) return summary.maxUs;
+        return us;
+    };
+    summary.p50Us = clamp(percentile(summary.count, 500));
+    summary.p99Us = clamp(percentile(summary.count, 990));
+    return summary;
+}
+
+int ModbusLatencyStats::slotFor(uint8_t functionCode) noexcept {
+    switch (functionCode) {
+        case 0x01: return 0;
+        case 0x02: return 1;
+        case 0x03: return 2;
+        case 0x04: return 3;
+        case 0x05: return 4;
+        case 0x06: return 5;
+        case 0x0F: return 6;
+        case 0x10: return 7;
+        default:   return -1;
+    }
+}
+
+#ifdef MODBUSDEVICE_LATENCY_STATS
+
+namespace {
+LatencyHistogram functionCodeHistograms[8];
+}
+
+void ModbusLatencyStats::recordTransaction(uint8_t functionCode, uint32_t us) noexcept {
+    int slot = slotFor(functionCode);
+    if (slot >= 0) {
+        functionCodeHistograms[slot].record(us);
+    }
+}
+
+ModbusResult<LatencySummary> ModbusLatencyStats::getFunctionCodeStats(uint8_t functionCode) {
+    int slot = slotFor(functionCode);
+    if (slot < 0) {
+        return ModbusResult<LatencySummary>::error(ModbusError::INVALID_PARAMETER);
+    }
+    return ModbusResult<LatencySummary>::ok(functionCodeHistograms[slot].summarize());
+}
+
+void ModbusLatencyStats::reset() noexcept {
+    for (auto& histogram : functionCodeHistograms) {
+        histogram.reset();
+    }
+}
+
+#else
+
+void ModbusLatencyStats::recordTransaction(uint8_t, uint32_t) noexcept {}
+
+ModbusResult<LatencySummary> ModbusLatencyStats::getFunctionCodeStats(uint8_t) {
+    return ModbusResult<LatencySummary>::error(ModbusError::NOT_SUPPORTED);
+}
+
+void ModbusLatencyStats::reset() noexcept {}
+
+#endif // MODBUSDEVICE_LATENCY_STATS
+
+} // namespace modbus
@@ -0,0 +1,153 @@
+/*
+ * ModbusLatencyStats.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSLATENCYSTATS_H
+#define MODBUSLATENCYSTATS_H
+
+/**
+ * @file ModbusLatencyStats.h
+ * @brief Log2 latency histograms for the bus transaction path
+ *
+ * Recording only happens when the library is built with
+ * -DMODBUSDEVICE_LATENCY_STATS; without it the histograms are not part of
+ * ModbusDevice and the query functions return NOT_SUPPORTED.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ModbusTypes.h"
+
+// Number of log2 buckets; bucket b holds [2^(b-1), 2^b) us, the last one is open-ended
+#ifndef MODBUS_LATENCY_BUCKETS
+#define MODBUS_LATENCY_BUCKETS 24  // top bucket starts at ~4.2 s
+#endif
+
+namespace modbus {
+
+/**
+ * @enum LatencyPhase
+ * @brief Phases of one synchronous transaction
+ */
+enum class LatencyPhase : uint8_t {
+    MUTEX_WAIT = 0,  ///< Waiting for the bus mutex
+    SEND,            ///< sendRequestWithPriority() (encode + RTU queue)
+    ROUND_TRIP,      ///< Send returned until response/error/timeout
+    INTER_FRAME,     ///< Inter-frame gap (tick sleep or precise wait)
+    TOTAL,           ///< Whole transaction including all of the above
+    COUNT
+};
+
+constexpr size_t LATENCY_PHASE_COUNT = static_cast<size_t>(LatencyPhase::COUNT);
+
+/**
+ * @struct LatencySummary
+ * @brief Aggregate of one histogram; percentiles are bucket upper bounds
+ */
+struct LatencySummary {
+    uint32_t count = 0;
+    uint32_t minUs = 0;
+    uint32_t maxUs = 0;
+    uint32_t p50Us = 0;
+    uint32_t p99Us = 0;
+};
+
+/**
+ * @struct LatencyStats
+ * @brief Per-phase summaries of one device
+ */
+struct LatencyStats {
+    LatencySummary phases[LATENCY_PHASE_COUNT];
+
+    const LatencySummary& operator[](LatencyPhase phase) const {
+        return phases[static_cast<size_t>(phase)];
+    }
+};
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-size log2 histogram of microsecond samples
+ *
+ * record() is lock-free and allocation-free; summarize() may run
+ * concurrently with record() and then sees a slightly inconsistent but
+ * usable snapshot.
+ */
+class LatencyHistogram {
+public:
+    void record(uint32_t us) noexcept;
+    void reset() noexcept;
+    LatencySummary summarize() const noexcept;
+
+    uint32_t getCount() const noexcept { return count_.load(std::memory_order_relaxed); }
+
+    static size_t bucketFor(uint32_t us) noexcept;
+    static uint32_t bucketUpperUs(size_t bucket) noexcept;
+
+private:
+    uint32_t percentile(uint32_t count, uint32_t permille) const noexcept;
+
+    std::atomic<uint32_t> buckets_[MODBUS_LATENCY_BUCKETS] = {};
+    std::atomic<uint32_t> count_{0};
+    std::atomic<uint32_t> min_{UINT32_MAX};
+    std::atomic<uint32_t> max_{0};
+};
+
+/**
+ * @class ModbusLatencyStats
+ * @brief Process-wide transaction latency per function code
+ *
+ * One set of histograms for the whole process: transactions on every bus
+ * are recorded together. Per-bus figures come from the devices'
+ * getLatencyStats().
+ */
+class ModbusLatencyStats {
+public:
+    /**
+     * @brief Record a complete transaction (called from ModbusDevice)
+     * @param functionCode Modbus function code
+     * @param us Transaction time in microseconds
+     */
+    static void recordTransaction(uint8_t functionCode, uint32_t us) noexcept;
+
+    /**
+     * @brief Get the transaction latency summary of one function code
+     * @param functionCode 0x01-0x06, 0x0F or 0x10
+     * @return Summary, INVALID_PARAMETER for other codes, NOT_SUPPORTED when compiled out
+     */
+    static ModbusResult<LatencySummary> getFunctionCodeStats(uint8_t functionCode);
+
+    static void reset() noexcept;
+
+    static constexpr bool isEnabled() {
+#ifdef MODBUSDEVICE_LATENCY_STATS
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+    static int slotFor(uint8_t functionCode) noexcept;
+};
+
+} // namespace modbus
+
+#endif // MODBUSLATENCYSTATS_H
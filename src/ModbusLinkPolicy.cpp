@@ -0,0 +1,138 @@
+/*
+ * ModbusLinkPolicy.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusLinkPolicy.h"
+#include "ModbusDeviceLogging.h"
+#include "ModbusErrorTracker.h"
+#include "freertos/task.h"
+#include <algorithm>
+
+namespace modbus {
+
+ModbusLinkPolicy::ModbusLinkPolicy() = default;
+
+ModbusLinkPolicy::ModbusLinkPolicy(const Config& config) : config(config) {}
+
+bool ModbusLinkPolicy::allowRequest([[maybe_unused]] uint8_t address) {
+    BreakerState current = state.load();
+    if (current == BreakerState::CLOSED) {
+        return true;
+    }
+
+    if (current == BreakerState::OPEN) {
+        // Signed difference keeps the comparison valid across tick wrap
+        if (static_cast<int32_t>(xTaskGetTickCount() - retryAt.load()) < 0) {
+            rejected++;
+            return false;
+        }
+        state.compare_exchange_strong(current, BreakerState::HALF_OPEN);
+    }
+
+    // HALF_OPEN: exactly one probe until it reports back
+    bool expected = false;
+    if (probeInFlight.compare_exchange_strong(expected, true)) {
+        MODBUSD_LOG_D("Probing device %d after %lu ms backoff", address,
+                      (unsigned long)backoffMs.load());
+        return true;
+    }
+    rejected++;
+    return false;
+}
+
+uint32_t ModbusLinkPolicy::getTimeoutMs(uint8_t address, uint32_t wireUs) const {
+    const uint32_t wireMs = (wireUs + 999) / 1000;
+    if (!config.adaptiveTimeout ||
+        ModbusErrorTracker::getRoundTripSamples(address) < config.minSamples) {
+        return config.maxTimeoutMs + wireMs;
+    }
+
+    // The tracker holds slave time only; the bounds apply to it, not to the frames
+    uint64_t us = ModbusErrorTracker::getRoundTripUs(address) +
+                  static_cast<uint64_t>(config.rttDeviations) *
+                  ModbusErrorTracker::getRoundTripDeviationUs(address);
+    uint64_t ms = (us + 999) / 1000;
+    return static_cast<uint32_t>(std::min<uint64_t>(std::max<uint64_t>(ms, config.minTimeoutMs),
+                                                    config.maxTimeoutMs)) + wireMs;
+}
+
+TickType_t ModbusLinkPolicy::getTimeout(uint8_t address, uint32_t wireUs) const {
+    // +1 tick: a tick-granular wait may otherwise end up to a tick early
+    return pdMS_TO_TICKS(getTimeoutMs(address, wireUs)) + 1;
+}
+
+void ModbusLinkPolicy::recordResult(uint8_t address, ModbusError error, uint32_t rttUs, uint32_t wireUs) {
+    auto category = ModbusErrorTracker::categorizeError(error);
+    // Learn the slave's time only, so one estimate serves frames of any size
+    rttUs = rttUs > wireUs ? rttUs - wireUs : 0;
+
+    if (error == ModbusError::SUCCESS) {
+        ModbusErrorTracker::recordSuccess(address);
+        ModbusErrorTracker::recordRoundTrip(address, rttUs);
+    } else if (error != ModbusError::MUTEX_ERROR) {
+        ModbusErrorTracker::recordError(address, category);
+        if (category == ModbusErrorTracker::ErrorCategory::DEVICE_ERROR) {
+            // An exception response is still a round trip
+            ModbusErrorTracker::recordRoundTrip(address, rttUs);
+        }
+    }
+
+    if (category == ModbusErrorTracker::ErrorCategory::TIMEOUT) {
+        if (state.load() == BreakerState::HALF_OPEN ||
+            (config.breakerThreshold > 0 &&
+             ModbusErrorTracker::getConsecutiveTimeouts(address) >= config.breakerThreshold)) {
+            open(address);
+            return;
+        }
+    } else if (error == ModbusError::SUCCESS ||
+               category == ModbusErrorTracker::ErrorCategory::CRC_ERROR ||
+               category == ModbusErrorTracker::ErrorCategory::DEVICE_ERROR) {
+        // The slave answered, even if garbled or with an exception
+        if (state.load() != BreakerState::CLOSED) {
+            MODBUSD_LOG_I("Device %d responding again", address);
+        }
+        state = BreakerState::CLOSED;
+        backoffMs = 0;
+    }
+
+    // A probe that failed locally (mutex, send) releases the slot for the next one
+    probeInFlight = false;
+}
+
+void ModbusLinkPolicy::reset() {
+    state = BreakerState::CLOSED;
+    backoffMs = 0;
+    rejected = 0;
+    probeInFlight = false;
+}
+
+void ModbusLinkPolicy::open([[maybe_unused]] uint8_t address) {
+    uint32_t previous = backoffMs.load();
+    uint32_t next = previous ? std::min<uint32_t>(previous * 2, config.backoffMaxMs)
+                             : std::min<uint32_t>(config.backoffBaseMs, config.backoffMaxMs);
+    backoffMs = next;
+    retryAt = xTaskGetTickCount() + pdMS_TO_TICKS(next);
+    state = BreakerState::OPEN;
+    probeInFlight = false;
+
+    MODBUSD_LOG_W("Device %d not responding, backing off %lu ms", address, (unsigned long)next);
+}
+
+} // namespace modbus
@@ -0,0 +1,196 @@
+/*
+ * ModbusLinkPolicy.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSLINKPOLICY_H
+#define MODBUSLINKPOLICY_H
+
+#include <atomic>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "ModbusTypes.h"
+
+// Bounds of the learned slave time in the adaptive response timeout; the
+// upper bound is also used until enough round-trip samples exist
+#ifndef MODBUS_LINK_MIN_TIMEOUT_MS
+#define MODBUS_LINK_MIN_TIMEOUT_MS 20
+#endif
+
+#ifndef MODBUS_LINK_MAX_TIMEOUT_MS
+#define MODBUS_LINK_MAX_TIMEOUT_MS 1000
+#endif
+
+// Timeout = smoothed slave time + MODBUS_LINK_RTT_DEVIATIONS x its deviation,
+// plus the wire time of the request
+#ifndef MODBUS_LINK_RTT_DEVIATIONS
+#define MODBUS_LINK_RTT_DEVIATIONS 4
+#endif
+
+#ifndef MODBUS_LINK_MIN_SAMPLES
+#define MODBUS_LINK_MIN_SAMPLES 8
+#endif
+
+// Consecutive timeouts that open the circuit breaker (0 = never)
+#ifndef MODBUS_LINK_BREAKER_THRESHOLD
+#define MODBUS_LINK_BREAKER_THRESHOLD 3
+#endif
+
+// First open period; doubled after every failed probe up to the maximum
+#ifndef MODBUS_LINK_BACKOFF_BASE_MS
+#define MODBUS_LINK_BACKOFF_BASE_MS 1000
+#endif
+
+#ifndef MODBUS_LINK_BACKOFF_MAX_MS
+#define MODBUS_LINK_BACKOFF_MAX_MS 60000
+#endif
+
+namespace modbus {
+
+/**
+ * @class ModbusLinkPolicy
+ * @brief Adaptive response timeout and circuit breaker for one device
+ *
+ * Attached to a ModbusDevice with setLinkPolicy(), every synchronous
+ * transaction of the device is reported to ModbusErrorTracker (success,
+ * error category and round-trip time) and the policy acts on those
+ * per-address statistics:
+ *
+ * - The response timeout follows the observed slave time: the round trip
+ *   minus the wire time of the frames
+ *   (ModbusPollBudget::estimateTransactionUs()), smoothed, plus k *
+ *   deviation, clamped to [minTimeoutMs, maxTimeoutMs]. The wire time of
+ *   the request at hand is added back, so a large read gets the time its
+ *   frames need while a healthy fast slave no longer reserves the bus for
+ *   a fixed second. The RTU master runs with it for that transaction
+ *   (ModbusBus::setTransactionTimeout()); a reply that arrives later is
+ *   dropped by transaction id.
+ * - After breakerThreshold consecutive timeouts the breaker opens: requests
+ *   fail immediately with DEVICE_NOT_FOUND without touching the bus. When
+ *   the backoff period has passed one probe request is let through; a
+ *   response closes the breaker, another timeout reopens it with twice the
+ *   backoff (up to backoffMaxMs).
+ *
+ * Statistics live in ModbusErrorTracker, so addresses it cannot track
+ * (table full) keep the fixed maxTimeoutMs and never trip the breaker.
+ * Device libraries should not record results for a device that has a
+ * policy attached, or they are counted twice.
+ *
+ * @code
+ * static ModbusLinkPolicy policy;
+ * device.setLinkPolicy(&policy);
+ * @endcode
+ */
+class ModbusLinkPolicy {
+public:
+    enum class BreakerState : uint8_t {
+        CLOSED,     ///< Requests pass
+        OPEN,       ///< Requests rejected until the backoff expires
+        HALF_OPEN   ///< One probe request in flight
+    };
+
+    struct Config {
+        bool adaptiveTimeout = true;
+        uint32_t minTimeoutMs = MODBUS_LINK_MIN_TIMEOUT_MS;
+        uint32_t maxTimeoutMs = MODBUS_LINK_MAX_TIMEOUT_MS;
+        uint8_t rttDeviations = MODBUS_LINK_RTT_DEVIATIONS;
+        uint8_t minSamples = MODBUS_LINK_MIN_SAMPLES;
+        uint8_t breakerThreshold = MODBUS_LINK_BREAKER_THRESHOLD;
+        uint32_t backoffBaseMs = MODBUS_LINK_BACKOFF_BASE_MS;
+        uint32_t backoffMaxMs = MODBUS_LINK_BACKOFF_MAX_MS;
+    };
+
+    ModbusLinkPolicy();
+    explicit ModbusLinkPolicy(const Config& config);
+
+    ModbusLinkPolicy(const ModbusLinkPolicy&) = delete;
+    ModbusLinkPolicy& operator=(const ModbusLinkPolicy&) = delete;
+
+    /**
+     * @brief Replace the configuration; call before the device is polled
+     */
+    void setConfig(const Config& config) { this->config = config; }
+
+    const Config& getConfig() const { return config; }
+
+    /**
+     * @brief Check whether a request may go out now
+     *
+     * Moves an expired OPEN breaker to HALF_OPEN and grants the single probe.
+     *
+     * @param address Device address
+     * @return false if the request must fail with DEVICE_NOT_FOUND
+     */
+    bool allowRequest(uint8_t address);
+
+    /**
+     * @brief Response timeout to use for the next request
+     * @param address Device address
+     * @param wireUs Wire time of the request
+     *        (ModbusPollBudget::estimateTransactionUs()), added to the slave time
+     * @return Timeout in ticks
+     */
+    TickType_t getTimeout(uint8_t address, uint32_t wireUs = 0) const;
+
+    /**
+     * @brief Response timeout in milliseconds
+     * @see getTimeout()
+     */
+    uint32_t getTimeoutMs(uint8_t address, uint32_t wireUs = 0) const;
+
+    /**
+     * @brief Report the outcome of a request granted by allowRequest()
+     * @param address Device address
+     * @param error Result of the transaction
+     * @param rttUs Request sent to completion, in microseconds
+     * @param wireUs Wire time of the request, not counted as slave time
+     */
+    void recordResult(uint8_t address, ModbusError error, uint32_t rttUs, uint32_t wireUs = 0);
+
+    BreakerState getState() const { return state.load(); }
+
+    /**
+     * @brief Current open period in milliseconds (0 while closed)
+     */
+    uint32_t getBackoffMs() const { return backoffMs.load(); }
+
+    /**
+     * @brief Requests rejected by the open breaker since the last reset()
+     */
+    uint32_t getRejectedCount() const { return rejected.load(); }
+
+    /**
+     * @brief Close the breaker and clear the backoff
+     */
+    void reset();
+
+private:
+    void open(uint8_t address);
+
+    Config config;
+    std::atomic<BreakerState> state{BreakerState::CLOSED};
+    std::atomic<TickType_t> retryAt{0};
+    std::atomic<uint32_t> backoffMs{0};
+    std::atomic<uint32_t> rejected{0};
+    std::atomic<bool> probeInFlight{false};
+};
+
+} // namespace modbus
+
+#endif // MODBUSLINKPOLICY_H
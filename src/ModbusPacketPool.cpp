@@ -0,0 +1,83 @@
+/*
+ * ModbusPacketPool.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusPacketPool.h"
+
+namespace modbus {
+
+namespace {
+
+// Free bits of bitmap word `index`: full words, the partial last word, then zeros
+constexpr uint32_t initialMask(size_t index) {
+    return (index + 1) * 32 <= MODBUS_PACKET_POOL_BLOCKS ? 0xFFFFFFFFUL
+         : index * 32 < MODBUS_PACKET_POOL_BLOCKS ? ((1UL << (MODBUS_PACKET_POOL_BLOCKS % 32)) - 1)
+         : 0;
+}
+
+} // namespace
+
+uint8_t ModbusPacketPool::blocks[MODBUS_PACKET_POOL_BLOCKS][BLOCK_SIZE];
+std::atomic<uint32_t> ModbusPacketPool::freeMask[WORDS] = {
+    {initialMask(0)}, {initialMask(1)}, {initialMask(2)}, {initialMask(3)},
+    {initialMask(4)}, {initialMask(5)}, {initialMask(6)}, {initialMask(7)}
+};
+std::atomic<uint32_t> ModbusPacketPool::exhausted{0};
+
+uint8_t ModbusPacketPool::acquire() noexcept {
+    for (size_t w = 0; w < WORDS; w++) {
+        uint32_t mask = freeMask[w].load(std::memory_order_relaxed);
+        while (mask != 0) {
+            uint32_t bit = static_cast<uint32_t>(__builtin_ctz(mask));
+            if (freeMask[w].compare_exchange_weak(mask, mask & ~(1UL << bit),
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+                return static_cast<uint8_t>(w * 32 + bit);
+            }
+            // mask was reloaded by the failed CAS; retry
+        }
+    }
+    exhausted.fetch_add(1, std::memory_order_relaxed);
+    return NO_BLOCK;
+}
+
+void ModbusPacketPool::release(uint8_t block) noexcept {
+    if (block >= MODBUS_PACKET_POOL_BLOCKS) {
+        return;
+    }
+    freeMask[block / 32].fetch_or(1UL << (block % 32), std::memory_order_release);
+}
+
+uint8_t* ModbusPacketPool::data(uint8_t block) noexcept {
+    if (block >= MODBUS_PACKET_POOL_BLOCKS) {
+        return nullptr;
+    }
+    return blocks[block];
+}
+
+size_t ModbusPacketPool::getFreeCount() noexcept {
+    size_t count = 0;
+    for (size_t w = 0; w < WORDS; w++) {
+        count += static_cast<size_t>(__builtin_popcount(freeMask[w].load(std::memory_order_relaxed)));
+    }
+    return count;
+}
+
+} // namespace modbus
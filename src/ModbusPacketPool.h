@@ -0,0 +1,91 @@
+/*
+ * ModbusPacketPool.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSPACKETPOOL_H
+#define MODBUSPACKETPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ModbusTypes.h"
+
+// Response payload blocks shared by all QueuedModbusDevice instances.
+// Size this for the number of responses queued but not yet processed
+// across all devices, not for the sum of the queue depths.
+#ifndef MODBUS_PACKET_POOL_BLOCKS
+#define MODBUS_PACKET_POOL_BLOCKS 16
+#endif
+
+static_assert(MODBUS_PACKET_POOL_BLOCKS > 0 && MODBUS_PACKET_POOL_BLOCKS < 255,
+              "MODBUS_PACKET_POOL_BLOCKS must be 1..254 (index 255 means no block)");
+
+namespace modbus {
+
+/**
+ * @class ModbusPacketPool
+ * @brief Fixed-block buffer pool for queued response payloads
+ *
+ * Each block holds one response payload (MODBUS_MAX_READ_SIZE bytes).
+ * Blocks are handed out by index from a lock-free bitmap, so acquire() and
+ * release() can be called from the RTU callback task and from any device
+ * task without a mutex.
+ */
+class ModbusPacketPool {
+public:
+    static constexpr uint8_t NO_BLOCK = 0xFF;
+    static constexpr size_t BLOCK_SIZE = MODBUS_MAX_READ_SIZE;
+
+    /**
+     * @brief Take a free block
+     * @return Block index, or NO_BLOCK if the pool is exhausted
+     */
+    static uint8_t acquire() noexcept;
+
+    /**
+     * @brief Return a block to the pool (NO_BLOCK is ignored)
+     */
+    static void release(uint8_t block) noexcept;
+
+    /**
+     * @brief Get the payload storage of a block
+     * @return Pointer to BLOCK_SIZE bytes, or nullptr for an invalid index
+     */
+    static uint8_t* data(uint8_t block) noexcept;
+
+    static size_t getFreeCount() noexcept;
+    static constexpr size_t getCapacity() { return MODBUS_PACKET_POOL_BLOCKS; }
+
+    /**
+     * @brief Number of acquire() calls that found the pool empty
+     */
+    static uint32_t getExhaustedCount() noexcept { return exhausted.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr size_t WORDS = 8;  // Covers the 254 block maximum
+
+    static uint8_t blocks[MODBUS_PACKET_POOL_BLOCKS][BLOCK_SIZE];
+    static std::atomic<uint32_t> freeMask[WORDS];  ///< Bit set = block free
+    static std::atomic<uint32_t> exhausted;
+};
+
+} // namespace modbus
+
+#endif // MODBUSPACKETPOOL_H
@@ -0,0 +1,250 @@
+/*
+ * ModbusPollBudget.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "ModbusPollBudget.h"
+#include "ModbusBus.h"
+#include "ModbusRegistry.h"
+#include "ModbusDeviceLogging.h"
+#include "MutexGuard.h"
+#include <esp_timer.h>
+
+namespace modbus {
+
+namespace {
+
+// Moving-average weights (1/8 per poll for volatility, 1/4 per window for the correction)
+constexpr float VOLATILITY_ALPHA = 0.125f;
+constexpr float CORRECTION_ALPHA = 0.25f;
+
+// Bounds on measured/predicted; outside them the estimates are not worth correcting
+constexpr float CORRECTION_MIN = 0.25f;
+constexpr float CORRECTION_MAX = 16.0f;
+
+constexpr float STATIC_WEIGHT = MODBUS_BUDGET_STATIC_WEIGHT_PERCENT / 100.0f;
+
+} // namespace
+
+ModbusPollBudget::ModbusPollBudget(ModbusBus* bus)
+    : bus(bus ? bus : &ModbusRegistry::getInstance().getDefaultBus()) {
+    mutex = createMutex(mutexStorage);
+    if (!mutex) {
+        MODBUSD_LOG_E("Failed to create poll budget mutex");
+    }
+    windowStartUs = esp_timer_get_time();
+    windowStartBusyUs = this->bus->getBusyTimeUs();
+}
+
+ModbusPollBudget::~ModbusPollBudget() {
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+}
+
+ModbusResult<uint8_t> ModbusPollBudget::addPoller(uint32_t costUs, uint32_t minPeriodMs,
+                                                  uint32_t maxPeriodMs) {
+    if (minPeriodMs == 0 || (maxPeriodMs != 0 && maxPeriodMs < minPeriodMs)) {
+        return ModbusResult<uint8_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (!mutex) {
+        return ModbusResult<uint8_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return ModbusResult<uint8_t>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    for (uint8_t i = 0; i < MODBUS_BUDGET_MAX_POLLERS; i++) {
+        Poller& p = pollers[i];
+        if (p.used) {
+            continue;
+        }
+        p = Poller{};
+        p.used = true;
+        p.costUs = costUs;
+        p.minPeriodMs = minPeriodMs;
+        p.maxPeriodMs = maxPeriodMs ? maxPeriodMs : minPeriodMs * MODBUS_BUDGET_MAX_STRETCH;
+        p.periodMs = minPeriodMs;
+        pollerCount++;
+        return ModbusResult<uint8_t>::ok(i);
+    }
+    return ModbusResult<uint8_t>::error(ModbusError::QUEUE_FULL);
+}
+
+void ModbusPollBudget::removePoller(uint8_t id) {
+    if (id >= MODBUS_BUDGET_MAX_POLLERS) {
+        return;
+    }
+    MutexGuard lock(mutex);
+    if (lock.hasLock() && pollers[id].used) {
+        pollers[id].used = false;
+        pollerCount--;
+    }
+}
+
+uint32_t ModbusPollBudget::getPeriodMs(uint8_t id) const {
+    if (id >= MODBUS_BUDGET_MAX_POLLERS) {
+        return 0;
+    }
+    MutexGuard lock(mutex);
+    return lock.hasLock() && pollers[id].used ? pollers[id].periodMs : 0;
+}
+
+float ModbusPollBudget::getVolatility(uint8_t id) const {
+    if (id >= MODBUS_BUDGET_MAX_POLLERS) {
+        return 0.0f;
+    }
+    MutexGuard lock(mutex);
+    return lock.hasLock() && pollers[id].used ? pollers[id].volatility : 0.0f;
+}
+
+void ModbusPollBudget::setTargetUtilization(float fraction) {
+    if (fraction < 0.05f) fraction = 0.05f;
+    if (fraction > 1.0f) fraction = 1.0f;
+    MutexGuard lock(mutex);
+    target = fraction;
+}
+
+float ModbusPollBudget::getPredictedUtilization() const {
+    MutexGuard lock(mutex);
+    float sum = 0.0f;
+    for (const Poller& p : pollers) {
+        if (p.used && p.periodMs) {
+            sum += p.costUs / (p.periodMs * 1000.0f);
+        }
+    }
+    return sum * correction;
+}
+
+void ModbusPollBudget::reportPoll(uint8_t id, bool changed) {
+    if (id >= MODBUS_BUDGET_MAX_POLLERS) {
+        return;
+    }
+    MutexGuard lock(mutex);
+    if (!lock.hasLock() || !pollers[id].used) {
+        return;
+    }
+    Poller& p = pollers[id];
+    p.volatility += VOLATILITY_ALPHA * ((changed ? 1.0f : 0.0f) - p.volatility);
+    p.polls++;
+
+    const int64_t nowUs = esp_timer_get_time();
+    if (nowUs - windowStartUs >= int64_t(MODBUS_BUDGET_WINDOW_MS) * 1000) {
+        recompute(nowUs);
+    }
+}
+
+void ModbusPollBudget::update() {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return;
+    }
+    const int64_t nowUs = esp_timer_get_time();
+    if (nowUs - windowStartUs >= int64_t(MODBUS_BUDGET_WINDOW_MS) * 1000) {
+        recompute(nowUs);
+    }
+}
+
+float ModbusPollBudget::weightOf(const Poller& p) const {
+    return STATIC_WEIGHT + (1.0f - STATIC_WEIGHT) * p.volatility;
+}
+
+// Caller holds the mutex
+void ModbusPollBudget::recompute(int64_t nowUs) {
+    const uint32_t busyUs = bus->getBusyTimeUs();
+    const float windowUs = float(nowUs - windowStartUs);
+    measured = float(uint32_t(busyUs - windowStartBusyUs)) / windowUs;  // Wraps with the counter
+    windowStartUs = nowUs;
+    windowStartBusyUs = busyUs;
+
+    // What the estimates say the polls of this window cost, to calibrate them
+    // against the hold time actually measured (turnaround, retries, other traffic)
+    float predicted = 0.0f;
+    for (Poller& p : pollers) {
+        if (p.used) {
+            predicted += float(p.costUs) * p.polls;
+        }
+        p.polls = 0;
+    }
+    predicted /= windowUs;
+    if (predicted > 0.0f) {
+        float ratio = measured / predicted;
+        if (ratio < CORRECTION_MIN) ratio = CORRECTION_MIN;
+        if (ratio > CORRECTION_MAX) ratio = CORRECTION_MAX;
+        correction += CORRECTION_ALPHA * (ratio - correction);
+    }
+
+    // Demand if every poller ran at its minimum period scaled by its weight
+    float demand = 0.0f;
+    for (const Poller& p : pollers) {
+        if (p.used) {
+            demand += p.costUs * weightOf(p) / (p.minPeriodMs * 1000.0f);
+        }
+    }
+    demand *= correction;
+    const float k = demand > target ? target / demand : 1.0f;
+
+    for (Poller& p : pollers) {
+        if (!p.used) {
+            continue;
+        }
+        // With room on the bus nobody is slowed; otherwise static pollers stretch most
+        float period = k >= 1.0f ? float(p.minPeriodMs) : p.minPeriodMs / (weightOf(p) * k);
+        if (period > p.maxPeriodMs) period = float(p.maxPeriodMs);
+        p.periodMs = uint32_t(period + 0.5f);
+        if (p.periodMs < p.minPeriodMs) p.periodMs = p.minPeriodMs;
+    }
+
+    MODBUSD_LOG_D("Poll budget: measured %.1f%%, correction %.2f, scale %.2f",
+                  measured * 100.0f, correction, k);
+}
+
+uint32_t ModbusPollBudget::estimateTransactionUs(uint8_t functionCode, uint16_t count, uint32_t baud) {
+    if (baud == 0) {
+        baud = MODBUS_BAUD_RATE;
+    }
+    uint32_t request = 8;   // addr + fc + address + count/value + crc
+    uint32_t response = 8;
+    switch (functionCode) {
+        case 0x01:
+        case 0x02:
+            response = 5 + (count + 7u) / 8;
+            break;
+        case 0x03:
+        case 0x04:
+            response = 5 + 2u * count;
+            break;
+        case 0x0F:
+            request = 9 + (count + 7u) / 8;
+            break;
+        case 0x10:
+            request = 9 + 2u * count;
+            break;
+        default:   // FC05/FC06 echo the request
+            break;
+    }
+    // 3.5 character gap after each frame = 7 characters
+    const uint64_t bits = uint64_t(request + response + 7) * 11;
+    return uint32_t(bits * 1000000ULL / baud);
+}
+
+} // namespace modbus
@@ -0,0 +1,196 @@
+/*
+ * ModbusPollBudget.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSPOLLBUDGET_H
+#define MODBUSPOLLBUDGET_H
+
+/**
+ * @file ModbusPollBudget.h
+ * @brief Poll-period controller that keeps a bus under a utilisation target
+ *
+ * Each poller (a driver's poll cycle, a PointTableDevice group) is
+ * registered with its estimated wire time per poll and a min/max period.
+ * The budget samples how long the bus was actually held
+ * (ModbusBus::getBusyTimeUs()), corrects the wire-time estimates by the
+ * measured/predicted ratio, and assigns each poller a period so the total
+ * stays at the target. Pollers whose values rarely change are stretched
+ * first; volatile ones stay close to their minimum period.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+
+// Pollers one budget can manage
+#ifndef MODBUS_BUDGET_MAX_POLLERS
+#define MODBUS_BUDGET_MAX_POLLERS 16
+#endif
+
+// Default share of the bus the pollers may use
+#ifndef MODBUS_BUDGET_TARGET_PERCENT
+#define MODBUS_BUDGET_TARGET_PERCENT 70
+#endif
+
+// Measurement window; periods are recomputed at most this often
+#ifndef MODBUS_BUDGET_WINDOW_MS
+#define MODBUS_BUDGET_WINDOW_MS 1000
+#endif
+
+// Relative rate kept by a poller whose values never change (vs. one that changes every poll)
+#ifndef MODBUS_BUDGET_STATIC_WEIGHT_PERCENT
+#define MODBUS_BUDGET_STATIC_WEIGHT_PERCENT 25
+#endif
+
+// Max period as a multiple of the configured one, for pollers registered without a max
+#ifndef MODBUS_BUDGET_MAX_STRETCH
+#define MODBUS_BUDGET_MAX_STRETCH 8
+#endif
+
+namespace modbus {
+
+class ModbusBus;
+
+/**
+ * @class ModbusPollBudget
+ * @brief Scales poll periods of the pollers on one bus to a utilisation target
+ *
+ * Pollers ask getPeriodMs() when scheduling their next poll and call
+ * reportPoll() after each one, saying whether any value changed. The
+ * controller recomputes at most once per MODBUS_BUDGET_WINDOW_MS from
+ * reportPoll() or on an explicit update():
+ *
+ *   weight_i = static + (1 - static) * volatility_i
+ *   k        = min(1, target / (correction * sum(cost_i * weight_i / min_i)))
+ *   period_i = clamp(min_i / (weight_i * k), min_i, max_i)
+ *
+ * volatility_i is a moving average of the changed flags, correction the
+ * smoothed ratio of measured bus time to the time the estimates predict.
+ * Traffic outside the budget (writes, unmanaged drivers) shows up in the
+ * measurement and so also pushes the pollers back.
+ *
+ * @code
+ * static ModbusPollBudget budget;
+ * meter.setPollBudget(&budget);   // PointTableDevice registers its groups
+ * meter.initialize();
+ * @endcode
+ */
+class ModbusPollBudget {
+public:
+    static constexpr uint8_t NO_POLLER = 0xFF;
+
+    /**
+     * @param bus Bus whose occupancy is measured (nullptr = default bus)
+     */
+    explicit ModbusPollBudget(ModbusBus* bus = nullptr);
+    ~ModbusPollBudget();
+
+    ModbusPollBudget(const ModbusPollBudget&) = delete;
+    ModbusPollBudget& operator=(const ModbusPollBudget&) = delete;
+
+    /**
+     * @brief Register a poller
+     * @param costUs Estimated bus time of one poll (see estimateTransactionUs())
+     * @param minPeriodMs Fastest period, used while the bus has room
+     * @param maxPeriodMs Slowest period under load (0 = MODBUS_BUDGET_MAX_STRETCH x min)
+     * @return Poller id; QUEUE_FULL once MODBUS_BUDGET_MAX_POLLERS are registered
+     */
+    ModbusResult<uint8_t> addPoller(uint32_t costUs, uint32_t minPeriodMs, uint32_t maxPeriodMs = 0);
+
+    void removePoller(uint8_t id);
+
+    /**
+     * @brief Current period of a poller (its min period until the first update)
+     */
+    uint32_t getPeriodMs(uint8_t id) const;
+
+    /**
+     * @brief Record one completed poll and recompute if the window has elapsed
+     * @param changed Any value of the poll differed from the previous one
+     */
+    void reportPoll(uint8_t id, bool changed);
+
+    /**
+     * @brief Recompute periods now if at least one window has elapsed
+     */
+    void update();
+
+    void setTargetUtilization(float fraction);
+    float getTargetUtilization() const { return target; }
+
+    /**
+     * @brief Bus occupancy measured over the last window (0..1)
+     */
+    float getMeasuredUtilization() const { return measured; }
+
+    /**
+     * @brief Occupancy the corrected estimates predict at the current periods
+     */
+    float getPredictedUtilization() const;
+
+    /**
+     * @brief Share of recent polls that changed a value (0..1)
+     */
+    float getVolatility(uint8_t id) const;
+
+    size_t getPollerCount() const { return pollerCount; }
+
+    /**
+     * @brief Wire time of one RTU transaction
+     *
+     * Request and response frames (11 bits per character) plus the 3.5
+     * character gap after each. Slave turnaround is not included; the
+     * measured correction accounts for it.
+     */
+    static uint32_t estimateTransactionUs(uint8_t functionCode, uint16_t count, uint32_t baud);
+
+private:
+    struct Poller {
+        bool used = false;
+        uint32_t costUs = 0;
+        uint32_t minPeriodMs = 0;
+        uint32_t maxPeriodMs = 0;
+        uint32_t periodMs = 0;
+        float volatility = 1.0f;   ///< Start volatile: nothing is slowed before it is observed
+        uint32_t polls = 0;        ///< Polls reported in the current window
+    };
+
+    void recompute(int64_t nowUs);
+    float weightOf(const Poller& p) const;
+
+    ModbusBus* bus;
+    Poller pollers[MODBUS_BUDGET_MAX_POLLERS];
+    size_t pollerCount = 0;
+    float target = MODBUS_BUDGET_TARGET_PERCENT / 100.0f;
+    float measured = 0.0f;
+    float correction = 1.0f;
+    int64_t windowStartUs = 0;
+    uint32_t windowStartBusyUs = 0;
+    mutable SemaphoreHandle_t mutex = nullptr;
+    SemaphoreStorage mutexStorage;
+};
+
+} // namespace modbus
+
+#endif // MODBUSPOLLBUDGET_H
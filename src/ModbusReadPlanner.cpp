@@ -0,0 +1,110 @@
+/*
+ * ModbusReadPlanner.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusReadPlanner.h"
+#include <algorithm>
+
+namespace modbus {
+
+ModbusReadPlanner::ModbusReadPlanner(uint16_t maxGap, uint16_t maxCount)
+    : maxGap_(maxGap), maxCount_(MODBUS_MAX_REGISTER_COUNT) {
+    setMaxCount(maxCount);
+}
+
+void ModbusReadPlanner::setMaxCount(uint16_t count) {
+    if (count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        count = MODBUS_MAX_REGISTER_COUNT;
+    }
+    maxCount_ = count;
+}
+
+void ModbusReadPlanner::clear() {
+    blocks_.clear();
+    order_.clear();
+}
+
+void ModbusReadPlanner::plan(const ReadItem* items, size_t count) {
+    clear();
+    if (!items || count == 0) return;
+
+    order_.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        order_.push_back(static_cast<uint16_t>(i));
+    }
+
+    // Sort by (FC, address); wider items first on equal address so the block
+    // end is known as early as possible
+    std::sort(order_.begin(), order_.end(), [items](uint16_t a, uint16_t b) {
+        if (items[a].functionCode != items[b].functionCode) {
+            return items[a].functionCode < items[b].functionCode;
+        }
+        if (items[a].address != items[b].address) {
+            return items[a].address < items[b].address;
+        }
+        return items[a].width > items[b].width;
+    });
+
+    ReadBlock current;
+    uint32_t currentEnd = 0;  // One past the last register of the block
+    bool open = false;
+
+    for (size_t pos = 0; pos < order_.size(); pos++) {
+        const ReadItem& item = items[order_[pos]];
+        uint32_t width = (item.width == 0) ? 1 : item.width;
+        uint32_t itemEnd = static_cast<uint32_t>(item.address) + width;
+
+        if (open) {
+            bool sameFc = (item.functionCode == current.functionCode);
+            uint32_t gap = (item.address > currentEnd) ? (item.address - currentEnd) : 0;
+            uint32_t newEnd = std::max(currentEnd, itemEnd);
+
+            if (sameFc && gap <= maxGap_ && (newEnd - current.address) <= maxCount_) {
+                currentEnd = newEnd;
+                current.count = static_cast<uint16_t>(currentEnd - current.address);
+                current.itemCount++;
+                continue;
+            }
+            blocks_.push_back(current);
+        }
+
+        current.functionCode = item.functionCode;
+        current.address = item.address;
+        currentEnd = std::min<uint32_t>(itemEnd, static_cast<uint32_t>(item.address) + maxCount_);
+        current.count = static_cast<uint16_t>(currentEnd - current.address);
+        current.firstItem = static_cast<uint16_t>(pos);
+        current.itemCount = 1;
+        open = true;
+    }
+
+    if (open) {
+        blocks_.push_back(current);
+    }
+}
+
+size_t ModbusReadPlanner::getRegisterCount() const {
+    size_t total = 0;
+    for (const auto& block : blocks_) {
+        total += block.count;
+    }
+    return total;
+}
+
+} // namespace modbus
@@ -0,0 +1,120 @@
+/*
+ * ModbusReadPlanner.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSREADPLANNER_H
+#define MODBUSREADPLANNER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "ModbusTypes.h"
+
+namespace modbus {
+
+/**
+ * @struct ReadItem
+ * @brief One register-backed value the planner has to cover
+ */
+struct ReadItem {
+    uint8_t functionCode = 0x03;  ///< 0x03 (holding) or 0x04 (input)
+    uint16_t address = 0;         ///< First register of the value
+    uint8_t width = 1;            ///< Number of registers the value occupies
+};
+
+/**
+ * @struct ReadBlock
+ * @brief One FC03/FC04 request produced by the planner
+ *
+ * The items served by this block are order()[firstItem .. firstItem + itemCount).
+ */
+struct ReadBlock {
+    uint8_t functionCode = 0x03;
+    uint16_t address = 0;      ///< Starting register of the request
+    uint16_t count = 0;        ///< Number of registers to request
+    uint16_t firstItem = 0;    ///< Index into ModbusReadPlanner::order()
+    uint16_t itemCount = 0;    ///< Number of items served by this block
+};
+
+/**
+ * @class ModbusReadPlanner
+ * @brief Coalesces register reads into as few block requests as possible
+ *
+ * Items are sorted by function code and address, then neighbouring items are
+ * merged into one request as long as the block stays within maxCount
+ * registers and the hole between two items is at most maxGap registers.
+ * Registers inside such a hole are read but not used.
+ *
+ * The plan is computed once (typically after configure()) and reused on
+ * every refresh; planning allocates, executing the plan does not.
+ */
+class ModbusReadPlanner {
+public:
+    /**
+     * @brief Constructor
+     * @param maxGap Maximum number of unused registers bridged inside a block
+     * @param maxCount Maximum registers per request (<= MODBUS_MAX_REGISTER_COUNT)
+     */
+    explicit ModbusReadPlanner(uint16_t maxGap = MODBUS_READ_MAX_GAP,
+                               uint16_t maxCount = MODBUS_MAX_REGISTER_COUNT);
+
+    /**
+     * @brief Build a plan for the given items
+     * @param items Items to cover
+     * @param count Number of items
+     */
+    void plan(const ReadItem* items, size_t count);
+
+    /**
+     * @brief Discard the current plan
+     */
+    void clear();
+
+    void setMaxGap(uint16_t gap) { maxGap_ = gap; }
+    uint16_t getMaxGap() const { return maxGap_; }
+
+    void setMaxCount(uint16_t count);
+    uint16_t getMaxCount() const { return maxCount_; }
+
+    /**
+     * @brief Planned block requests, in ascending (FC, address) order
+     */
+    const std::vector<ReadBlock>& blocks() const { return blocks_; }
+
+    /**
+     * @brief Item indices sorted by (FC, address), referenced by ReadBlock
+     */
+    const std::vector<uint16_t>& order() const { return order_; }
+
+    /**
+     * @brief Total registers requested by the plan (including gap registers)
+     */
+    size_t getRegisterCount() const;
+
+private:
+    uint16_t maxGap_;
+    uint16_t maxCount_;
+    std::vector<ReadBlock> blocks_;
+    std::vector<uint16_t> order_;
+};
+
+} // namespace modbus
+
+#endif // MODBUSREADPLANNER_H
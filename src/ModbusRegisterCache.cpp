@@ -0,0 +1,230 @@
+/*
+ * ModbusRegisterCache.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "ModbusRegisterCache.h"
+#include "ModbusDeviceLogging.h"
+#include "MutexGuard.h"
+#include <cstring>
+
+namespace modbus {
+
+ModbusRegisterCache::ModbusRegisterCache() {
+    mutex_ = createMutex(mutexStorage_);
+    if (!mutex_) {
+        MODBUSD_LOG_E("Failed to create register cache mutex");
+    }
+}
+
+ModbusRegisterCache::~ModbusRegisterCache() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+// Holding registers written with FC06/FC10 live in the FC03 table
+bool ModbusRegisterCache::sameTable(uint8_t a, uint8_t b) {
+    auto table = [](uint8_t fc) -> uint8_t {
+        return (fc == 0x06 || fc == 0x10) ? 0x03 : fc;
+    };
+    return table(a) == table(b);
+}
+
+bool ModbusRegisterCache::overlaps(const Range& r, uint8_t fc, uint16_t address, uint16_t count) {
+    if (!sameTable(r.functionCode, fc)) return false;
+    uint32_t end = static_cast<uint32_t>(address) + count;
+    uint32_t rEnd = static_cast<uint32_t>(r.address) + r.count;
+    return address < rEnd && r.address < end;
+}
+
+ModbusResult<void> ModbusRegisterCache::addRange(uint8_t functionCode, uint16_t address,
+                                                 uint16_t count, uint32_t maxAgeMs) {
+    if ((functionCode != 0x03 && functionCode != 0x04) ||
+        count == 0 || count > MODBUS_MAX_REGISTER_COUNT) {
+        return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (!mutex_) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) {
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    for (size_t i = 0; i < rangeCount_; i++) {
+        if (overlaps(ranges_[i], functionCode, address, count)) {
+            return ModbusResult<void>::error(ModbusError::INVALID_PARAMETER);
+        }
+    }
+    if (rangeCount_ >= MODBUS_REGISTER_CACHE_MAX_RANGES ||
+        used_ + count > MODBUS_REGISTER_CACHE_MAX_REGISTERS) {
+        MODBUSD_LOG_W("Register cache full (%u ranges, %u registers)",
+                      (unsigned)rangeCount_, (unsigned)used_);
+        return ModbusResult<void>::error(ModbusError::RESOURCE_ERROR);
+    }
+
+    Range& r = ranges_[rangeCount_++];
+    r = Range{};
+    r.functionCode = functionCode;
+    r.address = address;
+    r.count = count;
+    r.offset = static_cast<uint16_t>(used_);
+    r.maxAgeTicks = pdMS_TO_TICKS(maxAgeMs);
+    used_ += count;
+    return ModbusResult<void>::ok();
+}
+
+void ModbusRegisterCache::clear() {
+    if (!mutex_) return;
+    MutexGuard lock(mutex_);
+    if (lock.hasLock()) {
+        rangeCount_ = 0;
+        used_ = 0;
+    }
+}
+
+bool ModbusRegisterCache::lookup(uint8_t functionCode, uint16_t address, uint16_t count,
+                                 uint16_t* dest) {
+    if (!mutex_ || !dest || count == 0) return false;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return false;
+
+    TickType_t now = xTaskGetTickCount();
+    uint32_t end = static_cast<uint32_t>(address) + count;
+    for (size_t i = 0; i < rangeCount_; i++) {
+        const Range& r = ranges_[i];
+        if (r.functionCode != functionCode || address < r.address ||
+            end > static_cast<uint32_t>(r.address) + r.count) {
+            continue;
+        }
+        if (!r.valid || (now - r.updatedTick) > r.maxAgeTicks) {
+            misses_++;  // Covered but stale
+            return false;
+        }
+        std::memcpy(dest, &values_[r.offset + (address - r.address)], count * sizeof(uint16_t));
+        hits_++;
+        return true;
+    }
+    return false;
+}
+
+bool ModbusRegisterCache::findRange(uint8_t functionCode, uint16_t address, uint16_t count,
+                                    uint16_t& rangeAddress, uint16_t& rangeCount) const {
+    if (!mutex_) return false;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return false;
+
+    uint32_t end = static_cast<uint32_t>(address) + count;
+    for (size_t i = 0; i < rangeCount_; i++) {
+        const Range& r = ranges_[i];
+        if (r.functionCode == functionCode && address >= r.address &&
+            end <= static_cast<uint32_t>(r.address) + r.count) {
+            rangeAddress = r.address;
+            rangeCount = r.count;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModbusRegisterCache::store(uint8_t functionCode, uint16_t address, uint16_t count,
+                                const uint16_t* values) {
+    if (!mutex_ || !values || count == 0) return;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return;
+
+    TickType_t now = xTaskGetTickCount();
+    uint32_t end = static_cast<uint32_t>(address) + count;
+    for (size_t i = 0; i < rangeCount_; i++) {
+        Range& r = ranges_[i];
+        if (!overlaps(r, functionCode, address, count)) continue;
+
+        uint32_t rEnd = static_cast<uint32_t>(r.address) + r.count;
+        uint32_t from = (address > r.address) ? address : r.address;
+        uint32_t to = (end < rEnd) ? end : rEnd;
+
+        bool changed = false;
+        for (uint32_t reg = from; reg < to; reg++) {
+            uint16_t& slot = values_[r.offset + (reg - r.address)];
+            uint16_t value = values[reg - address];
+            if (slot != value) {
+                slot = value;
+                changed = true;
+            }
+        }
+        // The first data ever stored counts as a change: consumers have not seen it
+        if (changed || !r.everChanged) {
+            r.changedTick = now;
+            r.everChanged = true;
+        }
+        if (from == r.address && to == rEnd) {
+            r.valid = true;
+            r.updatedTick = now;
+        }
+    }
+}
+
+void ModbusRegisterCache::invalidate(uint8_t functionCode, uint16_t address, uint16_t count) {
+    if (!mutex_) return;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return;
+
+    for (size_t i = 0; i < rangeCount_; i++) {
+        if (overlaps(ranges_[i], functionCode, address, count)) {
+            ranges_[i].valid = false;
+        }
+    }
+}
+
+void ModbusRegisterCache::invalidateAll() {
+    if (!mutex_) return;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return;
+
+    for (size_t i = 0; i < rangeCount_; i++) {
+        ranges_[i].valid = false;
+    }
+}
+
+bool ModbusRegisterCache::hasChangedSince(uint8_t functionCode, uint16_t address, uint16_t count,
+                                          TickType_t since) const {
+    if (!mutex_) return false;
+
+    MutexGuard lock(mutex_);
+    if (!lock.hasLock()) return false;
+
+    for (size_t i = 0; i < rangeCount_; i++) {
+        const Range& r = ranges_[i];
+        // Signed tick difference keeps the comparison valid across wrap
+        if (r.everChanged && overlaps(r, functionCode, address, count) &&
+            static_cast<int32_t>(r.changedTick - since) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace modbus
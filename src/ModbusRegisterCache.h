@@ -0,0 +1,156 @@
+/*
+ * ModbusRegisterCache.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSREGISTERCACHE_H
+#define MODBUSREGISTERCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+
+#ifndef MODBUS_REGISTER_CACHE_MAX_RANGES
+#define MODBUS_REGISTER_CACHE_MAX_RANGES 8
+#endif
+
+// Total registers shared by all ranges of one cache
+#ifndef MODBUS_REGISTER_CACHE_MAX_REGISTERS
+#define MODBUS_REGISTER_CACHE_MAX_REGISTERS 128
+#endif
+
+namespace modbus {
+
+/**
+ * @class ModbusRegisterCache
+ * @brief Shadow copy of selected register ranges of one device
+ *
+ * Each range has its own maximum age. Attached to a ModbusDevice with
+ * setRegisterCache(), a register read that lies inside a range is answered
+ * from memory while the range is fresh; otherwise the whole range is read
+ * from the device (read-through) so neighbouring reads hit afterwards.
+ * Successful FC06/FC10 writes update the cached holding registers.
+ *
+ * All storage is fixed at compile time; ranges are added once at setup.
+ *
+ * @code
+ * static ModbusRegisterCache cache;
+ * cache.addRange(0x03, 0x0000, 16, 500);   // Holding 0-15, 500 ms
+ * device.setRegisterCache(&cache);
+ * @endcode
+ */
+class ModbusRegisterCache {
+public:
+    ModbusRegisterCache();
+    ~ModbusRegisterCache();
+
+    ModbusRegisterCache(const ModbusRegisterCache&) = delete;
+    ModbusRegisterCache& operator=(const ModbusRegisterCache&) = delete;
+
+    /**
+     * @brief Add a cached range
+     * @param functionCode 0x03 (holding) or 0x04 (input)
+     * @param address First register
+     * @param count Number of registers (1-125)
+     * @param maxAgeMs How long a read of the range stays fresh
+     * @return Result indicating success, INVALID_PARAMETER for overlaps or
+     *         bad arguments, RESOURCE_ERROR when out of ranges/storage
+     */
+    ModbusResult<void> addRange(uint8_t functionCode, uint16_t address, uint16_t count,
+                                uint32_t maxAgeMs);
+
+    /**
+     * @brief Remove all ranges
+     */
+    void clear();
+
+    /**
+     * @brief Copy registers out of a fresh range
+     * @return true if [address, address + count) lies in one fresh range
+     */
+    bool lookup(uint8_t functionCode, uint16_t address, uint16_t count, uint16_t* dest);
+
+    /**
+     * @brief Find the range covering [address, address + count)
+     * @param rangeAddress Set to the range's first register
+     * @param rangeCount Set to the range's register count
+     * @return true if a range covers the request
+     */
+    bool findRange(uint8_t functionCode, uint16_t address, uint16_t count,
+                   uint16_t& rangeAddress, uint16_t& rangeCount) const;
+
+    /**
+     * @brief Store values read from or written to the device
+     *
+     * Updates every overlapping range. A range becomes fresh only when the
+     * store covers all of it; partial stores update values but not age.
+     */
+    void store(uint8_t functionCode, uint16_t address, uint16_t count, const uint16_t* values);
+
+    /**
+     * @brief Mark overlapping ranges stale (values are kept for change detection)
+     */
+    void invalidate(uint8_t functionCode, uint16_t address, uint16_t count);
+
+    void invalidateAll();
+
+    /**
+     * @brief Check whether any cached register in the span changed after a tick
+     * @param since Tick count to compare against (e.g. the consumer's last pass)
+     * @return true if an overlapping range recorded a value change after `since`
+     */
+    bool hasChangedSince(uint8_t functionCode, uint16_t address, uint16_t count,
+                         TickType_t since) const;
+
+    size_t getRangeCount() const { return rangeCount_; }
+    uint32_t getHits() const { return hits_; }
+    uint32_t getMisses() const { return misses_; }  ///< Covered but stale lookups
+
+private:
+    struct Range {
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        uint16_t offset = 0;            ///< Into values_
+        TickType_t maxAgeTicks = 0;
+        TickType_t updatedTick = 0;
+        TickType_t changedTick = 0;
+        bool valid = false;             ///< Fully read at least once and not invalidated
+        bool everChanged = false;       ///< changedTick is meaningful
+    };
+
+    static bool overlaps(const Range& r, uint8_t fc, uint16_t address, uint16_t count);
+    static bool sameTable(uint8_t a, uint8_t b);
+
+    Range ranges_[MODBUS_REGISTER_CACHE_MAX_RANGES];
+    uint16_t values_[MODBUS_REGISTER_CACHE_MAX_REGISTERS] = {};
+    size_t rangeCount_ = 0;
+    size_t used_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    mutable SemaphoreHandle_t mutex_ = nullptr;
+    SemaphoreStorage mutexStorage_;
+};
+
+} // namespace modbus
+
+#endif // MODBUSREGISTERCACHE_H
@@ -0,0 +1,369 @@
+/*
+ * ModbusRegisterMap.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef MODBUSREGISTERMAP_H
+#define MODBUSREGISTERMAP_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <utility>
+#include "ModbusTypes.h"
+
+namespace modbus {
+
+/**
+ * @enum PointType
+ * @brief Register encoding of a point
+ */
+enum class PointType : uint8_t {
+    U16,        ///< One register, unsigned
+    I16,        ///< One register, two's complement
+    U32,        ///< Two registers, unsigned
+    I32,        ///< Two registers, two's complement
+    FLOAT32     ///< Two registers, IEEE 754 single precision
+};
+
+/**
+ * @enum WordOrder
+ * @brief Register order of 32-bit points (bytes within a register are always big-endian)
+ */
+enum class WordOrder : uint8_t {
+    HIGH_FIRST,  ///< High word at the lower address (ABCD)
+    LOW_FIRST    ///< Low word at the lower address (CDAB)
+};
+
+/**
+ * @struct PointDef
+ * @brief One entry of a declarative point table
+ *
+ * value = decoded register value * scale. periodMs = 0 reads the point on
+ * every update(). Used at run time by PointTableDevice and at compile time
+ * by RegisterMap; name and units are string literals and stay in flash.
+ */
+struct PointDef {
+    const char* name = "";
+    const char* units = "";
+    uint8_t functionCode = 0x03;          ///< 0x03 (holding) or 0x04 (input)
+    uint16_t address = 0;
+    PointType type = PointType::U16;
+    WordOrder wordOrder = WordOrder::HIGH_FIRST;
+    float scale = 1.0f;
+    uint32_t periodMs = 0;
+};
+
+/**
+ * @brief Number of registers a point of the given type occupies
+ */
+constexpr uint8_t pointWidth(PointType type) {
+    return (type == PointType::U16 || type == PointType::I16) ? 1 : 2;
+}
+
+/**
+ * @brief Combine two consecutive registers into a 32-bit word
+ * @param first Register at the lower address
+ * @param second Register at the higher address
+ */
+constexpr uint32_t combineWords(uint16_t first, uint16_t second, WordOrder order) {
+    return (order == WordOrder::HIGH_FIRST)
+        ? (static_cast<uint32_t>(first) << 16) | second
+        : (static_cast<uint32_t>(second) << 16) | first;
+}
+
+/**
+ * @brief Reinterpret a 32-bit word as IEEE 754 float
+ */
+inline float wordToFloat(uint32_t word) {
+    float f;
+    std::memcpy(&f, &word, sizeof(f));
+    return f;
+}
+
+/**
+ * @struct RegisterBlock
+ * @brief One FC03/FC04 request of a compile-time read plan
+ */
+struct RegisterBlock {
+    uint8_t functionCode = 0x03;
+    uint16_t address = 0;       ///< Starting register of the request
+    uint16_t count = 0;         ///< Number of registers to request
+    uint16_t imageOffset = 0;   ///< Position of the block in the register image
+};
+
+namespace detail {
+
+/**
+ * @brief Integer type a point decodes to (FLOAT32 decodes to its bit pattern)
+ */
+template<PointType Type> struct PointRaw { using type = uint32_t; };
+template<> struct PointRaw<PointType::U16> { using type = uint16_t; };
+template<> struct PointRaw<PointType::I16> { using type = int16_t; };
+template<> struct PointRaw<PointType::I32> { using type = int32_t; };
+
+/**
+ * @brief Read plan computed at compile time, sized for the worst case
+ *        of one block per point
+ */
+template<size_t N>
+struct MapPlan {
+    std::array<RegisterBlock, N> blocks{};
+    std::array<uint16_t, N> offset{};   ///< Point index -> register image offset
+    size_t blockCount = 0;
+    size_t imageSize = 0;
+};
+
+} // namespace detail
+
+/**
+ * @class RegisterMap
+ * @brief Compile-time register map over a constexpr PointDef table
+ *
+ * The table is checked, sorted and planned into block reads by the
+ * compiler: function codes, address ranges and overlapping points are
+ * static_assert failures instead of runtime errors, and the plan (same
+ * merge rules as ModbusReadPlanner) is a constexpr array. Blocks are read
+ * into one flat register image, and every point sits at a fixed offset in
+ * it, so value<I>() compiles down to a load or two, a shift and a multiply.
+ *
+ * Nothing is allocated and no per-point state is kept; periodMs is ignored.
+ *
+ * @code
+ * static constexpr PointDef meterPoints[] = {
+ *     {"voltage", "V",   0x04, 0x0000, PointType::FLOAT32},
+ *     {"current", "A",   0x04, 0x0006, PointType::FLOAT32},
+ *     {"energy",  "kWh", 0x04, 0x0156, PointType::U32, WordOrder::HIGH_FIRST, 0.01f},
+ * };
+ * using MeterMap = RegisterMap<meterPoints, 8>;     // Bridge up to 8 unused registers
+ * static_assert(MeterMap::blockCount == 2, "");
+ *
+ * MeterMap::Image image;
+ * if (MeterMap::read(device, image.data()).isOk()) {
+ *     float volts = MeterMap::value<0>(image.data());
+ * }
+ * @endcode
+ *
+ * @tparam Points Table of PointDef with static storage duration
+ * @tparam MaxGap Maximum unused registers bridged inside one block
+ * @tparam MaxCount Maximum registers per request
+ */
+template<const auto& Points, uint16_t MaxGap = MODBUS_READ_MAX_GAP,
+         uint16_t MaxCount = MODBUS_MAX_REGISTER_COUNT>
+class RegisterMap {
+public:
+    static constexpr size_t pointCount = std::size(Points);
+
+private:
+    static_assert(pointCount > 0, "RegisterMap: empty point table");
+    static_assert(pointCount <= 0xFFFF, "RegisterMap: too many points");
+    static_assert(MaxCount > 0 && MaxCount <= MODBUS_MAX_REGISTER_COUNT,
+                  "RegisterMap: MaxCount must be 1..MODBUS_MAX_REGISTER_COUNT");
+
+    static constexpr uint32_t endOf(size_t i) {
+        return static_cast<uint32_t>(Points[i].address) + pointWidth(Points[i].type);
+    }
+
+    static constexpr bool functionCodesValid() {
+        for (size_t i = 0; i < pointCount; i++) {
+            if (Points[i].functionCode != 0x03 && Points[i].functionCode != 0x04) return false;
+        }
+        return true;
+    }
+
+    static constexpr bool addressesValid() {
+        for (size_t i = 0; i < pointCount; i++) {
+            if (endOf(i) > 0x10000 || pointWidth(Points[i].type) > MaxCount) return false;
+        }
+        return true;
+    }
+
+    static constexpr bool pointsDisjoint() {
+        for (size_t i = 0; i < pointCount; i++) {
+            for (size_t j = i + 1; j < pointCount; j++) {
+                if (Points[i].functionCode == Points[j].functionCode &&
+                    Points[i].address < endOf(j) && Points[j].address < endOf(i)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static_assert(functionCodesValid(), "RegisterMap: function code must be 0x03 or 0x04");
+    static_assert(addressesValid(), "RegisterMap: point extends past register 0xFFFF");
+    static_assert(pointsDisjoint(), "RegisterMap: points overlap");
+
+    static constexpr detail::MapPlan<pointCount> makePlan() {
+        // Insertion sort by (FC, address); tables are small
+        std::array<uint16_t, pointCount> order{};
+        for (size_t i = 0; i < pointCount; i++) {
+            size_t pos = i;
+            while (pos > 0) {
+                const PointDef& prev = Points[order[pos - 1]];
+                const PointDef& cur = Points[i];
+                if (prev.functionCode < cur.functionCode ||
+                    (prev.functionCode == cur.functionCode && prev.address < cur.address)) {
+                    break;
+                }
+                order[pos] = order[pos - 1];
+                pos--;
+            }
+            order[pos] = static_cast<uint16_t>(i);
+        }
+
+        detail::MapPlan<pointCount> plan{};
+        uint32_t blockEnd = 0;
+        for (size_t pos = 0; pos < pointCount; pos++) {
+            size_t i = order[pos];
+            RegisterBlock* block = plan.blockCount ? &plan.blocks[plan.blockCount - 1] : nullptr;
+            bool merge = block && block->functionCode == Points[i].functionCode &&
+                         Points[i].address - blockEnd <= MaxGap &&
+                         endOf(i) - block->address <= MaxCount;
+            if (!merge) {
+                block = &plan.blocks[plan.blockCount++];
+                block->functionCode = Points[i].functionCode;
+                block->address = Points[i].address;
+                block->imageOffset = static_cast<uint16_t>(plan.imageSize);
+            } else {
+                plan.imageSize -= block->count;
+            }
+            blockEnd = endOf(i);
+            block->count = static_cast<uint16_t>(blockEnd - block->address);
+            plan.imageSize += block->count;
+            plan.offset[i] = static_cast<uint16_t>(block->imageOffset + Points[i].address - block->address);
+        }
+        return plan;
+    }
+
+    static constexpr detail::MapPlan<pointCount> plan_ = makePlan();
+
+    template<size_t... B>
+    static constexpr std::array<RegisterBlock, sizeof...(B)> trimBlocks(std::index_sequence<B...>) {
+        return {{plan_.blocks[B]...}};
+    }
+
+public:
+    /// Number of block requests one read() sends
+    static constexpr size_t blockCount = plan_.blockCount;
+
+    /// Registers in the image, gap registers included
+    static constexpr size_t imageSize = plan_.imageSize;
+
+    /// Block requests in ascending (FC, address) order
+    static constexpr std::array<RegisterBlock, blockCount> blocks =
+        trimBlocks(std::make_index_sequence<blockCount>{});
+
+    /// Storage for one read of the whole map
+    using Image = std::array<uint16_t, imageSize>;
+
+    /**
+     * @brief Position of point I in the register image
+     */
+    template<size_t I>
+    static constexpr uint16_t offsetOf() {
+        static_assert(I < pointCount, "RegisterMap: point index out of range");
+        return plan_.offset[I];
+    }
+
+    static constexpr uint16_t offsetOf(size_t i) { return plan_.offset[i]; }
+
+    static constexpr const char* name(size_t i) { return Points[i].name; }
+    static constexpr const char* units(size_t i) { return Points[i].units; }
+
+    /**
+     * @brief Decoded integer of point I (FLOAT32: the raw bit pattern)
+     * @param image Register image filled by read()
+     */
+    template<size_t I>
+    static constexpr typename detail::PointRaw<Points[I].type>::type raw(const uint16_t* image) {
+        constexpr uint16_t offset = offsetOf<I>();
+        using Raw = typename detail::PointRaw<Points[I].type>::type;
+        if constexpr (pointWidth(Points[I].type) == 1) {
+            return static_cast<Raw>(image[offset]);
+        } else {
+            return static_cast<Raw>(combineWords(image[offset], image[offset + 1], Points[I].wordOrder));
+        }
+    }
+
+    /**
+     * @brief Scaled value of point I
+     * @param image Register image filled by read()
+     */
+    template<size_t I>
+    static float value(const uint16_t* image) {
+        float v;
+        if constexpr (Points[I].type == PointType::FLOAT32) {
+            v = wordToFloat(raw<I>(image));
+        } else {
+            v = static_cast<float>(raw<I>(image));
+        }
+        if constexpr (Points[I].scale != 1.0f) {
+            v *= Points[I].scale;
+        }
+        return v;
+    }
+
+    /**
+     * @brief Scaled value of point i for loops over the table
+     */
+    static float value(size_t i, const uint16_t* image) {
+        const PointDef& p = Points[i];
+        const uint16_t* regs = image + plan_.offset[i];
+        uint32_t word = (pointWidth(p.type) == 2) ? combineWords(regs[0], regs[1], p.wordOrder) : 0;
+        float v = 0.0f;
+        switch (p.type) {
+            case PointType::U16:     v = static_cast<float>(regs[0]); break;
+            case PointType::I16:     v = static_cast<float>(static_cast<int16_t>(regs[0])); break;
+            case PointType::U32:     v = static_cast<float>(word); break;
+            case PointType::I32:     v = static_cast<float>(static_cast<int32_t>(word)); break;
+            case PointType::FLOAT32: v = wordToFloat(word); break;
+        }
+        return v * p.scale;
+    }
+
+    /**
+     * @brief Read every block of the plan into image
+     * @tparam Device ModbusDevice or anything with the buffer read overloads
+     * @param image At least imageSize registers
+     * @return Ok, or the first block's error (the image is then partial)
+     */
+    template<typename Device>
+    static ModbusResult<void> read(Device& device, uint16_t* image) {
+        for (const RegisterBlock& block : blocks) {
+            uint16_t* dest = image + block.imageOffset;
+            auto result = (block.functionCode == 0x04)
+                ? device.readInputRegisters(block.address, block.count, dest, block.count)
+                : device.readHoldingRegisters(block.address, block.count, dest, block.count);
+            if (!result.isOk()) {
+                return ModbusResult<void>::error(result.error());
+            }
+            if (result.value() < block.count) {
+                return ModbusResult<void>::error(ModbusError::INVALID_DATA_LENGTH);
+            }
+        }
+        return ModbusResult<void>::ok();
+    }
+};
+
+} // namespace modbus
+
+#endif // MODBUSREGISTERMAP_H
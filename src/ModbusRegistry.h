@@ -24,19 +24,18 @@
 
 /**
  * @file ModbusRegistry.h
- * @brief Thread-safe singleton registry for Modbus devices
+ * @brief Thread-safe singleton registry for Modbus buses and devices
  *
- * Provides centralized management of Modbus devices and the global
- * ModbusRTU instance, replacing the previous unsafe global variables.
+ * Provides centralized management of the Modbus buses (one per UART) and
+ * their devices, replacing the previous unsafe global variables.
  */
 
-#include <unordered_map>
+#include <atomic>
 #include <cstdint>
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
-
-// Forward declarations
-class esp32ModbusRTU;
+#include "ModbusBus.h"
+#include "ModbusTypes.h"
 
 namespace modbus {
 
@@ -44,18 +43,24 @@ class ModbusDevice;
 
 /**
  * @class ModbusRegistry
- * @brief Singleton registry for managing Modbus devices and RTU instance
+ * @brief Singleton owning the Modbus buses
  *
- * Thread-safe registry that provides:
- * - Device registration/unregistration by address
- * - Device lookup by address
- * - Global ModbusRTU instance management
- * - Bus mutex for thread-safe communication
+ * Holds MODBUS_MAX_BUSES ModbusBus objects. Bus 0 is the default bus:
+ * devices that were never bound with ModbusDevice::setBus() use it, and
+ * the single-bus API below (setModbusRTU(), registerDevice(), the bus
+ * mutex and inter-frame timing) forwards to it, so single-UART code is
+ * unchanged.
  *
  * Uses Meyer's singleton pattern for safe initialization.
+ *
+ * Each bus keeps its devices in a fixed table of atomic pointers indexed by
+ * slave address, so device lookup in the response path is wait-free and
+ * never blocks on registration.
  */
 class ModbusRegistry {
 public:
+    using InterFrameTiming = ModbusBus::InterFrameTiming;
+
     /**
      * @brief Get the singleton instance
      * @return Reference to the ModbusRegistry singleton
@@ -73,91 +78,157 @@ public:
     ModbusRegistry& operator=(ModbusRegistry&&) = delete;
 
     /**
-     * @brief Set the global ModbusRTU instance
+     * @brief Get a bus by id
+     * @param id Bus index, 0..MODBUS_MAX_BUSES-1
+     * @return Bus, or nullptr if the id is out of range
+     */
+    ModbusBus* getBus(uint8_t id) noexcept { return id < MODBUS_MAX_BUSES ? &buses_[id] : nullptr; }
+
+    /**
+     * @brief Get the default bus (id 0)
+     */
+    ModbusBus& getDefaultBus() noexcept { return buses_[0]; }
+    const ModbusBus& getDefaultBus() const noexcept { return buses_[0]; }
+
+    static constexpr uint8_t getBusCount() noexcept { return MODBUS_MAX_BUSES; }
+
+    // ===== Default bus shortcuts =====
+
+    /**
+     * @brief Set the ModbusRTU instance of the default bus
      * @param rtu Pointer to the ModbusRTU instance
      * @note Thread-safe
      */
-    void setModbusRTU(esp32ModbusRTU* rtu);
+    void setModbusRTU(esp32ModbusRTU* rtu) { getDefaultBus().setModbusRTU(rtu); }
 
     /**
-     * @brief Get the global ModbusRTU instance
+     * @brief Get the ModbusRTU instance of the default bus
      * @return Pointer to the ModbusRTU instance, or nullptr if not set
      * @note Thread-safe
      */
-    esp32ModbusRTU* getModbusRTU() const noexcept { return modbusRTU_; }
+    esp32ModbusRTU* getModbusRTU() const noexcept { return getDefaultBus().getModbusRTU(); }
 
     /**
-     * @brief Register a device at a specific address
+     * @brief Register a device at a specific address on the default bus
      * @param address Modbus address (1-247)
      * @param device Pointer to the device
      * @return true if registered successfully, false on error
      * @note Thread-safe
      */
-    bool registerDevice(uint8_t address, ModbusDevice* device);
+    bool registerDevice(uint8_t address, ModbusDevice* device) { return getDefaultBus().registerDevice(address, device); }
 
     /**
-     * @brief Unregister a device from the registry
+     * @brief Unregister a device from the default bus
      * @param address Modbus address to unregister
      * @return true if unregistered successfully, false if not found
      * @note Thread-safe
      */
-    bool unregisterDevice(uint8_t address);
+    bool unregisterDevice(uint8_t address) { return getDefaultBus().unregisterDevice(address); }
 
     /**
-     * @brief Get a device by address
+     * @brief Get a device on the default bus by address
      * @param address Modbus address to look up
      * @return Pointer to the device, or nullptr if not found
-     * @note Thread-safe
+     * @note Thread-safe and wait-free (safe to call from the RTU callback task)
      */
-    ModbusDevice* getDevice(uint8_t address) const;
+    ModbusDevice* getDevice(uint8_t address) const noexcept { return getDefaultBus().getDevice(address); }
 
     /**
-     * @brief Check if a device is registered at an address
+     * @brief Check if a device is registered at an address on the default bus
      * @param address Modbus address to check
      * @return true if a device is registered at this address
      * @note Thread-safe
      */
-    bool hasDevice(uint8_t address) const;
+    bool hasDevice(uint8_t address) const noexcept { return getDefaultBus().hasDevice(address); }
 
     /**
-     * @brief Get the number of registered devices
+     * @brief Get the number of registered devices on all buses
      * @return Number of devices in the registry
      * @note Thread-safe
      */
-    size_t getDeviceCount() const;
+    size_t getDeviceCount() const noexcept;
 
     /**
-     * @brief Get the device map mutex (for callback routing)
+     * @brief Get the registration mutex of the default bus
      * @return Mutex handle
      */
-    SemaphoreHandle_t getMutex() const noexcept { return mutex_; }
+    SemaphoreHandle_t getMutex() const noexcept { return getDefaultBus().getMutex(); }
 
     /**
-     * @brief Get the global bus mutex for Modbus communication
+     * @brief Get the bus mutex of the default bus
      * @return Bus mutex handle
      */
-    SemaphoreHandle_t getBusMutex() const noexcept { return busMutex_; }
+    SemaphoreHandle_t getBusMutex() const noexcept { return getDefaultBus().getBusMutex(); }
 
     /**
-     * @brief Acquire the bus mutex
+     * @brief Acquire the default bus mutex (see ModbusBus::acquireBusMutex())
      * @param timeoutMs Timeout in milliseconds
+     * @param priority Arbiter class to queue in
      * @return true if acquired, false on timeout
      */
-    bool acquireBusMutex(uint32_t timeoutMs = 2000);
+    bool acquireBusMutex(uint32_t timeoutMs = 2000,
+                         esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY) {
+        return getDefaultBus().acquireBusMutex(timeoutMs, priority);
+    }
+
+    /**
+     * @brief Release the default bus mutex
+     */
+    void releaseBusMutex() noexcept { getDefaultBus().releaseBusMutex(); }
+
+    /**
+     * @brief Set the default bus baud rate used to derive the inter-frame gap
+     *
+     * Overrides the compile-time MODBUS_BAUD_RATE so one build can serve
+     * sites running different baud rates.
+     *
+     * @param baud Baud rate in bit/s
+     */
+    void setBaudRate(uint32_t baud) { getDefaultBus().setBaudRate(baud); }
+
+    uint32_t getBaudRate() const noexcept { return getDefaultBus().getBaudRate(); }
+
+    /**
+     * @brief Select how the inter-frame gap is enforced on the default bus
+     * @param mode TICK_DELAY (default) or PRECISE
+     */
+    void setInterFrameTiming(InterFrameTiming mode) noexcept { getDefaultBus().setInterFrameTiming(mode); }
+
+    InterFrameTiming getInterFrameTiming() const noexcept { return getDefaultBus().getInterFrameTiming(); }
+
+    /**
+     * @brief Get the default bus 3.5 character gap in microseconds (no safety margin)
+     */
+    uint32_t getInterFrameDelayUs() const noexcept { return getDefaultBus().getInterFrameDelayUs(); }
+
+    /**
+     * @brief Get the default bus tick-mode delay in milliseconds (includes +1 ms margin)
+     */
+    uint32_t getInterFrameDelayMs() const noexcept { return getDefaultBus().getInterFrameDelayMs(); }
+
+    /**
+     * @brief Record that a frame just finished on the default bus
+     * @note Caller must hold the bus mutex
+     */
+    void markFrameEnd() noexcept { getDefaultBus().markFrameEnd(); }
+
+    /**
+     * @brief Wait until the default bus inter-frame gap has passed
+     * @note Caller must hold the bus mutex
+     */
+    void waitInterFrameGap() noexcept { getDefaultBus().waitInterFrameGap(); }
 
     /**
-     * @brief Release the bus mutex
+     * @brief Microseconds the last waitInterFrameGap() call spent waiting
+     * @note Only meaningful to the current bus mutex holder
      */
-    void releaseBusMutex() noexcept;
+    uint32_t getLastGapWaitUs() const noexcept { return getDefaultBus().getLastGapWaitUs(); }
 
 private:
     ModbusRegistry();
-    ~ModbusRegistry();
+    ~ModbusRegistry() = default;
 
-    std::unordered_map<uint8_t, ModbusDevice*> deviceMap_;
-    mutable SemaphoreHandle_t mutex_;
-    SemaphoreHandle_t busMutex_;
-    esp32ModbusRTU* modbusRTU_ = nullptr;
+    ModbusBus buses_[MODBUS_MAX_BUSES];
 };
 
 } // namespace modbus
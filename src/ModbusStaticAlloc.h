@@ -0,0 +1,151 @@
+/*
+ * ModbusStaticAlloc.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSSTATICALLOC_H
+#define MODBUSSTATICALLOC_H
+
+/**
+ * @file ModbusStaticAlloc.h
+ * @brief Storage selection for the FreeRTOS objects and lazily created state
+ *
+ * By default semaphores, queues and per-device state are created on the heap
+ * the first time they are needed. Building with
+ * -DMODBUSDEVICE_STATIC_ALLOCATION places all of them inside the objects that
+ * own them instead (xSemaphoreCreate*Static(), xQueueCreateStatic(),
+ * xEventGroupCreateStatic()), so the library's memory is fixed at link time
+ * and no request path allocates.
+ * Requires configSUPPORT_STATIC_ALLOCATION (the ESP-IDF default).
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "freertos/event_groups.h"
+
+namespace modbus {
+
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+using SemaphoreStorage = StaticSemaphore_t;
+#else
+struct SemaphoreStorage {};
+#endif
+
+inline SemaphoreHandle_t createMutex(SemaphoreStorage& storage) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    return xSemaphoreCreateMutexStatic(&storage);
+#else
+    (void)storage;
+    return xSemaphoreCreateMutex();
+#endif
+}
+
+inline SemaphoreHandle_t createBinarySemaphore(SemaphoreStorage& storage) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    return xSemaphoreCreateBinaryStatic(&storage);
+#else
+    (void)storage;
+    return xSemaphoreCreateBinary();
+#endif
+}
+
+inline SemaphoreHandle_t createCountingSemaphore(UBaseType_t maxCount, UBaseType_t initialCount,
+                                                 SemaphoreStorage& storage) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    return xSemaphoreCreateCountingStatic(maxCount, initialCount, &storage);
+#else
+    (void)storage;
+    return xSemaphoreCreateCounting(maxCount, initialCount);
+#endif
+}
+
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+using EventGroupStorage = StaticEventGroup_t;
+#else
+struct EventGroupStorage {};
+#endif
+
+inline EventGroupHandle_t createEventGroup(EventGroupStorage& storage) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    return xEventGroupCreateStatic(&storage);
+#else
+    (void)storage;
+    return xEventGroupCreate();
+#endif
+}
+
+/**
+ * @brief Item buffer and control block for a queue of up to Depth items
+ */
+template<size_t Depth, size_t ItemSize>
+struct QueueStorage {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    uint8_t items[Depth * ItemSize];
+    StaticQueue_t control;
+#endif
+};
+
+/**
+ * @brief Create a queue of `depth` items, at most Depth in static builds
+ * @return nullptr if creation failed or depth exceeds the storage
+ */
+template<size_t Depth, size_t ItemSize>
+QueueHandle_t createQueue(size_t depth, QueueStorage<Depth, ItemSize>& storage) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    if (depth == 0 || depth > Depth) {
+        return nullptr;
+    }
+    return xQueueCreateStatic(depth, ItemSize, storage.items, &storage.control);
+#else
+    (void)storage;
+    return xQueueCreate(depth, ItemSize);
+#endif
+}
+
+/**
+ * @brief State created on first use: heap by default, a slot inside the owner
+ * in static builds
+ *
+ * acquire() hands out the object and release() gives it back; static builds
+ * always return the same slot, so the owner must acquire it at most once at a
+ * time (ModbusDevice does so from its constructor).
+ */
+template<typename T>
+class LazySlot {
+public:
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    T* acquire() { return &object_; }
+    void release(T*) {}
+
+private:
+    T object_;
+#else
+    T* acquire() { return new (std::nothrow) T(); }
+    void release(T* object) { delete object; }
+#endif
+};
+
+} // namespace modbus
+
+#endif // MODBUSSTATICALLOC_H
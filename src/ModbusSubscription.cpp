@@ -0,0 +1,200 @@
+/*
+ * ModbusSubscription.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "ModbusSubscription.h"
+#include "ModbusDeviceLogging.h"
+#include "freertos/task.h"
+#include <cmath>
+
+namespace modbus {
+
+SubscriptionTable::SubscriptionTable() {
+    mutex_ = createMutex(mutexStorage_);
+    if (!mutex_) {
+        MODBUSD_LOG_E("Failed to create subscription mutex");
+    }
+}
+
+SubscriptionTable::~SubscriptionTable() {
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
+}
+
+ModbusResult<uint32_t> SubscriptionTable::addAnalog(uint16_t channel, const Deadband& deadband,
+                                                    const Target& target, bool reportInitial) {
+    if (deadband.absolute < 0.0f || deadband.percent < 0.0f) {
+        return ModbusResult<uint32_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    Entry entry;
+    entry.target = target;
+    entry.deadband = deadband;
+    entry.channel = channel;
+    entry.reportInitial = reportInitial;
+    return add(entry);
+}
+
+ModbusResult<uint32_t> SubscriptionTable::addDigital(uint16_t channel, Edge edge,
+                                                     const Target& target, bool reportInitial) {
+    Entry entry;
+    entry.target = target;
+    entry.channel = channel;
+    entry.digital = true;
+    entry.edge = edge;
+    entry.reportInitial = reportInitial;
+    return add(entry);
+}
+
+ModbusResult<uint32_t> SubscriptionTable::add(const Entry& entry) {
+    if (!entry.target.callback && !entry.target.queue) {
+        return ModbusResult<uint32_t>::error(ModbusError::NULL_POINTER);
+    }
+    if (!mutex_) {
+        return ModbusResult<uint32_t>::error(ModbusError::RESOURCE_CREATION_FAILED);
+    }
+    if (xSemaphoreTake(mutex_, pdMS_TO_TICKS(MODBUS_MUTEX_TIMEOUT_MS)) != pdTRUE) {
+        return ModbusResult<uint32_t>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    for (size_t i = 0; i < MODBUS_SUBSCRIPTION_MAX; i++) {
+        if (entries_[i].handle != 0) {
+            continue;
+        }
+        // Low byte is the slot, the rest a sequence so stale handles miss
+        uint32_t sequence = nextSequence_++ & 0xFFFFFF;
+        if (sequence == 0) {
+            sequence = nextSequence_++ & 0xFFFFFF;
+        }
+        entries_[i] = entry;
+        entries_[i].handle = (sequence << 8) | static_cast<uint32_t>(i);
+        used_++;
+        uint32_t handle = entries_[i].handle;
+        xSemaphoreGive(mutex_);
+        return ModbusResult<uint32_t>::ok(handle);
+    }
+
+    xSemaphoreGive(mutex_);
+    return ModbusResult<uint32_t>::error(ModbusError::QUEUE_FULL);
+}
+
+bool SubscriptionTable::remove(uint32_t handle) {
+    size_t slot = handle & 0xFF;
+    if (handle == 0 || slot >= MODBUS_SUBSCRIPTION_MAX || !mutex_) {
+        return false;
+    }
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    bool found = entries_[slot].handle == handle;
+    if (found) {
+        entries_[slot] = Entry();
+        used_--;
+    }
+    xSemaphoreGive(mutex_);
+    return found;
+}
+
+void SubscriptionTable::publishAnalog(const IModbusInput* source, uint16_t channel, float value) {
+    publish(source, channel, false, value, false);
+}
+
+void SubscriptionTable::publishDigital(const IModbusInput* source, uint16_t channel, bool state) {
+    publish(source, channel, true, state ? 1.0f : 0.0f, state);
+}
+
+bool SubscriptionTable::passes(const Entry& entry, float value, bool state) const {
+    if (!entry.seen) {
+        return entry.reportInitial;
+    }
+    if (entry.digital) {
+        if (state == entry.lastState) {
+            return false;
+        }
+        Edge fired = state ? Edge::RISING : Edge::FALLING;
+        return (static_cast<uint8_t>(entry.edge) & static_cast<uint8_t>(fired)) != 0;
+    }
+
+    if (std::isnan(value) || std::isnan(entry.last)) {
+        return std::isnan(value) != std::isnan(entry.last);
+    }
+    float delta = std::fabs(value - entry.last);
+    float threshold = std::fmax(entry.deadband.absolute,
+                                std::fabs(entry.last) * entry.deadband.percent / 100.0f);
+    return threshold > 0.0f ? delta >= threshold : delta > 0.0f;
+}
+
+void SubscriptionTable::publish(const IModbusInput* source, uint16_t channel, bool digital,
+                                float value, bool state) {
+    if (used_ == 0 || !mutex_) {
+        return;  // Nobody listening: no lock, no comparisons
+    }
+
+    struct Pending {
+        ChangeCallback callback;
+        void* context;
+        ChangeEvent event;
+    };
+    Pending pending[MODBUS_SUBSCRIPTION_MAX];
+    size_t pendingCount = 0;
+    uint32_t now = xTaskGetTickCount();
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& entry : entries_) {
+        if (entry.handle == 0 || entry.channel != channel || entry.digital != digital) {
+            continue;
+        }
+
+        bool report = passes(entry, value, state);
+        // Digital edges not in the filter still move the baseline
+        bool advance = report || !entry.seen || (digital && state != entry.lastState);
+        if (report) {
+            ChangeEvent event;
+            event.source = source;
+            event.subscription = entry.handle;
+            event.timestamp = now;
+            event.channel = channel;
+            event.initial = !entry.seen;
+            event.state = state;
+            event.value = value;
+            event.previous = entry.last;
+
+            if (entry.target.queue) {
+                if (xQueueSend(entry.target.queue, &event, 0) != pdTRUE) {
+                    dropped_++;
+                    advance = false;  // Compare the next value against what was delivered
+                }
+            } else {
+                pending[pendingCount++] = {entry.target.callback, entry.target.context, event};
+            }
+        }
+        if (advance) {
+            entry.seen = true;
+            entry.last = value;
+            entry.lastState = state;
+        }
+    }
+    xSemaphoreGive(mutex_);
+
+    for (size_t i = 0; i < pendingCount; i++) {
+        pending[i].callback(pending[i].event, pending[i].context);
+    }
+}
+
+} // namespace modbus
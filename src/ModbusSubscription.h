@@ -0,0 +1,259 @@
+/*
+ * ModbusSubscription.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSSUBSCRIPTION_H
+#define MODBUSSUBSCRIPTION_H
+
+/**
+ * @file ModbusSubscription.h
+ * @brief Report-by-exception subscriptions for IModbusAnalogInput/IModbusDigitalInput
+ *
+ * Instead of every consumer polling getFloat()/getState() and comparing,
+ * consumers subscribe to a channel once. The device evaluates each new value
+ * when it lands (update(), onAsyncResponse()) and notifies only the
+ * subscribers whose deadband or edge filter it passes, by callback or by
+ * posting a ChangeEvent to a FreeRTOS queue.
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+
+// Subscriptions one input device can hold
+#ifndef MODBUS_SUBSCRIPTION_MAX
+#define MODBUS_SUBSCRIPTION_MAX 8
+#endif
+
+namespace modbus {
+
+class IModbusInput;
+
+/**
+ * @struct ChangeEvent
+ * @brief A value passed to a subscriber; also the item type of subscription queues
+ */
+struct ChangeEvent {
+    const IModbusInput* source = nullptr;
+    uint32_t subscription = 0;  ///< Handle returned by subscribe()
+    uint32_t timestamp = 0;     ///< Tick count when the value landed
+    uint16_t channel = 0;
+    bool initial = false;       ///< First value since subscribing
+    bool state = false;         ///< Digital channels
+    float value = 0.0f;         ///< Analog channels
+    float previous = 0.0f;      ///< Last value reported to this subscriber
+};
+
+using ChangeCallback = void (*)(const ChangeEvent& event, void* context);
+
+/**
+ * @struct Deadband
+ * @brief Minimum change an analog subscriber is told about
+ *
+ * A value is reported when it differs from the last reported one by at least
+ * max(absolute, percent% of |last reported|). Both 0 reports every change.
+ */
+struct Deadband {
+    float absolute = 0.0f;
+    float percent = 0.0f;
+};
+
+/**
+ * @enum Edge
+ * @brief Transitions a digital subscriber is told about
+ */
+enum class Edge : uint8_t {
+    RISING = 1,
+    FALLING = 2,
+    BOTH = 3
+};
+
+/**
+ * @class SubscriptionTable
+ * @brief Fixed table of channel subscriptions, evaluated once per new value
+ *
+ * Queue targets are posted under the table lock without waiting; a full
+ * queue drops the event and the next value is compared against the last one
+ * actually delivered. Callbacks run on the publishing task after the lock is
+ * released, so they may unsubscribe.
+ */
+class SubscriptionTable {
+public:
+    /**
+     * @struct Target
+     * @brief Where notifications go: callback (with context) or queue
+     */
+    struct Target {
+        ChangeCallback callback = nullptr;
+        void* context = nullptr;
+        QueueHandle_t queue = nullptr;  ///< Items of sizeof(ChangeEvent)
+    };
+
+    SubscriptionTable();
+    ~SubscriptionTable();
+
+    SubscriptionTable(const SubscriptionTable&) = delete;
+    SubscriptionTable& operator=(const SubscriptionTable&) = delete;
+
+    ModbusResult<uint32_t> addAnalog(uint16_t channel, const Deadband& deadband,
+                                     const Target& target, bool reportInitial);
+    ModbusResult<uint32_t> addDigital(uint16_t channel, Edge edge,
+                                      const Target& target, bool reportInitial);
+
+    /**
+     * @return true if the handle was subscribed
+     */
+    bool remove(uint32_t handle);
+
+    void publishAnalog(const IModbusInput* source, uint16_t channel, float value);
+    void publishDigital(const IModbusInput* source, uint16_t channel, bool state);
+
+    size_t size() const { return used_; }
+
+    /**
+     * @brief Events a full subscriber queue could not take
+     */
+    uint32_t getDropped() const { return dropped_; }
+
+private:
+    struct Entry {
+        Target target;
+        Deadband deadband;
+        uint32_t handle = 0;     ///< 0 = free
+        uint16_t channel = 0;
+        bool digital = false;
+        Edge edge = Edge::BOTH;
+        bool reportInitial = true;
+        bool seen = false;       ///< A value has been evaluated
+        bool lastState = false;
+        float last = 0.0f;
+    };
+
+    ModbusResult<uint32_t> add(const Entry& entry);
+    bool passes(const Entry& entry, float value, bool state) const;
+    void publish(const IModbusInput* source, uint16_t channel, bool digital, float value, bool state);
+
+    Entry entries_[MODBUS_SUBSCRIPTION_MAX];
+    std::atomic<size_t> used_{0};
+    std::atomic<uint32_t> dropped_{0};
+    uint32_t nextSequence_ = 1;
+    SemaphoreHandle_t mutex_ = nullptr;
+    SemaphoreStorage mutexStorage_;
+};
+
+/**
+ * @class LazySubscriptionTable
+ * @brief SubscriptionTable created on the first add, for the input interfaces
+ *
+ * Until somebody subscribes an input carries one pointer instead of the
+ * table and its mutex, and publishing is a null check. With
+ * MODBUSDEVICE_STATIC_ALLOCATION the table lives in the owner (LazySlot).
+ */
+class LazySubscriptionTable {
+public:
+    LazySubscriptionTable() = default;
+    ~LazySubscriptionTable() { slot_.release(table_.load()); }
+
+    LazySubscriptionTable(const LazySubscriptionTable&) = delete;
+    LazySubscriptionTable& operator=(const LazySubscriptionTable&) = delete;
+
+    ModbusResult<uint32_t> addAnalog(uint16_t channel, const Deadband& deadband,
+                                     const SubscriptionTable::Target& target, bool reportInitial) {
+        SubscriptionTable* table = acquire();
+        if (!table) {
+            return ModbusResult<uint32_t>::error(ModbusError::RESOURCE_CREATION_FAILED);
+        }
+        return table->addAnalog(channel, deadband, target, reportInitial);
+    }
+
+    ModbusResult<uint32_t> addDigital(uint16_t channel, Edge edge,
+                                      const SubscriptionTable::Target& target, bool reportInitial) {
+        SubscriptionTable* table = acquire();
+        if (!table) {
+            return ModbusResult<uint32_t>::error(ModbusError::RESOURCE_CREATION_FAILED);
+        }
+        return table->addDigital(channel, edge, target, reportInitial);
+    }
+
+    bool remove(uint32_t handle) {
+        SubscriptionTable* table = table_.load();
+        return table && table->remove(handle);
+    }
+
+    void publishAnalog(const IModbusInput* source, uint16_t channel, float value) {
+        SubscriptionTable* table = table_.load();
+        if (table) {
+            table->publishAnalog(source, channel, value);
+        }
+    }
+
+    void publishDigital(const IModbusInput* source, uint16_t channel, bool state) {
+        SubscriptionTable* table = table_.load();
+        if (table) {
+            table->publishDigital(source, channel, state);
+        }
+    }
+
+    size_t size() const {
+        SubscriptionTable* table = table_.load();
+        return table ? table->size() : 0;
+    }
+
+    uint32_t getDropped() const {
+        SubscriptionTable* table = table_.load();
+        return table ? table->getDropped() : 0;
+    }
+
+    /**
+     * @return true once the table has been created
+     */
+    bool isCreated() const { return table_.load() != nullptr; }
+
+private:
+    SubscriptionTable* acquire() {
+        SubscriptionTable* table = table_.load();
+        if (table) {
+            return table;
+        }
+        SubscriptionTable* created = slot_.acquire();
+        if (!created) {
+            return nullptr;
+        }
+        // Concurrent first subscribers: one table wins, the other is given back
+        if (!table_.compare_exchange_strong(table, created)) {
+            slot_.release(created);
+            return table;
+        }
+        return created;
+    }
+
+    std::atomic<SubscriptionTable*> table_{nullptr};
+    LazySlot<SubscriptionTable> slot_;
+};
+
+} // namespace modbus
+
+#endif // MODBUSSUBSCRIPTION_H
@@ -0,0 +1,103 @@
+/*
+ * ModbusTask.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+
+#include "ModbusTask.h"
+#include "ModbusDeviceLogging.h"
+
+namespace modbus {
+
+ModbusTaskBase::~ModbusTaskBase() {
+    if (exited) {
+        vSemaphoreDelete(exited);
+    }
+}
+
+bool ModbusTaskBase::start(const char* name, Body taskBody, void* taskContext, uint32_t stackSize,
+                           UBaseType_t priority, BaseType_t core) {
+    if (running) {
+        return true;
+    }
+    // A previous instance that returned on its own still has to be reaped
+    join();
+
+    if (!exited) {
+        exited = createBinarySemaphore(exitedStorage);
+        if (!exited) {
+            MODBUSD_LOG_E("Failed to create %s exit semaphore", name);
+            return false;
+        }
+    }
+    xSemaphoreTake(exited, 0);
+
+    body = taskBody;
+    context = taskContext;
+    running = true;
+    TaskHandle_t created = nullptr;
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    if (stackSize > stackBytes) {
+        MODBUSD_LOG_E("%s stack %u exceeds its static stack (%u)", name, (unsigned)stackSize,
+                      (unsigned)stackBytes);
+        running = false;
+        return false;
+    }
+    created = xTaskCreateStaticPinnedToCore(entry, name, stackSize, this, priority, stack, control, core);
+    if (!created) {
+#else
+    (void)stack;
+    (void)control;
+    if (xTaskCreatePinnedToCore(entry, name, stackSize, this, priority, &created, core) != pdPASS) {
+#endif
+        MODBUSD_LOG_E("Failed to create %s task", name);
+        running = false;
+        return false;
+    }
+    handle = created;
+    return true;
+}
+
+void ModbusTaskBase::join() {
+    TaskHandle_t task = handle.load();
+    if (!task || xTaskGetCurrentTaskHandle() == task) {
+        return;
+    }
+    xSemaphoreTake(exited, portMAX_DELAY);
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    // The task still runs vTaskDelete() on our stack; nothing may reuse it before then
+    while (eTaskGetState(task) != eDeleted) {
+        vTaskDelay(1);
+    }
+#endif
+    handle = nullptr;
+}
+
+void ModbusTaskBase::entry(void* param) {
+    auto* self = static_cast<ModbusTaskBase*>(param);
+    // The creator stores the handle after xTaskCreate*() returns; the body may need it sooner
+    self->handle = xTaskGetCurrentTaskHandle();
+    self->body(self->context);
+    self->running = false;
+    xSemaphoreGive(self->exited);
+    vTaskDelete(nullptr);
+}
+
+} // namespace modbus
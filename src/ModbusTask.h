@@ -0,0 +1,142 @@
+/*
+ * ModbusTask.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSTASK_H
+#define MODBUSTASK_H
+
+/**
+ * @file ModbusTask.h
+ * @brief Start/stop lifecycle shared by the library's background tasks
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "ModbusStaticAlloc.h"
+
+namespace modbus {
+
+/**
+ * @class ModbusTaskBase
+ * @brief One background task with a restartable start()/stop()
+ *
+ * The body loops while isRunning() and may also return on its own (a
+ * listen failure, a finished scan). Either way the task gives an exit
+ * semaphore and deletes itself; join() consumes that token, and in static
+ * builds also waits until the kernel no longer uses the stack. start()
+ * joins an instance that exited on its own before creating the next one,
+ * so a stale token can never make a later stop() return early.
+ *
+ * stop() from inside the body (a completion callback) only clears the
+ * running flag; the body finishes its iteration and exits, and the next
+ * start(), stop() or the destructor of the owner joins it.
+ *
+ * Use ModbusTask<StackBytes>, which provides the stack for
+ * MODBUSDEVICE_STATIC_ALLOCATION builds.
+ */
+class ModbusTaskBase {
+public:
+    using Body = void (*)(void* context);
+
+    ModbusTaskBase(const ModbusTaskBase&) = delete;
+    ModbusTaskBase& operator=(const ModbusTaskBase&) = delete;
+
+    /**
+     * @param stackSize Stack in bytes (at most the ModbusTask capacity in static builds)
+     * @return true if the task is running
+     */
+    bool start(const char* name, Body body, void* context, uint32_t stackSize,
+               UBaseType_t priority, BaseType_t core);
+
+    /**
+     * @brief Clear the running flag
+     * @return true if the task was running
+     */
+    bool requestStop() { return running.exchange(false); }
+
+    /**
+     * @brief Wait until the last started task has exited
+     *
+     * No-op if none was started or when called from the task itself.
+     */
+    void join();
+
+    /// requestStop() + join()
+    void stop() {
+        requestStop();
+        join();
+    }
+
+    bool isRunning() const { return running.load(); }
+
+    /**
+     * @brief Whether the calling task is this task
+     */
+    bool isCurrentTask() const {
+        TaskHandle_t self = handle.load();
+        return self && xTaskGetCurrentTaskHandle() == self;
+    }
+
+    TaskHandle_t getHandle() const { return handle.load(); }
+
+protected:
+    ModbusTaskBase(StackType_t* stack, size_t stackBytes, StaticTask_t* control)
+        : stack(stack), stackBytes(stackBytes), control(control) {}
+    ~ModbusTaskBase();
+
+private:
+    static void entry(void* param);
+
+    Body body = nullptr;
+    void* context = nullptr;
+    std::atomic<bool> running{false};
+    std::atomic<TaskHandle_t> handle{nullptr};   ///< Last started instance, until joined
+    SemaphoreHandle_t exited = nullptr;          ///< Given by the task as its last action
+    SemaphoreStorage exitedStorage;
+    StackType_t* stack;
+    size_t stackBytes;
+    StaticTask_t* control;
+};
+
+template<size_t StackBytes>
+class ModbusTask : public ModbusTaskBase {
+public:
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    ModbusTask() : ModbusTaskBase(stackBuffer, sizeof(stackBuffer), &controlBlock) {}
+#else
+    ModbusTask() : ModbusTaskBase(nullptr, StackBytes, nullptr) {}
+#endif
+    ~ModbusTask() { stop(); }
+
+private:
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    StackType_t stackBuffer[StackBytes / sizeof(StackType_t)];
+    StaticTask_t controlBlock;
+#endif
+};
+
+} // namespace modbus
+
+#endif // MODBUSTASK_H
@@ -0,0 +1,631 @@
+/*
+ * ModbusTcpGateway.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "ModbusTcpGateway.h"
+#include "ModbusDevice.h"
+#include "ModbusDeviceLogging.h"
+#include "MutexGuard.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace modbus {
+
+namespace {
+
+// MBAP header + the longest non-read reply (write echo: FC, address, quantity)
+constexpr size_t MIN_RESPONSE = 7 + 5;
+
+// Modbus exception codes the gateway produces itself
+constexpr uint8_t EXCEPTION_ILLEGAL_FUNCTION = 0x01;
+constexpr uint8_t EXCEPTION_ILLEGAL_DATA_VALUE = 0x03;
+constexpr uint8_t EXCEPTION_DEVICE_FAILURE = 0x04;
+constexpr uint8_t EXCEPTION_BUSY = 0x06;
+constexpr uint8_t EXCEPTION_PATH_UNAVAILABLE = 0x0A;
+constexpr uint8_t EXCEPTION_TARGET_FAILED = 0x0B;
+
+inline uint16_t be16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline void putBe16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+uint8_t exceptionFor(ModbusError error) {
+    switch (error) {
+        case ModbusError::ILLEGAL_FUNCTION:
+        case ModbusError::ILLEGAL_DATA_ADDRESS:
+        case ModbusError::ILLEGAL_DATA_VALUE:
+        case ModbusError::SLAVE_DEVICE_FAILURE:
+            return static_cast<uint8_t>(error);  // Slave exception, passed through
+        case ModbusError::INVALID_PARAMETER:
+        case ModbusError::INVALID_DATA_LENGTH:
+            return EXCEPTION_ILLEGAL_DATA_VALUE;
+        case ModbusError::TIMEOUT:
+        case ModbusError::DEVICE_NOT_FOUND:   // Open circuit breaker
+            return EXCEPTION_TARGET_FAILED;
+        case ModbusError::MUTEX_ERROR:
+        case ModbusError::QUEUE_FULL:
+            return EXCEPTION_BUSY;
+        default:
+            return EXCEPTION_DEVICE_FAILURE;
+    }
+}
+
+size_t exceptionReply(uint8_t fc, uint8_t code, uint8_t* out) {
+    out[0] = static_cast<uint8_t>(fc | 0x80);
+    out[1] = code;
+    return 2;
+}
+
+} // namespace
+
+ModbusTcpGateway::ModbusTcpGateway() {
+    mutex = createMutex(mutexStorage);
+    if (!mutex) {
+        MODBUSD_LOG_E("Failed to create gateway mutex");
+    }
+}
+
+ModbusTcpGateway::~ModbusTcpGateway() {
+    stop();
+    if (mutex) {
+        vSemaphoreDelete(mutex);
+    }
+}
+
+ModbusResult<void> ModbusTcpGateway::mapUnit(uint8_t unitId, ModbusDevice& device,
+                                             esp32Modbus::ModbusPriority priority) {
+    if (!mutex) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return ModbusResult<void>::error(ModbusError::MUTEX_ERROR);
+    }
+
+    Unit* slot = nullptr;
+    for (auto& unit : units) {
+        if (unit.used && unit.unitId == unitId) {
+            slot = &unit;
+            break;
+        }
+        if (!unit.used && !slot) {
+            slot = &unit;
+        }
+    }
+    if (!slot) {
+        return ModbusResult<void>::error(ModbusError::QUEUE_FULL);
+    }
+    slot->used = true;
+    slot->unitId = unitId;
+    slot->device = &device;
+    slot->priority = priority;
+
+    // Responses cached for a previous mapping no longer apply
+    for (auto& entry : cache) {
+        if (entry.unitId == unitId) {
+            entry.used = false;
+        }
+    }
+    return ModbusResult<void>::ok();
+}
+
+void ModbusTcpGateway::unmapUnit(uint8_t unitId) {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return;
+    }
+    for (auto& unit : units) {
+        if (unit.used && unit.unitId == unitId) {
+            unit.used = false;
+        }
+    }
+    for (auto& entry : cache) {
+        if (entry.unitId == unitId) {
+            entry.used = false;
+        }
+    }
+}
+
+void ModbusTcpGateway::setCacheTtl(uint32_t ttlMs) {
+    MutexGuard lock(mutex);
+    cacheTtlMs = ttlMs;
+}
+
+void ModbusTcpGateway::setRateLimit(uint32_t perSecond, uint32_t burst) {
+    MutexGuard lock(mutex);
+    ratePerSec = perSecond;
+    rateBurst = burst ? burst : 1;
+    for (auto& bucket : buckets) {
+        bucket.primed = false;
+    }
+}
+
+void ModbusTcpGateway::invalidateCache() {
+    MutexGuard lock(mutex);
+    for (auto& entry : cache) {
+        entry.used = false;
+    }
+}
+
+ModbusTcpGateway::Stats ModbusTcpGateway::getStats() const {
+    MutexGuard lock(mutex);
+    return stats;
+}
+
+size_t ModbusTcpGateway::processFrame(uint8_t client, const uint8_t* request, size_t length,
+                                      uint8_t* response, size_t capacity) {
+    // MBAP: transaction id, protocol id 0, length of unit id + PDU, unit id
+    if (!request || !response || length < 8 || capacity < MIN_RESPONSE || be16(request + 2) != 0 ||
+        be16(request + 4) + 6u != length) {
+        return 0;
+    }
+    const uint8_t unitId = request[6];
+
+    Unit unit;
+    {
+        MutexGuard lock(mutex);
+        if (!lock.hasLock()) {
+            return 0;
+        }
+        for (const auto& candidate : units) {
+            if (candidate.used && candidate.unitId == unitId) {
+                unit = candidate;
+                break;
+            }
+        }
+    }
+
+    size_t n;
+    if (!unit.used) {
+        n = exceptionReply(request[7], EXCEPTION_PATH_UNAVAILABLE, response + 7);
+    } else {
+        n = handlePdu(client % MODBUS_GATEWAY_MAX_CLIENTS, unit, request + 7, length - 7,
+                      response + 7, std::min(capacity, MAX_ADU) - 7);
+    }
+
+    std::memcpy(response, request, 4);   // Transaction and protocol id
+    putBe16(response + 4, static_cast<uint16_t>(n + 1));
+    response[6] = unitId;
+
+    MutexGuard lock(mutex);
+    stats.requests++;
+    if (response[7] & 0x80) {
+        stats.exceptions++;
+    }
+    return n + 7;
+}
+
+size_t ModbusTcpGateway::handlePdu(uint8_t client, const Unit& unit, const uint8_t* pdu, size_t length,
+                                   uint8_t* out, size_t capacity) {
+    const uint8_t fc = pdu[0];
+    const bool supported = (fc >= 0x01 && fc <= 0x06) || fc == 0x0F || fc == 0x10;
+    if (!supported) {
+        return exceptionReply(fc, EXCEPTION_ILLEGAL_FUNCTION, out);
+    }
+    if (length < 5) {
+        return exceptionReply(fc, EXCEPTION_ILLEGAL_DATA_VALUE, out);
+    }
+    const uint16_t address = be16(pdu + 1);
+    const uint16_t count = be16(pdu + 3);   // Value for FC05/FC06
+    ModbusDevice& device = *unit.device;
+
+    switch (fc) {
+        case 0x01:
+        case 0x02:
+        case 0x03:
+        case 0x04: {
+            const bool bitRead = fc <= 0x02;
+            const uint16_t maxCount = bitRead ? MODBUS_MAX_COIL_COUNT : MODBUS_MAX_REGISTER_COUNT;
+            if (length != 5 || count == 0 || count > maxCount) {
+                return exceptionReply(fc, EXCEPTION_ILLEGAL_DATA_VALUE, out);
+            }
+            // FC + byte count + data must fit the caller's buffer, also for cache hits
+            const size_t bytes = bitRead ? (count + 7u) / 8 : 2u * count;
+            if (2 + bytes > capacity) {
+                return exceptionReply(fc, EXCEPTION_DEVICE_FAILURE, out);
+            }
+
+            size_t cached = 0;
+            if (lookupCache(unit.unitId, fc, address, count, out + 1, cached)) {
+                out[0] = fc;
+                return 1 + cached;
+            }
+            if (!takeToken(client)) {
+                return exceptionReply(fc, EXCEPTION_BUSY, out);
+            }
+
+            if (bitRead) {
+                auto result = device.readBitBlock(fc, address, count, out + 2, capacity - 2,
+                                                  "gateway", unit.priority);
+                if (!result.isOk()) {
+                    return exceptionReply(fc, exceptionFor(result.error()), out);
+                }
+                if (result.value() < count) {
+                    return exceptionReply(fc, EXCEPTION_DEVICE_FAILURE, out);
+                }
+            } else {
+                uint16_t regs[MODBUS_MAX_REGISTER_COUNT];
+                auto result = device.readRegisterBlock(fc, address, count, regs, MODBUS_MAX_REGISTER_COUNT,
+                                                       unit.priority, "gateway");
+                if (!result.isOk()) {
+                    return exceptionReply(fc, exceptionFor(result.error()), out);
+                }
+                if (result.value() < count) {
+                    return exceptionReply(fc, EXCEPTION_DEVICE_FAILURE, out);
+                }
+                for (uint16_t i = 0; i < count; i++) {
+                    putBe16(out + 2 + 2 * i, regs[i]);
+                }
+            }
+            out[0] = fc;
+            out[1] = static_cast<uint8_t>(bytes);
+            storeCache(unit.unitId, fc, address, count, out + 1, 1 + bytes);
+            return 2 + bytes;
+        }
+
+        case 0x05:
+        case 0x06: {
+            if (length != 5 || (fc == 0x05 && count != 0xFF00 && count != 0x0000)) {
+                return exceptionReply(fc, EXCEPTION_ILLEGAL_DATA_VALUE, out);
+            }
+            if (!takeToken(client)) {
+                return exceptionReply(fc, EXCEPTION_BUSY, out);
+            }
+            auto result = (fc == 0x05)
+                ? device.writeSingleCoilWithPriority(address, count == 0xFF00, unit.priority)
+                : device.writeSingleRegisterWithPriority(address, count, unit.priority);
+            invalidateRange(unit.unitId, fc == 0x05 ? 0x01 : 0x03, address, 1);
+            if (!result.isOk()) {
+                return exceptionReply(fc, exceptionFor(result.error()), out);
+            }
+            std::memcpy(out, pdu, 5);   // Echo of the request
+            return 5;
+        }
+
+        case 0x0F:
+        case 0x10: {
+            const uint16_t maxCount = (fc == 0x0F) ? MODBUS_MAX_WRITE_COIL_COUNT : MODBUS_MAX_WRITE_REGISTER_COUNT;
+            const size_t bytes = (fc == 0x0F) ? (count + 7u) / 8 : 2u * count;
+            if (length < 6 || count == 0 || count > maxCount || pdu[5] != bytes || length != 6 + bytes) {
+                return exceptionReply(fc, EXCEPTION_ILLEGAL_DATA_VALUE, out);
+            }
+            if (!takeToken(client)) {
+                return exceptionReply(fc, EXCEPTION_BUSY, out);
+            }
+
+            const uint8_t* payload = pdu + 6;
+            uint16_t values[MODBUS_MAX_WRITE_REGISTER_COUNT];
+            static_assert((MODBUS_MAX_WRITE_COIL_COUNT + 15) / 16 <= MODBUS_MAX_WRITE_REGISTER_COUNT,
+                          "coil words must fit the register buffer");
+            ModbusResult<void> result = ModbusResult<void>::ok();
+            if (fc == 0x0F) {
+                // Wire bytes are LSB first; the FC0F source is 16 coils per word
+                std::fill(values, values + (count + 15) / 16, 0);
+                for (size_t i = 0; i < bytes; i++) {
+                    values[i / 2] |= static_cast<uint16_t>(payload[i] << ((i % 2) * 8));
+                }
+                ModbusDevice::SyncSink sink;
+                sink.type = ModbusDevice::SyncSink::Type::NONE;
+                result = device.transact(0x0F, address, count, unit.priority, values, sink, "gateway");
+            } else {
+                for (uint16_t i = 0; i < count; i++) {
+                    values[i] = be16(payload + 2 * i);
+                }
+                result = device.writeRegisterRun(address, count, values, unit.priority, "gateway", 0x10);
+            }
+            invalidateRange(unit.unitId, fc == 0x0F ? 0x01 : 0x03, address, count);
+            if (!result.isOk()) {
+                return exceptionReply(fc, exceptionFor(result.error()), out);
+            }
+            std::memcpy(out, pdu, 5);   // FC, address, quantity
+            return 5;
+        }
+
+        default:
+            return exceptionReply(fc, EXCEPTION_ILLEGAL_FUNCTION, out);
+    }
+}
+
+bool ModbusTcpGateway::lookupCache(uint8_t unitId, uint8_t fc, uint16_t address, uint16_t count,
+                                   uint8_t* out, size_t& length) {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock() || cacheTtlMs == 0) {
+        return false;
+    }
+    const TickType_t now = xTaskGetTickCount();
+    const TickType_t ttl = pdMS_TO_TICKS(cacheTtlMs);
+    for (const auto& entry : cache) {
+        if (!entry.used || entry.unitId != unitId || entry.functionCode != fc ||
+            now - entry.stored >= ttl) {
+            continue;
+        }
+        if (entry.address == address && entry.count == count) {
+            std::memcpy(out, entry.data, entry.length);
+            length = entry.length;
+            stats.cacheHits++;
+            return true;
+        }
+        // Registers can be sliced out of a larger cached read
+        if (fc >= 0x03 && entry.address <= address &&
+            static_cast<uint32_t>(address) + count <= static_cast<uint32_t>(entry.address) + entry.count) {
+            out[0] = static_cast<uint8_t>(2 * count);
+            std::memcpy(out + 1, entry.data + 1 + 2 * (address - entry.address), 2u * count);
+            length = 1 + 2u * count;
+            stats.cacheHits++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void ModbusTcpGateway::storeCache(uint8_t unitId, uint8_t fc, uint16_t address, uint16_t count,
+                                  const uint8_t* data, size_t length) {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock() || cacheTtlMs == 0 || length > sizeof(CacheEntry::data)) {
+        return;
+    }
+    // Same request first, then a free slot, then the oldest entry
+    CacheEntry* slot = nullptr;
+    for (auto& entry : cache) {
+        if (entry.used && entry.unitId == unitId && entry.functionCode == fc &&
+            entry.address == address && entry.count == count) {
+            slot = &entry;
+            break;
+        }
+    }
+    for (size_t i = 0; !slot && i < MODBUS_GATEWAY_CACHE_ENTRIES; i++) {
+        if (!cache[i].used) {
+            slot = &cache[i];
+        }
+    }
+    if (!slot) {
+        slot = &cache[0];
+        for (auto& entry : cache) {
+            if (static_cast<int32_t>(entry.stored - slot->stored) < 0) {
+                slot = &entry;
+            }
+        }
+    }
+    slot->used = true;
+    slot->unitId = unitId;
+    slot->functionCode = fc;
+    slot->address = address;
+    slot->count = count;
+    slot->stored = xTaskGetTickCount();
+    slot->length = static_cast<uint8_t>(length);
+    std::memcpy(slot->data, data, length);
+}
+
+void ModbusTcpGateway::invalidateRange(uint8_t unitId, uint8_t readFc, uint16_t address, uint16_t count) {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return;
+    }
+    const uint32_t end = static_cast<uint32_t>(address) + count;
+    for (auto& entry : cache) {
+        if (entry.used && entry.unitId == unitId && entry.functionCode == readFc &&
+            entry.address < end && address < static_cast<uint32_t>(entry.address) + entry.count) {
+            entry.used = false;
+        }
+    }
+}
+
+bool ModbusTcpGateway::takeToken(uint8_t client) {
+    MutexGuard lock(mutex);
+    if (!lock.hasLock()) {
+        return false;
+    }
+    if (ratePerSec != 0) {
+        Bucket& bucket = buckets[client];
+        const TickType_t now = xTaskGetTickCount();
+        const uint32_t full = rateBurst * 1000;
+        if (!bucket.primed) {
+            bucket.primed = true;
+            bucket.milliTokens = full;
+        } else {
+            const uint64_t refill = static_cast<uint64_t>(now - bucket.refilled) * portTICK_PERIOD_MS * ratePerSec;
+            bucket.milliTokens = static_cast<uint32_t>(std::min<uint64_t>(full, bucket.milliTokens + refill));
+        }
+        bucket.refilled = now;
+        if (bucket.milliTokens < 1000) {
+            stats.rateLimited++;
+            return false;
+        }
+        bucket.milliTokens -= 1000;
+    }
+    stats.busRequests++;
+    return true;
+}
+
+bool ModbusTcpGateway::start(uint16_t listenPort, uint32_t stackSize, UBaseType_t priority, BaseType_t core) {
+    if (task.isRunning()) {
+        return true;
+    }
+    if (!mutex) {
+        return false;
+    }
+
+    port = listenPort;   // A task that exited on a listen failure has already read the old one
+    return task.start("ModbusTcpGw", taskEntry, this, stackSize, priority, core);
+}
+
+void ModbusTcpGateway::stop() {
+    const bool wasRunning = task.requestStop();
+    task.join();
+    if (wasRunning && !task.isCurrentTask()) {
+        MODBUSD_LOG_I("Modbus TCP gateway stopped");
+    }
+}
+
+void ModbusTcpGateway::taskEntry(void* param) {
+    static_cast<ModbusTcpGateway*>(param)->run();
+}
+
+void ModbusTcpGateway::run() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (listener >= 0) {
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            listen(listener, MODBUS_GATEWAY_MAX_CLIENTS) != 0) {
+            close(listener);
+            listener = -1;
+        }
+    }
+    if (listener < 0) {
+        MODBUSD_LOG_E("Gateway cannot listen on port %d (errno %d)", port, errno);
+        task.requestStop();   // The next start() or stop() reaps this task
+    } else {
+        MODBUSD_LOG_I("Modbus TCP gateway listening on port %d", port);
+    }
+
+    while (task.isRunning()) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(listener, &readable);
+        int maxFd = listener;
+        for (const auto& client : clients) {
+            if (client.fd >= 0) {
+                FD_SET(client.fd, &readable);
+                maxFd = std::max(maxFd, client.fd);
+            }
+        }
+
+        timeval timeout = {0, MODBUS_GATEWAY_POLL_MS * 1000};
+        int ready = select(maxFd + 1, &readable, nullptr, nullptr, &timeout);
+        if (ready < 0 && errno != EINTR) {
+            MODBUSD_LOG_W("Gateway select failed (errno %d)", errno);
+            vTaskDelay(pdMS_TO_TICKS(MODBUS_GATEWAY_POLL_MS));
+            continue;
+        }
+
+        if (ready > 0 && FD_ISSET(listener, &readable)) {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                Client* slot = nullptr;
+                for (auto& client : clients) {
+                    if (client.fd < 0) {
+                        slot = &client;
+                        break;
+                    }
+                }
+                MutexGuard lock(mutex);
+                if (slot) {
+                    slot->fd = fd;
+                    slot->length = 0;
+                    slot->lastActivity = xTaskGetTickCount();
+                    buckets[slot - clients].primed = false;   // A new client starts with a full burst
+                    clientCount++;
+                    stats.connections++;
+                } else {
+                    close(fd);
+                    stats.rejected++;
+                }
+            }
+        }
+
+        const TickType_t now = xTaskGetTickCount();
+        for (uint8_t i = 0; i < MODBUS_GATEWAY_MAX_CLIENTS; i++) {
+            Client& client = clients[i];
+            if (client.fd < 0) {
+                continue;
+            }
+            if (ready > 0 && FD_ISSET(client.fd, &readable)) {
+                serveClient(client, i);
+            } else if (now - client.lastActivity >= pdMS_TO_TICKS(MODBUS_GATEWAY_IDLE_TIMEOUT_MS)) {
+                closeClient(client);
+            }
+        }
+    }
+
+    for (auto& client : clients) {
+        if (client.fd >= 0) {
+            closeClient(client);
+        }
+    }
+    if (listener >= 0) {
+        close(listener);
+    }
+}
+
+void ModbusTcpGateway::serveClient(Client& client, uint8_t index) {
+    ssize_t received = recv(client.fd, client.buffer + client.length, sizeof(client.buffer) - client.length, 0);
+    if (received <= 0) {
+        closeClient(client);   // Orderly close or error
+        return;
+    }
+    client.length += static_cast<size_t>(received);
+    client.lastActivity = xTaskGetTickCount();
+
+    // A segment may carry several frames or part of one
+    uint8_t reply[MAX_ADU];
+    while (client.length >= 7) {
+        const size_t frame = 6u + be16(client.buffer + 4);
+        if (be16(client.buffer + 2) != 0 || frame < 8 || frame > MAX_ADU) {
+            MODBUSD_LOG_W("Gateway dropping client with malformed MBAP header");
+            closeClient(client);
+            return;
+        }
+        if (client.length < frame) {
+            break;
+        }
+
+        size_t n = processFrame(index, client.buffer, frame, reply, sizeof(reply));
+        for (size_t sent = 0; sent < n;) {
+#ifdef MSG_NOSIGNAL
+            ssize_t w = send(client.fd, reply + sent, n - sent, MSG_NOSIGNAL);
+#else
+            ssize_t w = send(client.fd, reply + sent, n - sent, 0);
+#endif
+            if (w <= 0) {
+                closeClient(client);
+                return;
+            }
+            sent += static_cast<size_t>(w);
+        }
+
+        client.length -= frame;
+        std::memmove(client.buffer, client.buffer + frame, client.length);
+    }
+}
+
+void ModbusTcpGateway::closeClient(Client& client) {
+    close(client.fd);
+    client.fd = -1;
+    client.length = 0;
+    MutexGuard lock(mutex);
+    clientCount--;
+}
+
+} // namespace modbus
@@ -0,0 +1,275 @@
+/*
+ * ModbusTcpGateway.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSTCPGATEWAY_H
+#define MODBUSTCPGATEWAY_H
+
+/**
+ * @file ModbusTcpGateway.h
+ * @brief Modbus TCP server that forwards to RTU devices on the bus
+ *
+ * SCADA clients connect over Modbus TCP (MBAP framing, port 502). Each
+ * request's unit id selects a ModbusDevice mapped with mapUnit(); the
+ * request runs through that device's normal transaction path at the unit's
+ * priority, so it queues behind the bus arbiter (or the BusScheduler when
+ * one owns the bus) like any local caller. Identical reads from several
+ * clients within the cache TTL are answered from the gateway's response
+ * cache, so bus load follows the unique data polled, not the client count.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <esp32ModbusRTU.h>
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+#include "ModbusTask.h"
+
+#ifndef MODBUS_GATEWAY_PORT
+#define MODBUS_GATEWAY_PORT 502
+#endif
+
+// Simultaneous TCP connections; further ones are closed on accept
+#ifndef MODBUS_GATEWAY_MAX_CLIENTS
+#define MODBUS_GATEWAY_MAX_CLIENTS 4
+#endif
+
+// Unit id -> device mappings
+#ifndef MODBUS_GATEWAY_MAX_UNITS
+#define MODBUS_GATEWAY_MAX_UNITS 16
+#endif
+
+// Read responses kept for repeat requests
+#ifndef MODBUS_GATEWAY_CACHE_ENTRIES
+#define MODBUS_GATEWAY_CACHE_ENTRIES 16
+#endif
+
+// Default age up to which a cached read response is served (0 = no cache)
+#ifndef MODBUS_GATEWAY_CACHE_TTL_MS
+#define MODBUS_GATEWAY_CACHE_TTL_MS 500
+#endif
+
+// Default per-client bus requests per second and burst (0 = unlimited); cache hits are free
+#ifndef MODBUS_GATEWAY_RATE_PER_SEC
+#define MODBUS_GATEWAY_RATE_PER_SEC 20
+#endif
+
+#ifndef MODBUS_GATEWAY_RATE_BURST
+#define MODBUS_GATEWAY_RATE_BURST 10
+#endif
+
+// Connections without traffic for this long are closed
+#ifndef MODBUS_GATEWAY_IDLE_TIMEOUT_MS
+#define MODBUS_GATEWAY_IDLE_TIMEOUT_MS 60000
+#endif
+
+// select() timeout of the server loop; bounds stop() latency
+#ifndef MODBUS_GATEWAY_POLL_MS
+#define MODBUS_GATEWAY_POLL_MS 50
+#endif
+
+#ifndef MODBUS_GATEWAY_STACK_SIZE
+#define MODBUS_GATEWAY_STACK_SIZE 4096
+#endif
+
+#ifndef MODBUS_GATEWAY_TASK_PRIORITY
+#define MODBUS_GATEWAY_TASK_PRIORITY 3
+#endif
+
+#ifndef MODBUS_GATEWAY_CORE
+#define MODBUS_GATEWAY_CORE tskNO_AFFINITY
+#endif
+
+namespace modbus {
+
+class ModbusDevice;
+
+/**
+ * @class ModbusTcpGateway
+ * @brief Modbus TCP front end for RTU devices
+ *
+ * Supports FC01-06, FC0F and FC10. Errors are returned as Modbus
+ * exceptions: device exceptions pass through, an unmapped unit is 0x0A
+ * (gateway path unavailable), a timeout or open breaker 0x0B (target
+ * failed to respond), and a client over its rate limit gets 0x06 (server
+ * busy) without touching the bus.
+ *
+ * Writes go straight to the device and drop cached reads they overlap.
+ * The connections are served by one task in request order; a request
+ * waiting on the bus holds up the others, as on the serial line itself.
+ *
+ * @code
+ * static ModbusTcpGateway gateway;
+ * gateway.mapUnit(1, boiler);                        // unit 1 -> boiler at its RTU address
+ * gateway.mapUnit(2, meter, esp32Modbus::STATUS);
+ * gateway.start();                                   // after the network is up
+ * @endcode
+ */
+class ModbusTcpGateway {
+public:
+    static constexpr size_t MAX_ADU = 260;   ///< 7-byte MBAP header + 253-byte PDU
+
+    ModbusTcpGateway();
+    ~ModbusTcpGateway();
+
+    ModbusTcpGateway(const ModbusTcpGateway&) = delete;
+    ModbusTcpGateway& operator=(const ModbusTcpGateway&) = delete;
+
+    /**
+     * @brief Route a unit id to a device (replaces an existing mapping)
+     * @param priority Bus priority of the unit's requests
+     * @return QUEUE_FULL once MODBUS_GATEWAY_MAX_UNITS are mapped
+     */
+    [[nodiscard]] ModbusResult<void> mapUnit(uint8_t unitId, ModbusDevice& device,
+                                             esp32Modbus::ModbusPriority priority = esp32Modbus::STATUS);
+
+    void unmapUnit(uint8_t unitId);
+
+    /**
+     * @brief Max age of a cached read response (0 disables the cache)
+     */
+    void setCacheTtl(uint32_t ttlMs);
+
+    /**
+     * @brief Per-client token bucket for requests that reach the bus
+     * @param perSecond Sustained rate, 0 = unlimited
+     * @param burst Requests a quiet client may send back to back
+     */
+    void setRateLimit(uint32_t perSecond, uint32_t burst);
+
+    void invalidateCache();
+
+    /**
+     * @brief Start listening and serving on a task
+     * @param port TCP port
+     * @param stackSize Task stack (at most MODBUS_GATEWAY_STACK_SIZE with
+     *        MODBUSDEVICE_STATIC_ALLOCATION)
+     * @return true if the task is running
+     */
+    bool start(uint16_t port = MODBUS_GATEWAY_PORT, uint32_t stackSize = MODBUS_GATEWAY_STACK_SIZE,
+               UBaseType_t priority = MODBUS_GATEWAY_TASK_PRIORITY, BaseType_t core = MODBUS_GATEWAY_CORE);
+
+    /**
+     * @brief Close all connections and stop the task (within MODBUS_GATEWAY_POLL_MS)
+     */
+    void stop();
+
+    bool isRunning() const { return task.isRunning(); }
+
+    /**
+     * @brief Answer one Modbus TCP frame
+     *
+     * The transport-independent core of the gateway, called by the server
+     * task for every complete frame; usable directly to bridge another
+     * transport.
+     * @param client Rate-limit bucket (0..MODBUS_GATEWAY_MAX_CLIENTS-1)
+     * @param request Complete ADU (MBAP header + PDU)
+     * @param response Reply ADU
+     * @param capacity Size of response, at least 12 bytes; MAX_ADU is always
+     *        enough, reads whose reply does not fit answer exception 04
+     * @return Reply length, 0 if the frame is not Modbus TCP and must be dropped
+     */
+    size_t processFrame(uint8_t client, const uint8_t* request, size_t length,
+                        uint8_t* response, size_t capacity);
+
+    struct Stats {
+        uint32_t requests = 0;        ///< Frames answered
+        uint32_t cacheHits = 0;       ///< Reads answered without the bus
+        uint32_t busRequests = 0;     ///< Requests forwarded to a device
+        uint32_t exceptions = 0;      ///< Exception replies, including the ones below
+        uint32_t rateLimited = 0;     ///< Rejected by a client's rate limit
+        uint32_t connections = 0;     ///< Connections accepted
+        uint32_t rejected = 0;        ///< Connections closed because all slots were in use
+    };
+
+    Stats getStats() const;
+
+    size_t getClientCount() const { return clientCount; }
+
+private:
+    struct Unit {
+        bool used = false;
+        uint8_t unitId = 0;
+        ModbusDevice* device = nullptr;
+        esp32Modbus::ModbusPriority priority = esp32Modbus::STATUS;
+    };
+
+    struct CacheEntry {
+        bool used = false;
+        uint8_t unitId = 0;
+        uint8_t functionCode = 0;
+        uint16_t address = 0;
+        uint16_t count = 0;
+        TickType_t stored = 0;
+        uint8_t length = 0;           ///< Bytes in data (byte count + payload)
+        uint8_t data[251];
+    };
+
+    struct Bucket {
+        uint32_t milliTokens = 0;
+        TickType_t refilled = 0;
+        bool primed = false;
+    };
+
+    struct Client {
+        int fd = -1;
+        size_t length = 0;
+        TickType_t lastActivity = 0;
+        uint8_t buffer[MAX_ADU];
+    };
+
+    size_t handlePdu(uint8_t client, const Unit& unit, const uint8_t* pdu, size_t length,
+                     uint8_t* out, size_t capacity);
+    bool lookupCache(uint8_t unitId, uint8_t fc, uint16_t address, uint16_t count,
+                     uint8_t* out, size_t& length);
+    void storeCache(uint8_t unitId, uint8_t fc, uint16_t address, uint16_t count,
+                    const uint8_t* data, size_t length);
+    void invalidateRange(uint8_t unitId, uint8_t readFc, uint16_t address, uint16_t count);
+    bool takeToken(uint8_t client);
+
+    static void taskEntry(void* param);
+    void run();
+    void serveClient(Client& client, uint8_t index);
+    void closeClient(Client& client);
+
+    Unit units[MODBUS_GATEWAY_MAX_UNITS];
+    CacheEntry cache[MODBUS_GATEWAY_CACHE_ENTRIES];
+    Bucket buckets[MODBUS_GATEWAY_MAX_CLIENTS];
+    Client clients[MODBUS_GATEWAY_MAX_CLIENTS];
+    size_t clientCount = 0;
+    uint32_t cacheTtlMs = MODBUS_GATEWAY_CACHE_TTL_MS;
+    uint32_t ratePerSec = MODBUS_GATEWAY_RATE_PER_SEC;
+    uint32_t rateBurst = MODBUS_GATEWAY_RATE_BURST;
+    Stats stats;
+
+    SemaphoreHandle_t mutex = nullptr;    ///< Guards units, cache and buckets
+    uint16_t port = MODBUS_GATEWAY_PORT;
+
+    SemaphoreStorage mutexStorage;
+    ModbusTask<MODBUS_GATEWAY_STACK_SIZE> task;
+};
+
+} // namespace modbus
+
+#endif // MODBUSTCPGATEWAY_H
@@ -0,0 +1,274 @@
+/*
+ * ModbusTrace.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "ModbusTrace.h"
+#include "ModbusDeviceLogging.h"
+#include <cstring>
+#include <new>
+
+#ifdef MODBUSDEVICE_TRACE
+#if __has_include(<esp_heap_caps.h>)
+#include <esp_heap_caps.h>
+#define MODBUS_TRACE_HEAP_CAPS 1
+#endif
+#if __has_include(<esp_attr.h>)
+#include <esp_attr.h>
+#endif
+#endif
+
+#ifndef EXT_RAM_BSS_ATTR
+#define EXT_RAM_BSS_ATTR
+#endif
+
+namespace modbus {
+
+#ifdef MODBUSDEVICE_TRACE
+
+static_assert((MODBUS_TRACE_RECORDS & (MODBUS_TRACE_RECORDS - 1)) == 0,
+              "MODBUS_TRACE_RECORDS must be a power of two");
+
+namespace {
+
+struct Slot {
+    std::atomic<uint32_t> sequence{0};   ///< Ticket + 1 once published, 0 while written
+    TraceRecord record;
+};
+
+static_assert(sizeof(Slot) == ModbusTrace::DUMP_RECORD_SIZE, "Slot is dumped as is");
+
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+EXT_RAM_BSS_ATTR Slot staticSlots[MODBUS_TRACE_RECORDS];
+#endif
+
+std::atomic<Slot*> slots{nullptr};
+uint32_t mask = 0;
+std::atomic<uint32_t> head{0};      ///< Next ticket
+std::atomic<uint32_t> origin{0};    ///< First ticket after the last clear()
+std::atomic<bool> paused{false};
+
+Slot* allocate(size_t records) {
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    (void)records;
+    return staticSlots;
+#else
+    const size_t bytes = records * sizeof(Slot);
+    void* memory = nullptr;
+#ifdef MODBUS_TRACE_HEAP_CAPS
+    memory = heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!memory) {
+        memory = heap_caps_malloc(bytes, MALLOC_CAP_8BIT);
+    }
+#else
+    memory = ::operator new(bytes, std::nothrow);
+#endif
+    if (!memory) {
+        return nullptr;
+    }
+    Slot* ring = static_cast<Slot*>(memory);
+    for (size_t i = 0; i < records; i++) {
+        new (&ring[i]) Slot();
+    }
+    return ring;
+#endif
+}
+
+void put32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+    p[2] = static_cast<uint8_t>(v >> 16);
+    p[3] = static_cast<uint8_t>(v >> 24);
+}
+
+// Copy one slot if it still holds ticket t; the sequence is checked on both
+// sides of the copy so a record overwritten meanwhile is never emitted torn
+bool readSlot(const Slot& slot, uint32_t t, uint8_t* out) {
+    if (slot.sequence.load(std::memory_order_acquire) != t + 1) {
+        return false;
+    }
+    TraceRecord copy = slot.record;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.sequence.load(std::memory_order_relaxed) != t + 1) {
+        return false;
+    }
+    put32(out, t + 1);
+    std::memcpy(out + 4, &copy, sizeof(copy));  // Little endian on the ESP32, as the format
+    return true;
+}
+
+// Header plus the newest maxRecords records, oldest first. Records lost to
+// writers during the dump are emitted with sequence 0 so the count holds.
+size_t dumpRecords(ModbusTrace::DumpWriter writer, void* context, size_t maxRecords) {
+    Slot* ring = slots.load(std::memory_order_acquire);
+    const uint32_t end = head.load(std::memory_order_acquire);
+    uint32_t available = end - origin.load(std::memory_order_relaxed);
+    uint32_t overwritten = 0;
+    if (ring && available > mask + 1) {
+        overwritten = available - (mask + 1);
+        available = mask + 1;
+    }
+    if (!ring) {
+        available = 0;
+    }
+    if (available > maxRecords) {
+        overwritten += available - static_cast<uint32_t>(maxRecords);
+        available = static_cast<uint32_t>(maxRecords);
+    }
+
+    uint8_t header[ModbusTrace::HEADER_SIZE] = {'M', 'B', 'T', 'R', ModbusTrace::FORMAT_VERSION,
+                                                ModbusTrace::DUMP_RECORD_SIZE, 0, 0};
+    put32(header + 8, available);
+    put32(header + 12, overwritten);
+    size_t written = writer(header, sizeof(header), context);
+    if (written != sizeof(header)) {
+        return written;
+    }
+
+    uint8_t out[ModbusTrace::DUMP_RECORD_SIZE];
+    for (uint32_t t = end - available; t != end; t++) {
+        if (!readSlot(ring[t & mask], t, out)) {
+            std::memset(out, 0, sizeof(out));
+        }
+        const size_t n = writer(out, sizeof(out), context);
+        written += n;
+        if (n != sizeof(out)) {
+            break;
+        }
+    }
+    return written;
+}
+
+struct BufferSink {
+    uint8_t* out;
+    size_t capacity;
+    size_t used;
+};
+
+size_t writeToBuffer(const uint8_t* data, size_t length, void* context) {
+    BufferSink& sink = *static_cast<BufferSink*>(context);
+    if (sink.capacity - sink.used < length) {
+        return 0;
+    }
+    std::memcpy(sink.out + sink.used, data, length);
+    sink.used += length;
+    return length;
+}
+
+} // namespace
+
+ModbusResult<void> ModbusTrace::begin(size_t records) {
+    if (slots.load(std::memory_order_acquire)) {
+        paused.store(false, std::memory_order_relaxed);
+        return ModbusResult<void>::ok();
+    }
+#ifdef MODBUSDEVICE_STATIC_ALLOCATION
+    records = MODBUS_TRACE_RECORDS;
+#else
+    size_t size = 16;
+    while (size * 2 <= records) {
+        size *= 2;
+    }
+    records = size;
+#endif
+
+    Slot* ring = allocate(records);
+    if (!ring) {
+        MODBUSD_LOG_E("Failed to allocate trace ring of %d records", records);
+        return ModbusResult<void>::error(ModbusError::RESOURCE_CREATION_FAILED);
+    }
+    mask = static_cast<uint32_t>(records - 1);
+    origin.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    paused.store(false, std::memory_order_relaxed);
+    slots.store(ring, std::memory_order_release);
+    return ModbusResult<void>::ok();
+}
+
+void ModbusTrace::record(const TraceRecord& record) noexcept {
+    Slot* ring = slots.load(std::memory_order_acquire);
+    if (!ring || paused.load(std::memory_order_relaxed)) {
+        return;
+    }
+    const uint32_t t = head.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[t & mask];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = record;
+    slot.sequence.store(t + 1, std::memory_order_release);
+}
+
+void ModbusTrace::setPaused(bool value) noexcept {
+    paused.store(value, std::memory_order_relaxed);
+}
+
+void ModbusTrace::clear() noexcept {
+    origin.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t ModbusTrace::dump(uint8_t* out, size_t capacity) {
+    if (!out || capacity < HEADER_SIZE) {
+        return 0;
+    }
+    BufferSink sink{out, capacity, 0};
+    dumpRecords(writeToBuffer, &sink, (capacity - HEADER_SIZE) / DUMP_RECORD_SIZE);
+    return sink.used;
+}
+
+size_t ModbusTrace::dump(DumpWriter writer, void* context) {
+    if (!writer) {
+        return 0;
+    }
+    return dumpRecords(writer, context, SIZE_MAX);
+}
+
+size_t ModbusTrace::getRecordCount() noexcept {
+    if (!slots.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    const uint32_t written = getWrittenCount();
+    return written > mask + 1 ? mask + 1 : written;
+}
+
+size_t ModbusTrace::getCapacity() noexcept {
+    return slots.load(std::memory_order_acquire) ? mask + 1 : 0;
+}
+
+uint32_t ModbusTrace::getWrittenCount() noexcept {
+    return head.load(std::memory_order_relaxed) - origin.load(std::memory_order_relaxed);
+}
+
+#else  // !MODBUSDEVICE_TRACE
+
+ModbusResult<void> ModbusTrace::begin(size_t) {
+    return ModbusResult<void>::error(ModbusError::NOT_SUPPORTED);
+}
+
+void ModbusTrace::record(const TraceRecord&) noexcept {}
+void ModbusTrace::setPaused(bool) noexcept {}
+void ModbusTrace::clear() noexcept {}
+size_t ModbusTrace::dump(uint8_t*, size_t) { return 0; }
+size_t ModbusTrace::dump(DumpWriter, void*) { return 0; }
+size_t ModbusTrace::getRecordCount() noexcept { return 0; }
+size_t ModbusTrace::getCapacity() noexcept { return 0; }
+uint32_t ModbusTrace::getWrittenCount() noexcept { return 0; }
+
+#endif // MODBUSDEVICE_TRACE
+
+} // namespace modbus
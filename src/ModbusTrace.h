@@ -0,0 +1,200 @@
+/*
+ * ModbusTrace.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef MODBUSTRACE_H
+#define MODBUSTRACE_H
+
+/**
+ * @file ModbusTrace.h
+ * @brief Binary ring of per-transaction bus records for offline profiling
+ *
+ * Recording only happens when the library is built with
+ * -DMODBUSDEVICE_TRACE; without it the hooks are compiled out, begin()
+ * returns NOT_SUPPORTED and dumps are empty. tools/modbus_trace.py turns
+ * a dump into Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+ */
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "ModbusTypes.h"
+
+// Records in the ring (power of two); 28 bytes each, in RAM and in a dump
+#ifndef MODBUS_TRACE_RECORDS
+#define MODBUS_TRACE_RECORDS 1024
+#endif
+
+namespace modbus {
+
+/**
+ * @enum TraceKind
+ * @brief Which path issued a traced transaction
+ */
+enum class TraceKind : uint8_t {
+    SYNC = 0,    ///< ModbusDevice blocking call (transactLocked())
+    ASYNC,       ///< *Async() request, recorded at completion or expiry
+    SCHEDULED,   ///< BusScheduler job
+    BROADCAST,   ///< ModbusBus::broadcastWrite(), no reply
+    GROUP,       ///< One device of ModbusBus::writeGroup()
+    PROBE        ///< ModbusBusScanner presence probe
+};
+
+/**
+ * @struct TraceRecord
+ * @brief One transaction as stored in the ring (24 bytes, little endian in dumps)
+ */
+struct TraceRecord {
+    uint32_t timestampUs = 0;   ///< esp_timer_get_time() when the request went to the RTU (low 32 bits)
+    uint32_t mutexWaitUs = 0;   ///< Bus arbitration wait before the request, 0 if not measured
+    uint32_t roundTripUs = 0;   ///< Request queued until response, error or timeout
+    uint16_t address = 0;
+    uint16_t count = 0;
+    uint8_t busId = 0;
+    uint8_t slave = 0;
+    uint8_t functionCode = 0;
+    uint8_t outcome = 0;        ///< ModbusError value, 0 = success
+    uint8_t priority = 0;       ///< esp32Modbus::ModbusPriority
+    uint8_t kind = 0;           ///< TraceKind
+    uint16_t reserved = 0;
+};
+
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord layout is part of the dump format");
+
+/**
+ * @class ModbusTrace
+ * @brief Lock-free, bus-wide trace ring
+ *
+ * record() claims a slot with one atomic increment and publishes it with
+ * a per-slot sequence number, so concurrent writers never block and a
+ * reader skips slots that were being overwritten while it copied them.
+ * When the ring is full the oldest records are overwritten.
+ *
+ * The ring is allocated by begin(), in PSRAM when the heap has it and in
+ * internal RAM otherwise; with -DMODBUSDEVICE_STATIC_ALLOCATION it is a
+ * MODBUS_TRACE_RECORDS array placed in external BSS where the build
+ * allows it. It stays allocated until reboot.
+ *
+ * Dump format (all little endian):
+ *
+ *   header  "MBTR", u8 version (1), u8 record size (28), u16 reserved,
+ *           u32 records in the dump, u32 records overwritten before it
+ *   record  u32 sequence, then TraceRecord
+ *
+ * @code
+ * ModbusTrace::begin();
+ * // ... run the workload ...
+ * ModbusTrace::setPaused(true);
+ * ModbusTrace::dump([](const uint8_t* data, size_t length, void*) {
+ *     return Serial.write(data, length);
+ * }, nullptr);
+ * @endcode
+ */
+class ModbusTrace {
+public:
+    static constexpr uint8_t FORMAT_VERSION = 1;
+    static constexpr size_t HEADER_SIZE = 16;
+    static constexpr size_t DUMP_RECORD_SIZE = 4 + sizeof(TraceRecord);
+
+    /// Dump sink; returns the bytes it accepted (fewer ends the dump)
+    using DumpWriter = size_t (*)(const uint8_t* data, size_t length, void* context);
+
+    /**
+     * @brief Allocate the ring and start recording
+     * @param records Ring size, rounded down to a power of two (min 16);
+     *        ignored in static builds, which always use MODBUS_TRACE_RECORDS
+     * @return NOT_SUPPORTED when compiled out, RESOURCE_CREATION_FAILED without memory.
+     *         Calling it again keeps the existing ring.
+     */
+    static ModbusResult<void> begin(size_t records = MODBUS_TRACE_RECORDS);
+
+    /**
+     * @brief Append one record (called from the transaction paths)
+     */
+    static void record(const TraceRecord& record) noexcept;
+
+    /**
+     * @brief Stop (or resume) recording, e.g. to freeze the ring around an anomaly
+     */
+    static void setPaused(bool paused) noexcept;
+
+    /**
+     * @brief Drop all records
+     */
+    static void clear() noexcept;
+
+    /**
+     * @brief Write the ring, oldest record first, to a buffer
+     * @return Bytes written; the records that fit after the header
+     */
+    static size_t dump(uint8_t* out, size_t capacity);
+
+    /**
+     * @brief Stream the ring through a writer without a dump-sized buffer
+     * @return Bytes accepted by the writer
+     */
+    static size_t dump(DumpWriter writer, void* context);
+
+    /**
+     * @brief Records currently held (at most getCapacity())
+     */
+    static size_t getRecordCount() noexcept;
+
+    static size_t getCapacity() noexcept;
+
+    /**
+     * @brief Records written since begin() or clear(), including overwritten ones
+     */
+    static uint32_t getWrittenCount() noexcept;
+
+    static constexpr bool isEnabled() {
+#ifdef MODBUSDEVICE_TRACE
+        return true;
+#else
+        return false;
+#endif
+    }
+};
+
+/**
+ * @brief Fill and append one record; the hook used by the transaction paths
+ */
+inline void traceTransaction(TraceKind kind, uint8_t busId, uint8_t slave, uint8_t functionCode,
+                             uint16_t address, uint16_t count, ModbusError outcome, uint8_t priority,
+                             int64_t sentUs, uint32_t mutexWaitUs, uint32_t roundTripUs) noexcept {
+    TraceRecord record;
+    record.timestampUs = static_cast<uint32_t>(sentUs);
+    record.mutexWaitUs = mutexWaitUs;
+    record.roundTripUs = roundTripUs;
+    record.address = address;
+    record.count = count;
+    record.busId = busId;
+    record.slave = slave;
+    record.functionCode = functionCode;
+    record.outcome = static_cast<uint8_t>(outcome);
+    record.priority = priority;
+    record.kind = static_cast<uint8_t>(kind);
+    ModbusTrace::record(record);
+}
+
+} // namespace modbus
+
+#endif // MODBUSTRACE_H
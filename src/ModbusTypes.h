@@ -47,6 +47,12 @@
 #define MODBUS_MAX_REGISTER_COUNT 125   // Max registers per read (FC 0x03/0x04)
 #endif
 
+// Max unused registers a coalesced block read may bridge between two wanted ones.
+// 0 = only merge contiguous registers (safe for devices that reject holes).
+#ifndef MODBUS_READ_MAX_GAP
+#define MODBUS_READ_MAX_GAP 0
+#endif
+
 #ifndef MODBUS_MAX_WRITE_REGISTER_COUNT
 #define MODBUS_MAX_WRITE_REGISTER_COUNT 123  // Max registers per write (FC 0x10)
 #endif
@@ -82,6 +88,37 @@
 #define MODBUS_INTER_FRAME_DELAY_MS ((38500UL / MODBUS_BAUD_RATE) + 1)
 #endif
 
+// Same 3.5 character gap in microseconds, without the tick safety margin.
+// Used where the gap is timed with esp_timer instead of vTaskDelay.
+#ifndef MODBUS_INTER_FRAME_DELAY_US
+#define MODBUS_INTER_FRAME_DELAY_US (38500000UL / MODBUS_BAUD_RATE)
+#endif
+
+// Async requests one device can have in flight (see ModbusDevice::*Async)
+#ifndef MODBUS_ASYNC_MAX_PENDING
+#define MODBUS_ASYNC_MAX_PENDING 4
+#endif
+
+// Requests one device can have queued in the RTU across all paths: the
+// async ones, a sync or worker request, and late frames of expired ones
+#ifndef MODBUS_DEVICE_MAX_OUTSTANDING
+#define MODBUS_DEVICE_MAX_OUTSTANDING (MODBUS_ASYNC_MAX_PENDING + 4)
+#endif
+
+#ifndef MODBUS_ASYNC_TIMEOUT_MS
+#define MODBUS_ASYNC_TIMEOUT_MS 1000  // Default async request deadline
+#endif
+
+// Coils and registers each that one device can stage (see ModbusDevice::stageCoil)
+#ifndef MODBUS_WRITE_BUFFER_ENTRIES
+#define MODBUS_WRITE_BUFFER_ENTRIES 32
+#endif
+
+// Readers that can join one in-flight register read (see ModbusDevice::setReadDeduplication)
+#ifndef MODBUS_READ_DEDUP_WAITERS
+#define MODBUS_READ_DEDUP_WAITERS 4
+#endif
+
 namespace modbus {
 
 /**
@@ -141,10 +178,9 @@ struct ModbusPacket {
     
     /**
      * @brief Default constructor
+     * @note data is left uninitialized; only the first `length` bytes are valid
      */
-    ModbusPacket() : functionCode(0), address(0), length(0), timestamp(0) {
-        memset(data, 0, sizeof(data));
-    }
+    ModbusPacket() : functionCode(0), address(0), length(0), timestamp(0) {}
     
     /**
      * @brief Check if packet is valid
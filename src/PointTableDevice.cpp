@@ -0,0 +1,329 @@
+/*
+ * PointTableDevice.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include "PointTableDevice.h"
+#include "ModbusDeviceLogging.h"
+
+namespace modbus {
+
+PointTableDevice::PointTableDevice(uint8_t serverAddr, const PointDef* points, size_t pointCount,
+                                   uint16_t maxGap)
+    : ModbusDevice(serverAddr), points(points), pointCount(points ? pointCount : 0), maxGap(maxGap) {
+}
+
+PointTableDevice::~PointTableDevice() {
+    releaseBudget();
+}
+
+void PointTableDevice::releaseBudget() {
+    for (PollGroup& group : groups) {
+        if (pollBudget && group.budgetId != ModbusPollBudget::NO_POLLER) {
+            pollBudget->removePoller(group.budgetId);
+        }
+        group.budgetId = ModbusPollBudget::NO_POLLER;
+    }
+}
+
+bool PointTableDevice::initialize() {
+    MODBUSD_LOG_I("Initializing PointTableDevice at address %d", getServerAddress());
+
+    setInitPhase(InitPhase::CONFIGURING);
+
+    if (registerDevice() != ModbusError::SUCCESS) {
+        MODBUSD_LOG_E("Failed to register device");
+        setInitPhase(InitPhase::ERROR);
+        return false;
+    }
+
+    for (size_t i = 0; i < pointCount; i++) {
+        const PointDef& p = points[i];
+        if ((p.functionCode != 0x03 && p.functionCode != 0x04) ||
+            static_cast<uint32_t>(p.address) + pointWidth(p.type) > 0x10000) {
+            MODBUSD_LOG_E("Point %d (%s): invalid FC %02X / address 0x%04X",
+                          i, p.name, p.functionCode, p.address);
+            setInitPhase(InitPhase::ERROR);
+            return false;
+        }
+    }
+
+    // One group per distinct period, in table order
+    releaseBudget();
+    groups.clear();
+    pointGroup.assign(pointCount, 0);
+    for (size_t i = 0; i < pointCount; i++) {
+        size_t g = 0;
+        while (g < groups.size() && groups[g].periodMs != points[i].periodMs) g++;
+        if (g == groups.size()) {
+            if (groups.size() == 255) {
+                MODBUSD_LOG_E("Too many distinct poll periods");
+                setInitPhase(InitPhase::ERROR);
+                return false;
+            }
+            PollGroup group;
+            group.periodMs = points[i].periodMs;
+            groups.push_back(group);
+        }
+        pointGroup[i] = static_cast<uint8_t>(g);
+    }
+
+    // Plan each group on its own so slow points never ride along fast reads
+    ModbusReadPlanner planner(maxGap);
+    std::vector<ReadItem> items;
+    std::vector<uint16_t> members;
+    blocks.clear();
+    blockPoints.clear();
+
+    for (size_t g = 0; g < groups.size(); g++) {
+        items.clear();
+        members.clear();
+        for (size_t i = 0; i < pointCount; i++) {
+            if (pointGroup[i] != g) continue;
+            ReadItem item;
+            item.functionCode = points[i].functionCode;
+            item.address = points[i].address;
+            item.width = pointWidth(points[i].type);
+            items.push_back(item);
+            members.push_back(static_cast<uint16_t>(i));
+        }
+        planner.plan(items.data(), items.size());
+
+        groups[g].firstBlock = static_cast<uint16_t>(blocks.size());
+        groups[g].blockCount = static_cast<uint16_t>(planner.blocks().size());
+        uint16_t base = static_cast<uint16_t>(blockPoints.size());
+        for (uint16_t index : planner.order()) {
+            blockPoints.push_back(members[index]);
+        }
+        for (ReadBlock block : planner.blocks()) {
+            block.firstItem += base;
+            blocks.push_back(block);
+        }
+    }
+
+    if (pollBudget) {
+        const uint32_t baud = getBus().getBaudRate();
+        for (PollGroup& group : groups) {
+            if (group.periodMs == 0) {
+                continue;  // Polled on every update(); nothing to stretch
+            }
+            uint32_t costUs = 0;
+            for (uint16_t b = 0; b < group.blockCount; b++) {
+                const ReadBlock& block = blocks[group.firstBlock + b];
+                costUs += ModbusPollBudget::estimateTransactionUs(block.functionCode, block.count, baud);
+            }
+            auto id = pollBudget->addPoller(costUs, group.periodMs);
+            if (id.isOk()) {
+                group.budgetId = id.value();
+            } else {
+                MODBUSD_LOG_W("Poll budget full; group %dms keeps its fixed period", group.periodMs);
+            }
+        }
+    }
+
+    values.assign(pointCount, 0.0f);
+    rawValues.assign(pointCount, 0);
+
+    setInitPhase(InitPhase::READY);
+    MODBUSD_LOG_I("Point table: %d points, %d groups, %d requests",
+                  pointCount, groups.size(), blocks.size());
+    return true;
+}
+
+ModbusResult<void> PointTableDevice::update() {
+    if (getInitPhase() != InitPhase::READY) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    ModbusResult<void> result = ModbusResult<void>::ok();
+    TickType_t now = xTaskGetTickCount();
+    for (PollGroup& group : groups) {
+        // Signed difference keeps the comparison valid across tick wrap
+        if (group.attempted && static_cast<int32_t>(now - group.nextDue) < 0) {
+            continue;
+        }
+        auto groupResult = pollGroup(group);
+        if (!groupResult.isOk()) {
+            result = groupResult;
+        }
+    }
+    return result;
+}
+
+ModbusResult<void> PointTableDevice::updateAll() {
+    if (getInitPhase() != InitPhase::READY) {
+        return ModbusResult<void>::error(ModbusError::NOT_INITIALIZED);
+    }
+
+    ModbusResult<void> result = ModbusResult<void>::ok();
+    for (PollGroup& group : groups) {
+        auto groupResult = pollGroup(group);
+        if (!groupResult.isOk()) {
+            result = groupResult;
+        }
+    }
+    return result;
+}
+
+ModbusResult<void> PointTableDevice::pollGroup(PollGroup& group) {
+    // Reschedule from the start of the poll, also on failure, so a dead
+    // device is retried at the group rate rather than on every update()
+    uint32_t periodMs = group.periodMs;
+    if (pollBudget && group.budgetId != ModbusPollBudget::NO_POLLER) {
+        periodMs = pollBudget->getPeriodMs(group.budgetId);
+    }
+    group.nextDue = xTaskGetTickCount() + pdMS_TO_TICKS(periodMs);
+    group.attempted = true;
+
+    bool changed = false;
+    uint16_t regs[MODBUS_MAX_REGISTER_COUNT];
+    for (uint16_t b = 0; b < group.blockCount; b++) {
+        const ReadBlock& block = blocks[group.firstBlock + b];
+        auto result = (block.functionCode == 0x04)
+            ? readInputRegisters(block.address, block.count, regs, MODBUS_MAX_REGISTER_COUNT)
+            : readHoldingRegisters(block.address, block.count, regs, MODBUS_MAX_REGISTER_COUNT);
+        if (!result.isOk()) {
+            MODBUSD_LOG_E("Failed to read %d registers at address 0x%04X (FC%02X)",
+                          block.count, block.address, block.functionCode);
+            return ModbusResult<void>::error(result.error());
+        }
+        changed |= decodeBlock(block, regs, result.value());
+    }
+
+    if (pollBudget && group.budgetId != ModbusPollBudget::NO_POLLER) {
+        // The first read always counts as a change
+        pollBudget->reportPoll(group.budgetId, changed || group.lastUpdate == 0);
+    }
+
+    group.lastUpdate = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    if (group.lastUpdate == 0) {
+        group.lastUpdate = 1;  // 0 means never read
+    }
+    lastUpdateTime = group.lastUpdate;
+    return ModbusResult<void>::ok();
+}
+
+bool PointTableDevice::decodeBlock(const ReadBlock& block, const uint16_t* regs, size_t decoded) {
+    bool changed = false;
+    for (uint16_t i = 0; i < block.itemCount; i++) {
+        uint16_t index = blockPoints[block.firstItem + i];
+        const PointDef& p = points[index];
+        size_t offset = p.address - block.address;
+        if (offset + pointWidth(p.type) > decoded) {
+            continue;  // Short response; keep the previous value
+        }
+
+        const int32_t previous = rawValues[index];
+        uint32_t word = 0;
+        if (pointWidth(p.type) == 2) {
+            word = combineWords(regs[offset], regs[offset + 1], p.wordOrder);
+        }
+
+        switch (p.type) {
+            case PointType::U16:
+                rawValues[index] = regs[offset];
+                values[index] = static_cast<float>(regs[offset]) * p.scale;
+                break;
+            case PointType::I16:
+                rawValues[index] = static_cast<int16_t>(regs[offset]);
+                values[index] = static_cast<float>(rawValues[index]) * p.scale;
+                break;
+            case PointType::U32:
+                rawValues[index] = static_cast<int32_t>(word);
+                values[index] = static_cast<float>(word) * p.scale;
+                break;
+            case PointType::I32:
+                rawValues[index] = static_cast<int32_t>(word);
+                values[index] = static_cast<float>(rawValues[index]) * p.scale;
+                break;
+            case PointType::FLOAT32: {
+                values[index] = wordToFloat(word) * p.scale;
+                rawValues[index] = static_cast<int32_t>(word);  // Bit pattern
+                break;
+            }
+        }
+        changed |= rawValues[index] != previous;
+        publishValue(index, values[index]);
+    }
+    return changed;
+}
+
+bool PointTableDevice::hasValidData() const {
+    if (getInitPhase() != InitPhase::READY || groups.empty()) {
+        return false;
+    }
+    for (const PollGroup& group : groups) {
+        if (group.lastUpdate == 0) return false;
+    }
+    return true;
+}
+
+uint32_t PointTableDevice::getDataAge() const {
+    if (lastUpdateTime == 0) return UINT32_MAX;
+    return xTaskGetTickCount() * portTICK_PERIOD_MS - lastUpdateTime;
+}
+
+uint32_t PointTableDevice::getTimeUntilDueMs() const {
+    TickType_t now = xTaskGetTickCount();
+    uint32_t soonest = UINT32_MAX;
+    for (const PollGroup& group : groups) {
+        // Like update(): a failed first poll waits out the period too
+        int32_t remaining = static_cast<int32_t>(group.nextDue - now);
+        if (!group.attempted || remaining <= 0) {
+            return 0;
+        }
+        uint32_t ms = static_cast<uint32_t>(remaining) * portTICK_PERIOD_MS;
+        if (ms < soonest) soonest = ms;
+    }
+    return soonest;
+}
+
+const char* PointTableDevice::getChannelName(size_t channel) const {
+    return (channel < pointCount && points[channel].name) ? points[channel].name : "";
+}
+
+const char* PointTableDevice::getChannelUnits(size_t channel) const {
+    return (channel < pointCount && points[channel].units) ? points[channel].units : "";
+}
+
+ModbusResult<float> PointTableDevice::getFloat(size_t channel) const {
+    if (channel >= values.size()) {
+        return ModbusResult<float>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (groups[pointGroup[channel]].lastUpdate == 0) {
+        return ModbusResult<float>::error(ModbusError::NOT_INITIALIZED);
+    }
+    return ModbusResult<float>::ok(values[channel]);
+}
+
+ModbusResult<int32_t> PointTableDevice::getRawValue(size_t channel) const {
+    if (channel >= rawValues.size()) {
+        return ModbusResult<int32_t>::error(ModbusError::INVALID_PARAMETER);
+    }
+    if (groups[pointGroup[channel]].lastUpdate == 0) {
+        return ModbusResult<int32_t>::error(ModbusError::NOT_INITIALIZED);
+    }
+    return ModbusResult<int32_t>::ok(rawValues[channel]);
+}
+
+float PointTableDevice::getScaleFactor(size_t channel) const {
+    return (channel < pointCount) ? points[channel].scale : 1.0f;
+}
+
+} // namespace modbus
@@ -0,0 +1,176 @@
+/*
+ * PointTableDevice.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef POINTTABLEDEVICE_H
+#define POINTTABLEDEVICE_H
+
+#include "ModbusDevice.h"
+#include "IModbusInput.h"
+#include "ModbusReadPlanner.h"
+#include "ModbusRegisterMap.h"
+#include "ModbusPollBudget.h"
+#include <vector>
+
+namespace modbus {
+
+/**
+ * @class PointTableDevice
+ * @brief Polls a device described by a point table
+ *
+ * Points with the same poll period form a group; each group is planned
+ * into FC03/FC04 block reads with ModbusReadPlanner (32-bit points occupy
+ * two registers) and read only when its period has elapsed, so fast and
+ * slow points no longer share one poll rate. Decoded values land in a flat
+ * array indexed by point number, which is the channel index of the
+ * IModbusAnalogInput interface.
+ *
+ * The table is referenced, not copied, and must outlive the device
+ * (typically a static const array). Planning allocates once in
+ * initialize(); update() does not allocate.
+ *
+ * @code
+ * static const PointDef meterPoints[] = {
+ *     // name      units  FC    address type               word order            scale  period ms
+ *     {"voltage",   "V",   0x04, 0x0000, PointType::FLOAT32, WordOrder::HIGH_FIRST, 1.0f, 1000},
+ *     {"current",   "A",   0x04, 0x0006, PointType::FLOAT32, WordOrder::HIGH_FIRST, 1.0f, 1000},
+ *     {"energy",    "kWh", 0x04, 0x0156, PointType::U32,     WordOrder::HIGH_FIRST, 0.01f, 60000},
+ * };
+ *
+ * PointTableDevice meter(0x02, meterPoints, 3);
+ * meter.initialize();
+ * for (;;) {
+ *     meter.update();                              // Reads only the due groups
+ *     auto v = meter.getFloat(0);
+ *     vTaskDelay(pdMS_TO_TICKS(meter.getTimeUntilDueMs()));
+ * }
+ * @endcode
+ */
+class PointTableDevice : public ModbusDevice, public IModbusAnalogInput {
+public:
+    /**
+     * @brief Constructor
+     * @param serverAddr Modbus server address
+     * @param points Point table (must outlive the device)
+     * @param pointCount Number of entries in points
+     * @param maxGap Maximum unused registers bridged inside one block read
+     */
+    PointTableDevice(uint8_t serverAddr, const PointDef* points, size_t pointCount,
+                     uint16_t maxGap = MODBUS_READ_MAX_GAP);
+    ~PointTableDevice() override;
+
+    /**
+     * @brief Let a bus budget stretch the group periods under load
+     *
+     * Set before initialize(). Each group becomes one poller with its
+     * period as the minimum and MODBUS_BUDGET_MAX_STRETCH x period as the
+     * maximum; groups whose values stop changing are slowed first.
+     * The budget must outlive the device.
+     */
+    void setPollBudget(ModbusPollBudget* budget) { pollBudget = budget; }
+
+    /**
+     * @brief Validate the table, plan the group reads and register the device
+     * @return true if initialization successful
+     */
+    bool initialize();
+
+    /**
+     * @brief Read every group whose period has elapsed
+     * @return Error of the last failed block, or success
+     */
+    ModbusResult<void> update() override;
+
+    /**
+     * @brief Read all groups regardless of their period
+     */
+    ModbusResult<void> updateAll();
+
+    // IModbusInput implementation
+    bool hasValidData() const override;
+    uint32_t getLastUpdateTime() const override { return lastUpdateTime; }
+    uint32_t getDataAge() const override;
+    size_t getChannelCount() const override { return pointCount; }
+    const char* getChannelName(size_t channel) const override;
+    const char* getChannelUnits(size_t channel) const override;
+
+    // IModbusAnalogInput implementation
+    ModbusResult<float> getFloat(size_t channel = 0) const override;
+    ModbusResult<int32_t> getRawValue(size_t channel = 0) const override;
+    float getScaleFactor(size_t channel = 0) const override;
+    bool getRange(size_t, float&, float&) const override { return false; }
+
+    /**
+     * @brief Flat array of scaled values, one per point (valid after initialize())
+     */
+    const float* getValues() const { return values.data(); }
+
+    /**
+     * @brief Milliseconds until the next group is due (0 = due now)
+     */
+    uint32_t getTimeUntilDueMs() const;
+
+    size_t getGroupCount() const { return groups.size(); }
+
+    /**
+     * @brief Total block requests of all groups
+     */
+    size_t getBlockCount() const { return blocks.size(); }
+
+protected:
+    /**
+     * @struct PollGroup
+     * @brief Points sharing one poll period
+     */
+    struct PollGroup {
+        uint32_t periodMs = 0;
+        TickType_t nextDue = 0;
+        uint32_t lastUpdate = 0;     ///< ms of last complete read, 0 = never
+        bool attempted = false;      ///< Polled at least once; nextDue is valid
+        uint16_t firstBlock = 0;     ///< Index into blocks
+        uint16_t blockCount = 0;
+        uint8_t budgetId = ModbusPollBudget::NO_POLLER;
+    };
+
+    ModbusResult<void> pollGroup(PollGroup& group);
+    bool decodeBlock(const ReadBlock& block, const uint16_t* regs, size_t decoded);
+    void releaseBudget();
+
+    const PointDef* points;
+    size_t pointCount;
+    uint16_t maxGap;
+
+    std::vector<PollGroup> groups;
+    std::vector<ReadBlock> blocks;          ///< All groups' blocks, group by group
+    std::vector<uint16_t> blockPoints;      ///< Point indices referenced by ReadBlock::firstItem
+    std::vector<uint8_t> pointGroup;        ///< Point index -> group index
+    std::vector<float> values;              ///< Point index -> scaled value
+    std::vector<int32_t> rawValues;         ///< Point index -> decoded integer
+    uint32_t lastUpdateTime = 0;
+    ModbusPollBudget* pollBudget = nullptr;
+
+private:
+    // Responses are consumed synchronously by the buffer read API
+    void handleModbusResponse(uint8_t, uint16_t, const uint8_t*, size_t) override {}
+};
+
+} // namespace modbus
+
+#endif // POINTTABLEDEVICE_H
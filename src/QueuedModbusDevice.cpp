@@ -20,6 +20,7 @@
  */
 
 #include "QueuedModbusDevice.h"
+#include "AsyncDispatcher.h"
 #include <cstring>
 
 namespace modbus {
@@ -33,10 +34,16 @@ QueuedModbusDevice::QueuedModbusDevice(uint8_t serverAddr)
 QueuedModbusDevice::~QueuedModbusDevice() {
     asyncMode = false;
 
+    if (AsyncDispatcher* owner = dispatcher.load()) {
+        owner->removeDevice(*this);
+    }
+
     if (queue) {
-        // Drain then delete
-        ModbusPacket packet;
-        while (xQueueReceive(queue, &packet, 0) == pdTRUE) {}
+        // Drain (returning pool blocks) then delete
+        PacketDescriptor packet;
+        while (xQueueReceive(queue, &packet, 0) == pdTRUE) {
+            ModbusPacketPool::release(packet.block);
+        }
         vQueueDelete(queue);
         queue = nullptr;
     }
@@ -52,7 +59,7 @@ bool QueuedModbusDevice::enableAsync(size_t queueDepth) {
     }
 
     // Create queue (persists until destructor)
-    queue = xQueueCreate(queueDepth, sizeof(ModbusPacket));
+    queue = createQueue(queueDepth, queueStorage);
     if (!queue) {
         MODBUSD_LOG_E("Failed to create queue with depth %d", queueDepth);
         return false;
@@ -69,9 +76,9 @@ void QueuedModbusDevice::disableAsync() {
 
     if (queue) {
         // Drain queue
-        ModbusPacket packet;
+        PacketDescriptor packet;
         while (xQueueReceive(queue, &packet, 0) == pdTRUE) {
-            // Discard packets
+            ModbusPacketPool::release(packet.block);
         }
         MODBUSD_LOG_I("Async mode disabled");
     }
@@ -85,16 +92,24 @@ size_t QueuedModbusDevice::getQueueDepth() const {
 
 // Process queue
 size_t QueuedModbusDevice::processQueue(size_t maxPackets) {
+    // Time out async requests whose response never arrived
+    expireAsyncRequests();
+
+    return deliverQueued(maxPackets);
+}
+
+size_t QueuedModbusDevice::deliverQueued(size_t maxPackets) {
     // Check asyncMode first - atomic read gates all queue usage
     if (!asyncMode || !queue) return 0;
 
     size_t processed = 0;
-    ModbusPacket packet;
+    PacketDescriptor packet;
 
     while (xQueueReceive(queue, &packet, 0) == pdTRUE) {
-        // Call virtual handler
+        // Call virtual handler straight on the pooled payload
         onAsyncResponse(packet.functionCode, packet.address,
-                       packet.data, packet.length);
+                        ModbusPacketPool::data(packet.block), packet.length);
+        ModbusPacketPool::release(packet.block);
 
         processed++;
 
@@ -116,20 +131,38 @@ void QueuedModbusDevice::handleModbusResponse(uint8_t functionCode, uint16_t add
         return;
     }
 
-    // Build packet (data is copied, not pointer-stored)
-    ModbusPacket packet;
+    // Descriptor only; the payload is copied once into a pool block
+    PacketDescriptor packet;
     packet.functionCode = functionCode;
     packet.address = address;
-    packet.length = (length > MODBUS_MAX_READ_SIZE) ? MODBUS_MAX_READ_SIZE : length;
+    packet.length = static_cast<uint8_t>((length > ModbusPacketPool::BLOCK_SIZE) ? ModbusPacketPool::BLOCK_SIZE : length);
     packet.timestamp = xTaskGetTickCount();
+    packet.block = ModbusPacketPool::NO_BLOCK;
 
     if (data && packet.length > 0) {
-        std::memcpy(packet.data, data, packet.length);
+        packet.block = ModbusPacketPool::acquire();
+        if (packet.block == ModbusPacketPool::NO_BLOCK) {
+            onQueueFull();
+            return;
+        }
+        std::memcpy(ModbusPacketPool::data(packet.block), data, packet.length);
+    } else {
+        packet.length = 0;
     }
 
     // Queue is never deleted during runtime, so this is safe
     if (xQueueSend(queue, &packet, 0) != pdTRUE) {
+        ModbusPacketPool::release(packet.block);
         onQueueFull();
+        return;
+    }
+    notifyDispatcher();
+}
+
+void QueuedModbusDevice::notifyDispatcher() {
+    AsyncDispatcher* owner = dispatcher.load(std::memory_order_acquire);
+    if (owner && !dispatchSignalled.exchange(true)) {
+        owner->signal(dispatchSlot);
     }
 }
 
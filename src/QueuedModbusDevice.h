@@ -24,11 +24,19 @@
 
 #include "ModbusDevice.h"
 #include "IModbusInput.h"
+#include "ModbusPacketPool.h"
 #include "freertos/queue.h"
 #include <atomic>
 
+// Deepest response queue enableAsync() can create in static-allocation builds
+#ifndef MODBUS_QUEUED_MAX_DEPTH
+#define MODBUS_QUEUED_MAX_DEPTH 10
+#endif
+
 namespace modbus {
 
+class AsyncDispatcher;
+
 /**
  * @class QueuedModbusDevice
  * @brief Asynchronous Modbus device with optional queuing
@@ -58,7 +66,13 @@ public:
     
     /**
      * @brief Enable asynchronous mode
-     * @param queueDepth Queue depth for async responses
+     *
+     * The queue only holds small descriptors; payloads are stored in the
+     * shared ModbusPacketPool (MODBUS_PACKET_POOL_BLOCKS blocks for all
+     * devices).
+     *
+     * @param queueDepth Queue depth for async responses (at most
+     *        MODBUS_QUEUED_MAX_DEPTH with MODBUSDEVICE_STATIC_ALLOCATION)
      * @return true if successful
      */
     bool enableAsync(size_t queueDepth = 10);
@@ -82,21 +96,29 @@ public:
     
     /**
      * @brief Process queued packets
+     *
+     * Not needed for devices added to an AsyncDispatcher, which delivers
+     * their packets on its own task.
      * @param maxPackets Maximum packets to process (0 = all)
      * @return Number of packets processed
      */
     size_t processQueue(size_t maxPackets = 0);
+
+    /**
+     * @brief Dispatcher serving this device's queue, nullptr if none
+     */
+    AsyncDispatcher* getDispatcher() const { return dispatcher.load(); }
     
 protected:
     /**
-     * @brief Modbus packet structure for queuing
+     * @brief Queue entry; the payload lives in a ModbusPacketPool block
      */
-    struct ModbusPacket {
-        uint8_t functionCode;
-        uint16_t address;
-        uint8_t data[MODBUS_MAX_READ_SIZE];
-        size_t length;
+    struct PacketDescriptor {
         TickType_t timestamp;
+        uint16_t address;
+        uint8_t functionCode;
+        uint8_t length;
+        uint8_t block;      ///< ModbusPacketPool index, NO_BLOCK for empty payloads
     };
     
     /**
@@ -111,8 +133,8 @@ protected:
      * @brief Process async response packet
      * 
      * Called when packet is dequeued. Override in derived classes.
-     * 
-     * @param packet The packet to process
+     * `data` points into a shared pool block that is returned to the pool
+     * as soon as this call returns; copy anything needed later.
      */
     virtual void onAsyncResponse(uint8_t functionCode, uint16_t address,
                                 const uint8_t* data, size_t length) = 0;
@@ -128,8 +150,24 @@ protected:
     
 private:
     QueueHandle_t queue = nullptr;
+    QueueStorage<MODBUS_QUEUED_MAX_DEPTH, sizeof(PacketDescriptor)> queueStorage;
     std::atomic<bool> asyncMode{false};
 
+    friend class AsyncDispatcher;
+    std::atomic<AsyncDispatcher*> dispatcher{nullptr};
+    uint8_t dispatchSlot = 0;
+    std::atomic<bool> dispatchSignalled{false};  ///< Slot is in the dispatcher's ready queue
+
+    /**
+     * @brief Deliver up to maxPackets (0 = all) queued packets to onAsyncResponse()
+     */
+    size_t deliverQueued(size_t maxPackets);
+
+    /**
+     * @brief Queue this device's slot with its dispatcher unless already queued
+     */
+    void notifyDispatcher();
+
     // Prevent copying
     QueuedModbusDevice(const QueuedModbusDevice&) = delete;
     QueuedModbusDevice& operator=(const QueuedModbusDevice&) = delete;
@@ -139,7 +177,9 @@ private:
  * @class QueuedModbusInputDevice
  * @brief Async Modbus device implementing IModbusInput
  * 
- * Convenience class for sensor devices that need async operation
+ * Convenience class for sensor devices that need async operation.
+ * Call publishValue() from onAsyncResponse() for each decoded channel so
+ * subscribers (IModbusAnalogInput::subscribe()) see the new data.
  */
 class QueuedModbusInputDevice : public QueuedModbusDevice, public IModbusAnalogInput {
 public:
@@ -0,0 +1,160 @@
+/*
+ * SensorGroup.cpp - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+
+#include "SensorGroup.h"
+#include "ModbusDeviceLogging.h"
+#include <esp_timer.h>
+
+static_assert(MODBUS_SENSOR_GROUP_MAX <= 24, "event groups provide 24 bits");
+
+namespace modbus {
+
+namespace {
+
+uint32_t elapsedMsSince(int64_t startUs) {
+    return static_cast<uint32_t>((esp_timer_get_time() - startUs) / 1000);
+}
+
+} // namespace
+
+SensorGroup::SensorGroup() {
+    events = createEventGroup(eventStorage);
+    if (!events) {
+        MODBUSD_LOG_E("Failed to create sensor group event group");
+    }
+}
+
+SensorGroup::~SensorGroup() {
+    for (auto& m : members) {
+        if (m.sensor && m.evented) {
+            m.sensor->setDataReadyEvent(nullptr, 0);
+        }
+    }
+    if (events) {
+        vEventGroupDelete(events);
+    }
+}
+
+ModbusResult<uint8_t> SensorGroup::add(ISensorInstance& sensor) {
+    int freeSlot = -1;
+    for (size_t i = 0; i < MODBUS_SENSOR_GROUP_MAX; i++) {
+        if (members[i].sensor == &sensor) {
+            return ModbusResult<uint8_t>::error(ModbusError::INVALID_PARAMETER);
+        }
+        if (!members[i].sensor && freeSlot < 0) {
+            freeSlot = static_cast<int>(i);
+        }
+    }
+    if (freeSlot < 0) {
+        return ModbusResult<uint8_t>::error(ModbusError::QUEUE_FULL);
+    }
+
+    Member& m = members[freeSlot];
+    m.sensor = &sensor;
+    m.evented = events && sensor.setDataReadyEvent(events, EventBits_t(1) << freeSlot);
+    sensorCount++;
+    return ModbusResult<uint8_t>::ok(static_cast<uint8_t>(freeSlot));
+}
+
+bool SensorGroup::remove(ISensorInstance& sensor) {
+    for (auto& m : members) {
+        if (m.sensor != &sensor) continue;
+        if (m.evented) {
+            sensor.setDataReadyEvent(nullptr, 0);
+        }
+        m = Member{};
+        sensorCount--;
+        return true;
+    }
+    return false;
+}
+
+ModbusResult<SensorGroup::CycleResult> SensorGroup::acquire(uint32_t deadlineMs) {
+    if (!events) {
+        return ModbusResult<CycleResult>::error(ModbusError::RESOURCE_ERROR);
+    }
+
+    const int64_t startUs = esp_timer_get_time();
+    CycleResult cycle;
+    uint32_t eventedMask = 0;
+
+    // Clear before requesting: a sensor may complete inside requestData()
+    xEventGroupClearBits(events, (EventBits_t(1) << MODBUS_SENSOR_GROUP_MAX) - 1);
+
+    for (size_t i = 0; i < MODBUS_SENSOR_GROUP_MAX; i++) {
+        Member& m = members[i];
+        if (!m.sensor || !m.sensor->isInitialized()) continue;
+        const uint32_t bit = 1UL << i;
+        if (!m.sensor->requestData()) {
+            cycle.failed |= bit;
+            continue;
+        }
+        cycle.requested |= bit;
+        if (m.evented) eventedMask |= bit;
+    }
+
+    // Sensors without an event wait in turn; completions of the others latch meanwhile
+    for (size_t i = 0; i < MODBUS_SENSOR_GROUP_MAX; i++) {
+        const uint32_t bit = 1UL << i;
+        if (!(cycle.requested & bit) || (eventedMask & bit)) continue;
+        if (elapsedMsSince(startUs) >= deadlineMs || !members[i].sensor->waitForData()) {
+            cycle.timedOut |= bit;
+            continue;
+        }
+        members[i].sensor->processData();
+        cycle.completed |= bit;
+    }
+
+    if (eventedMask) {
+        // One wait covers every event-capable sensor
+        uint32_t elapsed = elapsedMsSince(startUs);
+        TickType_t ticks = elapsed < deadlineMs ? pdMS_TO_TICKS(deadlineMs - elapsed) : 0;
+        uint32_t ready = xEventGroupWaitBits(events, eventedMask, pdTRUE, pdTRUE, ticks) & eventedMask;
+
+        for (size_t i = 0; i < MODBUS_SENSOR_GROUP_MAX; i++) {
+            const uint32_t bit = 1UL << i;
+            if (!(eventedMask & bit)) continue;
+            if (!(ready & bit)) {
+                cycle.timedOut |= bit;
+            } else if (!members[i].sensor->waitForData()) {
+                // Signalled, so waitForData() returns at once: false means the request failed
+                cycle.failed |= bit;
+            } else {
+                members[i].sensor->processData();
+                cycle.completed |= bit;
+            }
+        }
+    }
+
+    cycle.elapsedMs = elapsedMsSince(startUs);
+    if (cycle.timedOut) {
+        MODBUSD_LOG_W("Sensor group cycle: %u of %u sensors timed out after %lu ms",
+                      static_cast<unsigned>(__builtin_popcount(cycle.timedOut)),
+                      static_cast<unsigned>(__builtin_popcount(cycle.requested)),
+                      static_cast<unsigned long>(cycle.elapsedMs));
+    }
+    lastCycle = cycle;
+    return ModbusResult<CycleResult>::ok(cycle);
+}
+
+} // namespace modbus
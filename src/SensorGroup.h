@@ -0,0 +1,136 @@
+/*
+ * SensorGroup.h - part of the ESP32-ModbusDevice library
+ *
+ * Copyright (C) 2025-2026 packerlschupfer
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef SENSORGROUP_H
+#define SENSORGROUP_H
+
+/**
+ * @file SensorGroup.h
+ * @brief Pipelined acquisition cycle over many ISensorInstance objects
+ *
+ * A sensor task that walks N sensors with requestData(), waitForData(),
+ * processData() pays N full round trips back to back. SensorGroup issues
+ * every request first, waits once for all of them against a single cycle
+ * deadline, then processes whatever arrived. Sensors that implement
+ * ISensorInstance::setDataReadyEvent() are waited for through one event
+ * group; the others fall back to their own waitForData().
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "ISensorInstance.h"
+#include "ModbusTypes.h"
+#include "ModbusStaticAlloc.h"
+
+// Sensors one group can hold (one event group bit each; FreeRTOS provides 24)
+#ifndef MODBUS_SENSOR_GROUP_MAX
+#define MODBUS_SENSOR_GROUP_MAX 24
+#endif
+
+// Default deadline for one acquisition cycle
+#ifndef MODBUS_SENSOR_GROUP_DEADLINE_MS
+#define MODBUS_SENSOR_GROUP_DEADLINE_MS 1000
+#endif
+
+namespace modbus {
+
+/**
+ * @class SensorGroup
+ * @brief Runs one request/wait/process cycle across a set of sensors
+ *
+ * Bit i of every mask in CycleResult refers to the sensor added in slot i
+ * (the value returned by add()). Not thread-safe: a group belongs to the
+ * one task that calls acquire().
+ *
+ * @code
+ * static modbus::SensorGroup sensors;
+ * sensors.add(boilerTemp);
+ * sensors.add(roomTemp);
+ * for (;;) {
+ *     auto cycle = sensors.acquire(500);
+ *     vTaskDelay(pdMS_TO_TICKS(1000));
+ * }
+ * @endcode
+ */
+class SensorGroup {
+public:
+    struct CycleResult {
+        uint32_t requested = 0;   ///< requestData() accepted
+        uint32_t completed = 0;   ///< Data waited for and processed
+        uint32_t failed = 0;      ///< requestData() or waitForData() reported failure
+        uint32_t timedOut = 0;    ///< No completion before the deadline
+        uint32_t elapsedMs = 0;   ///< Duration of the whole cycle
+    };
+
+    SensorGroup();
+    ~SensorGroup();
+
+    SensorGroup(const SensorGroup&) = delete;
+    SensorGroup& operator=(const SensorGroup&) = delete;
+
+    /**
+     * @brief Add a sensor to the cycle
+     * @return Slot index; QUEUE_FULL when the group is full,
+     *         INVALID_PARAMETER if the sensor is already a member
+     */
+    ModbusResult<uint8_t> add(ISensorInstance& sensor);
+
+    /**
+     * @brief Remove a sensor and detach it from the group's event bits
+     * @return false if the sensor is not a member
+     */
+    bool remove(ISensorInstance& sensor);
+
+    /**
+     * @brief Request, wait for and process every initialized sensor once
+     *
+     * Uninitialized sensors are skipped. Sensors without event support are
+     * waited for first, each through its own waitForData() (which keeps its
+     * own timeout, and is skipped once @p deadlineMs has passed); the
+     * event-capable ones then share what is left of the deadline.
+     *
+     * @return Per-sensor outcome masks; RESOURCE_ERROR if the event group
+     *         could not be created
+     */
+    ModbusResult<CycleResult> acquire(uint32_t deadlineMs = MODBUS_SENSOR_GROUP_DEADLINE_MS);
+
+    const CycleResult& getLastCycle() const { return lastCycle; }
+    size_t getSensorCount() const { return sensorCount; }
+
+private:
+    struct Member {
+        ISensorInstance* sensor = nullptr;
+        bool evented = false;   ///< Completion is signalled through the event group
+    };
+
+    Member members[MODBUS_SENSOR_GROUP_MAX];
+    size_t sensorCount = 0;
+    CycleResult lastCycle;
+    EventGroupHandle_t events = nullptr;
+    EventGroupStorage eventStorage;
+};
+
+} // namespace modbus
+
+#endif // SENSORGROUP_H
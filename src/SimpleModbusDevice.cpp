@@ -148,12 +148,20 @@ bool SimpleModbusDevice::getRange(size_t channel, float& min, float& max) const
 }
 
 // Add channel
-void SimpleModbusDevice::addChannel(const std::string& name, const std::string& units, uint16_t address) {
+void SimpleModbusDevice::addChannel(const std::string& name, const std::string& units, uint16_t address,
+                                    uint8_t functionCode) {
+    if (functionCode != 0x03 && functionCode != 0x04) {
+        MODBUSD_LOG_W("Channel %s: unsupported FC %02X, using FC03", name.c_str(), functionCode);
+        functionCode = 0x03;
+    }
+
     ChannelInfo info;
     info.name = name;
     info.units = units;
     info.address = address;
+    info.functionCode = functionCode;
     channels.push_back(info);
+    readPlanDirty = true;
 }
 
 // Set channel range
@@ -164,18 +172,60 @@ void SimpleModbusDevice::setChannelRange(size_t channel, float min, float max) {
     }
 }
 
+// Set maximum register gap for coalesced reads
+void SimpleModbusDevice::setMaxReadGap(uint16_t gap) {
+    readPlanner.setMaxGap(gap);
+    readPlanDirty = true;
+}
+
+// Get (and rebuild if needed) the block read plan
+const ModbusReadPlanner& SimpleModbusDevice::getReadPlan() {
+    if (readPlanDirty || plannedChannels != channels.size()) {
+        std::vector<ReadItem> items(channels.size());
+        for (size_t i = 0; i < channels.size(); i++) {
+            items[i].functionCode = channels[i].functionCode;
+            items[i].address = channels[i].address;
+            items[i].width = 1;
+        }
+        readPlanner.plan(items.data(), items.size());
+        readPlanDirty = false;
+        plannedChannels = channels.size();
+
+        MODBUSD_LOG_D("Read plan: %d channels in %d requests (%d registers)",
+                      channels.size(), readPlanner.blocks().size(), readPlanner.getRegisterCount());
+    }
+    return readPlanner;
+}
+
 // Read channel data (default implementation)
 bool SimpleModbusDevice::readChannelData() {
-    // Default implementation reads each channel individually
-    for (size_t i = 0; i < channels.size(); i++) {
-        auto result = readHoldingRegisters(channels[i].address, 1);
+    if (values.size() != channels.size()) {
+        values.resize(channels.size(), 0);
+    }
+
+    const ModbusReadPlanner& plan = getReadPlan();
+    const auto& order = plan.order();
+    uint16_t regs[MODBUS_MAX_REGISTER_COUNT];
+
+    for (const ReadBlock& block : plan.blocks()) {
+        auto result = (block.functionCode == 0x04)
+            ? readInputRegisters(block.address, block.count, regs, MODBUS_MAX_REGISTER_COUNT)
+            : readHoldingRegisters(block.address, block.count, regs, MODBUS_MAX_REGISTER_COUNT);
         if (!result.isOk()) {
-            MODBUSD_LOG_E("Failed to read channel %d at address 0x%04X", i, channels[i].address);
+            MODBUSD_LOG_E("Failed to read %d registers at address 0x%04X (FC%02X)",
+                          block.count, block.address, block.functionCode);
             return false;
         }
-        
-        if (!result.value().empty()) {
-            values[i] = static_cast<int32_t>(result.value()[0]);
+
+        // Scatter the block back into the channels it serves
+        size_t decoded = result.value();
+        for (uint16_t i = 0; i < block.itemCount; i++) {
+            uint16_t channel = order[block.firstItem + i];
+            size_t offset = channels[channel].address - block.address;
+            if (offset < decoded) {
+                values[channel] = static_cast<int32_t>(regs[offset]);
+                publishValue(channel, static_cast<float>(values[channel]) * getScaleFactor(channel));
+            }
         }
     }
     
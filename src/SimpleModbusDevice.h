@@ -24,6 +24,8 @@
 
 #include "ModbusDevice.h"
 #include "IModbusInput.h"
+#include "ModbusReadPlanner.h"
+#include <limits>
 #include <map>
 #include <string>
 
@@ -88,7 +90,7 @@ public:
     // IModbusAnalogInput implementation
     ModbusResult<float> getFloat(size_t channel = 0) const override;
     ModbusResult<int32_t> getRawValue(size_t channel = 0) const override;
-    float getScaleFactor(size_t channel = 0) const override { return 1.0f; }
+    float getScaleFactor([[maybe_unused]] size_t channel = 0) const override { return 1.0f; }
     bool getRange(size_t channel, float& min, float& max) const override;
     
 protected:
@@ -99,6 +101,7 @@ protected:
         std::string name;
         std::string units;
         uint16_t address;
+        uint8_t functionCode = 0x03;  ///< 0x03 (holding) or 0x04 (input register)
         float minValue = -std::numeric_limits<float>::max();
         float maxValue = std::numeric_limits<float>::max();
     };
@@ -108,8 +111,10 @@ protected:
      * @param name Channel name
      * @param units Channel units
      * @param address Modbus register address
+     * @param functionCode Read function code, 0x03 (holding) or 0x04 (input)
      */
-    void addChannel(const std::string& name, const std::string& units, uint16_t address);
+    void addChannel(const std::string& name, const std::string& units, uint16_t address,
+                    uint8_t functionCode = 0x03);
     
     /**
      * @brief Set channel range
@@ -118,6 +123,17 @@ protected:
      * @param max Maximum valid value
      */
     void setChannelRange(size_t channel, float min, float max);
+
+    /**
+     * @brief Set the maximum register gap bridged by coalesced reads
+     *
+     * The default readChannelData() merges channels at neighbouring addresses
+     * into block reads. A gap > 0 also merges channels separated by up to
+     * `gap` unused registers; only use this if the device allows reading them.
+     *
+     * @param gap Maximum unused registers inside one block read
+     */
+    void setMaxReadGap(uint16_t gap);
     
     /**
      * @brief Virtual method to configure device
@@ -128,20 +144,41 @@ protected:
     
     /**
      * @brief Virtual method to read all channel data
-     * Called by update() to refresh values
+     * Called by update() to refresh values. The default implementation
+     * sorts channels by address and reads them with as few FC03/FC04 block
+     * requests as possible, then scatters the registers back into values.
      * @return true if read successful
      */
     virtual bool readChannelData();
+
+    /**
+     * @brief Get the block read plan used by readChannelData()
+     * @return Planner (rebuilt when channels are added or removed)
+     */
+    const ModbusReadPlanner& getReadPlan();
+
+    /**
+     * @brief Rebuild the read plan before the next readChannelData()
+     *
+     * Needed only after changing the address or function code of an
+     * existing entry in `channels` directly.
+     */
+    void invalidateReadPlan() { readPlanDirty = true; }
     
-    // Data storage
+    // Data storage. Add channels with addChannel(); the plan also follows
+    // direct push_back()/erase(), but in-place edits need invalidateReadPlan().
     std::vector<ChannelInfo> channels;
     std::vector<int32_t> values;
     uint32_t lastUpdateTime = 0;
     
 private:
+    ModbusReadPlanner readPlanner;
+    bool readPlanDirty = true;
+    size_t plannedChannels = 0;    ///< channels.size() the plan was built for
+
     // Override base class handler to prevent warnings
-    void handleModbusResponse(uint8_t functionCode, uint16_t address,
-                            const uint8_t* data, size_t length) override {
+    void handleModbusResponse([[maybe_unused]] uint8_t functionCode, [[maybe_unused]] uint16_t address,
+                              [[maybe_unused]] const uint8_t* data, [[maybe_unused]] size_t length) override {
         // During normal operation, we use synchronous reads
         // Responses are handled internally by waitForResponse()
     }
@@ -0,0 +1,500 @@
+// Host-side throughput benchmark for ModbusDevice, SimpleModbusDevice and
+// QueuedModbusDevice against the simulated bus in stubs/esp32ModbusRTU.h.
+//
+// All times are virtual: the clock only moves with simulated wire time,
+// slave turnaround, inter-frame gaps and timeouts, so results are
+// deterministic and comparable between runs and machines.
+//
+//   make -C test bench
+//   ./test/bench/modbus_bench [--baud N] [--slaves N] [--iterations N]
+//                             [--latency US] [--jitter US] [--crc RATE]
+//                             [--trace FILE]   (needs -DMODBUSDEVICE_TRACE, see make bench-trace)
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "AsyncDispatcher.h"
+#include "ModbusBusScanner.h"
+#include "ModbusDevice.h"
+#include "ModbusInitOrchestrator.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusRegistry.h"
+#include "ModbusTrace.h"
+#include "QueuedModbusDevice.h"
+#include "SimpleModbusDevice.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+// ===== Heap accounting =====
+
+static std::atomic<bool> countAllocations{false};
+static std::atomic<size_t> allocationCount{0};
+
+// Every replaceable form goes through allocate()/release(), so each new
+// pairs with the matching delete (plain, sized, array, aligned, nothrow).
+// Out of line: inlined into a delete expression, GCC flags the free() of a
+// pointer it saw come from operator new.
+[[gnu::noinline]] static void* allocate(size_t size, size_t alignment) noexcept {
+    if (countAllocations.load(std::memory_order_relaxed)) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (size == 0) size = 1;
+    if (alignment <= alignof(std::max_align_t)) {
+        return std::malloc(size);
+    }
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+[[gnu::noinline]] static void release(void* p) noexcept { std::free(p); }
+
+static void* allocateOrThrow(size_t size, size_t alignment) {
+    void* p = allocate(size, alignment);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size, 0); }
+void* operator new[](size_t size) { return allocateOrThrow(size, 0); }
+void* operator new(size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return allocateOrThrow(size, static_cast<size_t>(al)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size, 0); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(al));
+}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return allocate(size, static_cast<size_t>(al));
+}
+
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { release(p); }
+
+// ===== Options =====
+
+struct Options {
+    uint32_t baud = 0;          // 0 = run 9600 and 115200
+    unsigned slaves = 4;
+    unsigned iterations = 500;
+    uint32_t latencyUs = 2000;
+    uint32_t jitterUs = 500;
+    double crcErrorRate = 0.0;
+    const char* traceFile = nullptr;
+};
+
+static bool parseOptions(int argc, char** argv, Options& opt) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!value) {
+            std::fprintf(stderr, "missing value for %s\n", arg);
+            return false;
+        }
+        if (!std::strcmp(arg, "--baud")) opt.baud = std::strtoul(value, nullptr, 10);
+        else if (!std::strcmp(arg, "--slaves")) opt.slaves = std::strtoul(value, nullptr, 10);
+        else if (!std::strcmp(arg, "--iterations")) opt.iterations = std::strtoul(value, nullptr, 10);
+        else if (!std::strcmp(arg, "--latency")) opt.latencyUs = std::strtoul(value, nullptr, 10);
+        else if (!std::strcmp(arg, "--jitter")) opt.jitterUs = std::strtoul(value, nullptr, 10);
+        else if (!std::strcmp(arg, "--crc")) opt.crcErrorRate = std::strtod(value, nullptr);
+        else if (!std::strcmp(arg, "--trace")) opt.traceFile = value;
+        else {
+            std::fprintf(stderr, "unknown option %s\n", arg);
+            return false;
+        }
+        i++;
+    }
+    if (opt.slaves == 0 || opt.slaves > 32 || opt.iterations == 0) {
+        std::fprintf(stderr, "--slaves must be 1..32, --iterations > 0\n");
+        return false;
+    }
+    return true;
+}
+
+// ===== Devices under test =====
+
+class BenchDevice : public ModbusDevice {
+public:
+    explicit BenchDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~BenchDevice() override { (void)unregisterDevice(); }
+};
+
+class BenchSimpleDevice : public SimpleModbusDevice {
+public:
+    explicit BenchSimpleDevice(uint8_t addr) : SimpleModbusDevice(addr) {}
+    ~BenchSimpleDevice() override { (void)unregisterDevice(); }
+
+protected:
+    bool configure() override {
+        // Two contiguous runs: one FC03 block and one FC04 block per update
+        for (uint16_t i = 0; i < 6; i++) addChannel("h", "", 0x0010 + i, 0x03);
+        for (uint16_t i = 0; i < 4; i++) addChannel("i", "", 0x0040 + i, 0x04);
+        return true;
+    }
+};
+
+class BenchQueuedDevice : public QueuedModbusDevice {
+public:
+    explicit BenchQueuedDevice(uint8_t addr) : QueuedModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~BenchQueuedDevice() override { (void)unregisterDevice(); }
+
+    bool trigger() { return sendRequest(0x03, 0x0010, 8) == ESP_OK; }
+
+    size_t responses = 0;
+    size_t overflows = 0;
+
+protected:
+    void onAsyncResponse(uint8_t, uint16_t, const uint8_t*, size_t) override { responses++; }
+    void onQueueFull() override { overflows++; }
+};
+
+struct AsyncCheck {
+    bool done = false;
+    bool ok = false;
+};
+
+static void asyncChecked(ModbusDevice&, const ModbusDevice::AsyncResult& result) {
+    auto* check = static_cast<AsyncCheck*>(result.context);
+    check->done = true;
+    check->ok = result.error == ModbusError::SUCCESS && result.length == 2u * result.count;
+}
+
+// ===== Measurement =====
+
+struct Run {
+    explicit Run(const char* runName) : name(runName) {}
+
+    const char* name;
+    size_t transactions = 0;
+    size_t failures = 0;
+    int64_t elapsedUs = 0;
+    uint64_t wireUs = 0;
+    size_t allocations = 0;
+    std::vector<int64_t> latencies;
+};
+
+static esp32ModbusRTU* bus = nullptr;
+
+static void beginRun(Run& run, size_t expected) {
+    run.latencies.clear();
+    run.latencies.reserve(expected);
+    bus->resetCounters();
+    allocationCount = 0;
+    countAllocations = true;
+}
+
+static void endRun(Run& run, int64_t startUs) {
+    countAllocations = false;
+    run.allocations = allocationCount;
+    run.elapsedUs = sim::nowUs() - startUs;
+    run.wireUs = bus->getWireTimeUs();
+}
+
+static void report(const Run& run) {
+    std::vector<int64_t> sorted = run.latencies;
+    std::sort(sorted.begin(), sorted.end());
+    int64_t p50 = sorted.empty() ? 0 : sorted[sorted.size() / 2];
+    int64_t p99 = sorted.empty() ? 0 : sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+    double seconds = run.elapsedUs / 1e6;
+    double tps = seconds > 0 ? run.transactions / seconds : 0.0;
+    double utilization = run.elapsedUs > 0 ? 100.0 * run.wireUs / run.elapsedUs : 0.0;
+    double allocsPerTx = run.transactions ? static_cast<double>(run.allocations) / run.transactions : 0.0;
+
+    std::printf("  %-30s %7.1f tx/s  bus %5.1f%%  p50 %6lld us  p99 %6lld us  %5.2f allocs/tx  %zu failed\n",
+                run.name, tps, utilization, static_cast<long long>(p50),
+                static_cast<long long>(p99), allocsPerTx, run.failures);
+}
+
+template<typename Fn>
+static void measure(Run& run, size_t iterations, Fn&& transaction) {
+    beginRun(run, iterations);
+    int64_t start = sim::nowUs();
+    for (size_t i = 0; i < iterations; i++) {
+        int64_t t0 = sim::nowUs();
+        if (!transaction(i)) run.failures++;
+        run.latencies.push_back(sim::nowUs() - t0);
+        run.transactions++;
+    }
+    endRun(run, start);
+    report(run);
+}
+
+static void runSuite(const Options& opt, uint32_t baud, ModbusRegistry::InterFrameTiming timing) {
+    auto& registry = ModbusRegistry::getInstance();
+    bus->setBaudRate(baud);
+    registry.setBaudRate(baud);
+    registry.setInterFrameTiming(timing);
+
+    std::printf("\n%u baud, %s inter-frame timing, %u slaves\n", baud,
+                timing == ModbusRegistry::InterFrameTiming::PRECISE ? "precise" : "tick",
+                opt.slaves);
+
+    std::vector<BenchDevice*> devices;
+    for (unsigned s = 0; s < opt.slaves; s++) devices.push_back(new BenchDevice(1 + s));
+
+    uint16_t regs[16];
+    {
+        Run run("ModbusDevice FC03 x8 buffer");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->readHoldingRegisters(0x0010, 8, regs, 16).isOk();
+        });
+    }
+    {
+        Run run("ModbusDevice FC03 x8 vector");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->readHoldingRegisters(0x0010, 8).isOk();
+        });
+    }
+    {
+        Run run("ModbusDevice FC06 write");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->writeSingleRegister(0x0020, static_cast<uint16_t>(i)).isOk();
+        });
+    }
+
+    {
+        // writeMultipleRegisters/Coils take vectors; build them outside the loop
+        std::vector<uint16_t> block(16, 0x1234);
+        Run run("ModbusDevice FC10 x16 write");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->writeMultipleRegisters(0x0020, block).isOk();
+        });
+    }
+    {
+        std::vector<bool> coils(40, true);
+        Run run("ModbusDevice FC0F x40 write");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->writeMultipleCoils(0x0000, coils).isOk();
+        });
+    }
+
+    {
+        // One "transaction" = the same FC05 write to every slave
+        Run run("FC05 bank, one by one");
+        measure(run, opt.iterations, [&](size_t i) {
+            bool ok = true;
+            for (auto* d : devices) ok = d->writeSingleCoil(0x0000, (i & 1) != 0).isOk() && ok;
+            return ok;
+        });
+    }
+    {
+        std::vector<ModbusDevice*> bank(devices.begin(), devices.end());
+        Run run("FC05 bank, writeGroup");
+        measure(run, opt.iterations, [&](size_t i) {
+            const uint16_t on = i & 1;
+            return registry.getDefaultBus().writeGroup(bank.data(), bank.size(), 0x05, 0x0000, 1, &on).isOk();
+        });
+    }
+    {
+        Run run("FC05 bank, broadcast");
+        measure(run, opt.iterations, [&](size_t i) {
+            return registry.getDefaultBus().broadcastWriteCoil(0x0000, (i & 1) != 0).isOk();
+        });
+    }
+    {
+        // The simulated slaves act within their turnaround, so they need no 100 ms
+        const uint32_t turnaroundMs = (opt.latencyUs + opt.jitterUs + 999) / 1000;
+        Run run("  ... slave turnaround");
+        measure(run, opt.iterations, [&](size_t i) {
+            return registry.getDefaultBus().broadcastWriteCoil(0x0000, (i & 1) != 0, esp32Modbus::RELAY,
+                                                               turnaroundMs).isOk();
+        });
+    }
+
+    // One extra, unconfigured address: every poll of it times out
+    devices.push_back(new BenchDevice(1 + opt.slaves));
+    {
+        Run run("FC03 x8, 1 dead slave");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->readHoldingRegisters(0x0010, 8, regs, 16).isOk();
+        });
+    }
+    {
+        std::vector<ModbusLinkPolicy*> policies;
+        for (auto* d : devices) {
+            policies.push_back(new ModbusLinkPolicy());
+            d->setLinkPolicy(policies.back());
+        }
+        Run run("  ... with ModbusLinkPolicy");
+        measure(run, opt.iterations, [&](size_t i) {
+            return devices[i % devices.size()]->readHoldingRegisters(0x0010, 8, regs, 16).isOk();
+        });
+        {
+            // Slave 1 stops answering once its round-trip time is known: its
+            // timeouts cost the adaptive timeout, not the RTU default
+            esp32ModbusRTU::SlaveConfig gone;
+            gone.present = false;
+            bus->configureSlave(1, gone);
+            Run dropout("  ... slave 1 drops out");
+            measure(dropout, opt.iterations, [&](size_t i) {
+                return devices[i % devices.size()]->readHoldingRegisters(0x0010, 8, regs, 16).isOk();
+            });
+            esp32ModbusRTU::SlaveConfig back;
+            back.latencyUs = opt.latencyUs;
+            back.jitterUs = opt.jitterUs;
+            back.crcErrorRate = opt.crcErrorRate;
+            bus->configureSlave(1, back);
+        }
+        for (size_t i = 0; i < devices.size(); i++) {
+            devices[i]->setLinkPolicy(nullptr);
+            delete policies[i];
+        }
+    }
+    {
+        // One transaction = one address of a full 1-247 pass; empty ones cost the probe timeout
+        ModbusBusScanner scanner;
+        Run run("ModbusBusScanner 1-247 pass");
+        measure(run, MODBUS_MAX_SLAVE_ADDRESS, [&](size_t) {
+            return scanner.step(1).isOk();
+        });
+    }
+    {
+        // The RTU queues frames like its task does: each async read is still
+        // outstanding when the sync read to the same slave goes out behind it
+        bus->setQueued(true);
+        Run run("async + sync, queued RTU");
+        measure(run, opt.iterations, [&](size_t i) {
+            BenchDevice* d = devices[i % opt.slaves];
+            AsyncCheck check;
+            bool ok = d->readInputRegistersAsync(0x0010, 8, asyncChecked, &check).isOk();
+            ok = d->readHoldingRegisters(0x0010, 8, regs, 16).isOk() && ok;
+            for (int waited = 0; !check.done && waited < 1000; waited++) vTaskDelay(pdMS_TO_TICKS(1));
+            return ok && check.ok;
+        });
+        bus->setQueued(false);
+    }
+    {
+        // One transaction = bringing up every slave, the dead one included,
+        // with a probe and one configuration read each through the RTU queue
+        static const ModbusInitOrchestrator::InitStep steps[] = {
+            {0x03, 0x0000, 1},
+            {0x03, 0x0010, 8},
+        };
+        ModbusInitOrchestrator init;
+        for (auto* d : devices) (void)init.addDevice(*d, steps, 2);
+        bus->setQueued(true);
+        Run run("ModbusInitOrchestrator run");
+        measure(run, 20, [&](size_t) {
+            auto ready = init.run();
+            return ready.isOk() && ready.value() == opt.slaves;
+        });
+        bus->setQueued(false);
+    }
+    for (auto* d : devices) delete d;
+
+    std::vector<BenchSimpleDevice*> simple;
+    for (unsigned s = 0; s < opt.slaves; s++) {
+        simple.push_back(new BenchSimpleDevice(1 + s));
+        simple.back()->initialize();
+    }
+    {
+        // One update = two planned block reads
+        Run run("SimpleModbusDevice update");
+        measure(run, opt.iterations, [&](size_t i) {
+            return simple[i % simple.size()]->update().isOk();
+        });
+    }
+    for (auto* d : simple) delete d;
+
+    std::vector<BenchQueuedDevice*> queued;
+    for (unsigned s = 0; s < opt.slaves; s++) {
+        queued.push_back(new BenchQueuedDevice(1 + s));
+        queued.back()->enableAsync(8);
+    }
+    {
+        Run run("QueuedModbusDevice async+drain");
+        measure(run, opt.iterations, [&](size_t i) {
+            BenchQueuedDevice* d = queued[i % queued.size()];
+            bool sent = d->trigger();
+            return sent && d->processQueue() == 1;
+        });
+    }
+    {
+        // Same traffic delivered by one dispatcher instead of per-device polling
+        AsyncDispatcher dispatcher;
+        for (auto* d : queued) (void)dispatcher.addDevice(*d);
+        Run run("QueuedModbusDevice dispatcher");
+        measure(run, opt.iterations, [&](size_t i) {
+            bool sent = queued[i % queued.size()]->trigger();
+            return sent && dispatcher.dispatch(0) == 1;
+        });
+        for (auto* d : queued) dispatcher.removeDevice(*d);
+    }
+    for (auto* d : queued) delete d;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parseOptions(argc, argv, opt)) {
+        return 2;
+    }
+
+    static esp32ModbusRTU rtu;
+    bus = &rtu;
+    rtu.setSeed(42);
+    for (unsigned s = 0; s < opt.slaves; s++) {
+        esp32ModbusRTU::SlaveConfig cfg;
+        cfg.latencyUs = opt.latencyUs;
+        cfg.jitterUs = opt.jitterUs;
+        cfg.crcErrorRate = opt.crcErrorRate;
+        rtu.configureSlave(1 + s, cfg);
+    }
+    rtu.onData(mainHandleData);
+    rtu.onError(handleError);
+    ModbusRegistry::getInstance().setModbusRTU(&rtu);
+
+    if (opt.traceFile && !ModbusTrace::begin(1u << 16).isOk()) {
+        std::fprintf(stderr, "--trace needs a build with -DMODBUSDEVICE_TRACE (make bench-trace)\n");
+        return 2;
+    }
+
+    std::printf("slave turnaround %u us + 0..%u us jitter, CRC error rate %.3f, %u iterations\n",
+                opt.latencyUs, opt.jitterUs, opt.crcErrorRate, opt.iterations);
+
+    const uint32_t bauds[] = {9600, 115200};
+    for (uint32_t baud : bauds) {
+        if (opt.baud && opt.baud != baud) continue;
+        runSuite(opt, baud, ModbusRegistry::InterFrameTiming::TICK_DELAY);
+        runSuite(opt, baud, ModbusRegistry::InterFrameTiming::PRECISE);
+    }
+    if (opt.baud && opt.baud != 9600 && opt.baud != 115200) {
+        runSuite(opt, opt.baud, ModbusRegistry::InterFrameTiming::TICK_DELAY);
+        runSuite(opt, opt.baud, ModbusRegistry::InterFrameTiming::PRECISE);
+    }
+
+    if (opt.traceFile) {
+        FILE* f = std::fopen(opt.traceFile, "wb");
+        if (!f) {
+            std::perror(opt.traceFile);
+            return 1;
+        }
+        size_t bytes = ModbusTrace::dump([](const uint8_t* data, size_t length, void* context) {
+            return std::fwrite(data, 1, length, static_cast<FILE*>(context));
+        }, f);
+        std::fclose(f);
+        std::printf("trace: %zu of %u records, %zu bytes -> %s\n", ModbusTrace::getRecordCount(),
+                    ModbusTrace::getWrittenCount(), bytes, opt.traceFile);
+    }
+    return 0;
+}
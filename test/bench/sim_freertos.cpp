@@ -0,0 +1,409 @@
+// Virtual-clock implementations of the FreeRTOS / esp_timer / Arduino stubs.
+
+#include "stubs/freertos/FreeRTOS.h"
+#include "stubs/freertos/semphr.h"
+#include "stubs/freertos/task.h"
+#include "stubs/freertos/queue.h"
+#include "stubs/freertos/event_groups.h"
+#include "stubs/esp_timer.h"
+#include "stubs/Arduino.h"
+#include "stubs/sim_clock.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <ucontext.h>
+#include <vector>
+
+namespace sim {
+
+static int64_t timeUs = 0;
+static PendingFn pending = nullptr;
+
+int64_t nowUs() { return timeUs; }
+void advanceUs(int64_t us) { if (us > 0) timeUs += us; }
+void reset() { timeUs = 0; }
+void setPending(PendingFn fn) { pending = fn; }
+bool runPending(int64_t untilUs) { return pending && pending(untilUs); }
+
+} // namespace sim
+
+namespace {
+
+struct Semaphore {
+    UBaseType_t count;
+    UBaseType_t max;
+    bool heap;
+};
+
+struct Queue {
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t* storage;
+    bool heap;
+};
+
+static_assert(sizeof(Semaphore) <= sizeof(StaticSemaphore_t), "grow StaticSemaphore_t");
+static_assert(sizeof(Queue) <= sizeof(StaticQueue_t), "grow StaticQueue_t");
+
+struct EventGroup {
+    EventBits_t bits;
+    bool heap;
+};
+
+static_assert(sizeof(EventGroup) <= sizeof(StaticEventGroup_t), "grow StaticEventGroup_t");
+
+int64_t ticksToUs(TickType_t ticks) {
+    return static_cast<int64_t>(ticks) * 1000 * portTICK_PERIOD_MS;
+}
+
+// A cooperative task: the main thread, or one started by sim::spawn()
+struct Task {
+    ucontext_t context;
+    uint8_t* stack;
+    sim::TaskFn fn;
+    void* param;
+    bool done;
+    bool blocked;
+    bool timedOut;
+    int64_t deadline;
+    bool (*ready)(void*);
+    void* readyContext;
+    bool notifyPending;
+    uint32_t notifyValue;
+};
+
+constexpr size_t TASK_STACK_SIZE = 256 * 1024;
+
+Task mainTask{};
+std::vector<Task*> tasks{&mainTask};
+Task* current = &mainTask;
+
+void switchTo(Task* next) {
+    if (next == current) return;
+    Task* prev = current;
+    current = next;
+    swapcontext(&prev->context, &next->context);
+}
+
+// Runs the next task once the current one blocked or finished: first one
+// whose wait is satisfied (the current task last), else deferred work due
+// before the nearest timeout, else that timeout
+void schedule() {
+    for (;;) {
+        size_t self = 0;
+        while (tasks[self] != current) self++;
+        for (size_t i = 1; i <= tasks.size(); i++) {
+            Task* task = tasks[(self + i) % tasks.size()];
+            if (task->blocked && task->ready(task->readyContext)) {
+                task->blocked = false;
+                task->timedOut = false;
+                switchTo(task);
+                return;
+            }
+        }
+        Task* first = nullptr;
+        for (Task* task : tasks) {
+            if (task->blocked && (!first || task->deadline < first->deadline)) first = task;
+        }
+        if (sim::runPending(first->deadline)) continue;
+        if (first->deadline == INT64_MAX) {
+            // Nothing can ever wake anyone: the current wait gives up
+            first = current->blocked ? current : first;
+        } else {
+            sim::advanceUs(first->deadline - sim::nowUs());
+        }
+        first->blocked = false;
+        first->timedOut = true;
+        switchTo(first);
+        return;
+    }
+}
+
+void reapTasks() {
+    for (size_t i = 1; i < tasks.size();) {
+        if (tasks[i]->done && tasks[i] != current) {
+            delete[] tasks[i]->stack;
+            delete tasks[i];
+            tasks.erase(tasks.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            i++;
+        }
+    }
+}
+
+void taskEntry() {
+    current->fn(current->param);
+    current->done = true;
+    schedule();
+}
+
+// A wait runs deferred work and other tasks until ready() holds, otherwise
+// it times out. With no spawned task this is the plain single-thread loop.
+template <typename Ready>
+bool waitFor(TickType_t ticks, Ready ready) {
+    reapTasks();
+    Task* self = current;
+    self->deadline = (ticks == portMAX_DELAY) ? INT64_MAX : sim::nowUs() + ticksToUs(ticks);
+    self->ready = [](void* context) { return (*static_cast<Ready*>(context))(); };
+    self->readyContext = &ready;
+    self->blocked = true;
+    schedule();
+    return !self->timedOut;
+}
+
+Task* startTask(sim::TaskFn fn, void* param) {
+    reapTasks();
+    Task* task = new Task{};
+    task->stack = new uint8_t[TASK_STACK_SIZE];
+    task->fn = fn;
+    task->param = param;
+    getcontext(&task->context);
+    task->context.uc_stack.ss_sp = task->stack;
+    task->context.uc_stack.ss_size = TASK_STACK_SIZE;
+    task->context.uc_link = nullptr;
+    makecontext(&task->context, taskEntry, 0);
+    // Ready at once: it starts the next time the caller blocks
+    task->deadline = INT64_MAX;
+    task->ready = [](void*) { return true; };
+    task->blocked = true;
+    tasks.push_back(task);
+    return task;
+}
+
+} // namespace
+
+namespace sim {
+
+bool spawn(TaskFn fn, void* param) { return startTask(fn, param) != nullptr; }
+
+size_t liveTasks() {
+    size_t live = 0;
+    for (size_t i = 1; i < tasks.size(); i++) {
+        if (!tasks[i]->done) live++;
+    }
+    return live;
+}
+
+} // namespace sim
+
+// ===== Semaphores =====
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new Semaphore{1, 1, true}; }
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new Semaphore{0, 1, true}; }
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount) {
+    return new Semaphore{initialCount, maxCount, true};
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* storage) {
+    return new (storage) Semaphore{1, 1, false};
+}
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* storage) {
+    return new (storage) Semaphore{0, 1, false};
+}
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount,
+                                                 StaticSemaphore_t* storage) {
+    return new (storage) Semaphore{initialCount, maxCount, false};
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks) {
+    auto* sem = static_cast<Semaphore*>(handle);
+    if (!sem) return pdFALSE;
+    if (sem->count == 0 && !waitFor(ticks, [sem] { return sem->count > 0; })) {
+        return pdFALSE;
+    }
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    auto* sem = static_cast<Semaphore*>(handle);
+    if (!sem || sem->count >= sem->max) return pdFALSE;
+    sem->count++;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) {
+    auto* sem = static_cast<Semaphore*>(handle);
+    if (sem && sem->heap) delete sem;
+}
+
+// ===== Tasks =====
+
+TickType_t xTaskGetTickCount() {
+    return static_cast<TickType_t>(sim::nowUs() / (1000 * portTICK_PERIOD_MS));
+}
+
+void vTaskDelay(TickType_t ticks) { waitFor(ticks, [] { return false; }); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return current; }
+
+// Library tasks (BusScheduler's worker and the like) become cooperative tasks;
+// stack size, priority and core are ignored
+BaseType_t xTaskCreate(TaskFunction_t fn, const char*, uint32_t, void* param, UBaseType_t,
+                       TaskHandle_t* handle) {
+    Task* task = startTask(fn, param);
+    if (handle) *handle = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stack, void* param,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t) {
+    return xTaskCreate(fn, name, stack, param, priority, handle);
+}
+
+TaskHandle_t xTaskCreateStaticPinnedToCore(TaskFunction_t fn, const char*, uint32_t, void* param,
+                                           UBaseType_t, StackType_t*, StaticTask_t*, BaseType_t) {
+    return startTask(fn, param);
+}
+
+// Deleting the calling task ends it here; another one never runs again
+void vTaskDelete(TaskHandle_t handle) {
+    Task* task = handle ? static_cast<Task*>(handle) : current;
+    if (task == &mainTask) return;
+    task->done = true;
+    task->blocked = false;
+    if (task == current) schedule();
+}
+
+// A reaped task's handle no longer appears in the list
+eTaskState eTaskGetState(TaskHandle_t handle) {
+    for (Task* task : tasks) {
+        if (task != handle) continue;
+        if (task->done) return eDeleted;
+        if (task == current) return eRunning;
+        return task->blocked ? eBlocked : eReady;
+    }
+    return eDeleted;
+}
+
+// Each task has one notification slot; a null handle (a task that was never
+// created) addresses the main task's
+BaseType_t xTaskNotify(TaskHandle_t handle, uint32_t value, eNotifyAction action) {
+    Task* task = handle ? static_cast<Task*>(handle) : &mainTask;
+    if (action == eSetValueWithoutOverwrite && task->notifyPending) return pdFAIL;
+    if (action == eSetBits) task->notifyValue |= value;
+    else if (action == eIncrement) task->notifyValue++;
+    else if (action != eNoAction) task->notifyValue = value;
+    task->notifyPending = true;
+    return pdPASS;
+}
+
+BaseType_t xTaskNotifyWait(uint32_t clearOnEntry, uint32_t clearOnExit, uint32_t* value, TickType_t ticks) {
+    Task* task = current;
+    if (!task->notifyPending) {
+        task->notifyValue &= ~clearOnEntry;
+        if (!waitFor(ticks, [task] { return task->notifyPending; })) return pdFALSE;
+    }
+    if (value) *value = task->notifyValue;
+    task->notifyValue &= ~clearOnExit;
+    task->notifyPending = false;
+    return pdTRUE;
+}
+
+// ===== Queues =====
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    auto* queue = new Queue{length, itemSize, 0, 0, nullptr, true};
+    queue->storage = static_cast<uint8_t*>(std::malloc(static_cast<size_t>(length) * itemSize));
+    return queue;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t itemSize, uint8_t* items,
+                                 StaticQueue_t* storage) {
+    return new (storage) Queue{length, itemSize, 0, 0, items, false};
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t ticks) {
+    auto* queue = static_cast<Queue*>(handle);
+    if (!queue) return pdFALSE;
+    if (queue->count >= queue->length &&
+        !waitFor(ticks, [queue] { return queue->count < queue->length; })) {
+        return pdFALSE;
+    }
+    UBaseType_t tail = (queue->head + queue->count) % queue->length;
+    std::memcpy(queue->storage + tail * queue->itemSize, item, queue->itemSize);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t ticks) {
+    auto* queue = static_cast<Queue*>(handle);
+    if (!queue) return pdFALSE;
+    if (queue->count == 0 && !waitFor(ticks, [queue] { return queue->count > 0; })) return pdFALSE;
+    std::memcpy(item, queue->storage + queue->head * queue->itemSize, queue->itemSize);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    auto* queue = static_cast<Queue*>(handle);
+    return queue ? queue->count : 0;
+}
+
+void vQueueDelete(QueueHandle_t handle) {
+    auto* queue = static_cast<Queue*>(handle);
+    if (queue && queue->heap) {
+        std::free(queue->storage);
+        delete queue;
+    }
+}
+
+// ===== Event groups =====
+
+EventGroupHandle_t xEventGroupCreate() { return new EventGroup{0, true}; }
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t* storage) {
+    return storage ? new (storage->storage) EventGroup{0, false} : nullptr;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t handle, EventBits_t bits) {
+    auto* group = static_cast<EventGroup*>(handle);
+    return group ? (group->bits |= bits) : 0;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t handle, EventBits_t bits) {
+    auto* group = static_cast<EventGroup*>(handle);
+    if (!group) return 0;
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t handle) {
+    auto* group = static_cast<EventGroup*>(handle);
+    return group ? group->bits : 0;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t handle, EventBits_t bits, BaseType_t clear,
+                                BaseType_t waitAll, TickType_t ticks) {
+    auto* group = static_cast<EventGroup*>(handle);
+    if (!group) return 0;
+    auto satisfied = [=] {
+        return waitAll ? ((group->bits & bits) == bits) : ((group->bits & bits) != 0);
+    };
+    if (!satisfied() && !waitFor(ticks, satisfied)) {
+        return group->bits;
+    }
+    EventBits_t current = group->bits;
+    if (clear) group->bits &= ~bits;
+    return current;
+}
+
+void vEventGroupDelete(EventGroupHandle_t handle) {
+    auto* group = static_cast<EventGroup*>(handle);
+    if (group && group->heap) delete group;
+}
+
+// ===== esp_timer / Arduino =====
+
+int64_t esp_timer_get_time() {
+    sim::advanceUs(1);
+    return sim::nowUs();
+}
+
+uint32_t millis() { return static_cast<uint32_t>(sim::nowUs() / 1000); }
+uint32_t micros() { return static_cast<uint32_t>(sim::nowUs()); }
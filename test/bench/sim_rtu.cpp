@@ -0,0 +1,256 @@
+// Simulated RTU master + slaves (see stubs/esp32ModbusRTU.h)
+
+#include "stubs/esp32ModbusRTU.h"
+#include "stubs/sim_clock.h"
+#include <cstdint>
+
+esp32ModbusRTU::esp32ModbusRTU(uint32_t baud) : baud_(baud) {
+    for (int s = 0; s < 248; s++) {
+        slaves_[s].present = false;
+        for (int r = 0; r < SLAVE_REGISTERS; r++) {
+            registers_[s][r] = static_cast<uint16_t>((s << 8) | r);
+        }
+    }
+}
+
+void esp32ModbusRTU::configureSlave(uint8_t address, const SlaveConfig& config) {
+    if (address > 0 && address < 248) {
+        slaves_[address] = config;
+    }
+}
+
+uint32_t esp32ModbusRTU::nextRandom() {
+    // xorshift32: deterministic across runs for comparable numbers
+    rng_ ^= rng_ << 13;
+    rng_ ^= rng_ >> 17;
+    rng_ ^= rng_ << 5;
+    return rng_;
+}
+
+int64_t esp32ModbusRTU::frameUs(size_t bytes) const {
+    // 11 bits per character (start, 8 data, parity/stop, stop)
+    return static_cast<int64_t>(bytes) * 11 * 1000000 / baud_;
+}
+
+bool esp32ModbusRTU::answers(uint8_t slave) const {
+    return slave != 0 && slave < 248 && slaves_[slave].present;
+}
+
+int64_t esp32ModbusRTU::durationUs(const Request& request) const {
+    int64_t us = frameUs(request.requestBytes);
+    if (!answers(request.slave)) {
+        return us + static_cast<int64_t>(timeoutMs_) * 1000;
+    }
+    return us + request.turnaroundUs + frameUs(request.responseBytes);
+}
+
+bool esp32ModbusRTU::exchange(uint8_t slave, esp32Modbus::FunctionCode fc, uint16_t address,
+                              size_t requestBytes, size_t responseBytes,
+                              const uint8_t* payload, size_t payloadLength,
+                              esp32Modbus::ModbusPriority priority) {
+    Request request;
+    request.slave = slave;
+    request.priority = priority;
+    request.fc = fc;
+    request.address = address;
+    request.requestBytes = requestBytes;
+    request.responseBytes = responseBytes;
+    request.payloadLength = payloadLength < sizeof(request.payload) ? payloadLength : sizeof(request.payload);
+    for (size_t i = 0; i < request.payloadLength; i++) request.payload[i] = payload[i];
+    request.turnaroundUs = 0;
+    request.corrupt = false;
+    if (answers(slave)) {
+        const SlaveConfig& cfg = slaves_[slave];
+        request.turnaroundUs = cfg.latencyUs + (cfg.jitterUs ? nextRandom() % (cfg.jitterUs + 1) : 0);
+        request.corrupt = cfg.crcErrorRate > 0.0 && (nextRandom() / 4294967296.0) < cfg.crcErrorRate;
+    }
+
+    if (!queued_) {
+        sim::advanceUs(durationUs(request));
+        complete(request);
+        return true;
+    }
+
+    if (queueCount_ == QUEUE_DEPTH) {
+        return false;  // The RTU rejects requests when its queue is full
+    }
+    if (queueCount_ == 0) {
+        idleAtUs_ = sim::nowUs();  // The wire is free; the request goes out now
+    }
+    request.queuedUs = sim::nowUs();
+    queue_[queueCount_++] = request;
+    return true;
+}
+
+void esp32ModbusRTU::complete(const Request& request) {
+    if (frames_ < FRAME_LOG_DEPTH) frameLog_[frames_] = FrameRecord{request.fc, request.address};
+    frames_++;
+    wireTimeUs_ += frameUs(request.requestBytes);
+    if (!answers(request.slave)) {
+        errors_++;
+        if (onError_) onError_(request.slave, esp32Modbus::TIMEOUT);
+        return;
+    }
+    wireTimeUs_ += frameUs(request.responseBytes);
+    if (request.corrupt) {
+        errors_++;
+        if (onError_) onError_(request.slave, esp32Modbus::CRC_ERROR);
+        return;
+    }
+    if (onData_) onData_(request.slave, request.fc, request.address, request.payload, request.payloadLength);
+}
+
+esp32ModbusRTU* esp32ModbusRTU::queuedRtu_ = nullptr;
+
+esp32ModbusRTU::~esp32ModbusRTU() {
+    if (queuedRtu_ == this) {
+        queuedRtu_ = nullptr;
+        sim::setPending(nullptr);
+    }
+}
+
+void esp32ModbusRTU::setQueued(bool queued) {
+    if (queued) {
+        queuedRtu_ = this;
+        sim::setPending(&runQueued);
+    } else if (queuedRtu_ == this) {
+        while (runQueued(INT64_MAX)) {
+        }
+        queuedRtu_ = nullptr;
+        sim::setPending(nullptr);
+    }
+    queued_ = queued;
+}
+
+bool esp32ModbusRTU::runQueued(int64_t untilUs) {
+    esp32ModbusRTU* rtu = queuedRtu_;
+    if (!rtu || rtu->delivering_ || rtu->queueCount_ == 0) {
+        return false;
+    }
+    // A request that found the wire free went out at once. Otherwise, once
+    // the wire is free, the RTU sends the most urgent request queued by then
+    // (lowest ModbusPriority value), oldest first within a priority.
+    const bool idle = rtu->queue_[0].queuedUs >= rtu->idleAtUs_;
+    const int64_t start = idle ? rtu->queue_[0].queuedUs : rtu->idleAtUs_;
+    size_t next = 0;
+    for (size_t i = 1; !idle && i < rtu->queueCount_ && rtu->queue_[i].queuedUs <= start; i++) {
+        if (rtu->queue_[i].priority < rtu->queue_[next].priority) {
+            next = i;
+        }
+    }
+    const Request request = rtu->queue_[next];  // A handler may queue into its slot
+    const int64_t end = start + rtu->durationUs(request);
+    if (end > untilUs) {
+        return false;
+    }
+
+    for (size_t i = next + 1; i < rtu->queueCount_; i++) {
+        rtu->queue_[i - 1] = rtu->queue_[i];
+    }
+    rtu->queueCount_--;
+    rtu->idleAtUs_ = end;
+    sim::advanceUs(end - sim::nowUs());
+    // Handlers run on the RTU task; a wait inside them must not deliver the next frame
+    rtu->delivering_ = true;
+    rtu->complete(request);
+    rtu->delivering_ = false;
+    return true;
+}
+
+bool esp32ModbusRTU::readHoldingRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                                      esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 125) return false;
+    const uint16_t* regs = registers_[slave < 248 ? slave : 0];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t v = regs[(address + i) % SLAVE_REGISTERS];
+        response_[i * 2] = static_cast<uint8_t>(v >> 8);
+        response_[i * 2 + 1] = static_cast<uint8_t>(v & 0xFF);
+    }
+    return exchange(slave, esp32Modbus::READ_HOLD_REGISTER, address, 8, 5 + count * 2u,
+                    response_, count * 2u, priority);
+}
+
+bool esp32ModbusRTU::readInputRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                                    esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 125) return false;
+    const uint16_t* regs = registers_[slave < 248 ? slave : 0];
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t v = regs[(address + i) % SLAVE_REGISTERS] ^ 0x8000;
+        response_[i * 2] = static_cast<uint8_t>(v >> 8);
+        response_[i * 2 + 1] = static_cast<uint8_t>(v & 0xFF);
+    }
+    return exchange(slave, esp32Modbus::READ_INPUT_REGISTER, address, 8, 5 + count * 2u,
+                    response_, count * 2u, priority);
+}
+
+bool esp32ModbusRTU::readCoilsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                           esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 2000) return false;
+    size_t bytes = (count + 7) / 8;
+    const uint8_t* coils = coils_[slave < 248 ? slave : 0];
+    for (size_t i = 0; i < bytes; i++) response_[i] = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        uint16_t c = (address + i) % SLAVE_REGISTERS;
+        if (coils[c / 8] & (1 << (c % 8))) response_[i / 8] |= static_cast<uint8_t>(1 << (i % 8));
+    }
+    return exchange(slave, esp32Modbus::READ_COIL, address, 8, 5 + bytes, response_, bytes, priority);
+}
+
+bool esp32ModbusRTU::readDiscreteInputsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                                    esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 2000) return false;
+    size_t bytes = (count + 7) / 8;
+    for (size_t i = 0; i < bytes; i++) response_[i] = static_cast<uint8_t>(0xA5 ^ (address + i));
+    return exchange(slave, esp32Modbus::READ_DISCR_INPUT, address, 8, 5 + bytes, response_, bytes, priority);
+}
+
+bool esp32ModbusRTU::writeSingleHoldingRegisterWithPriority(uint8_t slave, uint16_t address, uint16_t value,
+                                                            esp32Modbus::ModbusPriority priority) {
+    if (slave < 248) registers_[slave][address % SLAVE_REGISTERS] = value;
+    response_[0] = static_cast<uint8_t>(value >> 8);
+    response_[1] = static_cast<uint8_t>(value & 0xFF);
+    return exchange(slave, esp32Modbus::WRITE_HOLD_REGISTER, address, 8, 8, response_, 2, priority);
+}
+
+bool esp32ModbusRTU::writeMultHoldingRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                                           uint8_t* data, esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 123 || !data) return false;
+    if (slave < 248) {
+        for (uint16_t i = 0; i < count; i++) {
+            registers_[slave][(address + i) % SLAVE_REGISTERS] =
+                static_cast<uint16_t>((data[i * 2] << 8) | data[i * 2 + 1]);
+        }
+    }
+    response_[0] = static_cast<uint8_t>(count >> 8);
+    response_[1] = static_cast<uint8_t>(count & 0xFF);
+    return exchange(slave, esp32Modbus::WRITE_MULT_REGISTERS, address, 9 + count * 2u, 8, response_, 2,
+                    priority);
+}
+
+bool esp32ModbusRTU::writeSingleCoilWithPriority(uint8_t slave, uint16_t address, bool value,
+                                                 esp32Modbus::ModbusPriority priority) {
+    if (slave < 248) {
+        uint16_t c = address % SLAVE_REGISTERS;
+        if (value) coils_[slave][c / 8] |= static_cast<uint8_t>(1 << (c % 8));
+        else coils_[slave][c / 8] &= static_cast<uint8_t>(~(1 << (c % 8)));
+    }
+    response_[0] = value ? 0xFF : 0x00;
+    response_[1] = 0x00;
+    return exchange(slave, esp32Modbus::WRITE_COIL, address, 8, 8, response_, 2, priority);
+}
+
+bool esp32ModbusRTU::writeMultipleCoilsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                                    bool* values, esp32Modbus::ModbusPriority priority) {
+    if (count == 0 || count > 1968 || !values) return false;
+    if (slave < 248) {
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t c = (address + i) % SLAVE_REGISTERS;
+            if (values[i]) coils_[slave][c / 8] |= static_cast<uint8_t>(1 << (c % 8));
+            else coils_[slave][c / 8] &= static_cast<uint8_t>(~(1 << (c % 8)));
+        }
+    }
+    response_[0] = static_cast<uint8_t>(count >> 8);
+    response_[1] = static_cast<uint8_t>(count & 0xFF);
+    return exchange(slave, esp32Modbus::WRITE_MULT_COILS, address, 9 + (count + 7) / 8u, 8, response_, 2,
+                    priority);
+}
@@ -0,0 +1,9 @@
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+#include <stdint.h>
+
+uint32_t millis();
+uint32_t micros();
+
+#endif // BENCH_ARDUINO_H
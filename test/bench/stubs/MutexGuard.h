@@ -0,0 +1,24 @@
+#ifndef BENCH_MUTEXGUARD_H
+#define BENCH_MUTEXGUARD_H
+
+#include "freertos/semphr.h"
+
+// Same interface as the LibraryCommon MutexGuard
+class MutexGuard {
+public:
+    explicit MutexGuard(SemaphoreHandle_t mutex, TickType_t timeout = portMAX_DELAY)
+        : mutex_(mutex), locked_(mutex && xSemaphoreTake(mutex, timeout) == pdTRUE) {}
+    ~MutexGuard() {
+        if (locked_) xSemaphoreGive(mutex_);
+    }
+    MutexGuard(const MutexGuard&) = delete;
+    MutexGuard& operator=(const MutexGuard&) = delete;
+
+    bool hasLock() const { return locked_; }
+
+private:
+    SemaphoreHandle_t mutex_;
+    bool locked_;
+};
+
+#endif // BENCH_MUTEXGUARD_H
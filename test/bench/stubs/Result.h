@@ -0,0 +1,47 @@
+#ifndef BENCH_RESULT_H
+#define BENCH_RESULT_H
+
+#include <utility>
+
+// Minimal stand-in for common::Result from LibraryCommon
+namespace common {
+
+template<typename T, typename E>
+class Result {
+public:
+    static Result ok(T value) { Result r; r.ok_ = true; r.value_ = std::move(value); return r; }
+    static Result error(E error) { Result r; r.ok_ = false; r.error_ = error; return r; }
+
+    bool isOk() const { return ok_; }
+    bool isError() const { return !ok_; }
+    explicit operator bool() const { return ok_; }
+    T& value() { return value_; }
+    const T& value() const { return value_; }
+    T valueOr(T fallback) const { return ok_ ? value_ : std::move(fallback); }
+    E error() const { return error_; }
+
+private:
+    bool ok_ = false;
+    T value_{};
+    E error_{};
+};
+
+template<typename E>
+class Result<void, E> {
+public:
+    static Result ok() { Result r; r.ok_ = true; return r; }
+    static Result error(E error) { Result r; r.ok_ = false; r.error_ = error; return r; }
+
+    bool isOk() const { return ok_; }
+    bool isError() const { return !ok_; }
+    explicit operator bool() const { return ok_; }
+    E error() const { return error_; }
+
+private:
+    bool ok_ = false;
+    E error_{};
+};
+
+} // namespace common
+
+#endif // BENCH_RESULT_H
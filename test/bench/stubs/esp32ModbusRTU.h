@@ -0,0 +1,174 @@
+#ifndef BENCH_ESP32MODBUSRTU_H
+#define BENCH_ESP32MODBUSRTU_H
+
+// Simulated esp32ModbusRTU master for the host benchmark. Requests are
+// "transmitted" synchronously: the virtual clock advances by the request
+// frame, the slave's turnaround (latency + jitter) and the response frame,
+// then the onData/onError handler runs before the call returns.
+//
+// setQueued(true) models the RTU task instead: requests wait in a FIFO and
+// run back to back on the wire while the caller blocks, so a reply can
+// arrive after the caller gave up on it.
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace esp32Modbus {
+
+enum FunctionCode : uint8_t {
+    READ_COIL = 0x01,
+    READ_DISCR_INPUT = 0x02,
+    READ_HOLD_REGISTER = 0x03,
+    READ_INPUT_REGISTER = 0x04,
+    WRITE_COIL = 0x05,
+    WRITE_HOLD_REGISTER = 0x06,
+    WRITE_MULT_COILS = 0x0F,
+    WRITE_MULT_REGISTERS = 0x10
+};
+
+enum Error : uint8_t {
+    SUCCESS = 0x00,
+    ILLEGAL_FUNCTION = 0x01,
+    ILLEGAL_DATA_ADDRESS = 0x02,
+    ILLEGAL_DATA_VALUE = 0x03,
+    SERVER_DEVICE_FAILURE = 0x04,
+    TIMEOUT = 0xE0,
+    CRC_ERROR = 0xE1,
+    INVALID_RESPONSE = 0xE2,
+    QUEUE_FULL = 0xE3,
+    MEMORY_ALLOCATION_FAILED = 0xE4,
+    INVALID_SLAVE = 0xE5,
+    INVALID_FUNCTION = 0xE6,
+    INVALID_PARAMETER = 0xE7,
+    COMM_ERROR = 0xE8
+};
+
+enum ModbusPriority : uint8_t {
+    EMERGENCY = 0,
+    SENSOR = 1,
+    RELAY = 2,
+    STATUS = 3
+};
+
+typedef void (*MBRTUOnData)(uint8_t serverAddress, FunctionCode fc, uint16_t address,
+                            const uint8_t* data, size_t length);
+typedef void (*MBRTUOnError)(uint8_t serverAddress, Error error);
+
+} // namespace esp32Modbus
+
+class esp32ModbusRTU {
+public:
+    struct SlaveConfig {
+        bool present = true;
+        uint32_t latencyUs = 2000;     ///< Request end to response start
+        uint32_t jitterUs = 0;         ///< Uniform extra latency 0..jitterUs
+        double crcErrorRate = 0.0;     ///< Probability a response is corrupted
+    };
+
+    static constexpr uint16_t SLAVE_REGISTERS = 256;  ///< Register/coil space per slave (wraps)
+
+    explicit esp32ModbusRTU(uint32_t baud = 9600);
+    ~esp32ModbusRTU();
+
+    void begin() {}
+    void onData(esp32Modbus::MBRTUOnData handler) { onData_ = handler; }
+    void onError(esp32Modbus::MBRTUOnError handler) { onError_ = handler; }
+    void setTimeOutValue(uint32_t ms) { timeoutMs_ = ms; }
+
+    void setBaudRate(uint32_t baud) { baud_ = baud; }
+    uint32_t getBaudRate() const { return baud_; }
+    void configureSlave(uint8_t address, const SlaveConfig& config);
+    void setSeed(uint32_t seed) { rng_ = seed ? seed : 1; }
+
+    // Answer from a request queue while the caller waits (one queued RTU at a
+    // time). Like the real master it serves higher priorities first, FIFO
+    // within one, and has one response timeout: a request runs at the value
+    // set when it goes on the wire, not when it was queued. Turning it off
+    // first completes everything still queued.
+    void setQueued(bool queued);
+    size_t getQueuedCount() const { return queueCount_; }
+
+    bool readHoldingRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                          esp32Modbus::ModbusPriority priority);
+    bool readInputRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                        esp32Modbus::ModbusPriority priority);
+    bool readCoilsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                               esp32Modbus::ModbusPriority priority);
+    bool readDiscreteInputsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                        esp32Modbus::ModbusPriority priority);
+    bool writeSingleHoldingRegisterWithPriority(uint8_t slave, uint16_t address, uint16_t value,
+                                                esp32Modbus::ModbusPriority priority);
+    bool writeMultHoldingRegistersWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                               uint8_t* data, esp32Modbus::ModbusPriority priority);
+    bool writeSingleCoilWithPriority(uint8_t slave, uint16_t address, bool value,
+                                     esp32Modbus::ModbusPriority priority);
+    bool writeMultipleCoilsWithPriority(uint8_t slave, uint16_t address, uint16_t count,
+                                        bool* values, esp32Modbus::ModbusPriority priority);
+
+    // Bus accounting
+    uint64_t getWireTimeUs() const { return wireTimeUs_; }
+    uint32_t getFrames() const { return frames_; }
+    uint32_t getErrors() const { return errors_; }
+    void resetCounters() { wireTimeUs_ = 0; frames_ = 0; errors_ = 0; }
+
+    // Function code and start address of the first FRAME_LOG_DEPTH frames
+    // since resetCounters(), in wire order
+    struct FrameRecord {
+        esp32Modbus::FunctionCode fc;
+        uint16_t address;
+    };
+    static constexpr size_t FRAME_LOG_DEPTH = 16;
+    FrameRecord getFrame(size_t index) const { return frameLog_[index < FRAME_LOG_DEPTH ? index : 0]; }
+
+private:
+    struct Request {
+        uint8_t slave;
+        esp32Modbus::ModbusPriority priority;
+        esp32Modbus::FunctionCode fc;
+        uint16_t address;
+        size_t requestBytes;
+        size_t responseBytes;
+        uint8_t payload[256];
+        size_t payloadLength;
+        int64_t turnaroundUs;
+        bool corrupt;
+        int64_t queuedUs;
+    };
+
+    bool exchange(uint8_t slave, esp32Modbus::FunctionCode fc, uint16_t address,
+                  size_t requestBytes, size_t responseBytes, const uint8_t* payload, size_t payloadLength,
+                  esp32Modbus::ModbusPriority priority);
+    bool answers(uint8_t slave) const;
+    int64_t durationUs(const Request& request) const;
+    void complete(const Request& request);
+    static bool runQueued(int64_t untilUs);
+    int64_t frameUs(size_t bytes) const;
+    uint32_t nextRandom();
+
+    static constexpr size_t QUEUE_DEPTH = 32;   ///< Fixed, so queueing does not count as a heap allocation
+
+    static esp32ModbusRTU* queuedRtu_;
+    Request queue_[QUEUE_DEPTH];
+    size_t queueCount_ = 0;
+    bool queued_ = false;
+    bool delivering_ = false;
+    int64_t idleAtUs_ = 0;
+
+    esp32Modbus::MBRTUOnData onData_ = nullptr;
+    esp32Modbus::MBRTUOnError onError_ = nullptr;
+    uint32_t baud_;
+    uint32_t timeoutMs_ = 1000;
+    uint32_t rng_ = 0x12345678;
+
+    SlaveConfig slaves_[248];
+    uint16_t registers_[248][SLAVE_REGISTERS] = {};
+    uint8_t coils_[248][SLAVE_REGISTERS / 8] = {};
+    uint8_t response_[256] = {};
+
+    uint64_t wireTimeUs_ = 0;
+    uint32_t frames_ = 0;
+    uint32_t errors_ = 0;
+    FrameRecord frameLog_[FRAME_LOG_DEPTH] = {};
+};
+
+#endif // BENCH_ESP32MODBUSRTU_H
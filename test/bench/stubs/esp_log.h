@@ -0,0 +1,11 @@
+#ifndef BENCH_ESP_LOG_H
+#define BENCH_ESP_LOG_H
+
+// Logging is discarded so it does not distort the measurements
+#define ESP_LOGE(tag, ...) ((void)0)
+#define ESP_LOGW(tag, ...) ((void)0)
+#define ESP_LOGI(tag, ...) ((void)0)
+#define ESP_LOGD(tag, ...) ((void)0)
+#define ESP_LOGV(tag, ...) ((void)0)
+
+#endif // BENCH_ESP_LOG_H
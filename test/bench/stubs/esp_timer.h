@@ -0,0 +1,10 @@
+#ifndef BENCH_ESP_TIMER_H
+#define BENCH_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Virtual microseconds; every call advances the clock by 1 us so busy-wait
+// loops on esp_timer_get_time() terminate and are charged as bus idle time.
+int64_t esp_timer_get_time();
+
+#endif // BENCH_ESP_TIMER_H
@@ -0,0 +1,44 @@
+// Host stub of the FreeRTOS subset used by the library, driven by a virtual
+// clock (see sim_clock.h). Single-threaded: a blocking call runs deferred
+// work and any sim::spawn() tasks, and a wait that nothing can satisfy
+// advances the clock by its timeout instead.
+#ifndef BENCH_FREERTOS_H
+#define BENCH_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef void* SemaphoreHandle_t;
+typedef void* QueueHandle_t;
+typedef void* TaskHandle_t;
+typedef void* EventGroupHandle_t;
+typedef uint32_t TickType_t;
+typedef uint32_t EventBits_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef int esp_err_t;
+typedef uint8_t StackType_t;
+
+// Static-allocation control blocks, large enough for the simulated objects
+typedef struct { alignas(8) uint8_t storage[16]; } StaticSemaphore_t;
+typedef struct { alignas(8) uint8_t storage[40]; } StaticQueue_t;
+typedef struct { uint8_t storage[1]; } StaticTask_t;
+typedef struct { alignas(8) uint8_t storage[8]; } StaticEventGroup_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFu
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(((uint64_t)(ms) * configTICK_RATE_HZ) / 1000))
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+#endif // BENCH_FREERTOS_H
@@ -0,0 +1,15 @@
+#ifndef BENCH_EVENT_GROUPS_H
+#define BENCH_EVENT_GROUPS_H
+
+#include "FreeRTOS.h"
+
+EventGroupHandle_t xEventGroupCreate();
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t* storage);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clear,
+                                BaseType_t waitAll, TickType_t ticks);
+void vEventGroupDelete(EventGroupHandle_t group);
+
+#endif // BENCH_EVENT_GROUPS_H
@@ -0,0 +1,17 @@
+#ifndef BENCH_SEMPHR_H
+#define BENCH_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t* storage);
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t* storage);
+SemaphoreHandle_t xSemaphoreCreateCountingStatic(UBaseType_t maxCount, UBaseType_t initialCount,
+                                                 StaticSemaphore_t* storage);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+#endif // BENCH_SEMPHR_H
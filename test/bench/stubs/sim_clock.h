@@ -0,0 +1,31 @@
+#ifndef BENCH_SIM_CLOCK_H
+#define BENCH_SIM_CLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Virtual time shared by the FreeRTOS, esp_timer and bus simulators
+namespace sim {
+
+int64_t nowUs();
+void advanceUs(int64_t us);
+void reset();
+
+// Deferred work (the queued RTU). Every blocking wait calls runPending()
+// until it returns false; fn runs the next item due at or before untilUs,
+// moving the clock to its time, and returns whether it ran one.
+using PendingFn = bool (*)(int64_t untilUs);
+void setPending(PendingFn fn);
+bool runPending(int64_t untilUs);
+
+// Cooperative tasks for tests. A task runs until it blocks in a FreeRTOS
+// wait; then the next task whose wait is satisfied runs, and when none is
+// the clock moves to the nearest timeout. Ready tasks never preempt the
+// running one. xTaskCreate*() starts library tasks the same way.
+using TaskFn = void (*)(void* param);
+bool spawn(TaskFn fn, void* param);
+size_t liveTasks();             ///< Spawned tasks that have not returned
+
+} // namespace sim
+
+#endif // BENCH_SIM_CLOCK_H
@@ -0,0 +1,201 @@
+#include "test_framework.h"
+#include "ModbusRegistry.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+namespace {
+
+// Bus 1 has no RTU; the arbiter does not need one
+ModbusBus& arbiterBus() { return *ModbusRegistry::getInstance().getBus(1); }
+
+int nextGrant = 0;
+
+// One task queueing for the bus, holding it briefly once granted
+struct Waiter {
+    esp32Modbus::ModbusPriority priority;
+    uint32_t timeoutMs = 1000;
+    bool granted = false;
+    int grantOrder = -1;
+};
+
+void waiterTask(void* param) {
+    Waiter* waiter = static_cast<Waiter*>(param);
+    waiter->granted = arbiterBus().acquireBusMutex(waiter->timeoutMs, waiter->priority);
+    if (!waiter->granted) {
+        return;
+    }
+    waiter->grantOrder = nextGrant++;
+    vTaskDelay(pdMS_TO_TICKS(5));
+    arbiterBus().releaseBusMutex();
+}
+
+// Starts the waiter and lets it queue before the caller goes on
+void enqueue(Waiter& waiter) {
+    sim::spawn(waiterTask, &waiter);
+    vTaskDelay(pdMS_TO_TICKS(1));
+}
+
+bool joinWaiters() {
+    for (int i = 0; i < 10000 && sim::liveTasks() != 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return sim::liveTasks() == 0;
+}
+
+// Arbiter settings for one test; the defaults come back afterwards
+class ArbiterSetup {
+public:
+    ArbiterSetup(uint32_t agingMs, uint32_t relayBudgetMs = 0) : bus(arbiterBus()) {
+        savedAging = bus.getAgingMs();
+        for (size_t cls = 0; cls < ModbusBus::PRIORITY_CLASSES; cls++) {
+            const auto priority = static_cast<esp32Modbus::ModbusPriority>(cls);
+            savedBudgets[cls] = bus.getLatencyBudget(priority);
+            bus.setLatencyBudget(priority, 0);
+        }
+        bus.setLatencyBudget(esp32Modbus::RELAY, relayBudgetMs);
+        bus.setAgingMs(agingMs);
+        bus.resetArbiterStats();
+        nextGrant = 0;
+    }
+    ~ArbiterSetup() {
+        bus.setAgingMs(savedAging);
+        for (size_t cls = 0; cls < ModbusBus::PRIORITY_CLASSES; cls++) {
+            bus.setLatencyBudget(static_cast<esp32Modbus::ModbusPriority>(cls), savedBudgets[cls]);
+        }
+    }
+
+    ModbusBus& bus;
+
+private:
+    uint32_t savedAging;
+    uint32_t savedBudgets[ModbusBus::PRIORITY_CLASSES];
+};
+
+} // namespace
+
+TEST(BusArbiter_StrictPriorityOrder) {
+    ArbiterSetup setup(0);
+    ModbusBus& bus = setup.bus;
+    ASSERT_TRUE(bus.acquireBusMutex(100, esp32Modbus::STATUS));
+
+    // Queued lowest class first: arrival order must not matter
+    Waiter status{esp32Modbus::STATUS};
+    Waiter relay{esp32Modbus::RELAY};
+    Waiter sensor{esp32Modbus::SENSOR};
+    Waiter emergency{esp32Modbus::EMERGENCY};
+    enqueue(status);
+    enqueue(relay);
+    enqueue(sensor);
+    enqueue(emergency);
+    ASSERT_EQ(1u, bus.getWaiterCount(esp32Modbus::RELAY));
+    ASSERT_EQ(1u, bus.getWaiterCount(esp32Modbus::EMERGENCY));
+    ASSERT_TRUE(bus.shouldYield(esp32Modbus::STATUS));
+    ASSERT_FALSE(bus.shouldYield(esp32Modbus::EMERGENCY));
+
+    bus.releaseBusMutex();
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_EQ(0, emergency.grantOrder);
+    ASSERT_EQ(1, sensor.grantOrder);
+    ASSERT_EQ(2, relay.grantOrder);
+    ASSERT_EQ(3, status.grantOrder);
+    ASSERT_EQ(1u, bus.getArbiterStats(esp32Modbus::SENSOR).contended);
+    ASSERT_EQ(2u, bus.getArbiterStats(esp32Modbus::STATUS).grants);
+    ASSERT_EQ(1u, bus.getArbiterStats(esp32Modbus::STATUS).contended);
+}
+
+TEST(BusArbiter_AgingPromotesStarvedClass) {
+    ArbiterSetup setup(100);
+    ModbusBus& bus = setup.bus;
+    ASSERT_TRUE(bus.acquireBusMutex(1000, esp32Modbus::EMERGENCY));
+
+    // 150 ms raise STATUS one class only: SENSOR still goes first
+    Waiter status{esp32Modbus::STATUS};
+    Waiter sensor{esp32Modbus::SENSOR};
+    enqueue(status);
+    vTaskDelay(pdMS_TO_TICKS(150));
+    enqueue(sensor);
+    bus.releaseBusMutex();
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_EQ(0, sensor.grantOrder);
+    ASSERT_EQ(1, status.grantOrder);
+
+    // 300 ms age it three classes, past SENSOR's own rank
+    nextGrant = 0;
+    ASSERT_TRUE(bus.acquireBusMutex(1000, esp32Modbus::EMERGENCY));
+    Waiter starved{esp32Modbus::STATUS};
+    Waiter fresh{esp32Modbus::SENSOR};
+    enqueue(starved);
+    vTaskDelay(pdMS_TO_TICKS(300));
+    enqueue(fresh);
+    ASSERT_TRUE(bus.shouldYield(esp32Modbus::SENSOR));
+    bus.releaseBusMutex();
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_EQ(0, starved.grantOrder);
+    ASSERT_EQ(1, fresh.grantOrder);
+    ASSERT_TRUE(bus.getArbiterStats(esp32Modbus::STATUS).maxWaitUs >= 300 * 1000);
+}
+
+TEST(BusArbiter_OverdueBudgetWins) {
+    ArbiterSetup setup(0, 100);
+    ModbusBus& bus = setup.bus;
+    ASSERT_TRUE(bus.acquireBusMutex(1000, esp32Modbus::STATUS));
+
+    Waiter relay{esp32Modbus::RELAY};
+    Waiter emergency{esp32Modbus::EMERGENCY};
+    enqueue(relay);
+    vTaskDelay(pdMS_TO_TICKS(150));
+    enqueue(emergency);
+
+    // Past its budget RELAY outranks even a fresh EMERGENCY request
+    ASSERT_TRUE(bus.shouldYield(esp32Modbus::EMERGENCY));
+    bus.releaseBusMutex();
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_EQ(0, relay.grantOrder);
+    ASSERT_EQ(1, emergency.grantOrder);
+
+    const ModbusBus::ArbiterStats stats = bus.getArbiterStats(esp32Modbus::RELAY);
+    ASSERT_EQ(1u, stats.budgetMisses);
+    ASSERT_TRUE(stats.maxWaitUs >= 150 * 1000);
+    ASSERT_EQ(0u, bus.getArbiterStats(esp32Modbus::EMERGENCY).budgetMisses);
+}
+
+TEST(BusArbiter_WithinBudgetKeepsPriority) {
+    ArbiterSetup setup(0, 100);
+    ModbusBus& bus = setup.bus;
+    ASSERT_TRUE(bus.acquireBusMutex(1000, esp32Modbus::STATUS));
+
+    Waiter relay{esp32Modbus::RELAY};
+    Waiter sensor{esp32Modbus::SENSOR};
+    enqueue(relay);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    enqueue(sensor);
+    bus.releaseBusMutex();
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_EQ(0, sensor.grantOrder);
+    ASSERT_EQ(1, relay.grantOrder);
+    ASSERT_EQ(0u, bus.getArbiterStats(esp32Modbus::RELAY).budgetMisses);
+}
+
+TEST(BusArbiter_WaiterTimesOut) {
+    ArbiterSetup setup(0);
+    ModbusBus& bus = setup.bus;
+    ASSERT_TRUE(bus.acquireBusMutex(1000, esp32Modbus::STATUS));
+
+    Waiter sensor{esp32Modbus::SENSOR};
+    sensor.timeoutMs = 50;
+    enqueue(sensor);
+    vTaskDelay(pdMS_TO_TICKS(100));
+    ASSERT_TRUE(joinWaiters());
+    ASSERT_FALSE(sensor.granted);
+    ASSERT_EQ(0u, bus.getWaiterCount(esp32Modbus::SENSOR));
+    ASSERT_EQ(1u, bus.getArbiterStats(esp32Modbus::SENSOR).timeouts);
+    ASSERT_FALSE(bus.shouldYield(esp32Modbus::STATUS));
+
+    // The abandoned queue slot does not keep the bus busy
+    bus.releaseBusMutex();
+    ASSERT_TRUE(bus.acquireBusMutex(0, esp32Modbus::STATUS));
+    ASSERT_EQ(2u, bus.getArbiterStats(esp32Modbus::STATUS).grants);
+    ASSERT_EQ(0u, bus.getArbiterStats(esp32Modbus::STATUS).contended);
+    bus.releaseBusMutex();
+}
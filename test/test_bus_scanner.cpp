@@ -0,0 +1,183 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "ModbusBusScanner.h"
+#include "ModbusErrorTracker.h"
+#include "ModbusLinkPolicy.h"
+
+using namespace modbus;
+
+namespace {
+
+// Each test scans its own eight-address window
+constexpr uint8_t BITMAP_FIRST = 0xD0;
+constexpr uint8_t CANDIDATE_FIRST = 0xD8;
+constexpr uint8_t LOOKAHEAD_FIRST = 0xE0;
+constexpr uint8_t HOTSWAP_FIRST = 0xE8;
+
+void setPresent(uint8_t slave, bool present) {
+    esp32ModbusRTU::SlaveConfig config;
+    config.present = present;
+    simBus().configureSlave(slave, config);
+}
+
+ModbusBusScanner::Config window(uint8_t first) {
+    ModbusBusScanner::Config config;
+    config.firstAddress = first;
+    config.lastAddress = static_cast<uint8_t>(first + 7);
+    return config;
+}
+
+struct Change {
+    uint8_t address;
+    bool present;
+};
+
+struct ChangeLog {
+    Change changes[8];
+    size_t count = 0;
+};
+
+void onChange(ModbusBusScanner&, uint8_t address, bool present, void* context) {
+    ChangeLog* log = static_cast<ChangeLog*>(context);
+    if (log->count < 8) {
+        log->changes[log->count++] = {address, present};
+    }
+}
+
+class PolicyDevice : public ModbusDevice {
+public:
+    PolicyDevice(uint8_t addr, ModbusLinkPolicy& policy) : ModbusDevice(addr) {
+        ModbusErrorTracker::resetDevice(addr);
+        setLinkPolicy(&policy);
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~PolicyDevice() override { (void)unregisterDevice(); }
+};
+
+} // namespace
+
+TEST(BusScanner_PresenceBitmapAndRtt) {
+    setPresent(BITMAP_FIRST + 3, true);
+    setPresent(BITMAP_FIRST + 6, true);
+    ModbusBusScanner scanner;
+    ASSERT_TRUE(scanner.setConfig(window(BITMAP_FIRST)));
+
+    auto found = scanner.scan();
+    ASSERT_TRUE(found.isOk());
+    ASSERT_EQ(2u, found.value());
+    ASSERT_TRUE(scanner.isPassComplete());
+    ASSERT_EQ(1u, scanner.getPassCount());
+
+    uint32_t bitmap[ModbusBusScanner::BITMAP_WORDS];
+    scanner.getPresence(bitmap);
+    for (size_t i = 0; i < ModbusBusScanner::BITMAP_WORDS; i++) {
+        uint32_t expected = 0;
+        for (uint8_t a : {uint8_t(BITMAP_FIRST + 3), uint8_t(BITMAP_FIRST + 6)}) {
+            if (a / 32 == i) expected |= 1u << (a % 32);
+        }
+        ASSERT_EQ(expected, bitmap[i]);
+    }
+
+    ASSERT_TRUE(scanner.getRttUs(BITMAP_FIRST + 3) > 0);
+    ASSERT_TRUE(scanner.getRttUs(BITMAP_FIRST + 6) > 0);
+    ASSERT_EQ(0u, scanner.getRttUs(BITMAP_FIRST + 4));
+    ASSERT_FALSE(scanner.isPresent(BITMAP_FIRST));
+}
+
+TEST(BusScanner_CandidatesFirst) {
+    setPresent(CANDIDATE_FIRST + 1, true);
+    setPresent(CANDIDATE_FIRST + 5, true);
+    ModbusBusScanner scanner;
+    ASSERT_TRUE(scanner.setConfig(window(CANDIDATE_FIRST)));
+    ASSERT_TRUE(scanner.addCandidates(CANDIDATE_FIRST + 5, CANDIDATE_FIRST + 6));
+
+    // The two candidates go before the lower addresses of the range
+    auto sent = scanner.step(2);
+    ASSERT_TRUE(sent.isOk());
+    ASSERT_EQ(2u, sent.value());
+    ASSERT_TRUE(scanner.isPresent(CANDIDATE_FIRST + 5));
+    ASSERT_FALSE(scanner.isPresent(CANDIDATE_FIRST + 1));
+    ASSERT_FALSE(scanner.isPassComplete());
+
+    // The rest of the range, without probing the candidates twice
+    sent = scanner.step(8);
+    ASSERT_TRUE(sent.isOk());
+    ASSERT_EQ(6u, sent.value());
+    ASSERT_TRUE(scanner.isPassComplete());
+    ASSERT_TRUE(scanner.isPresent(CANDIDATE_FIRST + 1));
+    ASSERT_EQ(2u, scanner.getPresentCount());
+}
+
+TEST(BusScanner_LookaheadCarriesAcrossSlices) {
+    setPresent(LOOKAHEAD_FIRST + 2, true);
+    setPresent(LOOKAHEAD_FIRST + 3, true);
+    ModbusBusScanner scanner;
+    ASSERT_TRUE(scanner.setConfig(window(LOOKAHEAD_FIRST)));
+
+    // The slice ends with the third address already taken from the pass
+    ASSERT_EQ(2u, scanner.step(2).value());
+    ASSERT_FALSE(scanner.isPresent(LOOKAHEAD_FIRST + 2));
+
+    // The next slice starts with it instead of skipping it
+    ASSERT_EQ(1u, scanner.step(1).value());
+    ASSERT_TRUE(scanner.isPresent(LOOKAHEAD_FIRST + 2));
+    ASSERT_FALSE(scanner.isPresent(LOOKAHEAD_FIRST + 3));
+    ASSERT_EQ(1u, scanner.step(1).value());
+    ASSERT_TRUE(scanner.isPresent(LOOKAHEAD_FIRST + 3));
+
+    // Every address once per pass
+    size_t total = 4;
+    while (!scanner.isPassComplete()) {
+        auto sent = scanner.step(3);
+        ASSERT_TRUE(sent.isOk());
+        total += sent.value();
+    }
+    ASSERT_EQ(8u, total);
+    ASSERT_EQ(1u, scanner.getPassCount());
+}
+
+TEST(BusScanner_ReappearingSlaveResetsPolicy) {
+    constexpr uint8_t SLAVE = HOTSWAP_FIRST + 4;
+    ModbusLinkPolicy::Config policyConfig;
+    policyConfig.maxTimeoutMs = 50;
+    policyConfig.minTimeoutMs = 10;
+    policyConfig.breakerThreshold = 3;
+    policyConfig.backoffBaseMs = 60000;
+    ModbusLinkPolicy policy(policyConfig);
+    PolicyDevice device(SLAVE, policy);
+
+    ModbusBusScanner scanner;
+    ASSERT_TRUE(scanner.setConfig(window(HOTSWAP_FIRST)));
+    ChangeLog log;
+    scanner.setChangeCallback(onChange, &log);
+
+    setPresent(SLAVE, true);
+    ASSERT_EQ(1u, scanner.scan().value());
+    ASSERT_EQ(1u, log.count);
+    ASSERT_EQ(SLAVE, log.changes[0].address);
+    ASSERT_TRUE(log.changes[0].present);
+
+    // The slave drops off: the device trips its breaker, the scan reports it gone
+    setPresent(SLAVE, false);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_FALSE(device.readHoldingRegisters(0x00, 1).isOk());
+    }
+    ASSERT_EQ(ModbusLinkPolicy::BreakerState::OPEN, policy.getState());
+    ASSERT_EQ(0u, scanner.scan().value());
+    ASSERT_EQ(2u, log.count);
+    ASSERT_FALSE(log.changes[1].present);
+
+    // Back again: the device is usable at once instead of after its backoff
+    setPresent(SLAVE, true);
+    ASSERT_EQ(1u, scanner.scan().value());
+    ASSERT_EQ(3u, log.count);
+    ASSERT_EQ(SLAVE, log.changes[2].address);
+    ASSERT_TRUE(log.changes[2].present);
+    ASSERT_EQ(ModbusLinkPolicy::BreakerState::CLOSED, policy.getState());
+    ASSERT_TRUE(device.readHoldingRegisters(0x00, 1).isOk());
+
+    // No change, no callback
+    ASSERT_EQ(1u, scanner.scan().value());
+    ASSERT_EQ(3u, log.count);
+}
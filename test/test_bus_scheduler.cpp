@@ -0,0 +1,231 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "sim_clock.h"
+#include "BusScheduler.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t SLAVE = 0xC1;
+
+class ScheduledDevice : public ModbusDevice {
+public:
+    explicit ScheduledDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~ScheduledDevice() override { (void)unregisterDevice(); }
+};
+
+uint16_t expected(uint16_t reg) { return static_cast<uint16_t>((SLAVE << 8) | reg); }
+
+// Queued RTU: the worker sends while the test task waits
+class QueuedBus {
+public:
+    explicit QueuedBus(uint32_t latencyMs) : rtu(simBus()) {
+        esp32ModbusRTU::SlaveConfig config;
+        config.latencyUs = latencyMs * 1000;
+        rtu.configureSlave(SLAVE, config);
+        rtu.setQueued(true);
+    }
+    ~QueuedBus() { rtu.setQueued(false); }
+
+private:
+    esp32ModbusRTU& rtu;
+};
+
+struct Outcome {
+    int calls = 0;
+    uint32_t jobId = 0;
+    ModbusError error = ModbusError::SUCCESS;
+    size_t decoded = 0;
+    uint16_t values[4] = {};
+};
+
+void onComplete(const BusScheduler::Completion& completion) {
+    Outcome* outcome = static_cast<Outcome*>(completion.context);
+    outcome->calls++;
+    outcome->jobId = completion.jobId;
+    outcome->error = completion.error;
+    outcome->decoded = completion.decoded;
+}
+
+BusScheduler::Job readJob(ModbusDevice& device, uint16_t address, Outcome& outcome) {
+    BusScheduler::Job job;
+    job.device = &device;
+    job.functionCode = 0x03;
+    job.address = address;
+    job.count = 1;
+    job.registers = outcome.values;
+    job.capacity = 4;
+    job.callback = onComplete;
+    job.context = &outcome;
+    return job;
+}
+
+bool waitFor(const Outcome& outcome, int calls = 1) {
+    for (int i = 0; i < 5000 && outcome.calls < calls; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return outcome.calls >= calls;
+}
+
+// A synchronous read issued from its own task
+struct SyncReader {
+    ModbusDevice* device;
+    uint16_t address;
+    uint16_t value = 0;
+    ModbusError error = ModbusError::SUCCESS;
+    bool done = false;
+};
+
+void syncReaderTask(void* param) {
+    SyncReader* reader = static_cast<SyncReader*>(param);
+    auto result = reader->device->readHoldingRegisters(reader->address, 1, &reader->value, 1);
+    reader->error = result.isOk() ? ModbusError::SUCCESS : result.error();
+    reader->done = true;
+}
+
+} // namespace
+
+TEST(BusScheduler_CallbackCompletion) {
+    ScheduledDevice device(SLAVE);
+    QueuedBus bus(5);
+    BusScheduler scheduler;
+    ASSERT_TRUE(scheduler.start());
+
+    Outcome outcome;
+    auto submitted = scheduler.submit(readJob(device, 0x10, outcome));
+    ASSERT_TRUE(submitted.isOk());
+    ASSERT_TRUE(waitFor(outcome));
+
+    ASSERT_EQ(1, outcome.calls);
+    ASSERT_EQ(submitted.value(), outcome.jobId);
+    ASSERT_EQ(ModbusError::SUCCESS, outcome.error);
+    ASSERT_EQ(1u, outcome.decoded);
+    ASSERT_EQ(expected(0x10), outcome.values[0]);
+    scheduler.stop();
+}
+
+TEST(BusScheduler_NotifyTaskCompletion) {
+    ScheduledDevice device(SLAVE);
+    QueuedBus bus(5);
+    BusScheduler scheduler;
+    ASSERT_TRUE(scheduler.start());
+    xTaskNotifyWait(0, UINT32_MAX, nullptr, 0);   // Nothing left over from earlier tests
+
+    Outcome outcome;
+    BusScheduler::Job job = readJob(device, 0x11, outcome);
+    job.callback = nullptr;
+    job.notifyTask = xTaskGetCurrentTaskHandle();
+    ASSERT_TRUE(scheduler.submit(job).isOk());
+
+    uint32_t value = UINT32_MAX;
+    ASSERT_EQ(pdTRUE, xTaskNotifyWait(0, UINT32_MAX, &value, pdMS_TO_TICKS(1000)));
+    ASSERT_EQ(static_cast<uint32_t>(ModbusError::SUCCESS), value);
+    ASSERT_EQ(expected(0x11), outcome.values[0]);
+    ASSERT_EQ(0, outcome.calls);
+    scheduler.stop();
+}
+
+TEST(BusScheduler_SyncCallRunsAsJob) {
+    ScheduledDevice device(SLAVE);
+    QueuedBus bus(5);
+    BusScheduler scheduler;
+    ASSERT_TRUE(scheduler.start());
+
+    // An async job ahead of it on the worker
+    Outcome queued;
+    auto first = scheduler.submit(readJob(device, 0x12, queued));
+    ASSERT_TRUE(first.isOk());
+
+    uint16_t value = 0;
+    auto result = device.readHoldingRegisters(0x13, 1, &value, 1);
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(expected(0x13), value);
+    ASSERT_TRUE(waitFor(queued));
+    ASSERT_EQ(ModbusError::SUCCESS, queued.error);
+
+    // runSync() took the job id between the two submits
+    Outcome last;
+    auto next = scheduler.submit(readJob(device, 0x14, last));
+    ASSERT_TRUE(next.isOk());
+    ASSERT_EQ(first.value() + 2, next.value());
+    ASSERT_TRUE(waitFor(last));
+    scheduler.stop();
+}
+
+TEST(BusScheduler_StopCompletesQueuedAndInFlight) {
+    ScheduledDevice device(SLAVE);
+    QueuedBus bus(50);
+    BusScheduler scheduler;
+    ASSERT_TRUE(scheduler.start());
+
+    Outcome inFlight;
+    Outcome queued[2];
+    ASSERT_TRUE(scheduler.submit(readJob(device, 0x20, inFlight)).isOk());
+    ASSERT_TRUE(scheduler.submit(readJob(device, 0x21, queued[0])).isOk());
+    ASSERT_TRUE(scheduler.submit(readJob(device, 0x22, queued[1])).isOk());
+
+    // A synchronous caller queued behind them
+    SyncReader reader{&device, 0x23};
+    sim::spawn(syncReaderTask, &reader);
+    vTaskDelay(pdMS_TO_TICKS(10));
+    ASSERT_EQ(0, inFlight.calls);
+
+    scheduler.stop();
+    ASSERT_FALSE(scheduler.isRunning());
+
+    // The transaction on the wire finishes; the rest fail without bus time
+    ASSERT_EQ(1, inFlight.calls);
+    ASSERT_EQ(ModbusError::SUCCESS, inFlight.error);
+    ASSERT_EQ(expected(0x20), inFlight.values[0]);
+    for (const Outcome& outcome : queued) {
+        ASSERT_EQ(1, outcome.calls);
+        ASSERT_EQ(ModbusError::NOT_INITIALIZED, outcome.error);
+    }
+    for (int i = 0; i < 100 && !reader.done; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    ASSERT_TRUE(reader.done);
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, reader.error);
+    ASSERT_EQ(0u, scheduler.getPendingCount());
+
+    Outcome late;
+    auto rejected = scheduler.submit(readJob(device, 0x24, late));
+    ASSERT_FALSE(rejected.isOk());
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, rejected.error());
+
+    // Sync calls take the bus mutex again
+    uint16_t value = 0;
+    ASSERT_TRUE(device.readHoldingRegisters(0x25, 1, &value, 1).isOk());
+    ASSERT_EQ(expected(0x25), value);
+}
+
+TEST(BusScheduler_LateReplyAfterTimeoutIsDropped) {
+    ScheduledDevice device(SLAVE);
+    QueuedBus bus(50);
+    BusScheduler scheduler;
+    ASSERT_TRUE(scheduler.start());
+
+    Outcome expired;
+    Outcome next;
+    BusScheduler::Job first = readJob(device, 0x30, expired);
+    first.timeoutMs = 20;
+    ASSERT_TRUE(scheduler.submit(first).isOk());
+    ASSERT_TRUE(scheduler.submit(readJob(device, 0x31, next)).isOk());
+
+    ASSERT_TRUE(waitFor(expired));
+    ASSERT_EQ(ModbusError::TIMEOUT, expired.error);
+    ASSERT_EQ(0u, expired.decoded);
+
+    // Same device and function code: only the transaction id tells the
+    // first job's reply (register 0x30) from the second's
+    ASSERT_TRUE(waitFor(next));
+    ASSERT_EQ(1, next.calls);
+    ASSERT_EQ(ModbusError::SUCCESS, next.error);
+    ASSERT_EQ(expected(0x31), next.values[0]);
+    ASSERT_EQ(1, expired.calls);
+    scheduler.stop();
+}
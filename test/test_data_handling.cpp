@@ -1,30 +1,13 @@
 #include "test_framework.h"
-#include "mock_freertos.h"
-#include "mock_logger.h"
-
-// Mock esp32Modbus types
-namespace esp32Modbus {
-    enum FunctionCode {
-        READ_COILS = 0x01,
-        READ_INPUT_REGISTERS = 0x04,
-        WRITE_SINGLE_COIL = 0x05,
-        WRITE_SINGLE_REGISTER = 0x06
-    };
-
-    enum Error {
-        SUCCESS = 0,
-        TIMEOUT = 1,
-        INVALID_RESPONSE = 2,
-        CRC_ERROR = 3
-    };
-}
-
-// Include the source files for testing
-#include "../src/ModbusRegistry.cpp"
-#include "../src/ModbusDevice.cpp"
+#include "test_sim_bus.h"
 
 using namespace modbus;
 
+namespace {
+
+constexpr uint8_t PRESENT_SLAVE = 0x31;
+constexpr uint8_t ABSENT_SLAVE = 0x32;
+
 // Helper to get registry instance
 ModbusRegistry& registry() {
     return ModbusRegistry::getInstance();
@@ -37,9 +20,15 @@ public:
     bool handleErrorCalled = false;
     const uint8_t* receivedData = nullptr;
     size_t receivedLength = 0;
+    uint8_t receivedFunctionCode = 0;
     ModbusError lastError = ModbusError::SUCCESS;
 
-    DataTestDevice(uint8_t addr = 0x01) : ModbusDevice(addr) {}
+    explicit DataTestDevice(uint8_t addr = 0x01) : ModbusDevice(addr) {}
+
+    void makeReady() {
+        registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
 
 protected:
     void handleModbusResponse(uint8_t functionCode, uint16_t address,
@@ -47,6 +36,7 @@ protected:
         handleDataCalled = true;
         receivedData = data;
         receivedLength = length;
+        receivedFunctionCode = functionCode;
         ModbusDevice::handleModbusResponse(functionCode, address, data, length);
     }
 
@@ -57,139 +47,169 @@ protected:
     }
 };
 
+// Async completions seen by onAsyncDone()
+struct AsyncRecord {
+    int calls = 0;
+    ModbusError error = ModbusError::SUCCESS;
+    uint16_t firstRegister = 0;
+    size_t registers = 0;
+};
+
+void onAsyncDone(ModbusDevice&, const ModbusDevice::AsyncResult& result) {
+    AsyncRecord* record = static_cast<AsyncRecord*>(result.context);
+    record->calls++;
+    record->error = result.error;
+    record->registers = result.isOk() ? result.getRegisterCount() : 0;
+    record->firstRegister = record->registers > 0 ? result.getRegister(0) : 0;
+}
+
 // Helper to reset global state
 void resetTestState() {
-    // Unregister all devices from registry
     for (uint8_t addr = 1; addr <= 247; addr++) {
         registry().unregisterDevice(addr);
     }
-    mockMutexShouldFail = false;
-    mockMutexCreateShouldFail = false;
+    esp32ModbusRTU& rtu = simBus();
+    rtu.configureSlave(PRESENT_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    rtu.resetCounters();
 }
 
+} // namespace
+
 TEST(DataHandling_ValidData) {
     resetTestState();
 
     DataTestDevice device(0x01);
-    uint8_t address = 0x01;
     device.registerDevice();
 
+    // Unsolicited frame: nothing outstanding, still reaches the device
     uint8_t testData[] = {0x01, 0x02, 0x03, 0x04};
-    mainHandleData(address, esp32Modbus::READ_INPUT_REGISTERS, 0x100, testData, sizeof(testData));
+    mainHandleData(0x01, esp32Modbus::READ_INPUT_REGISTER, 0x100, testData, sizeof(testData));
 
     ASSERT_TRUE(device.handleDataCalled);
     ASSERT_EQ(testData, device.receivedData);
     ASSERT_EQ(sizeof(testData), device.receivedLength);
+    ASSERT_EQ(0x04, device.receivedFunctionCode);
 }
 
 TEST(DataHandling_NullDataWithZeroLength) {
     resetTestState();
 
     DataTestDevice device(0x01);
-    uint8_t address = 0x01;
     device.registerDevice();
 
-    // This should be valid - null data with zero length
-    mainHandleData(address, esp32Modbus::READ_INPUT_REGISTERS, 0x100, nullptr, 0);
+    // Valid - write acknowledgements carry no payload
+    mainHandleData(0x01, esp32Modbus::WRITE_HOLD_REGISTER, 0x100, nullptr, 0);
 
     ASSERT_TRUE(device.handleDataCalled);
     ASSERT_NULL(device.receivedData);
-    ASSERT_EQ(0, device.receivedLength);
+    ASSERT_EQ(0u, device.receivedLength);
 }
 
-TEST(DataHandling_NullDataWithNonZeroLength) {
+TEST(DataHandling_SyncReadDecodes) {
     resetTestState();
 
-    DataTestDevice device(0x01);
-    uint8_t address = 0x01;
-    device.registerDevice();
+    DataTestDevice device(PRESENT_SLAVE);
+    device.makeReady();
 
-    // This should fail validation
-    mainHandleData(address, esp32Modbus::READ_INPUT_REGISTERS, 0x100, nullptr, 10);
+    auto result = device.readHoldingRegisters(0x10, 3);
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(3u, result.value().size());
+    ASSERT_EQ((PRESENT_SLAVE << 8) | 0x10, result.value()[0]);
+    ASSERT_EQ((PRESENT_SLAVE << 8) | 0x12, result.value()[2]);
 
-    ASSERT_FALSE(device.handleDataCalled);
+    // The raw frame also went through the virtual handler
+    ASSERT_TRUE(device.handleDataCalled);
+    ASSERT_EQ(0x03, device.receivedFunctionCode);
+    ASSERT_EQ(6u, device.receivedLength);
+    ASSERT_EQ(1u, simBus().getFrames());
 }
 
-TEST(DataHandling_ExcessiveDataLength) {
+TEST(DataHandling_WriteThenRead) {
     resetTestState();
 
-    DataTestDevice device(0x01);
-    uint8_t address = 0x01;
-    device.registerDevice();
-
-    uint8_t testData[300];  // Exceeds MAX_MODBUS_DATA_LENGTH (252)
-    mainHandleData(address, esp32Modbus::READ_INPUT_REGISTERS, 0x100, testData, sizeof(testData));
+    DataTestDevice device(PRESENT_SLAVE);
+    device.makeReady();
 
-    ASSERT_FALSE(device.handleDataCalled);
+    ASSERT_TRUE(device.writeSingleRegister(0x20, 0xBEEF).isOk());
+    auto result = device.readHoldingRegisters(0x20, 1);
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(0xBEEF, result.value()[0]);
 }
 
 TEST(DataHandling_DeviceNotFound) {
     resetTestState();
 
     uint8_t testData[] = {0x01, 0x02};
-    uint8_t address = 0x99;  // Not registered
 
-    // Should not crash, just log error
-    mainHandleData(address, esp32Modbus::READ_INPUT_REGISTERS, 0x100, testData, sizeof(testData));
+    // Should not crash, just be dropped
+    mainHandleData(0x99, esp32Modbus::READ_INPUT_REGISTER, 0x100, testData, sizeof(testData));
+    ASSERT_NULL(registry().getDevice(0x99));
 }
 
 TEST(ErrorHandling_ValidError) {
     resetTestState();
 
     DataTestDevice device(0x01);
-    uint8_t address = 0x01;
     device.registerDevice();
 
-    handleError(address, esp32Modbus::TIMEOUT);
+    handleError(0x01, esp32Modbus::TIMEOUT);
 
     ASSERT_TRUE(device.handleErrorCalled);
     ASSERT_EQ(ModbusError::TIMEOUT, device.lastError);
 }
 
-TEST(ErrorHandling_DeviceNotFound) {
+TEST(ErrorHandling_AbsentSlaveTimesOut) {
     resetTestState();
 
-    uint8_t address = 0x99;  // Not registered
+    DataTestDevice device(ABSENT_SLAVE);
+    device.makeReady();
 
-    // Should not crash, just log error
-    handleError(address, esp32Modbus::TIMEOUT);
+    auto result = device.readHoldingRegisters(0x00, 1);
+    ASSERT_TRUE(result.isError());
+    ASSERT_EQ(ModbusError::TIMEOUT, result.error());
+    ASSERT_TRUE(device.handleErrorCalled);
+    ASSERT_FALSE(device.handleDataCalled);
 }
 
-TEST(Callback_InvokeWithValidData) {
+TEST(ErrorHandling_DeviceNotFound) {
     resetTestState();
 
-    DataTestDevice device(0x01);
-    bool callbackInvoked = false;
-    uint8_t receivedFunctionCode = 0;
+    // Should not crash, just be dropped
+    handleError(0x99, esp32Modbus::TIMEOUT);
+    ASSERT_NULL(registry().getDevice(0x99));
+}
 
-    device.registerModbusResponseCallback([&](uint8_t functionCode, const uint8_t* data, uint16_t length) {
-        callbackInvoked = true;
-        receivedFunctionCode = functionCode;
-    });
+TEST(Callback_AsyncReadResult) {
+    resetTestState();
 
-    ASSERT_TRUE(device.hasModbusResponseCallback());
+    DataTestDevice device(PRESENT_SLAVE);
+    device.makeReady();
 
-    uint8_t testData[] = {0x01, 0x02};
-    device.invokeModbusResponseCallback(0x04, testData, sizeof(testData));
+    AsyncRecord record;
+    auto handle = device.readInputRegistersAsync(0x05, 2, onAsyncDone, &record);
+    ASSERT_TRUE(handle.isOk());
 
-    ASSERT_TRUE(callbackInvoked);
-    ASSERT_EQ(0x04, receivedFunctionCode);
+    ASSERT_EQ(1, record.calls);
+    ASSERT_EQ(ModbusError::SUCCESS, record.error);
+    ASSERT_EQ(2u, record.registers);
+    ASSERT_EQ(((PRESENT_SLAVE << 8) | 0x05) ^ 0x8000, record.firstRegister);
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
 }
 
-TEST(Callback_InvokeWithNullDataNonZeroLength) {
+TEST(Callback_AsyncErrorResult) {
     resetTestState();
 
-    DataTestDevice device(0x01);
-    bool callbackInvoked = false;
-
-    device.registerModbusResponseCallback([&](uint8_t functionCode, const uint8_t* data, uint16_t length) {
-        callbackInvoked = true;
-    });
+    DataTestDevice device(ABSENT_SLAVE);
+    device.makeReady();
 
-    // Should not invoke callback due to validation failure
-    device.invokeModbusResponseCallback(0x04, nullptr, 10);
+    AsyncRecord record;
+    auto handle = device.readHoldingRegistersAsync(0x00, 1, onAsyncDone, &record);
+    ASSERT_TRUE(handle.isOk());
 
-    ASSERT_FALSE(callbackInvoked);
+    ASSERT_EQ(1, record.calls);
+    ASSERT_EQ(ModbusError::TIMEOUT, record.error);
+    ASSERT_EQ(0u, record.registers);
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
 }
 
 TEST(Registry_GetDevice) {
@@ -203,7 +223,7 @@ TEST(Registry_GetDevice) {
 
     ASSERT_EQ(&device1, registry().getDevice(0x01));
     ASSERT_EQ(&device2, registry().getDevice(0x05));
-    ASSERT_EQ(nullptr, registry().getDevice(0x99)); // Not registered
+    ASSERT_NULL(registry().getDevice(0x99)); // Not registered
 }
 
 TEST(Registry_HasDevice) {
@@ -219,21 +239,21 @@ TEST(Registry_HasDevice) {
 TEST(Registry_GetDeviceCount) {
     resetTestState();
 
-    ASSERT_EQ(0, registry().getDeviceCount());
+    ASSERT_EQ(0u, registry().getDeviceCount());
 
     DataTestDevice device1(0x01);
     DataTestDevice device2(0x02);
     DataTestDevice device3(0x03);
 
     device1.registerDevice();
-    ASSERT_EQ(1, registry().getDeviceCount());
+    ASSERT_EQ(1u, registry().getDeviceCount());
 
     device2.registerDevice();
-    ASSERT_EQ(2, registry().getDeviceCount());
+    ASSERT_EQ(2u, registry().getDeviceCount());
 
     device3.registerDevice();
-    ASSERT_EQ(3, registry().getDeviceCount());
+    ASSERT_EQ(3u, registry().getDeviceCount());
 
     device2.unregisterDevice();
-    ASSERT_EQ(2, registry().getDeviceCount());
+    ASSERT_EQ(2u, registry().getDeviceCount());
 }
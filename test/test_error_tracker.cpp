@@ -0,0 +1,134 @@
+#include "test_framework.h"
+#include "ModbusErrorTracker.h"
+#include "Arduino.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+using Tracker = ModbusErrorTracker;
+
+// Move the clock to the start of the next long bucket so both windows start
+// with a fresh bucket
+static void alignToLongBucket() {
+    uint32_t now = millis();
+    uint32_t next = (now / MODBUS_ERROR_TRACKER_LONG_BUCKET_MS + 1) * MODBUS_ERROR_TRACKER_LONG_BUCKET_MS;
+    sim::advanceUs(static_cast<int64_t>(next - now) * 1000);
+}
+
+static void advanceMs(uint32_t ms) {
+    sim::advanceUs(static_cast<int64_t>(ms) * 1000);
+}
+
+TEST(ErrorTracker_WindowCounts) {
+    Tracker::resetAll();
+    alignToLongBucket();
+
+    const uint8_t addr = 0x31;
+    Tracker::recordSuccess(addr);
+    Tracker::recordSuccess(addr);
+    Tracker::recordSuccess(addr);
+    Tracker::recordError(addr, Tracker::ErrorCategory::TIMEOUT);
+    Tracker::recordError(addr, Tracker::ErrorCategory::CRC_ERROR);
+
+    auto shortStats = Tracker::getWindowStats(addr, Tracker::Window::SHORT);
+    ASSERT_EQ(3u, shortStats.successes);
+    ASSERT_EQ(2u, shortStats.errors);
+    ASSERT_EQ(1u, shortStats.timeouts);
+    ASSERT_TRUE(shortStats.errorRate() > 39.9f && shortStats.errorRate() < 40.1f);
+
+    auto longStats = Tracker::getWindowStats(addr, Tracker::Window::LONG);
+    ASSERT_EQ(3u, longStats.successes);
+    ASSERT_EQ(2u, longStats.errors);
+
+    // Lifetime counters track the same events
+    ASSERT_EQ(3u, Tracker::getSuccessCount(addr));
+    ASSERT_EQ(2u, Tracker::getTotalErrors(addr));
+}
+
+TEST(ErrorTracker_ShortWindowExpires) {
+    Tracker::resetAll();
+    alignToLongBucket();
+
+    const uint8_t addr = 0x31;
+    Tracker::recordError(addr, Tracker::ErrorCategory::TIMEOUT);
+
+    // Still inside the last minute
+    advanceMs(MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS * (MODBUS_ERROR_TRACKER_SHORT_BUCKETS - 1));
+    Tracker::recordSuccess(addr);
+    auto stats = Tracker::getWindowStats(addr, Tracker::Window::SHORT);
+    ASSERT_EQ(1u, stats.errors);
+    ASSERT_EQ(1u, stats.successes);
+
+    // The first bucket has rotated out of the short window, not the long one
+    advanceMs(MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS);
+    stats = Tracker::getWindowStats(addr, Tracker::Window::SHORT);
+    ASSERT_EQ(0u, stats.errors);
+    ASSERT_EQ(1u, stats.successes);
+    ASSERT_EQ(1u, Tracker::getWindowStats(addr, Tracker::Window::LONG).errors);
+
+    // A full period later the short window is empty
+    advanceMs(MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS * MODBUS_ERROR_TRACKER_SHORT_BUCKETS);
+    stats = Tracker::getWindowStats(addr, Tracker::Window::SHORT);
+    ASSERT_EQ(0u, stats.successes);
+    ASSERT_EQ(0u, stats.errors);
+    ASSERT_TRUE(stats.errorRate() == 0.0f);
+}
+
+TEST(ErrorTracker_LongWindowExpires) {
+    Tracker::resetAll();
+    alignToLongBucket();
+
+    const uint8_t addr = 0x32;
+    Tracker::recordError(addr, Tracker::ErrorCategory::DEVICE_ERROR);
+
+    advanceMs(MODBUS_ERROR_TRACKER_LONG_BUCKET_MS * (MODBUS_ERROR_TRACKER_LONG_BUCKETS - 1));
+    ASSERT_EQ(1u, Tracker::getWindowStats(addr, Tracker::Window::LONG).errors);
+
+    advanceMs(MODBUS_ERROR_TRACKER_LONG_BUCKET_MS);
+    ASSERT_EQ(0u, Tracker::getWindowStats(addr, Tracker::Window::LONG).errors);
+
+    // Recycled bucket starts from zero when written again
+    Tracker::recordSuccess(addr);
+    auto stats = Tracker::getWindowStats(addr, Tracker::Window::LONG);
+    ASSERT_EQ(1u, stats.successes);
+    ASSERT_EQ(0u, stats.errors);
+}
+
+TEST(ErrorTracker_WindowLatency) {
+    Tracker::resetAll();
+    alignToLongBucket();
+
+    const uint8_t addr = 0x31;
+    Tracker::recordRoundTrip(addr, 1000);
+    Tracker::recordRoundTrip(addr, 3000);
+    advanceMs(MODBUS_ERROR_TRACKER_SHORT_BUCKET_MS);
+    Tracker::recordRoundTrip(addr, 2000);
+
+    auto stats = Tracker::getWindowStats(addr, Tracker::Window::SHORT);
+    ASSERT_EQ(3u, stats.latencySamples);
+    ASSERT_EQ(2000u, stats.avgLatencyUs);
+    ASSERT_EQ(3000u, stats.maxLatencyUs);
+    ASSERT_EQ(0u, stats.successes);     // Round trips are not successes
+}
+
+TEST(ErrorTracker_UntrackedDevice) {
+    Tracker::resetAll();
+
+    auto stats = Tracker::getWindowStats(0xF0, Tracker::Window::SHORT);
+    ASSERT_EQ(0u, stats.successes);
+    ASSERT_EQ(0u, stats.errors);
+    ASSERT_FALSE(Tracker::isDeviceTracked(0xF0));
+}
+
+TEST(ErrorTracker_ResetDeviceClearsWindows) {
+    Tracker::resetAll();
+    alignToLongBucket();
+
+    const uint8_t addr = 0x32;
+    Tracker::recordError(addr, Tracker::ErrorCategory::TIMEOUT);
+    Tracker::resetDevice(addr);
+
+    ASSERT_EQ(0u, Tracker::getWindowStats(addr, Tracker::Window::SHORT).errors);
+    ASSERT_EQ(0u, Tracker::getWindowStats(addr, Tracker::Window::LONG).errors);
+    ASSERT_EQ(0u, Tracker::getTotalErrors(addr));
+}
@@ -27,7 +27,7 @@ public:
         return instance;
     }
 
-    void runAllTests() {
+    int runAllTests() {
         printf("\n===== Running Unit Tests =====\n");
         
         int totalTests = 0;
@@ -57,6 +57,8 @@ public:
         if (passedTests == totalTests) {
             printf("All tests passed!\n");
         }
+
+        return totalTests - passedTests;
     }
 
     void registerTest(const char* name, std::function<void()> func) {
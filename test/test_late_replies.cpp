@@ -0,0 +1,191 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t SLAVE = 0xB1;
+constexpr uint8_t ABSENT_SLAVE = 0xB2;
+constexpr uint8_t OTHER_SLAVE = 0xB3;
+
+class LateReplyDevice : public ModbusDevice {
+public:
+    explicit LateReplyDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~LateReplyDevice() override { (void)unregisterDevice(); }
+};
+
+struct Completion {
+    int calls = 0;
+    ModbusError error = ModbusError::SUCCESS;
+    uint16_t value = 0;
+};
+
+void onDone(ModbusDevice&, const ModbusDevice::AsyncResult& result) {
+    Completion* completion = static_cast<Completion*>(result.context);
+    completion->calls++;
+    completion->error = result.error;
+    if (result.isOk() && result.getRegisterCount() > 0) {
+        completion->value = result.getRegister(0);
+    }
+}
+
+void setLatency(uint32_t latencyMs) {
+    esp32ModbusRTU::SlaveConfig config;
+    config.latencyUs = latencyMs * 1000;
+    simBus().configureSlave(SLAVE, config);
+}
+
+// Queued RTU: replies come back in order while callers wait, or after they gave up
+class QueuedBus {
+public:
+    explicit QueuedBus(uint32_t latencyMs) : rtu(simBus()) {
+        setLatency(latencyMs);
+        rtu.setQueued(true);
+    }
+    ~QueuedBus() { finish(); }
+
+    // Delivers everything still queued
+    void finish() { rtu.setQueued(false); }
+
+private:
+    esp32ModbusRTU& rtu;
+};
+
+} // namespace
+
+TEST(LateReply_ExpiredAsyncSkipsNewerRequest) {
+    LateReplyDevice device(SLAVE);
+    QueuedBus bus(50);
+    ASSERT_TRUE(device.writeSingleRegister(0x10, 0x0001).isOk());
+
+    Completion expired;
+    Completion write;
+    Completion newer;
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x10, 1, onDone, &expired,
+                                                 esp32Modbus::RELAY, 20).isOk());
+    vTaskDelay(pdMS_TO_TICKS(30));
+    ASSERT_EQ(1u, device.expireAsyncRequests());
+    ASSERT_EQ(ModbusError::TIMEOUT, expired.error);
+
+    // Same FC and address again, after the register changed
+    ASSERT_TRUE(device.writeSingleRegisterAsync(0x10, 0x1234, onDone, &write).isOk());
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x10, 1, onDone, &newer).isOk());
+    bus.finish();
+
+    // The stale reply (0x0001) went to the expired request and was dropped
+    ASSERT_EQ(1, expired.calls);
+    ASSERT_EQ(1, write.calls);
+    ASSERT_EQ(1, newer.calls);
+    ASSERT_EQ(ModbusError::SUCCESS, newer.error);
+    ASSERT_EQ(0x1234, newer.value);
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
+}
+
+TEST(LateReply_CancelledAsyncSkipsNewerRequest) {
+    LateReplyDevice device(SLAVE);
+    QueuedBus bus(50);
+    ASSERT_TRUE(device.writeSingleRegister(0x11, 0x0002).isOk());
+
+    Completion cancelled;
+    Completion newer;
+    auto handle = device.readHoldingRegistersAsync(0x11, 1, onDone, &cancelled);
+    ASSERT_TRUE(handle.isOk());
+    ASSERT_TRUE(device.cancelAsync(handle.value()));
+    ASSERT_TRUE(device.writeSingleRegisterAsync(0x11, 0x5678).isOk());
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x11, 1, onDone, &newer).isOk());
+    bus.finish();
+
+    ASSERT_EQ(0, cancelled.calls);
+    ASSERT_EQ(1, newer.calls);
+    ASSERT_EQ(0x5678, newer.value);
+}
+
+TEST(LateReply_TimedOutSyncSkipsNewerRead) {
+    LateReplyDevice device(SLAVE);
+    QueuedBus bus(1200);
+
+    // The reply takes longer than the 1 s sync wait and is still queued
+    auto stale = device.readHoldingRegisters(0x20, 1);
+    ASSERT_EQ(ModbusError::TIMEOUT, stale.error());
+
+    // The next read queues behind it; the stale frame arrives first while it waits
+    setLatency(5);
+    auto fresh = device.readHoldingRegisters(0x30, 1);
+    ASSERT_TRUE(fresh.isOk());
+    ASSERT_EQ((SLAVE << 8) | 0x30, fresh.value()[0]);
+    ASSERT_EQ(0u, simBus().getQueuedCount());   // Both frames came back
+}
+
+TEST(LateReply_BroadcastWaitsForAsyncFrame) {
+    LateReplyDevice device(ABSENT_SLAVE);
+    ModbusBus& bus = ModbusRegistry::getInstance().getDefaultBus();
+    bus.setResponseTimeout(50);
+    QueuedBus queued(5);
+
+    // The broadcast's 1 ms turnaround must not become the timeout of the
+    // read still on the wire: it goes out once the read has timed out
+    Completion read;
+    const int64_t start = sim::nowUs();
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x40, 1, onDone, &read).isOk());
+    ASSERT_TRUE(bus.broadcastWriteRegister(0x40, 0x0001).isOk());
+    ASSERT_EQ(1, read.calls);
+    ASSERT_EQ(ModbusError::TIMEOUT, read.error);
+    ASSERT_TRUE(sim::nowUs() - start >= 50 * 1000);
+
+    queued.finish();
+    bus.setResponseTimeout(1000);
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
+}
+
+TEST(LateReply_RtuServesHigherPriorityFirst) {
+    LateReplyDevice device(SLAVE);
+    LateReplyDevice other(OTHER_SLAVE);
+    simBus().configureSlave(OTHER_SLAVE, esp32ModbusRTU::SlaveConfig());
+    QueuedBus bus(10);
+    simBus().resetCounters();
+
+    // The first frame is on the wire; the urgent one overtakes the second
+    Completion first;
+    Completion second;
+    Completion urgent;
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x50, 1, onDone, &first, esp32Modbus::STATUS).isOk());
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x51, 1, onDone, &second, esp32Modbus::STATUS).isOk());
+    ASSERT_TRUE(other.readHoldingRegistersAsync(0x52, 1, onDone, &urgent, esp32Modbus::EMERGENCY).isOk());
+    bus.finish();
+
+    ASSERT_EQ(3u, simBus().getFrames());
+    ASSERT_EQ(0x50, simBus().getFrame(0).address);
+    ASSERT_EQ(0x52, simBus().getFrame(1).address);
+    ASSERT_EQ(0x51, simBus().getFrame(2).address);
+    ASSERT_EQ((OTHER_SLAVE << 8) | 0x52, urgent.value);
+    ASSERT_EQ((SLAVE << 8) | 0x51, second.value);
+}
+
+TEST(LateReply_DevicePriorityPinnedWhileOutstanding) {
+    LateReplyDevice device(SLAVE);
+    QueuedBus bus(10);
+    ASSERT_TRUE(device.writeSingleRegister(0x60, 0x0001).isOk());
+    simBus().resetCounters();
+
+    // Two reads of one register around a write: only the order tells their
+    // replies apart, so the urgent read must not overtake the older one
+    Completion busy;
+    Completion before;
+    Completion after;
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x61, 1, onDone, &busy, esp32Modbus::STATUS).isOk());
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x60, 1, onDone, &before, esp32Modbus::STATUS).isOk());
+    ASSERT_TRUE(device.writeSingleRegisterAsync(0x60, 0x0002, nullptr, nullptr, esp32Modbus::STATUS).isOk());
+    ASSERT_TRUE(device.readHoldingRegistersAsync(0x60, 1, onDone, &after, esp32Modbus::EMERGENCY).isOk());
+    bus.finish();
+
+    ASSERT_EQ(4u, simBus().getFrames());
+    ASSERT_EQ(esp32Modbus::WRITE_HOLD_REGISTER, simBus().getFrame(2).fc);
+    ASSERT_EQ(0x0001, before.value);
+    ASSERT_EQ(0x0002, after.value);
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
+}
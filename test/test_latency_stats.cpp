@@ -0,0 +1,74 @@
+#include "test_framework.h"
+#include "ModbusLatencyStats.h"
+
+using namespace modbus;
+
+TEST(LatencyHistogram_BucketBounds) {
+    // Bucket b holds [2^(b-1), 2^b) us
+    ASSERT_EQ(0u, LatencyHistogram::bucketFor(0));
+    ASSERT_EQ(1u, LatencyHistogram::bucketFor(1));
+    ASSERT_EQ(2u, LatencyHistogram::bucketFor(2));
+    ASSERT_EQ(2u, LatencyHistogram::bucketFor(3));
+    ASSERT_EQ(3u, LatencyHistogram::bucketFor(4));
+    ASSERT_EQ(10u, LatencyHistogram::bucketFor(1023));
+    ASSERT_EQ(11u, LatencyHistogram::bucketFor(1024));
+
+    // Everything past the top bucket's start lands in it
+    ASSERT_EQ(size_t(MODBUS_LATENCY_BUCKETS - 1), LatencyHistogram::bucketFor(1u << (MODBUS_LATENCY_BUCKETS - 2)));
+    ASSERT_EQ(size_t(MODBUS_LATENCY_BUCKETS - 1), LatencyHistogram::bucketFor(UINT32_MAX));
+
+    ASSERT_EQ(0u, LatencyHistogram::bucketUpperUs(0));
+    ASSERT_EQ(1u, LatencyHistogram::bucketUpperUs(1));
+    ASSERT_EQ(1023u, LatencyHistogram::bucketUpperUs(10));
+    ASSERT_EQ(UINT32_MAX, LatencyHistogram::bucketUpperUs(32));
+}
+
+TEST(LatencyHistogram_Percentiles) {
+    LatencyHistogram histogram;
+    for (int i = 0; i < 90; i++) histogram.record(100);    // 64..127
+    for (int i = 0; i < 10; i++) histogram.record(1000);   // 512..1023
+    histogram.record(3000);
+
+    LatencySummary summary = histogram.summarize();
+    ASSERT_EQ(101u, summary.count);
+    ASSERT_EQ(100u, summary.minUs);
+    ASSERT_EQ(3000u, summary.maxUs);
+    // Rank 51 of 101 is in the 100 us bucket, rank 100 in the 1000 us one
+    ASSERT_EQ(127u, summary.p50Us);
+    ASSERT_EQ(1023u, summary.p99Us);
+}
+
+TEST(LatencyHistogram_SummaryClampedToObservedRange) {
+    LatencyHistogram histogram;
+    ASSERT_EQ(0u, histogram.summarize().count);
+    ASSERT_EQ(0u, histogram.summarize().p99Us);
+
+    // One bucket: its upper bound (127) would exceed every sample
+    histogram.record(70);
+    histogram.record(80);
+    LatencySummary summary = histogram.summarize();
+    ASSERT_EQ(70u, summary.minUs);
+    ASSERT_EQ(80u, summary.maxUs);
+    ASSERT_EQ(80u, summary.p50Us);
+    ASSERT_EQ(80u, summary.p99Us);
+
+    // A slow outlier: p99 reports the sample, not its bucket's 8191
+    for (int i = 0; i < 98; i++) histogram.record(75);
+    histogram.record(5000);
+    histogram.record(5000);
+    summary = histogram.summarize();
+    ASSERT_EQ(127u, summary.p50Us);
+    ASSERT_EQ(5000u, summary.p99Us);
+
+    histogram.reset();
+    summary = histogram.summarize();
+    ASSERT_EQ(0u, summary.count);
+    ASSERT_EQ(0u, summary.minUs);
+    ASSERT_EQ(0u, summary.maxUs);
+}
+
+TEST(LatencyStats_FunctionCodeStatsCompiledOut) {
+    // The unit tests build without MODBUSDEVICE_LATENCY_STATS
+    ASSERT_FALSE(ModbusLatencyStats::isEnabled());
+    ASSERT_EQ(ModbusError::NOT_SUPPORTED, ModbusLatencyStats::getFunctionCodeStats(0x03).error());
+}
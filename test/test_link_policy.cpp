@@ -0,0 +1,212 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "ModbusErrorTracker.h"
+#include "ModbusLinkPolicy.h"
+#include "ModbusPollBudget.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t FLAKY_SLAVE = 0xA1;
+constexpr uint8_t SLOW_SLAVE = 0xA2;
+constexpr uint8_t FAST_SLAVE = 0xA3;
+constexpr uint8_t BULK_SLAVE = 0xA4;
+
+using BreakerState = ModbusLinkPolicy::BreakerState;
+
+class PolicyDevice : public ModbusDevice {
+public:
+    PolicyDevice(uint8_t addr, ModbusLinkPolicy& policy) : ModbusDevice(addr) {
+        ModbusErrorTracker::resetDevice(addr);
+        setLinkPolicy(&policy);
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~PolicyDevice() override { (void)unregisterDevice(); }
+
+    ModbusError read(uint16_t count = 1) {
+        auto result = readHoldingRegisters(0x00, count);
+        return result.isOk() ? ModbusError::SUCCESS : result.error();
+    }
+};
+
+// Short timeouts and backoff so a test walks the breaker in a few virtual seconds
+ModbusLinkPolicy::Config testConfig() {
+    ModbusLinkPolicy::Config config;
+    config.maxTimeoutMs = 50;
+    config.minTimeoutMs = 10;
+    config.breakerThreshold = 3;
+    config.backoffBaseMs = 200;
+    config.backoffMaxMs = 500;
+    return config;
+}
+
+void setPresent(uint8_t slave, bool present, uint32_t latencyUs = 2000) {
+    esp32ModbusRTU::SlaveConfig config;
+    config.present = present;
+    config.latencyUs = latencyUs;
+    simBus().configureSlave(slave, config);
+}
+
+struct Probe {
+    PolicyDevice* device;
+    ModbusError error = ModbusError::SUCCESS;
+};
+
+void probeTask(void* param) {
+    Probe* probe = static_cast<Probe*>(param);
+    probe->error = probe->device->read();
+}
+
+} // namespace
+
+TEST(LinkPolicy_BreakerOpensAfterThreshold) {
+    ModbusLinkPolicy policy(testConfig());
+    PolicyDevice device(FLAKY_SLAVE, policy);
+    setPresent(FLAKY_SLAVE, false);
+    esp32ModbusRTU& rtu = simBus();
+    rtu.resetCounters();
+
+    ASSERT_EQ(ModbusError::TIMEOUT, device.read());
+    ASSERT_EQ(ModbusError::TIMEOUT, device.read());
+    ASSERT_EQ(BreakerState::CLOSED, policy.getState());
+    ASSERT_EQ(ModbusError::TIMEOUT, device.read());
+    ASSERT_EQ(BreakerState::OPEN, policy.getState());
+    ASSERT_EQ(200u, policy.getBackoffMs());
+    ASSERT_EQ(3u, rtu.getFrames());
+
+    // Open: rejected without a frame
+    ASSERT_EQ(ModbusError::DEVICE_NOT_FOUND, device.read());
+    ASSERT_EQ(ModbusError::DEVICE_NOT_FOUND, device.read());
+    ASSERT_EQ(3u, rtu.getFrames());
+    ASSERT_EQ(2u, policy.getRejectedCount());
+}
+
+TEST(LinkPolicy_FailedProbeDoublesBackoff) {
+    ModbusLinkPolicy policy(testConfig());
+    PolicyDevice device(FLAKY_SLAVE, policy);
+    setPresent(FLAKY_SLAVE, false);
+    for (int i = 0; i < 3; i++) {
+        (void)device.read();
+    }
+    ASSERT_EQ(BreakerState::OPEN, policy.getState());
+    esp32ModbusRTU& rtu = simBus();
+    rtu.resetCounters();
+
+    // Still inside the backoff
+    vTaskDelay(pdMS_TO_TICKS(150));
+    ASSERT_EQ(ModbusError::DEVICE_NOT_FOUND, device.read());
+    ASSERT_EQ(0u, rtu.getFrames());
+
+    // Expired: one probe goes out, times out and reopens for twice as long
+    vTaskDelay(pdMS_TO_TICKS(60));
+    ASSERT_EQ(ModbusError::TIMEOUT, device.read());
+    ASSERT_EQ(1u, rtu.getFrames());
+    ASSERT_EQ(BreakerState::OPEN, policy.getState());
+    ASSERT_EQ(400u, policy.getBackoffMs());
+
+    vTaskDelay(pdMS_TO_TICKS(410));
+    ASSERT_EQ(ModbusError::TIMEOUT, device.read());
+    ASSERT_EQ(500u, policy.getBackoffMs());   // Capped at backoffMaxMs
+}
+
+TEST(LinkPolicy_SuccessfulProbeCloses) {
+    ModbusLinkPolicy policy(testConfig());
+    PolicyDevice device(FLAKY_SLAVE, policy);
+    setPresent(FLAKY_SLAVE, false);
+    for (int i = 0; i < 3; i++) {
+        (void)device.read();
+    }
+    ASSERT_EQ(BreakerState::OPEN, policy.getState());
+
+    setPresent(FLAKY_SLAVE, true);
+    ASSERT_EQ(ModbusError::DEVICE_NOT_FOUND, device.read());   // Back, but not probed yet
+    vTaskDelay(pdMS_TO_TICKS(210));
+    ASSERT_EQ(ModbusError::SUCCESS, device.read());
+    ASSERT_EQ(BreakerState::CLOSED, policy.getState());
+    ASSERT_EQ(0u, policy.getBackoffMs());
+    ASSERT_EQ(ModbusError::SUCCESS, device.read());
+}
+
+TEST(LinkPolicy_HalfOpenAdmitsOneProbe) {
+    ModbusLinkPolicy::Config config = testConfig();
+    config.maxTimeoutMs = 200;
+    ModbusLinkPolicy policy(config);
+    PolicyDevice device(SLOW_SLAVE, policy);
+    setPresent(SLOW_SLAVE, false);
+    for (int i = 0; i < 3; i++) {
+        (void)device.read();
+    }
+    ASSERT_EQ(BreakerState::OPEN, policy.getState());
+    vTaskDelay(pdMS_TO_TICKS(210));
+
+    // The probe waits 50 ms for its reply on the queued RTU; a second task
+    // asking meanwhile (not joining the probe's read) is turned away
+    device.setReadDeduplication(false);
+    setPresent(SLOW_SLAVE, true, 50 * 1000);
+    esp32ModbusRTU& rtu = simBus();
+    rtu.setQueued(true);
+    rtu.resetCounters();
+    Probe second{&device};
+    sim::spawn(probeTask, &second);
+    ModbusError probe = device.read();
+    rtu.setQueued(false);
+
+    ASSERT_EQ(0u, sim::liveTasks());
+    ASSERT_EQ(ModbusError::SUCCESS, probe);
+    ASSERT_EQ(ModbusError::DEVICE_NOT_FOUND, second.error);
+    ASSERT_EQ(1u, rtu.getFrames());
+    ASSERT_EQ(BreakerState::CLOSED, policy.getState());
+}
+
+TEST(LinkPolicy_AdaptiveTimeoutFollowsRtt) {
+    ModbusLinkPolicy policy(testConfig());
+    PolicyDevice device(FAST_SLAVE, policy);
+    setPresent(FAST_SLAVE, true);
+
+    ASSERT_EQ(50u, policy.getTimeoutMs(FAST_SLAVE));   // No samples yet: the maximum
+    for (int i = 0; i < MODBUS_LINK_MIN_SAMPLES; i++) {
+        ASSERT_EQ(ModbusError::SUCCESS, device.read());
+    }
+
+    // A few ms round trip clamps to the minimum
+    ASSERT_EQ(static_cast<uint32_t>(MODBUS_LINK_MIN_SAMPLES), ModbusErrorTracker::getRoundTripSamples(FAST_SLAVE));
+    ASSERT_EQ(10u, policy.getTimeoutMs(FAST_SLAVE));
+}
+
+TEST(LinkPolicy_LargeReadsGetTheirWireTime) {
+    ModbusLinkPolicy::Config config = testConfig();
+    config.minTimeoutMs = MODBUS_LINK_MIN_TIMEOUT_MS;
+    config.maxTimeoutMs = 200;
+    ModbusLinkPolicy policy(config);
+    PolicyDevice device(BULK_SLAVE, policy);
+    setPresent(BULK_SLAVE, true);
+
+    // Wire speed as the bus assumes it: a 125 register reply takes ~300 ms
+    esp32ModbusRTU& rtu = simBus();
+    rtu.setBaudRate(MODBUS_BAUD_RATE);
+    rtu.setQueued(true);
+
+    for (int i = 0; i < MODBUS_LINK_MIN_SAMPLES; i++) {
+        ASSERT_EQ(ModbusError::SUCCESS, device.read());
+    }
+    ASSERT_EQ(static_cast<uint32_t>(MODBUS_LINK_MIN_TIMEOUT_MS), policy.getTimeoutMs(BULK_SLAVE));
+
+    // Learned on single registers, yet the large reads are not cut short,
+    // and they do not stretch the timeout of the small ones
+    ModbusError small = ModbusError::SUCCESS;
+    ModbusError large = ModbusError::SUCCESS;
+    for (int i = 0; i < 4 && large == ModbusError::SUCCESS && small == ModbusError::SUCCESS; i++) {
+        large = device.read(125);
+        small = device.read();
+    }
+    rtu.setQueued(false);
+    rtu.setBaudRate(115200);
+
+    ASSERT_EQ(ModbusError::SUCCESS, large);
+    ASSERT_EQ(ModbusError::SUCCESS, small);
+    ASSERT_EQ(static_cast<uint32_t>(MODBUS_LINK_MIN_TIMEOUT_MS), policy.getTimeoutMs(BULK_SLAVE));
+    ASSERT_TRUE(policy.getTimeoutMs(BULK_SLAVE, ModbusPollBudget::estimateTransactionUs(0x03, 125, MODBUS_BAUD_RATE)) > 300);
+}
@@ -1,30 +1,6 @@
 #include "test_framework.h"
-#include "mock_freertos.h"
-#include "mock_logger.h"
-
-// Mock esp32Modbus types
-namespace esp32Modbus {
-    enum FunctionCode {
-        READ_COILS = 0x01,
-        READ_INPUT_REGISTERS = 0x04,
-        WRITE_SINGLE_COIL = 0x05,
-        WRITE_SINGLE_REGISTER = 0x06
-    };
-
-    enum Error {
-        SUCCESS = 0,
-        TIMEOUT = 1,
-        INVALID_RESPONSE = 2,
-        CRC_ERROR = 3
-    };
-}
-
-// Mock global ModbusRTU
-esp32ModbusRTU* globalModbusRTU = nullptr;
-
-// Include the source files for testing
-#include "../src/ModbusRegistry.cpp"
-#include "../src/ModbusDevice.cpp"
+#include "ModbusDevice.h"
+#include "ModbusRegistry.h"
 
 using namespace modbus;
 
@@ -66,10 +42,6 @@ void resetGlobalState() {
     for (uint8_t addr = 1; addr <= 247; addr++) {
         registry().unregisterDevice(addr);
     }
-
-    // Reset mock flags
-    mockMutexShouldFail = false;
-    mockMutexCreateShouldFail = false;
 }
 
 TEST(ModbusDevice_Construction) {
@@ -152,6 +124,7 @@ TEST(ModbusDevice_SetServerAddress) {
 
     TestModbusDevice device(0x01);
     device.registerDevice();
+    device.setInitPhase(ModbusDevice::InitPhase::READY);  // only READY devices re-register
 
     // Change to valid address
     auto result = device.setServerAddress(0x10);
@@ -197,7 +170,7 @@ TEST(ModbusDevice_HandleResponse_DuringConfig) {
 
     // During CONFIGURING phase, responses should be handled without warnings
     uint8_t data[] = {0x01, 0x02, 0x03, 0x04};
-    mainHandleData(0x01, esp32Modbus::READ_INPUT_REGISTERS, 0x1000, data, sizeof(data));
+    mainHandleData(0x01, esp32Modbus::READ_INPUT_REGISTER, 0x1000, data, sizeof(data));
 
     ASSERT_TRUE(device.handleResponseCalled);
     ASSERT_EQ(0x04, device.lastFunctionCode); // READ_INPUT_REGISTERS
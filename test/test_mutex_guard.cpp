@@ -1,103 +1,92 @@
 #include "test_framework.h"
-#include "mock_freertos.h"
-#include "mock_logger.h"
+#include "MutexGuard.h"
+#include "sim_clock.h"
 
-// Define logger instance
-Logger logger;
+namespace {
 
-// Mock control flags
-bool mockMutexShouldFail = false;
-bool mockMutexCreateShouldFail = false;
-
-// Include the header under test
-#include "../src/ModbusDevice.h"
-
-// Reset mock state before each test
-void resetMockState() {
-    mockMutexShouldFail = false;
-    mockMutexCreateShouldFail = false;
+// A zero-wait take succeeds only while nobody holds the mutex
+bool isFree(SemaphoreHandle_t mutex) {
+    if (xSemaphoreTake(mutex, 0) != pdTRUE) {
+        return false;
+    }
+    xSemaphoreGive(mutex);
+    return true;
 }
 
+} // namespace
+
 TEST(MutexGuard_ConstructorAcquiresMutex) {
-    resetMockState();
-    
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     ASSERT_NOT_NULL(mutex);
-    
+
     {
         MutexGuard guard(mutex);
         ASSERT_TRUE(guard.hasLock());
-        
+
         // Verify mutex is taken
-        MockSemaphore* mockMutex = static_cast<MockSemaphore*>(mutex);
-        ASSERT_TRUE(mockMutex->taken);
+        ASSERT_FALSE(isFree(mutex));
     }
-    
+
     // Verify mutex is released after guard destruction
-    MockSemaphore* mockMutex = static_cast<MockSemaphore*>(mutex);
-    ASSERT_FALSE(mockMutex->taken);
-    
+    ASSERT_TRUE(isFree(mutex));
+
     vSemaphoreDelete(mutex);
 }
 
 TEST(MutexGuard_HandlesNullMutex) {
-    resetMockState();
-    
     MutexGuard guard(nullptr);
     ASSERT_FALSE(guard.hasLock());
 }
 
 TEST(MutexGuard_HandlesMutexAcquisitionFailure) {
-    resetMockState();
-    
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     ASSERT_NOT_NULL(mutex);
-    
-    // Make mutex acquisition fail
-    mockMutexShouldFail = true;
-    
+
+    // Held elsewhere for longer than the guard waits
+    ASSERT_EQ(pdTRUE, xSemaphoreTake(mutex, portMAX_DELAY));
+
+    int64_t start = sim::nowUs();
     {
-        MutexGuard guard(mutex);
+        MutexGuard guard(mutex, pdMS_TO_TICKS(5));
         ASSERT_FALSE(guard.hasLock());
     }
-    
+    ASSERT_EQ(5000, sim::nowUs() - start);   // Waited the full timeout
+
+    xSemaphoreGive(mutex);
     vSemaphoreDelete(mutex);
 }
 
 TEST(MutexGuard_DestructorOnlyReleasesOwnedMutex) {
-    resetMockState();
-    
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     ASSERT_NOT_NULL(mutex);
-    
+
     // Take mutex manually
     ASSERT_EQ(pdTRUE, xSemaphoreTake(mutex, portMAX_DELAY));
-    
+
     {
         // Guard should fail to acquire already-taken mutex
         MutexGuard guard(mutex, 0);  // 0 timeout
         ASSERT_FALSE(guard.hasLock());
     }
-    
+
     // Mutex should still be taken after guard destruction
-    MockSemaphore* mockMutex = static_cast<MockSemaphore*>(mutex);
-    ASSERT_TRUE(mockMutex->taken);
-    
+    ASSERT_FALSE(isFree(mutex));
+
     // Release and cleanup
     xSemaphoreGive(mutex);
     vSemaphoreDelete(mutex);
 }
 
 TEST(MutexGuard_SupportsTimeout) {
-    resetMockState();
-    
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     ASSERT_NOT_NULL(mutex);
-    
+
+    int64_t start = sim::nowUs();
     {
-        MutexGuard guard(mutex, 1000);  // 1 second timeout
+        MutexGuard guard(mutex, pdMS_TO_TICKS(1000));  // 1 second timeout
         ASSERT_TRUE(guard.hasLock());
     }
-    
+    ASSERT_EQ(0, sim::nowUs() - start);      // A free mutex is taken without waiting
+
     vSemaphoreDelete(mutex);
-}
\ No newline at end of file
+}
@@ -0,0 +1,165 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "PointTableDevice.h"
+#include "sim_clock.h"
+#include <cmath>
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t TABLE_SLAVE = 0xC5;
+constexpr uint8_t ABSENT_SLAVE = 0xC6;
+
+const PointDef tablePoints[] = {
+    {"u32_hi", "",  0x03, 0x0010, PointType::U32,     WordOrder::HIGH_FIRST, 0.5f,  1000},
+    {"u32_lo", "",  0x03, 0x0012, PointType::U32,     WordOrder::LOW_FIRST,  1.0f,  1000},
+    {"i32_hi", "",  0x03, 0x0014, PointType::I32,     WordOrder::HIGH_FIRST, 1.0f,  1000},
+    {"i32_lo", "",  0x03, 0x0016, PointType::I32,     WordOrder::LOW_FIRST,  0.1f,  1000},
+    {"f_hi",   "V", 0x03, 0x0018, PointType::FLOAT32, WordOrder::HIGH_FIRST, 2.0f,  1000},
+    {"f_lo",   "A", 0x03, 0x001A, PointType::FLOAT32, WordOrder::LOW_FIRST,  1.0f,  1000},
+    {"slow",   "",  0x04, 0x0040, PointType::U16,     WordOrder::HIGH_FIRST, 1.0f,  10000},
+    {"far",    "",  0x03, 0x0080, PointType::U16,     WordOrder::HIGH_FIRST, 1.0f,  1000},
+};
+constexpr size_t TABLE_POINTS = sizeof(tablePoints) / sizeof(tablePoints[0]);
+
+bool near(float expected, float actual) {
+    return std::fabs(expected - actual) <= std::fabs(expected) * 1e-6f + 1e-6f;
+}
+
+void setPresent(uint8_t slave, bool present) {
+    esp32ModbusRTU::SlaveConfig config;
+    config.present = present;
+    simBus().configureSlave(slave, config);
+}
+
+class TableDevice : public PointTableDevice {
+public:
+    TableDevice(uint8_t addr, const PointDef* points, size_t count) : PointTableDevice(addr, points, count) {}
+    ~TableDevice() override { (void)unregisterDevice(); }
+};
+
+} // namespace
+
+TEST(PointTable_GroupsByPeriod) {
+    setPresent(TABLE_SLAVE, true);
+    TableDevice device(TABLE_SLAVE, tablePoints, TABLE_POINTS);
+    ASSERT_TRUE(device.initialize());
+
+    // 1000 ms: 0x10-0x1B in one read, 0x80 too far to bridge; 10 s: FC04 0x40
+    ASSERT_EQ(2u, device.getGroupCount());
+    ASSERT_EQ(3u, device.getBlockCount());
+
+    esp32ModbusRTU& rtu = simBus();
+    rtu.resetCounters();
+    ASSERT_TRUE(device.updateAll().isOk());
+    ASSERT_EQ(3u, rtu.getFrames());
+    ASSERT_EQ(esp32Modbus::READ_HOLD_REGISTER, rtu.getFrame(0).fc);
+    ASSERT_EQ(0x0010, rtu.getFrame(0).address);
+    ASSERT_EQ(esp32Modbus::READ_HOLD_REGISTER, rtu.getFrame(1).fc);
+    ASSERT_EQ(0x0080, rtu.getFrame(1).address);
+    ASSERT_EQ(esp32Modbus::READ_INPUT_REGISTER, rtu.getFrame(2).fc);
+    ASSERT_EQ(0x0040, rtu.getFrame(2).address);
+}
+
+TEST(PointTable_DecodesWordOrdersAndScale) {
+    setPresent(TABLE_SLAVE, true);
+    TableDevice device(TABLE_SLAVE, tablePoints, TABLE_POINTS);
+    ASSERT_TRUE(device.initialize());
+
+    // 0x12345678, 0x89ABCDEF, -2, -100000, 1.5f (0x3FC00000), -0.25f (0xBE800000)
+    const std::vector<uint16_t> image = {
+        0x1234, 0x5678,   0xCDEF, 0x89AB,   0xFFFF, 0xFFFE,
+        0x7960, 0xFFFE,   0x3FC0, 0x0000,   0x0000, 0xBE80,
+    };
+    ASSERT_TRUE(device.writeMultipleRegisters(0x0010, image).isOk());
+    ASSERT_TRUE(device.updateAll().isOk());
+
+    ASSERT_EQ(0x12345678, device.getRawValue(0).value());
+    ASSERT_TRUE(near(0x12345678 * 0.5f, device.getFloat(0).value()));
+    ASSERT_EQ(static_cast<int32_t>(0x89ABCDEFu), device.getRawValue(1).value());
+    ASSERT_TRUE(near(static_cast<float>(0x89ABCDEFu), device.getFloat(1).value()));
+    ASSERT_EQ(-2, device.getRawValue(2).value());
+    ASSERT_TRUE(near(-2.0f, device.getFloat(2).value()));
+    ASSERT_EQ(-100000, device.getRawValue(3).value());
+    ASSERT_TRUE(near(-10000.0f, device.getFloat(3).value()));
+    ASSERT_EQ(0x3FC00000, device.getRawValue(4).value());
+    ASSERT_TRUE(near(3.0f, device.getFloat(4).value()));
+    ASSERT_TRUE(near(-0.25f, device.getFloat(5).value()));
+    ASSERT_TRUE(near(-0.25f, device.getValues()[5]));
+
+    // Input registers read as holding ^ 0x8000 in the simulator
+    ASSERT_EQ(((TABLE_SLAVE << 8) | 0x40) ^ 0x8000, device.getRawValue(6).value());
+}
+
+TEST(PointTable_UpdatePollsDueGroupsOnly) {
+    setPresent(TABLE_SLAVE, true);
+    TableDevice device(TABLE_SLAVE, tablePoints, TABLE_POINTS);
+    ASSERT_TRUE(device.initialize());
+    esp32ModbusRTU& rtu = simBus();
+
+    rtu.resetCounters();
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(3u, rtu.getFrames());
+    ASSERT_TRUE(device.hasValidData());
+
+    // Nothing is due yet
+    rtu.resetCounters();
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(0u, rtu.getFrames());
+    ASSERT_TRUE(device.getTimeUntilDueMs() > 900);
+
+    // Only the fast group
+    sim::advanceUs(1000 * 1000);
+    rtu.resetCounters();
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(2u, rtu.getFrames());
+    ASSERT_EQ(esp32Modbus::READ_HOLD_REGISTER, rtu.getFrame(0).fc);
+
+    // Both once the slow period is over
+    sim::advanceUs(9100 * 1000);
+    rtu.resetCounters();
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(3u, rtu.getFrames());
+}
+
+TEST(PointTable_FailedFirstPollWaitsForPeriod) {
+    setPresent(ABSENT_SLAVE, false);
+    ModbusBus& bus = ModbusRegistry::getInstance().getDefaultBus();
+    bus.setResponseTimeout(50);
+    TableDevice device(ABSENT_SLAVE, tablePoints, TABLE_POINTS);
+    ASSERT_TRUE(device.initialize());
+    esp32ModbusRTU& rtu = simBus();
+
+    rtu.resetCounters();
+    ASSERT_FALSE(device.update().isOk());
+    const uint32_t firstPoll = rtu.getFrames();
+    ASSERT_TRUE(firstPoll > 0);
+    ASSERT_FALSE(device.hasValidData());
+
+    // Retried at the group rate, not on every update()
+    rtu.resetCounters();
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(0u, rtu.getFrames());
+    ASSERT_TRUE(device.getTimeUntilDueMs() > 0);
+
+    sim::advanceUs(1000 * 1000);
+    ASSERT_FALSE(device.update().isOk());
+    ASSERT_TRUE(rtu.getFrames() > 0);
+    bus.setResponseTimeout(1000);
+}
+
+TEST(PointTable_ValuesNotInitializedBeforeFirstRead) {
+    setPresent(TABLE_SLAVE, true);
+    TableDevice device(TABLE_SLAVE, tablePoints, TABLE_POINTS);
+    ASSERT_TRUE(device.initialize());
+
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, device.getFloat(0).error());
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, device.getRawValue(6).error());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, device.getFloat(TABLE_POINTS).error());
+    ASSERT_FALSE(device.hasValidData());
+
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_TRUE(device.getFloat(0).isOk());
+    ASSERT_TRUE(device.getRawValue(6).isOk());
+}
@@ -0,0 +1,94 @@
+#include "test_framework.h"
+#include "ModbusPollBudget.h"
+#include "sim_clock.h"
+#include <cmath>
+
+using namespace modbus;
+
+namespace {
+
+void nextWindow() {
+    sim::advanceUs(int64_t(MODBUS_BUDGET_WINDOW_MS) * 1000);
+}
+
+} // namespace
+
+TEST(PollBudget_FrameTimeEstimates) {
+    // (request + response + 7 gap characters) x 11 bits
+    // FC01 x16: 8 + (5 + 2) + 7 = 22 characters at 9600 baud
+    ASSERT_EQ(25208u, ModbusPollBudget::estimateTransactionUs(0x01, 16, 9600));
+    // FC03 x10: 8 + (5 + 20) + 7 = 40
+    ASSERT_EQ(45833u, ModbusPollBudget::estimateTransactionUs(0x03, 10, 9600));
+    // FC0F x16: (9 + 2) + 8 + 7 = 26 at 19200
+    ASSERT_EQ(14895u, ModbusPollBudget::estimateTransactionUs(0x0F, 16, 19200));
+    // FC10 x4: (9 + 8) + 8 + 7 = 32 at 115200
+    ASSERT_EQ(3055u, ModbusPollBudget::estimateTransactionUs(0x10, 4, 115200));
+
+    // Baud 0 falls back to MODBUS_BAUD_RATE
+    ASSERT_EQ(ModbusPollBudget::estimateTransactionUs(0x03, 10, MODBUS_BAUD_RATE),
+              ModbusPollBudget::estimateTransactionUs(0x03, 10, 0));
+}
+
+TEST(PollBudget_StretchesStaticPollersFirst) {
+    ModbusPollBudget budget;
+    // Each alone would hold the bus 100% at its min period
+    uint8_t volatileId = budget.addPoller(50000, 50).value();
+    uint8_t staticId = budget.addPoller(50000, 50).value();
+    ASSERT_EQ(50u, budget.getPeriodMs(volatileId));
+    ASSERT_EQ(50u, budget.getPeriodMs(staticId));
+
+    for (int i = 0; i < 40; i++) {
+        budget.reportPoll(volatileId, true);
+        budget.reportPoll(staticId, false);
+    }
+    ASSERT_TRUE(budget.getVolatility(staticId) < 0.01f);
+    ASSERT_TRUE(budget.getVolatility(volatileId) > 0.99f);
+
+    // Nothing recomputes inside the window
+    budget.update();
+    ASSERT_EQ(50u, budget.getPeriodMs(staticId));
+
+    nextWindow();
+    budget.update();
+    const uint32_t volatilePeriod = budget.getPeriodMs(volatileId);
+    const uint32_t staticPeriod = budget.getPeriodMs(staticId);
+    ASSERT_TRUE(volatilePeriod > 50);
+    ASSERT_TRUE(staticPeriod > 3 * volatilePeriod);
+    ASSERT_TRUE(staticPeriod <= 50 * MODBUS_BUDGET_MAX_STRETCH);
+
+    // The stretched periods bring the estimate down to the target
+    ASSERT_TRUE(std::fabs(budget.getPredictedUtilization() - budget.getTargetUtilization()) < 0.02f);
+}
+
+TEST(PollBudget_MaxPeriodBoundsStretch) {
+    ModbusPollBudget budget;
+    budget.setTargetUtilization(0.05f);
+    uint8_t id = budget.addPoller(100000, 100, 300).value();
+    budget.reportPoll(id, false);
+
+    nextWindow();
+    budget.update();
+    ASSERT_EQ(300u, budget.getPeriodMs(id));
+}
+
+TEST(PollBudget_PeriodsReturnToMinWithRoom) {
+    ModbusPollBudget budget;
+    uint8_t heavyId = budget.addPoller(80000, 50).value();
+    uint8_t lightId = budget.addPoller(20000, 50).value();
+    for (int i = 0; i < 40; i++) {
+        budget.reportPoll(heavyId, true);
+        budget.reportPoll(lightId, false);
+    }
+    nextWindow();
+    budget.update();
+    ASSERT_TRUE(budget.getPeriodMs(heavyId) > 50);
+    ASSERT_TRUE(budget.getPeriodMs(lightId) > 50);
+
+    // The heavy poller goes away; the light one alone fits
+    budget.removePoller(heavyId);
+    ASSERT_EQ(1u, budget.getPollerCount());
+    nextWindow();
+    budget.update();
+    ASSERT_EQ(50u, budget.getPeriodMs(lightId));
+    ASSERT_EQ(0u, budget.getPeriodMs(heavyId));
+}
@@ -1,296 +1,317 @@
 #include "test_framework.h"
-#include "mock_freertos.h"
-#include "mock_logger.h"
-#include "../src/QueuedModbusDevice.h"
-
-// Mock esp32Modbus types
-namespace esp32Modbus {
-    enum FunctionCode {
-        READ_INPUT_REGISTERS = 0x04,
-        WRITE_SINGLE_REGISTER = 0x06
-    };
-    
-    enum Error {
-        SUCCESS = 0,
-        TIMEOUT = 1,
-        INVALID_RESPONSE = 2,
-        CRC_ERROR = 3
+#include "test_sim_bus.h"
+#include "QueuedModbusDevice.h"
+#include "ModbusPacketPool.h"
+#include "sim_clock.h"
+#include <vector>
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t QUEUED_SLAVE = 0x51;
+constexpr uint8_t ABSENT_SLAVE = 0x52;
+
+uint16_t holding(uint16_t reg) { return static_cast<uint16_t>((QUEUED_SLAVE << 8) | reg); }
+
+// Records what the queue hands to onAsyncResponse()
+class TestQueuedDevice : public QueuedModbusDevice {
+public:
+    struct Packet {
+        uint8_t functionCode;
+        uint16_t address;
+        size_t length;
+        uint16_t firstRegister;
     };
-}
 
-// Mock global ModbusRTU
-esp32ModbusRTU* globalModbusRTU = nullptr;
+    std::vector<Packet> packets;
+    int queueFullCalls = 0;
+    int errorCalls = 0;
 
-using namespace modbus;
+    explicit TestQueuedDevice(uint8_t addr) : QueuedModbusDevice(addr) {}
+    ~TestQueuedDevice() override { (void)unregisterDevice(); }
+
+    void makeReady() {
+        registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+
+    void setPhase(InitPhase phase) { setInitPhase(phase); }
+    esp_err_t send(uint8_t fc, uint16_t addr, uint16_t count) { return sendRequest(fc, addr, count); }
+
+protected:
+    void onAsyncResponse(uint8_t functionCode, uint16_t address,
+                         const uint8_t* data, size_t length) override {
+        Packet packet;
+        packet.functionCode = functionCode;
+        packet.address = address;
+        packet.length = length;
+        packet.firstRegister = (data && length >= 2) ? static_cast<uint16_t>((data[0] << 8) | data[1]) : 0;
+        packets.push_back(packet);
+    }
+
+    void onQueueFull() override { queueFullCalls++; }
+
+    void handleModbusError(ModbusError error) override {
+        errorCalls++;
+        QueuedModbusDevice::handleModbusError(error);
+    }
+};
 
-// Test implementation to access protected members
-class TestQueuedModbusDevice : public QueuedModbusDevice {
+// Input device that refreshes one FC03 channel through the queue
+class TestQueuedInput : public QueuedModbusInputDevice {
 public:
-    TestQueuedModbusDevice(uint8_t addr) : QueuedModbusDevice(addr) {}
-    
-    // Expose protected methods for testing
-    void testHandleModbusResponse(uint8_t functionCode, uint16_t address, 
-                                const uint8_t* data, size_t length) {
-        handleModbusResponse(functionCode, address, data, length);
+    explicit TestQueuedInput(uint8_t addr) : QueuedModbusInputDevice(addr) {
+        registerDevice();
+        enableAsync(4);
+        setInitPhase(InitPhase::READY);
     }
-    
-    void testHandleModbusError(ModbusError error) {
-        handleModbusError(error);
+    ~TestQueuedInput() override { (void)unregisterDevice(); }
+
+    uint16_t value = 0;
+
+    size_t getChannelCount() const override { return 1; }
+    const char* getChannelName(size_t) const override { return "Level"; }
+    const char* getChannelUnits(size_t) const override { return "mm"; }
+    ModbusResult<float> getFloat(size_t channel) const override {
+        if (channel != 0) return ModbusResult<float>::error(ModbusError::INVALID_PARAMETER);
+        return ModbusResult<float>::ok(static_cast<float>(value));
     }
-    
-    // Access internals for testing
-    size_t getQueueSize() const {
-        return requestQueue ? uxQueueMessagesWaiting(requestQueue) : 0;
+    ModbusResult<int32_t> getRawValue(size_t channel) const override {
+        if (channel != 0) return ModbusResult<int32_t>::error(ModbusError::INVALID_PARAMETER);
+        return ModbusResult<int32_t>::ok(value);
     }
-    
-    bool hasActiveRequest() const {
-        return activeRequest.has_value();
+    float getScaleFactor(size_t) const override { return 1.0f; }
+    bool getRange(size_t, float&, float&) const override { return false; }
+
+protected:
+    ModbusResult<void> triggerUpdate() override {
+        auto handle = readHoldingRegistersAsync(0x0030, 1);
+        if (handle.isError()) return ModbusResult<void>::error(handle.error());
+        return ModbusResult<void>::ok();
+    }
+
+    void onAsyncResponse(uint8_t, uint16_t, const uint8_t* data, size_t length) override {
+        if (!data || length < 2) return;
+        value = static_cast<uint16_t>((data[0] << 8) | data[1]);
+        lastUpdateTime = xTaskGetTickCount() * portTICK_PERIOD_MS;
+        publishValue(0, static_cast<float>(value));
     }
 };
 
-// Mock implementations
-bool mockQueueSendResult = true;
-bool mockQueueReceiveResult = false;
-ModbusRequest mockReceivedRequest;
+void resetBus() {
+    esp32ModbusRTU& rtu = simBus();
+    rtu.configureSlave(QUEUED_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    rtu.resetCounters();
+    sim::advanceUs(1000);
+}
+
+int changeCount = 0;
+void countChange(const ChangeEvent&, void*) { changeCount++; }
+
+} // namespace
 
 TEST(QueuedModbusDevice_Construction) {
-    TestQueuedModbusDevice device(0x01);
-    
-    ASSERT_EQ(0x01, device.getServerAddress());
-    ASSERT_FALSE(device.hasActiveRequest());
+    TestQueuedDevice device(QUEUED_SLAVE);
+
+    ASSERT_EQ(QUEUED_SLAVE, device.getServerAddress());
+    ASSERT_FALSE(device.isAsyncEnabled());
+    ASSERT_EQ(0u, device.getQueueDepth());
+    ASSERT_EQ(0u, device.processQueue());
+    ASSERT_NULL(device.getDispatcher());
 }
 
-TEST(QueuedModbusDevice_InitializeQueue) {
-    TestQueuedModbusDevice device(0x01);
-    
-    auto result = device.initializeQueue(10);
-    ASSERT_TRUE(result.isOk());
-    
-    // Queue should be created
-    ASSERT_TRUE(device.isQueueInitialized());
+TEST(QueuedModbusDevice_EnableAsync) {
+    TestQueuedDevice device(QUEUED_SLAVE);
+
+    ASSERT_TRUE(device.enableAsync(4));
+    ASSERT_TRUE(device.isAsyncEnabled());
+    ASSERT_EQ(0u, device.getQueueDepth());
+
+    // Enabling again keeps the existing queue
+    ASSERT_TRUE(device.enableAsync(8));
+    ASSERT_TRUE(device.isAsyncEnabled());
 }
 
-TEST(QueuedModbusDevice_EnqueueRequest_Success) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    
-    ModbusRequest request;
-    request.functionCode = 0x04;
-    request.address = 0x1000;
-    request.data = {0x00, 0x0A};
-    request.id = 123;
-    
-    mockQueueSendResult = true;
-    auto result = device.enqueueRequest(request);
-    
-    ASSERT_TRUE(result.isOk());
+TEST(QueuedModbusDevice_SendRequest_Queued) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(4));
+
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0010, 2));
+
+    // The response waits in the queue until processQueue()
+    ASSERT_EQ(1u, device.getQueueDepth());
+    ASSERT_EQ(0u, device.packets.size());
+
+    ASSERT_EQ(1u, device.processQueue());
+    ASSERT_EQ(1u, device.packets.size());
+    ASSERT_EQ(0x03, device.packets[0].functionCode);
+    ASSERT_EQ(0x0010, device.packets[0].address);
+    ASSERT_EQ(4u, device.packets[0].length);
+    ASSERT_EQ(holding(0x0010), device.packets[0].firstRegister);
+    ASSERT_EQ(0u, device.getQueueDepth());
 }
 
-TEST(QueuedModbusDevice_EnqueueRequest_QueueFull) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    
-    ModbusRequest request;
-    request.functionCode = 0x04;
-    request.address = 0x1000;
-    
-    mockQueueSendResult = false;
-    auto result = device.enqueueRequest(request);
-    
-    ASSERT_FALSE(result.isOk());
-    ASSERT_EQ(ModbusError::QUEUE_FULL, result.error);
+TEST(QueuedModbusDevice_AsyncRead_Queued) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(4));
+
+    // Without a callback the async reply goes through the queue
+    auto handle = device.readHoldingRegistersAsync(0x0020, 1);
+    ASSERT_TRUE(handle.isOk());
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
+    ASSERT_EQ(1u, device.getQueueDepth());
+
+    ASSERT_EQ(1u, device.processQueue());
+    ASSERT_EQ(holding(0x0020), device.packets[0].firstRegister);
 }
 
-TEST(QueuedModbusDevice_EnqueueRequest_NoQueue) {
-    TestQueuedModbusDevice device(0x01);
-    
-    ModbusRequest request;
-    auto result = device.enqueueRequest(request);
-    
-    ASSERT_FALSE(result.isOk());
-    ASSERT_EQ(ModbusError::NOT_INITIALIZED, result.error);
+TEST(QueuedModbusDevice_QueueFull) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(2));
+    const size_t freeBlocks = ModbusPacketPool::getFreeCount();
+
+    for (uint16_t i = 0; i < 3; i++) {
+        ASSERT_EQ(ESP_OK, device.send(0x03, i, 1));
+    }
+
+    // The overflowing reply is dropped and its pool block returned
+    ASSERT_EQ(1, device.queueFullCalls);
+    ASSERT_EQ(2u, device.getQueueDepth());
+    ASSERT_EQ(freeBlocks - 2, ModbusPacketPool::getFreeCount());
+
+    ASSERT_EQ(2u, device.processQueue());
+    ASSERT_EQ(freeBlocks, ModbusPacketPool::getFreeCount());
+    ASSERT_EQ(holding(0x0000), device.packets[0].firstRegister);
+    ASSERT_EQ(holding(0x0001), device.packets[1].firstRegister);
 }
 
-TEST(QueuedModbusDevice_ProcessQueue_EmptyQueue) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    device.registerDevice();
-    
-    mockQueueReceiveResult = false;
-    auto result = device.processQueue();
-    
-    // Should succeed but no request processed
-    ASSERT_TRUE(result.isOk());
-    ASSERT_FALSE(device.hasActiveRequest());
+TEST(QueuedModbusDevice_ProcessQueue_Limit) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(4));
+
+    for (uint16_t i = 0; i < 3; i++) {
+        ASSERT_EQ(ESP_OK, device.send(0x03, i, 1));
+    }
+
+    ASSERT_EQ(1u, device.processQueue(1));
+    ASSERT_EQ(2u, device.getQueueDepth());
+    ASSERT_EQ(2u, device.processQueue());
+    ASSERT_EQ(0u, device.processQueue());
+    ASSERT_EQ(3u, device.packets.size());
 }
 
-TEST(QueuedModbusDevice_ProcessQueue_WithRequest) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
+TEST(QueuedModbusDevice_Configuring_NotQueued) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
     device.registerDevice();
-    
-    // Setup mock to return a request
-    mockQueueReceiveResult = true;
-    mockReceivedRequest.functionCode = 0x04;
-    mockReceivedRequest.address = 0x1000;
-    mockReceivedRequest.data = {0x00, 0x05};
-    mockReceivedRequest.id = 456;
-    
-    auto result = device.processQueue();
-    
-    // Should process the request
+    ASSERT_TRUE(device.enableAsync(4));
+    device.setPhase(ModbusDevice::InitPhase::CONFIGURING);
+
+    // Initialization reads are synchronous and bypass the queue
+    auto result = device.readHoldingRegisters(0x0040, 1);
     ASSERT_TRUE(result.isOk());
-    ASSERT_TRUE(device.hasActiveRequest());
+    ASSERT_EQ(holding(0x0040), result.value()[0]);
+    ASSERT_EQ(0u, device.getQueueDepth());
 }
 
-TEST(QueuedModbusDevice_ProcessQueue_NotReady) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    // Device is still UNINITIALIZED
-    
-    auto result = device.processQueue();
-    
-    ASSERT_FALSE(result.isOk());
-    ASSERT_EQ(ModbusError::NOT_INITIALIZED, result.error);
-}
+TEST(QueuedModbusDevice_SyncMode_NotQueued) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
 
-TEST(QueuedModbusDevice_HandleResponse_NoActiveRequest) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    
-    uint8_t data[] = {0x00, 0x0A};
-    device.testHandleModbusResponse(0x04, 0x1000, data, sizeof(data));
-    
-    // Should handle gracefully
-    ASSERT_FALSE(device.hasActiveRequest());
-}
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0010, 1));
+    ASSERT_EQ(0u, device.getQueueDepth());
+    ASSERT_EQ(0u, device.processQueue());
+    ASSERT_EQ(0u, device.packets.size());
 
-TEST(QueuedModbusDevice_Callback_Registration) {
-    TestQueuedModbusDevice device(0x01);
-    
-    bool callbackCalled = false;
-    uint32_t callbackId = 0;
-    ModbusError callbackError = ModbusError::SUCCESS;
-    
-    auto callback = [&](uint32_t id, const ModbusResponse& resp) {
-        callbackCalled = true;
-        callbackId = id;
-        callbackError = resp.error;
-    };
-    
-    device.setResponseCallback(callback);
-    
-    // Simulate response callback
-    ModbusResponse response;
-    response.requestId = 789;
-    response.error = ModbusError::TIMEOUT;
-    
-    // Manually trigger callback (in real code this happens in handleModbusResponse)
-    device.setResponseCallback(callback);
-    callback(response.requestId, response);
-    
-    ASSERT_TRUE(callbackCalled);
-    ASSERT_EQ(789, callbackId);
-    ASSERT_EQ(ModbusError::TIMEOUT, callbackError);
+    auto result = device.readHoldingRegisters(0x0011, 1);
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(holding(0x0011), result.value()[0]);
 }
 
-TEST(QueuedModbusDevice_Statistics) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    
-    auto stats1 = device.getStatistics();
-    uint32_t initialRequests = stats1.totalRequests;
-    
-    // Enqueue a request
-    ModbusRequest request;
-    request.functionCode = 0x06;
-    request.address = 0x2000;
-    request.data = {0x12, 0x34};
-    
-    mockQueueSendResult = true;
-    device.enqueueRequest(request);
-    
-    // Process it
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    device.registerDevice();
-    mockQueueReceiveResult = true;
-    mockReceivedRequest = request;
-    
-    device.processQueue();
-    
-    auto stats2 = device.getStatistics();
-    ASSERT_EQ(initialRequests + 1, stats2.totalRequests);
-}
+TEST(QueuedModbusDevice_DisableAsync) {
+    resetBus();
+    TestQueuedDevice device(QUEUED_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(4));
+    const size_t freeBlocks = ModbusPacketPool::getFreeCount();
 
-TEST(QueuedModbusDevice_ClearQueue) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    
-    // Add multiple requests
-    ModbusRequest request;
-    request.functionCode = 0x04;
-    mockQueueSendResult = true;
-    
-    device.enqueueRequest(request);
-    device.enqueueRequest(request);
-    device.enqueueRequest(request);
-    
-    // Clear queue
-    device.clearQueue();
-    
-    // Queue should be empty
-    mockQueueReceiveResult = false;
-    auto result = device.processQueue();
-    ASSERT_TRUE(result.isOk());
-    ASSERT_FALSE(device.hasActiveRequest());
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0000, 1));
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0001, 1));
+
+    // Disabling drains the queue and hands the blocks back
+    device.disableAsync();
+    ASSERT_EQ(0u, device.getQueueDepth());
+    ASSERT_EQ(freeBlocks, ModbusPacketPool::getFreeCount());
+
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0002, 1));
+    ASSERT_EQ(0u, device.getQueueDepth());
+    ASSERT_EQ(0u, device.processQueue());
+    ASSERT_EQ(0u, device.packets.size());
+
+    // Re-enabling reuses the queue
+    ASSERT_TRUE(device.enableAsync());
+    ASSERT_EQ(ESP_OK, device.send(0x03, 0x0003, 1));
+    ASSERT_EQ(1u, device.processQueue());
 }
 
-TEST(QueuedModbusDevice_HandleError_WithActiveRequest) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    device.registerDevice();
-    
-    // Setup active request
-    mockQueueReceiveResult = true;
-    mockReceivedRequest.functionCode = 0x04;
-    mockReceivedRequest.address = 0x1000;
-    mockReceivedRequest.id = 999;
-    
-    device.processQueue();
-    ASSERT_TRUE(device.hasActiveRequest());
-    
-    // Trigger error
-    bool callbackCalled = false;
-    ModbusError receivedError = ModbusError::SUCCESS;
-    
-    device.setResponseCallback([&](uint32_t id, const ModbusResponse& resp) {
-        callbackCalled = true;
-        receivedError = resp.error;
-    });
-    
-    device.testHandleModbusError(ModbusError::TIMEOUT);
-    
-    // Active request should be cleared
-    ASSERT_FALSE(device.hasActiveRequest());
+TEST(QueuedModbusDevice_HandleError) {
+    resetBus();
+    TestQueuedDevice device(ABSENT_SLAVE);
+    device.makeReady();
+    ASSERT_TRUE(device.enableAsync(4));
+
+    auto handle = device.readHoldingRegistersAsync(0x0000, 1);
+    ASSERT_TRUE(handle.isOk());
+
+    // Errors go to handleModbusError(), never into the response queue
+    ASSERT_EQ(1, device.errorCalls);
     ASSERT_EQ(ModbusError::TIMEOUT, device.getLastError());
+    ASSERT_EQ(0u, device.getPendingAsyncCount());
+    ASSERT_EQ(0u, device.getQueueDepth());
 }
 
-TEST(QueuedModbusDevice_IModbusDevice_Interface) {
-    TestQueuedModbusDevice device(0x01);
-    device.initializeQueue(5);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    device.registerDevice();
-    
-    // Test through IModbusDevice interface
-    IModbusDevice* modbusDevice = &device;
-    
-    // These should all enqueue requests
-    auto result1 = modbusDevice->readHoldingRegisters(0x1000, 10);
-    ASSERT_TRUE(result1.isOk() || result1.error == ModbusError::QUEUE_FULL);
-    
-    auto result2 = modbusDevice->writeSingleRegister(0x2000, 0x1234);
-    ASSERT_TRUE(result2.isOk() || result2.error == ModbusError::QUEUE_FULL);
-}
\ No newline at end of file
+TEST(QueuedModbusDevice_Destructor_ReturnsBlocks) {
+    resetBus();
+    const size_t freeBlocks = ModbusPacketPool::getFreeCount();
+    {
+        TestQueuedDevice device(QUEUED_SLAVE);
+        device.makeReady();
+        ASSERT_TRUE(device.enableAsync(4));
+        ASSERT_EQ(ESP_OK, device.send(0x03, 0x0000, 1));
+        ASSERT_EQ(freeBlocks - 1, ModbusPacketPool::getFreeCount());
+    }
+    ASSERT_EQ(freeBlocks, ModbusPacketPool::getFreeCount());
+    ASSERT_FALSE(ModbusRegistry::getInstance().hasDevice(QUEUED_SLAVE));
+}
+
+TEST(QueuedModbusDevice_IModbusInput_Interface) {
+    resetBus();
+    TestQueuedInput device(QUEUED_SLAVE);
+    IModbusAnalogInput& input = device;
+    changeCount = 0;
+    ASSERT_TRUE(input.subscribe(0, Deadband{}, countChange).isOk());
+
+    ASSERT_FALSE(input.hasValidData());
+    ASSERT_EQ(UINT32_MAX, input.getDataAge());
+
+    // First update only sends the read; the second delivers its reply
+    ASSERT_TRUE(input.update().isOk());
+    ASSERT_FALSE(input.hasValidData());
+    ASSERT_TRUE(input.update().isOk());
+    ASSERT_TRUE(input.hasValidData());
+    ASSERT_EQ(holding(0x0030), input.getRawValue(0).value());
+    ASSERT_EQ(1, changeCount);
+
+    sim::advanceUs(40 * 1000);
+    ASSERT_TRUE(input.getDataAge() >= 40);
+}
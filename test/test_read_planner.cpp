@@ -0,0 +1,115 @@
+#include "test_framework.h"
+#include "ModbusReadPlanner.h"
+
+using namespace modbus;
+
+TEST(ReadPlanner_Empty) {
+    ModbusReadPlanner planner;
+    planner.plan(nullptr, 0);
+
+    ASSERT_EQ(0u, planner.blocks().size());
+    ASSERT_EQ(0u, planner.order().size());
+    ASSERT_EQ(0u, planner.getRegisterCount());
+}
+
+TEST(ReadPlanner_MergesWithinGap) {
+    // 0x10 (1 reg), 0x12 (2 regs), 0x20 (1 reg): gap 1 merges, gap 12 does not
+    const ReadItem items[] = {
+        {0x03, 0x20, 1},
+        {0x03, 0x10, 1},
+        {0x03, 0x12, 2},
+    };
+    ModbusReadPlanner planner(4, 125);
+    planner.plan(items, 3);
+
+    ASSERT_EQ(2u, planner.blocks().size());
+
+    const ReadBlock& first = planner.blocks()[0];
+    ASSERT_EQ(0x03, first.functionCode);
+    ASSERT_EQ(0x10, first.address);
+    ASSERT_EQ(4, first.count);          // 0x10..0x13, including the hole at 0x11
+    ASSERT_EQ(0, first.firstItem);
+    ASSERT_EQ(2, first.itemCount);
+
+    const ReadBlock& second = planner.blocks()[1];
+    ASSERT_EQ(0x20, second.address);
+    ASSERT_EQ(1, second.count);
+    ASSERT_EQ(2, second.firstItem);
+    ASSERT_EQ(1, second.itemCount);
+
+    // order() lists item indices by address
+    ASSERT_EQ(1, planner.order()[0]);
+    ASSERT_EQ(2, planner.order()[1]);
+    ASSERT_EQ(0, planner.order()[2]);
+
+    ASSERT_EQ(5u, planner.getRegisterCount());
+}
+
+TEST(ReadPlanner_ZeroGapKeepsHolesOut) {
+    const ReadItem items[] = {
+        {0x03, 0, 1},
+        {0x03, 1, 1},   // adjacent: merges
+        {0x03, 3, 1},   // one register hole: separate block
+    };
+    ModbusReadPlanner planner(0, 125);
+    planner.plan(items, 3);
+
+    ASSERT_EQ(2u, planner.blocks().size());
+    ASSERT_EQ(2, planner.blocks()[0].count);
+    ASSERT_EQ(3, planner.blocks()[1].address);
+}
+
+TEST(ReadPlanner_SplitsByFunctionCode) {
+    const ReadItem items[] = {
+        {0x04, 0x00, 1},
+        {0x03, 0x01, 1},
+        {0x03, 0x00, 1},
+    };
+    ModbusReadPlanner planner(8, 125);
+    planner.plan(items, 3);
+
+    ASSERT_EQ(2u, planner.blocks().size());
+    ASSERT_EQ(0x03, planner.blocks()[0].functionCode);
+    ASSERT_EQ(2, planner.blocks()[0].count);
+    ASSERT_EQ(0x04, planner.blocks()[1].functionCode);
+    ASSERT_EQ(1, planner.blocks()[1].count);
+}
+
+TEST(ReadPlanner_RespectsMaxCount) {
+    const ReadItem items[] = {
+        {0x03, 0, 2},
+        {0x03, 2, 2},
+        {0x03, 4, 2},   // would make the block 6 registers
+    };
+    ModbusReadPlanner planner(0, 4);
+    planner.plan(items, 3);
+
+    ASSERT_EQ(2u, planner.blocks().size());
+    ASSERT_EQ(0, planner.blocks()[0].address);
+    ASSERT_EQ(4, planner.blocks()[0].count);
+    ASSERT_EQ(4, planner.blocks()[1].address);
+    ASSERT_EQ(2, planner.blocks()[1].count);
+}
+
+TEST(ReadPlanner_OverlappingItems) {
+    // A 32-bit value and a view of its low word share one block
+    const ReadItem items[] = {
+        {0x03, 0x101, 1},
+        {0x03, 0x100, 2},
+    };
+    ModbusReadPlanner planner(0, 125);
+    planner.plan(items, 2);
+
+    ASSERT_EQ(1u, planner.blocks().size());
+    ASSERT_EQ(0x100, planner.blocks()[0].address);
+    ASSERT_EQ(2, planner.blocks()[0].count);
+    ASSERT_EQ(2, planner.blocks()[0].itemCount);
+}
+
+TEST(ReadPlanner_InvalidMaxCountFallsBack) {
+    ModbusReadPlanner planner(0, 0);
+    ASSERT_EQ(MODBUS_MAX_REGISTER_COUNT, planner.getMaxCount());
+
+    planner.setMaxCount(MODBUS_MAX_REGISTER_COUNT + 1);
+    ASSERT_EQ(MODBUS_MAX_REGISTER_COUNT, planner.getMaxCount());
+}
@@ -0,0 +1,202 @@
+#include "test_framework.h"
+#include "ModbusRegisterCache.h"
+#include "test_sim_bus.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+TEST(RegisterCache_AddRangeValidation) {
+    ModbusRegisterCache cache;
+
+    ASSERT_TRUE(cache.addRange(0x03, 0x00, 8, 100).isOk());
+    ASSERT_TRUE(cache.addRange(0x04, 0x00, 8, 100).isOk());   // Other table: no overlap
+    ASSERT_EQ(2u, cache.getRangeCount());
+
+    // Overlap within the holding table
+    auto overlap = cache.addRange(0x03, 0x07, 2, 100);
+    ASSERT_TRUE(overlap.isError());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, overlap.error());
+
+    // Only FC03/FC04, 1..125 registers
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, cache.addRange(0x01, 0x20, 1, 100).error());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, cache.addRange(0x03, 0x20, 0, 100).error());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER,
+              cache.addRange(0x03, 0x20, MODBUS_MAX_REGISTER_COUNT + 1, 100).error());
+    ASSERT_EQ(2u, cache.getRangeCount());
+}
+
+TEST(RegisterCache_OutOfStorage) {
+    ModbusRegisterCache cache;
+
+    // Fill the register storage exactly
+    ASSERT_TRUE(cache.addRange(0x03, 0, MODBUS_MAX_REGISTER_COUNT, 100).isOk());
+    ASSERT_TRUE(cache.addRange(0x04, 0, MODBUS_REGISTER_CACHE_MAX_REGISTERS - MODBUS_MAX_REGISTER_COUNT,
+                               100).isOk());
+    auto full = cache.addRange(0x04, 0x100, 1, 100);
+    ASSERT_TRUE(full.isError());
+    ASSERT_EQ(ModbusError::RESOURCE_ERROR, full.error());
+
+    cache.clear();
+    for (uint16_t i = 0; i < MODBUS_REGISTER_CACHE_MAX_RANGES; i++) {
+        ASSERT_TRUE(cache.addRange(0x03, i * 2, 1, 100).isOk());
+    }
+    ASSERT_EQ(ModbusError::RESOURCE_ERROR, cache.addRange(0x04, 0, 1, 100).error());
+}
+
+TEST(RegisterCache_FreshOnlyAfterFullStore) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x03, 0x10, 4, 100);
+
+    uint16_t out[4] = {};
+    ASSERT_FALSE(cache.lookup(0x03, 0x10, 1, out));
+    ASSERT_EQ(1u, cache.getMisses());
+
+    // A partial store updates values but leaves the range stale
+    const uint16_t part[] = {11, 12};
+    cache.store(0x03, 0x10, 2, part);
+    ASSERT_FALSE(cache.lookup(0x03, 0x10, 1, out));
+
+    const uint16_t full[] = {1, 2, 3, 4};
+    cache.store(0x03, 0x10, 4, full);
+    ASSERT_TRUE(cache.lookup(0x03, 0x11, 2, out));
+    ASSERT_EQ(2, out[0]);
+    ASSERT_EQ(3, out[1]);
+    ASSERT_EQ(1u, cache.getHits());
+
+    // Not covered by any range: neither a hit nor a miss
+    ASSERT_FALSE(cache.lookup(0x03, 0x13, 2, out));
+    ASSERT_FALSE(cache.lookup(0x04, 0x10, 1, out));
+    ASSERT_EQ(1u, cache.getHits());
+    ASSERT_EQ(2u, cache.getMisses());
+}
+
+TEST(RegisterCache_Expiry) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x04, 0x00, 2, 50);
+
+    const uint16_t values[] = {7, 8};
+    cache.store(0x04, 0x00, 2, values);
+
+    uint16_t out[2] = {};
+    sim::advanceUs(40 * 1000);
+    ASSERT_TRUE(cache.lookup(0x04, 0x00, 2, out));
+
+    sim::advanceUs(20 * 1000);
+    ASSERT_FALSE(cache.lookup(0x04, 0x00, 2, out));
+}
+
+TEST(RegisterCache_WritesUpdateHoldingTable) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x03, 0x00, 4, 1000);
+
+    const uint16_t values[] = {1, 2, 3, 4};
+    cache.store(0x03, 0x00, 4, values);
+
+    // An FC06 write lands in the FC03 range
+    const uint16_t written = 99;
+    cache.store(0x06, 0x02, 1, &written);
+
+    uint16_t out = 0;
+    ASSERT_TRUE(cache.lookup(0x03, 0x02, 1, &out));
+    ASSERT_EQ(99, out);
+}
+
+TEST(RegisterCache_Invalidate) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x03, 0x00, 2, 1000);
+    cache.addRange(0x03, 0x10, 2, 1000);
+
+    const uint16_t values[] = {1, 2};
+    cache.store(0x03, 0x00, 2, values);
+    cache.store(0x03, 0x10, 2, values);
+
+    uint16_t out[2] = {};
+    cache.invalidate(0x03, 0x01, 1);
+    ASSERT_FALSE(cache.lookup(0x03, 0x00, 2, out));
+    ASSERT_TRUE(cache.lookup(0x03, 0x10, 2, out));
+
+    cache.invalidateAll();
+    ASSERT_FALSE(cache.lookup(0x03, 0x10, 2, out));
+}
+
+TEST(RegisterCache_FindRange) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x04, 0x20, 8, 1000);
+
+    uint16_t rangeAddress = 0;
+    uint16_t rangeCount = 0;
+    ASSERT_TRUE(cache.findRange(0x04, 0x22, 2, rangeAddress, rangeCount));
+    ASSERT_EQ(0x20, rangeAddress);
+    ASSERT_EQ(8, rangeCount);
+
+    ASSERT_FALSE(cache.findRange(0x04, 0x27, 2, rangeAddress, rangeCount));  // Runs past the end
+    ASSERT_FALSE(cache.findRange(0x03, 0x22, 2, rangeAddress, rangeCount));
+}
+
+TEST(RegisterCache_HasChangedSince) {
+    ModbusRegisterCache cache;
+    cache.addRange(0x03, 0x00, 2, 1000);
+
+    const uint16_t values[] = {5, 6};
+    sim::advanceUs(1000);
+    TickType_t before = xTaskGetTickCount();
+    sim::advanceUs(1000);
+    cache.store(0x03, 0x00, 2, values);     // First data counts as a change
+    ASSERT_TRUE(cache.hasChangedSince(0x03, 0x00, 2, before));
+
+    TickType_t seen = xTaskGetTickCount();
+    sim::advanceUs(1000);
+    cache.store(0x03, 0x00, 2, values);     // Same values: no change
+    ASSERT_FALSE(cache.hasChangedSince(0x03, 0x00, 2, seen));
+
+    const uint16_t other[] = {5, 7};
+    cache.store(0x03, 0x00, 2, other);
+    ASSERT_TRUE(cache.hasChangedSince(0x03, 0x01, 1, seen));
+    ASSERT_FALSE(cache.hasChangedSince(0x03, 0x10, 1, seen));  // Outside every range
+}
+
+namespace {
+
+constexpr uint8_t CACHED_SLAVE = 0x61;
+
+class CachedTestDevice : public ModbusDevice {
+public:
+    explicit CachedTestDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~CachedTestDevice() override { (void)unregisterDevice(); }
+};
+
+} // namespace
+
+TEST(RegisterCache_AsyncWriteThrough) {
+    esp32ModbusRTU& rtu = simBus();
+    rtu.configureSlave(CACHED_SLAVE, esp32ModbusRTU::SlaveConfig{});
+
+    ModbusRegisterCache cache;
+    cache.addRange(0x03, 0x00, 4, 1000);
+    CachedTestDevice device(CACHED_SLAVE);
+    device.setRegisterCache(&cache);
+    ASSERT_TRUE(device.readHoldingRegisters(0x00, 4).isOk());
+
+    // A completed async FC06 lands in the cached holding range
+    ASSERT_TRUE(device.writeSingleRegisterAsync(0x02, 77).isOk());
+    rtu.resetCounters();
+    auto read = device.readHoldingRegisters(0x02, 1);
+    ASSERT_TRUE(read.isOk());
+    ASSERT_EQ(77, read.value()[0]);
+    ASSERT_EQ(0u, rtu.getFrames());
+
+    // A failed one leaves the register's state unknown
+    esp32ModbusRTU::SlaveConfig absent;
+    absent.present = false;
+    rtu.configureSlave(CACHED_SLAVE, absent);
+    ASSERT_TRUE(device.writeSingleRegisterAsync(0x02, 78).isOk());
+    uint16_t out[4] = {};
+    ASSERT_FALSE(cache.lookup(0x03, 0x00, 4, out));
+
+    rtu.configureSlave(CACHED_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    ASSERT_TRUE(device.writeSingleRegister(0x02, (CACHED_SLAVE << 8) | 0x02).isOk());
+    device.setRegisterCache(nullptr);
+}
@@ -0,0 +1,158 @@
+#include "test_framework.h"
+#include "ModbusRegisterMap.h"
+#include <vector>
+
+using namespace modbus;
+
+namespace {
+
+constexpr PointDef meterPoints[] = {
+    {"energy",  "kWh", 0x04, 0x0156, PointType::U32, WordOrder::HIGH_FIRST, 0.01f},
+    {"voltage", "V",   0x04, 0x0000, PointType::FLOAT32},
+    {"current", "A",   0x04, 0x0006, PointType::FLOAT32, WordOrder::LOW_FIRST},
+    {"offset",  "",    0x03, 0x0010, PointType::I16},
+    {"status",  "",    0x03, 0x0011, PointType::U16},
+    {"total",   "",    0x03, 0x0020, PointType::I32, WordOrder::LOW_FIRST},
+};
+
+using MeterMap = RegisterMap<meterPoints, 8, MODBUS_MAX_REGISTER_COUNT>;
+
+// Planned at compile time: FC03 0x10-0x11, FC03 0x20-0x21, FC04 0x00-0x07, FC04 0x156-0x157
+static_assert(MeterMap::blockCount == 4, "");
+static_assert(MeterMap::imageSize == 2 + 2 + 8 + 2, "");
+
+constexpr PointDef splitPoints[] = {
+    {"a", "", 0x03, 0, PointType::U32},
+    {"b", "", 0x03, 2, PointType::U32},
+    {"c", "", 0x03, 4, PointType::U32},
+};
+
+using SplitMap = RegisterMap<splitPoints, 0, 4>;
+static_assert(SplitMap::blockCount == 2, "MaxCount splits the run");
+
+// Answers block reads from a register space where each register holds its
+// address (FC04 adds 0x4000), and records the requests it saw
+struct FakeDevice {
+    struct Request { uint8_t fc; uint16_t address; uint16_t count; };
+    std::vector<Request> requests;
+    ModbusError failWith = ModbusError::SUCCESS;
+
+    ModbusResult<size_t> readHoldingRegisters(uint16_t address, uint16_t count,
+                                              uint16_t* dest, size_t capacity) {
+        return fill(0x03, address, count, dest, capacity);
+    }
+
+    ModbusResult<size_t> readInputRegisters(uint16_t address, uint16_t count,
+                                            uint16_t* dest, size_t capacity) {
+        return fill(0x04, address, count, dest, capacity);
+    }
+
+    ModbusResult<size_t> fill(uint8_t fc, uint16_t address, uint16_t count,
+                              uint16_t* dest, size_t capacity) {
+        requests.push_back({fc, address, count});
+        if (failWith != ModbusError::SUCCESS) {
+            return ModbusResult<size_t>::error(failWith);
+        }
+        for (size_t i = 0; i < count && i < capacity; i++) {
+            dest[i] = static_cast<uint16_t>((fc == 0x04 ? 0x4000 : 0) + address + i);
+        }
+        return ModbusResult<size_t>::ok(count);
+    }
+};
+
+} // namespace
+
+TEST(RegisterMap_Blocks) {
+    ASSERT_EQ(0x03, MeterMap::blocks[0].functionCode);
+    ASSERT_EQ(0x0010, MeterMap::blocks[0].address);
+    ASSERT_EQ(2, MeterMap::blocks[0].count);
+    ASSERT_EQ(0, MeterMap::blocks[0].imageOffset);
+
+    ASSERT_EQ(0x0020, MeterMap::blocks[1].address);     // 14 register gap > 8
+    ASSERT_EQ(2, MeterMap::blocks[1].imageOffset);
+
+    ASSERT_EQ(0x04, MeterMap::blocks[2].functionCode);
+    ASSERT_EQ(0x0000, MeterMap::blocks[2].address);
+    ASSERT_EQ(8, MeterMap::blocks[2].count);            // 0x02-0x05 bridged
+    ASSERT_EQ(4, MeterMap::blocks[2].imageOffset);
+
+    ASSERT_EQ(0x0156, MeterMap::blocks[3].address);
+    ASSERT_EQ(12, MeterMap::blocks[3].imageOffset);
+}
+
+TEST(RegisterMap_Offsets) {
+    ASSERT_EQ(12, MeterMap::offsetOf<0>());
+    ASSERT_EQ(4, MeterMap::offsetOf<1>());
+    ASSERT_EQ(10, MeterMap::offsetOf<2>());
+    ASSERT_EQ(0, MeterMap::offsetOf<3>());
+    ASSERT_EQ(1, MeterMap::offsetOf<4>());
+    ASSERT_EQ(2, MeterMap::offsetOf(5));
+}
+
+TEST(RegisterMap_Decode) {
+    MeterMap::Image image{};
+
+    // energy: U32 high word first, scaled by 0.01
+    image[MeterMap::offsetOf<0>()] = 0x0001;
+    image[MeterMap::offsetOf<0>() + 1] = 0x86A0;    // 100000
+    ASSERT_EQ(100000u, MeterMap::raw<0>(image.data()));
+    ASSERT_TRUE(MeterMap::value<0>(image.data()) > 999.9f && MeterMap::value<0>(image.data()) < 1000.1f);
+
+    // voltage: FLOAT32 230.0f = 0x43660000
+    image[MeterMap::offsetOf<1>()] = 0x4366;
+    image[MeterMap::offsetOf<1>() + 1] = 0x0000;
+    ASSERT_TRUE(MeterMap::value<1>(image.data()) == 230.0f);
+
+    // current: FLOAT32 low word first, 1.5f = 0x3FC00000
+    image[MeterMap::offsetOf<2>()] = 0x0000;
+    image[MeterMap::offsetOf<2>() + 1] = 0x3FC0;
+    ASSERT_TRUE(MeterMap::value<2>(image.data()) == 1.5f);
+
+    // offset: I16 sign extension
+    image[MeterMap::offsetOf<3>()] = 0xFFFE;
+    ASSERT_EQ(-2, MeterMap::raw<3>(image.data()));
+    ASSERT_TRUE(MeterMap::value<3>(image.data()) == -2.0f);
+
+    // total: I32 low word first
+    image[MeterMap::offsetOf<5>()] = 0xFFFF;
+    image[MeterMap::offsetOf<5>() + 1] = 0xFFFF;
+    ASSERT_EQ(-1, MeterMap::raw<5>(image.data()));
+
+    // The runtime overload decodes the same way
+    ASSERT_TRUE(MeterMap::value(1, image.data()) == MeterMap::value<1>(image.data()));
+    ASSERT_TRUE(MeterMap::value(3, image.data()) == MeterMap::value<3>(image.data()));
+    ASSERT_TRUE(MeterMap::value(5, image.data()) == -1.0f);
+}
+
+TEST(RegisterMap_Read) {
+    FakeDevice device;
+    MeterMap::Image image{};
+
+    ASSERT_TRUE(MeterMap::read(device, image.data()).isOk());
+    ASSERT_EQ(MeterMap::blockCount, device.requests.size());
+    ASSERT_EQ(0x03, device.requests[0].fc);
+    ASSERT_EQ(0x04, device.requests[3].fc);
+    ASSERT_EQ(0x0156, device.requests[3].address);
+
+    ASSERT_EQ(0x0011, MeterMap::raw<4>(image.data()));
+    ASSERT_EQ(0x4000u + 0x0006, image[MeterMap::offsetOf<2>()]);
+}
+
+TEST(RegisterMap_ReadStopsOnError) {
+    FakeDevice device;
+    device.failWith = ModbusError::TIMEOUT;
+    MeterMap::Image image{};
+
+    auto result = MeterMap::read(device, image.data());
+    ASSERT_TRUE(result.isError());
+    ASSERT_EQ(ModbusError::TIMEOUT, result.error());
+    ASSERT_EQ(1u, device.requests.size());
+}
+
+TEST(RegisterMap_SplitByMaxCount) {
+    ASSERT_EQ(0, SplitMap::blocks[0].address);
+    ASSERT_EQ(4, SplitMap::blocks[0].count);
+    ASSERT_EQ(4, SplitMap::blocks[1].address);
+    ASSERT_EQ(2, SplitMap::blocks[1].count);
+    ASSERT_EQ(4, SplitMap::offsetOf<2>());
+}
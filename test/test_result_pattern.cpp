@@ -1,5 +1,6 @@
 #include "test_framework.h"
 #include "../src/ModbusTypes.h"
+#include <vector>
 
 using namespace modbus;
 
@@ -11,15 +12,14 @@ TEST(Result_BasicUsage) {
     
     ASSERT_TRUE(successResult.isOk());
     ASSERT_FALSE(successResult.isError());
-    ASSERT_EQ(42, successResult.value);
-    ASSERT_EQ(ModbusError::SUCCESS, successResult.error);
+    ASSERT_EQ(42, successResult.value());
     
     // Test error result
-    ModbusResult<int> errorResult = ModbusResult<int>::err(ModbusError::TIMEOUT);
+    ModbusResult<int> errorResult = ModbusResult<int>::error(ModbusError::TIMEOUT);
     
     ASSERT_FALSE(errorResult.isOk());
     ASSERT_TRUE(errorResult.isError());
-    ASSERT_EQ(ModbusError::TIMEOUT, errorResult.error);
+    ASSERT_EQ(ModbusError::TIMEOUT, errorResult.error());
 }
 
 TEST(Result_VoidSpecialization) {
@@ -28,19 +28,18 @@ TEST(Result_VoidSpecialization) {
     
     ASSERT_TRUE(successResult.isOk());
     ASSERT_FALSE(successResult.isError());
-    ASSERT_EQ(ModbusError::SUCCESS, successResult.error);
     
     // Test error void result
-    ModbusResult<void> errorResult = ModbusResult<void>::err(ModbusError::CRC_ERROR);
+    ModbusResult<void> errorResult = ModbusResult<void>::error(ModbusError::CRC_ERROR);
     
     ASSERT_FALSE(errorResult.isOk());
     ASSERT_TRUE(errorResult.isError());
-    ASSERT_EQ(ModbusError::CRC_ERROR, errorResult.error);
+    ASSERT_EQ(ModbusError::CRC_ERROR, errorResult.error());
 }
 
 TEST(Result_BoolOperator) {
     ModbusResult<int> successResult = ModbusResult<int>::ok(100);
-    ModbusResult<int> errorResult = ModbusResult<int>::err(ModbusError::INVALID_PARAMETER);
+    ModbusResult<int> errorResult = ModbusResult<int>::error(ModbusError::INVALID_PARAMETER);
     
     // Test bool operator
     if (successResult) {
@@ -60,7 +59,7 @@ TEST(Result_BoolOperator) {
 
 TEST(Result_ValueOr) {
     ModbusResult<int> successResult = ModbusResult<int>::ok(42);
-    ModbusResult<int> errorResult = ModbusResult<int>::err(ModbusError::NOT_INITIALIZED);
+    ModbusResult<int> errorResult = ModbusResult<int>::error(ModbusError::NOT_INITIALIZED);
     
     ASSERT_EQ(42, successResult.valueOr(100));
     ASSERT_EQ(100, errorResult.valueOr(100));
@@ -73,35 +72,27 @@ TEST(Result_VectorType) {
         ModbusResult<std::vector<uint16_t>>::ok(testData);
     
     ASSERT_TRUE(successResult.isOk());
-    ASSERT_EQ(3, successResult.value.size());
-    ASSERT_EQ(0x1234, successResult.value[0]);
-    ASSERT_EQ(0x5678, successResult.value[1]);
-    ASSERT_EQ(0xABCD, successResult.value[2]);
+    ASSERT_EQ(3u, successResult.value().size());
+    ASSERT_EQ(0x1234, successResult.value()[0]);
+    ASSERT_EQ(0x5678, successResult.value()[1]);
+    ASSERT_EQ(0xABCD, successResult.value()[2]);
 }
 
 TEST(Result_ErrorPropagation) {
     // Simulate error propagation pattern
     auto operation1 = []() -> ModbusResult<int> {
-        return ModbusResult<int>::err(ModbusError::COMMUNICATION_ERROR);
-    };
-    
-    auto operation2 = [](int value) -> ModbusResult<float> {
-        return ModbusResult<float>::ok(value * 1.5f);
+        return ModbusResult<int>::error(ModbusError::COMMUNICATION_ERROR);
     };
     
     // Test error propagation
     auto result1 = operation1();
-    if (!result1.isOk()) {
-        // Propagate error
-        ModbusResult<float> propagatedError = 
-            ModbusResult<float>::err(result1.error);
-        
-        ASSERT_FALSE(propagatedError.isOk());
-        ASSERT_EQ(ModbusError::COMMUNICATION_ERROR, propagatedError.error);
-    } else {
-        auto result2 = operation2(result1.value);
-        ASSERT_TRUE(false); // Should not reach here
-    }
+    ASSERT_FALSE(result1.isOk());
+
+    // Propagate error
+    ModbusResult<float> propagatedError = ModbusResult<float>::error(result1.error());
+    
+    ASSERT_FALSE(propagatedError.isOk());
+    ASSERT_EQ(ModbusError::COMMUNICATION_ERROR, propagatedError.error());
 }
 
 TEST(Result_ChainedOperations) {
@@ -110,12 +101,12 @@ TEST(Result_ChainedOperations) {
         if (addr == 0x1000) {
             return ModbusResult<uint16_t>::ok(0x1234);
         }
-        return ModbusResult<uint16_t>::err(ModbusError::INVALID_DATA_ADDRESS);
+        return ModbusResult<uint16_t>::error(ModbusError::ILLEGAL_DATA_ADDRESS);
     };
     
     auto convertToFloat = [](uint16_t value) -> ModbusResult<float> {
         if (value == 0) {
-            return ModbusResult<float>::err(ModbusError::INVALID_DATA_VALUE);
+            return ModbusResult<float>::error(ModbusError::ILLEGAL_DATA_VALUE);
         }
         return ModbusResult<float>::ok(value / 10.0f);
     };
@@ -124,14 +115,14 @@ TEST(Result_ChainedOperations) {
     auto result1 = readRegister(0x1000);
     ASSERT_TRUE(result1.isOk());
     
-    auto result2 = convertToFloat(result1.value);
+    auto result2 = convertToFloat(result1.value());
     ASSERT_TRUE(result2.isOk());
-    ASSERT_EQ(123.4f, result2.value);
+    ASSERT_EQ(0x1234 / 10.0f, result2.value());
     
     // Test error in first operation
     auto result3 = readRegister(0x2000);
     ASSERT_FALSE(result3.isOk());
-    ASSERT_EQ(ModbusError::INVALID_DATA_ADDRESS, result3.error);
+    ASSERT_EQ(ModbusError::ILLEGAL_DATA_ADDRESS, result3.error());
 }
 
 TEST(ModbusError_Values) {
@@ -145,4 +136,4 @@ TEST(ModbusError_Values) {
     // Library-specific errors should be 0x80+
     ASSERT_TRUE(static_cast<int>(ModbusError::TIMEOUT) >= 0x80);
     ASSERT_TRUE(static_cast<int>(ModbusError::CRC_ERROR) > static_cast<int>(ModbusError::TIMEOUT));
-}
\ No newline at end of file
+}
@@ -0,0 +1,244 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "SensorGroup.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t FAST_SLAVE_A = 0x71;
+constexpr uint8_t FAST_SLAVE_B = 0x72;
+constexpr uint8_t FAST_SLAVE_C = 0x73;
+constexpr uint8_t SLOW_SLAVE = 0x74;
+constexpr uint8_t ABSENT_SLAVE = 0x75;
+constexpr uint16_t VALUE_REGISTER = 0x0008;
+
+class SensorDevice : public ModbusDevice {
+public:
+    explicit SensorDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~SensorDevice() override { (void)unregisterDevice(); }
+};
+
+// Reads one register asynchronously; completion is reported through
+// setDataReadyEvent() when the group supports it, else through a semaphore
+class AsyncSensor : public ISensorInstance {
+public:
+    explicit AsyncSensor(uint8_t addr, bool evented = true)
+        : device(addr), evented(evented), done(xSemaphoreCreateBinary()) {}
+    ~AsyncSensor() override { vSemaphoreDelete(done); }
+
+    SensorDevice device;
+    bool initialized = true;
+    uint16_t latest = 0;    ///< Last raw reply
+    uint16_t value = 0;     ///< Set by processData()
+    int processCalls = 0;
+    EventGroupHandle_t readyGroup = nullptr;
+    EventBits_t readyBit = 0;
+
+    void initialize() override { initialized = true; }
+    bool isInitialized() const override { return initialized; }
+    void waitForInitialization() override {}
+    SemaphoreHandle_t getMutexInstance() const override { return nullptr; }
+
+    bool requestData() override {
+        complete = false;
+        ok = false;
+        xSemaphoreTake(done, 0);
+        // Longer than any cycle deadline below: the group deadline decides
+        return device.readHoldingRegistersAsync(VALUE_REGISTER, 1, &onReply, this,
+                                                esp32Modbus::SENSOR, 5000).isOk();
+    }
+
+    bool waitForData() override {
+        if (!complete && xSemaphoreTake(done, pdMS_TO_TICKS(50)) != pdTRUE) {
+            return false;
+        }
+        return ok;
+    }
+
+    void processData() override {
+        value = latest;
+        processCalls++;
+    }
+
+    bool setDataReadyEvent(EventGroupHandle_t group, EventBits_t bit) override {
+        if (!evented) {
+            return false;
+        }
+        readyGroup = group;
+        readyBit = bit;
+        return true;
+    }
+
+private:
+    bool evented;
+    SemaphoreHandle_t done;
+    bool complete = false;
+    bool ok = false;
+
+    static void onReply(ModbusDevice&, const ModbusDevice::AsyncResult& result) {
+        AsyncSensor* self = static_cast<AsyncSensor*>(result.context);
+        self->ok = result.isOk() && result.getRegisterCount() == 1;
+        if (self->ok) {
+            self->latest = result.getRegister(0);
+        }
+        self->complete = true;
+        xSemaphoreGive(self->done);
+        if (self->readyGroup) {
+            xEventGroupSetBits(self->readyGroup, self->readyBit);
+        }
+    }
+};
+
+uint16_t expected(uint8_t slave) { return static_cast<uint16_t>((slave << 8) | VALUE_REGISTER); }
+
+// Queued RTU: requests run back to back while the group waits. Declare it
+// after the sensors so whatever is still queued completes while they exist.
+class QueuedBus {
+public:
+    QueuedBus() : rtu(simBus()) {
+        esp32ModbusRTU::SlaveConfig fast;
+        fast.latencyUs = 5000;
+        rtu.configureSlave(FAST_SLAVE_A, fast);
+        rtu.configureSlave(FAST_SLAVE_B, fast);
+        rtu.configureSlave(FAST_SLAVE_C, fast);
+        esp32ModbusRTU::SlaveConfig slow;
+        slow.latencyUs = 300 * 1000;
+        rtu.configureSlave(SLOW_SLAVE, slow);
+        ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(40);
+        rtu.setQueued(true);
+    }
+    ~QueuedBus() { finish(); }
+
+    void finish() {
+        rtu.setQueued(false);
+        ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(1000);
+    }
+
+private:
+    esp32ModbusRTU& rtu;
+};
+
+} // namespace
+
+TEST(SensorGroup_AddRemove) {
+    AsyncSensor a(FAST_SLAVE_A);
+    AsyncSensor plain(FAST_SLAVE_B, false);
+    SensorGroup group;      // Detaches the sensors, so it goes after them
+
+    ASSERT_EQ(0, group.add(a).value());
+    ASSERT_EQ(1, group.add(plain).value());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, group.add(a).error());
+    ASSERT_EQ(2u, group.getSensorCount());
+
+    // Only the event-capable sensor holds a bit of the group
+    ASSERT_NOT_NULL(a.readyGroup);
+    ASSERT_EQ(1u, a.readyBit);
+    ASSERT_NULL(plain.readyGroup);
+
+    ASSERT_TRUE(group.remove(a));
+    ASSERT_NULL(a.readyGroup);
+    ASSERT_FALSE(group.remove(a));
+    ASSERT_EQ(1u, group.getSensorCount());
+}
+
+TEST(SensorGroup_EventedSensorsComplete) {
+    AsyncSensor a(FAST_SLAVE_A);
+    AsyncSensor b(FAST_SLAVE_B);
+    AsyncSensor c(FAST_SLAVE_C);
+    SensorGroup group;
+    group.add(a);
+    group.add(b);
+    group.add(c);
+    QueuedBus bus;
+
+    auto cycle = group.acquire(100);
+    ASSERT_TRUE(cycle.isOk());
+    ASSERT_EQ(0x7u, cycle.value().requested);
+    ASSERT_EQ(0x7u, cycle.value().completed);
+    ASSERT_EQ(0u, cycle.value().timedOut);
+    ASSERT_EQ(0u, cycle.value().failed);
+
+    // One wait for all three: finished well inside the deadline
+    ASSERT_TRUE(cycle.value().elapsedMs < 100);
+    ASSERT_EQ(expected(FAST_SLAVE_A), a.value);
+    ASSERT_EQ(expected(FAST_SLAVE_C), c.value);
+    ASSERT_EQ(1, b.processCalls);
+}
+
+TEST(SensorGroup_EventedDeadline) {
+    AsyncSensor a(FAST_SLAVE_A);
+    AsyncSensor slow(SLOW_SLAVE);
+    AsyncSensor absent(ABSENT_SLAVE);
+    SensorGroup group;
+    group.add(a);
+    group.add(absent);
+    group.add(slow);
+    QueuedBus bus;
+
+    const int64_t start = sim::nowUs();
+    auto cycle = group.acquire(100);
+    ASSERT_TRUE(cycle.isOk());
+    ASSERT_EQ(0x7u, cycle.value().requested);
+
+    // The reply came in time; the RTU gave up on the absent slave inside
+    // the deadline; the slow slave missed it
+    ASSERT_EQ(0x1u, cycle.value().completed);
+    ASSERT_EQ(0x2u, cycle.value().failed);
+    ASSERT_EQ(0x4u, cycle.value().timedOut);
+    ASSERT_TRUE(cycle.value().elapsedMs >= 100 && cycle.value().elapsedMs <= 101);
+    ASSERT_TRUE(sim::nowUs() - start < 102 * 1000);
+    ASSERT_EQ(0, slow.processCalls);
+    ASSERT_EQ(0, absent.processCalls);
+    ASSERT_EQ(1, a.processCalls);
+
+    // The late reply lands after the cycle and is not processed
+    bus.finish();
+    ASSERT_EQ(0, slow.processCalls);
+    ASSERT_EQ(expected(SLOW_SLAVE), slow.latest);
+}
+
+TEST(SensorGroup_MixedSensorsShareDeadline) {
+    AsyncSensor a(FAST_SLAVE_A);
+    AsyncSensor plain(FAST_SLAVE_B, false);
+    AsyncSensor c(FAST_SLAVE_C);
+    AsyncSensor idle(FAST_SLAVE_A + 0x10);
+    idle.initialized = false;
+    SensorGroup group;
+    group.add(a);
+    group.add(plain);
+    group.add(c);
+    group.add(idle);
+    QueuedBus bus;
+
+    // The plain sensor's own wait drives the bus; the others latch their bits meanwhile
+    auto cycle = group.acquire(100);
+    ASSERT_TRUE(cycle.isOk());
+    ASSERT_EQ(0x7u, cycle.value().requested);   // Uninitialized sensor skipped
+    ASSERT_EQ(0x7u, cycle.value().completed);
+    ASSERT_EQ(0u, cycle.value().timedOut | cycle.value().failed);
+    ASSERT_EQ(expected(FAST_SLAVE_B), plain.value);
+    ASSERT_EQ(expected(FAST_SLAVE_C), c.value);
+    ASSERT_EQ(0, idle.processCalls);
+}
+
+TEST(SensorGroup_PlainSensorAfterDeadline) {
+    AsyncSensor slow(SLOW_SLAVE, false);
+    AsyncSensor plain(FAST_SLAVE_A, false);
+    SensorGroup group;
+    group.add(slow);
+    group.add(plain);
+    QueuedBus bus;
+
+    // The slow sensor's 50 ms wait passes the deadline: the next one is not waited for
+    auto cycle = group.acquire(30);
+    ASSERT_TRUE(cycle.isOk());
+    ASSERT_EQ(0x3u, cycle.value().requested);
+    ASSERT_EQ(0u, cycle.value().completed);
+    ASSERT_EQ(0x3u, cycle.value().timedOut);
+    ASSERT_EQ(0, plain.processCalls);
+}
@@ -0,0 +1,208 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+#include "sim_clock.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t PRESENT_SLAVE = 0x81;
+constexpr uint8_t ABSENT_SLAVE = 0x82;
+
+class SharedReadDevice : public ModbusDevice {
+public:
+    explicit SharedReadDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~SharedReadDevice() override { (void)unregisterDevice(); }
+};
+
+// A task reading holding registers while the test's own read is in flight
+struct Reader {
+    ModbusDevice* device;
+    uint16_t address;
+    uint16_t count;
+    esp32Modbus::ModbusPriority priority = esp32Modbus::RELAY;
+    uint16_t values[8] = {};
+    size_t decoded = 0;
+    ModbusError error = ModbusError::SUCCESS;
+    int finishOrder = -1;
+};
+
+int nextFinish = 0;
+
+void readerTask(void* param) {
+    Reader* reader = static_cast<Reader*>(param);
+    auto result = reader->device->readHoldingRegistersWithPriority(reader->address, reader->count,
+                                                                   reader->values, 8, reader->priority);
+    reader->error = result.isOk() ? ModbusError::SUCCESS : result.error();
+    reader->decoded = result.isOk() ? result.value() : 0;
+    reader->finishOrder = nextFinish++;
+}
+
+bool joinReaders() {
+    for (int i = 0; i < 10000 && sim::liveTasks() != 0; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return sim::liveTasks() == 0;
+}
+
+uint16_t expected(uint16_t reg) { return static_cast<uint16_t>((PRESENT_SLAVE << 8) | reg); }
+
+// Queued RTU with a 20 ms turnaround: the readers started before the test's
+// read get to run while it waits for its response
+class SlowBus {
+public:
+    SlowBus() : rtu(simBus()) {
+        esp32ModbusRTU::SlaveConfig slow;
+        slow.latencyUs = 20 * 1000;
+        rtu.configureSlave(PRESENT_SLAVE, slow);
+        ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(50);
+        rtu.setQueued(true);
+        rtu.resetCounters();
+    }
+    ~SlowBus() {
+        rtu.setQueued(false);
+        ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(1000);
+    }
+
+    esp32ModbusRTU& rtu;
+};
+
+} // namespace
+
+TEST(SharedRead_WaitersShareOneFrame) {
+    SharedReadDevice device(PRESENT_SLAVE);
+    SlowBus bus;
+
+    Reader same{&device, 0x10, 4};
+    Reader inside{&device, 0x11, 2};
+    sim::spawn(readerTask, &same);
+    sim::spawn(readerTask, &inside);
+
+    uint16_t values[4] = {};
+    auto result = device.readHoldingRegisters(0x10, 4, values, 4);
+    ASSERT_TRUE(joinReaders());
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(4u, result.value());
+    ASSERT_EQ(expected(0x13), values[3]);
+
+    // Both readers got their slice of the one response
+    ASSERT_EQ(1u, bus.rtu.getFrames());
+    ASSERT_EQ(2u, device.getDedupedReadCount());
+    ASSERT_EQ(ModbusError::SUCCESS, same.error);
+    ASSERT_EQ(4u, same.decoded);
+    ASSERT_EQ(expected(0x10), same.values[0]);
+    ASSERT_EQ(expected(0x13), same.values[3]);
+    ASSERT_EQ(2u, inside.decoded);
+    ASSERT_EQ(expected(0x11), inside.values[0]);
+    ASSERT_EQ(expected(0x12), inside.values[1]);
+}
+
+TEST(SharedRead_UncoveredRangeSendsOwnFrame) {
+    SharedReadDevice device(PRESENT_SLAVE);
+    SlowBus bus;
+
+    // Overlapping but not inside the flight: cannot be served from it
+    Reader overlap{&device, 0x12, 4};
+    sim::spawn(readerTask, &overlap);
+
+    uint16_t values[4] = {};
+    auto result = device.readHoldingRegisters(0x10, 4, values, 4);
+    ASSERT_TRUE(joinReaders());
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(2u, bus.rtu.getFrames());
+    ASSERT_EQ(0u, device.getDedupedReadCount());
+    ASSERT_EQ(4u, overlap.decoded);
+    ASSERT_EQ(expected(0x15), overlap.values[3]);
+}
+
+TEST(SharedRead_WaiterLimit) {
+    SharedReadDevice device(PRESENT_SLAVE);
+    SlowBus bus;
+
+    // One reader more than the flight has room for
+    Reader readers[MODBUS_READ_DEDUP_WAITERS + 1] = {};
+    for (auto& reader : readers) {
+        reader.device = &device;
+        reader.address = 0x10;
+        reader.count = 2;
+        sim::spawn(readerTask, &reader);
+    }
+
+    uint16_t values[2] = {};
+    auto result = device.readHoldingRegisters(0x10, 2, values, 2);
+    ASSERT_TRUE(joinReaders());
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(2u, bus.rtu.getFrames());
+    ASSERT_EQ(static_cast<uint32_t>(MODBUS_READ_DEDUP_WAITERS), device.getDedupedReadCount());
+    for (const auto& reader : readers) {
+        ASSERT_EQ(ModbusError::SUCCESS, reader.error);
+        ASSERT_EQ(expected(0x11), reader.values[1]);
+    }
+}
+
+TEST(SharedRead_ErrorReachesWaiters) {
+    SharedReadDevice device(ABSENT_SLAVE);
+    SlowBus bus;
+
+    Reader joined{&device, 0x00, 1};
+    sim::spawn(readerTask, &joined);
+
+    uint16_t value = 0;
+    auto result = device.readHoldingRegisters(0x00, 1, &value, 1);
+    ASSERT_TRUE(joinReaders());
+    ASSERT_EQ(ModbusError::TIMEOUT, result.error());
+    ASSERT_EQ(ModbusError::TIMEOUT, joined.error);
+    ASSERT_EQ(1u, device.getDedupedReadCount());
+    ASSERT_EQ(1u, bus.rtu.getFrames());
+}
+
+TEST(SharedRead_DisabledSendsEach) {
+    SharedReadDevice device(PRESENT_SLAVE);
+    device.setReadDeduplication(false);
+    SlowBus bus;
+
+    Reader same{&device, 0x10, 4};
+    sim::spawn(readerTask, &same);
+
+    uint16_t values[4] = {};
+    auto result = device.readHoldingRegisters(0x10, 4, values, 4);
+    ASSERT_TRUE(joinReaders());
+    ASSERT_TRUE(result.isOk());
+    ASSERT_EQ(2u, bus.rtu.getFrames());
+    ASSERT_EQ(0u, device.getDedupedReadCount());
+    ASSERT_EQ(expected(0x10), same.values[0]);
+}
+
+TEST(SharedRead_UrgentReaderDoesNotJoinQueuedLeader) {
+    SharedReadDevice device(PRESENT_SLAVE);
+    SlowBus bus;
+    ModbusBus& arbiter = ModbusRegistry::getInstance().getDefaultBus();
+    nextFinish = 0;
+
+    // The STATUS leader opens the flight, then queues behind our hold
+    ASSERT_TRUE(arbiter.acquireBusMutex(100, esp32Modbus::STATUS));
+    Reader leader{&device, 0x10, 4, esp32Modbus::STATUS};
+    Reader urgent{&device, 0x10, 4, esp32Modbus::EMERGENCY};
+    Reader relaxed{&device, 0x11, 2, esp32Modbus::STATUS};
+    sim::spawn(readerTask, &leader);
+    vTaskDelay(pdMS_TO_TICKS(1));
+    sim::spawn(readerTask, &urgent);
+    sim::spawn(readerTask, &relaxed);
+    vTaskDelay(pdMS_TO_TICKS(5));
+    arbiter.releaseBusMutex();
+    ASSERT_TRUE(joinReaders());
+
+    // The urgent reader sent its own frame and was granted the bus first;
+    // the one no more urgent than the leader still joined it
+    ASSERT_EQ(2u, bus.rtu.getFrames());
+    ASSERT_EQ(1u, device.getDedupedReadCount());
+    ASSERT_EQ(ModbusError::SUCCESS, urgent.error);
+    ASSERT_EQ(0, urgent.finishOrder);
+    ASSERT_EQ(expected(0x13), urgent.values[3]);
+    ASSERT_EQ(ModbusError::SUCCESS, leader.error);
+    ASSERT_EQ(ModbusError::SUCCESS, relaxed.error);
+    ASSERT_EQ(expected(0x12), relaxed.values[1]);
+}
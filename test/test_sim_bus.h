@@ -0,0 +1,22 @@
+#ifndef TEST_SIM_BUS_H
+#define TEST_SIM_BUS_H
+
+#include "ModbusDevice.h"
+#include "ModbusRegistry.h"
+
+// Simulated RTU on the default bus, shared by the tests that talk to a slave.
+// Slaves answer only after configureSlave(); their holding registers read as
+// (address << 8) | register and input registers as that ^ 0x8000.
+inline esp32ModbusRTU& simBus() {
+    static esp32ModbusRTU rtu(115200);
+    static bool attached = false;
+    if (!attached) {
+        rtu.onData(mainHandleData);
+        rtu.onError(handleError);
+        attached = true;
+    }
+    modbus::ModbusRegistry::getInstance().setModbusRTU(&rtu);
+    return rtu;
+}
+
+#endif // TEST_SIM_BUS_H
@@ -1,268 +1,307 @@
 #include "test_framework.h"
-#include "mock_freertos.h"
-#include "mock_logger.h"
-#include "../src/SimpleModbusDevice.h"
-
-// Mock esp32Modbus types
-namespace esp32Modbus {
-    enum FunctionCode {
-        READ_INPUT_REGISTERS = 0x04
-    };
-    
-    enum Error {
-        SUCCESS = 0,
-        TIMEOUT = 1,
-        INVALID_RESPONSE = 2,
-        CRC_ERROR = 3
-    };
-}
-
-// Mock global ModbusRTU
-esp32ModbusRTU* globalModbusRTU = nullptr;
+#include "test_sim_bus.h"
+#include "SimpleModbusDevice.h"
+#include "sim_clock.h"
+#include <vector>
 
 using namespace modbus;
 
+namespace {
+
+constexpr uint8_t SENSOR_SLAVE = 0x41;
+constexpr uint8_t ABSENT_SLAVE = 0x42;
+
+// Register values served by the simulated slave
+uint16_t holding(uint16_t reg) { return static_cast<uint16_t>((SENSOR_SLAVE << 8) | reg); }
+uint16_t input(uint16_t reg) { return holding(reg) ^ 0x8000; }
+
 // Test implementation to access protected members
 class TestSimpleModbusDevice : public SimpleModbusDevice {
 public:
-    TestSimpleModbusDevice(uint8_t addr) : SimpleModbusDevice(addr) {}
-    
-    // Expose protected methods for testing
-    void testHandleModbusResponse(uint8_t functionCode, uint16_t address, 
-                                const uint8_t* data, size_t length) {
-        handleModbusResponse(functionCode, address, data, length);
+    bool configureResult = true;
+    int configureCalls = 0;
+
+    explicit TestSimpleModbusDevice(uint8_t addr) : SimpleModbusDevice(addr) {}
+    ~TestSimpleModbusDevice() override { (void)unregisterDevice(); }
+
+    void testSetMaxReadGap(uint16_t gap) { setMaxReadGap(gap); }
+    size_t plannedRequests() { return getReadPlan().blocks().size(); }
+
+    // Edits that bypass addChannel()
+    void pushChannel(uint16_t address) {
+        ChannelInfo info;
+        info.name = "Extra";
+        info.address = address;
+        channels.push_back(info);
     }
-    
-    void testHandleModbusError(ModbusError error) {
-        handleModbusError(error);
+    void moveChannel(size_t channel, uint16_t address) {
+        channels[channel].address = address;
+        invalidateReadPlan();
     }
-    
-    // Access channel data for verification
-    const std::vector<uint16_t>& getRawValues() const {
-        return rawValues;
+
+protected:
+    bool configure() override {
+        configureCalls++;
+        addChannel("Temperature", "C", 0x0001);
+        addChannel("Humidity", "%", 0x0002);
+        addChannel("Pressure", "hPa", 0x0010, 0x04);
+        addChannel("Setpoint", "C", 0x0005);
+        setChannelRange(0, -40.0f, 125.0f);
+        return configureResult;
     }
-    
-    uint32_t getLastUpdateTime() const {
-        return lastUpdateTime;
+};
+
+// Sets up the simulated slave; each test starts on a quiet bus
+void resetBus() {
+    esp32ModbusRTU& rtu = simBus();
+    rtu.configureSlave(SENSOR_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    rtu.resetCounters();
+    // A zero tick count would read as "never updated"
+    sim::advanceUs(1000);
+}
+
+// Collects the values delivered to a subscriber
+struct ValueLog {
+    std::vector<float> values;
+
+    static void onChange(const ChangeEvent& event, void* context) {
+        static_cast<ValueLog*>(context)->values.push_back(event.value);
     }
 };
 
-// Mock for xTaskGetTickCount
-uint32_t mockTickCount = 0;
+} // namespace
 
 TEST(SimpleModbusDevice_Construction) {
-    TestSimpleModbusDevice device(0x01);
-    
-    ASSERT_EQ(0x01, device.getServerAddress());
-    ASSERT_EQ(0, device.getChannelCount());
-    ASSERT_EQ(0, device.getBaseRegister());
-    ASSERT_EQ(1.0f, device.getScaleFactor(0));
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+
+    ASSERT_EQ(SENSOR_SLAVE, device.getServerAddress());
+    ASSERT_EQ(0u, device.getChannelCount());
+    ASSERT_FALSE(device.hasValidData());
+    ASSERT_EQ(UINT32_MAX, device.getDataAge());
+    ASSERT_EQ(0, device.configureCalls);
 }
 
 TEST(SimpleModbusDevice_Configuration) {
-    TestSimpleModbusDevice device(0x01);
-    
-    // Configure device
-    device.configureChannels(10, 0x1000, 2.5f);
-    
-    ASSERT_EQ(10, device.getChannelCount());
-    ASSERT_EQ(0x1000, device.getBaseRegister());
-    ASSERT_EQ(2.5f, device.getScaleFactor(0));
-    
-    // Check initial values
-    auto values = device.getRawValues();
-    ASSERT_EQ(10, values.size());
-    for (size_t i = 0; i < values.size(); i++) {
-        ASSERT_EQ(0, values[i]);
-    }
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+
+    ASSERT_TRUE(device.initialize());
+    ASSERT_EQ(1, device.configureCalls);
+    ASSERT_EQ(ModbusDevice::InitPhase::READY, device.getInitPhase());
+    ASSERT_EQ(&device, ModbusRegistry::getInstance().getDevice(SENSOR_SLAVE));
+
+    ASSERT_EQ(4u, device.getChannelCount());
+    ASSERT_EQ(0, strcmp("Temperature", device.getChannelName(0)));
+    ASSERT_EQ(0, strcmp("hPa", device.getChannelUnits(2)));
+
+    float min = 0.0f;
+    float max = 0.0f;
+    ASSERT_TRUE(device.getRange(0, min, max));
+    ASSERT_TRUE(min == -40.0f && max == 125.0f);
+    ASSERT_FALSE(device.getRange(1, min, max));   // No range set
+}
+
+TEST(SimpleModbusDevice_ConfigurationFailure) {
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    device.configureResult = false;
+
+    ASSERT_FALSE(device.initialize());
+    ASSERT_EQ(ModbusDevice::InitPhase::ERROR, device.getInitPhase());
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, device.update().error());
 }
 
 TEST(SimpleModbusDevice_ReadChannel) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(5, 0x1000, 0.1f);
-    
-    // Set init phase to READY
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    
-    // Simulate response data
-    mockTickCount = 1000;
-    uint8_t responseData[] = {
-        0x00, 0x0A,  // 10
-        0x00, 0x14,  // 20
-        0x00, 0x1E,  // 30
-        0x00, 0x28,  // 40
-        0x00, 0x32   // 50
-    };
-    
-    device.testHandleModbusResponse(0x04, 0x1000, responseData, sizeof(responseData));
-    
-    // Test reading channels
-    auto result0 = device.readChannel(0);
-    ASSERT_TRUE(result0.isOk());
-    ASSERT_EQ(1.0f, result0.value); // 10 * 0.1
-    
-    auto result2 = device.readChannel(2);
-    ASSERT_TRUE(result2.isOk());
-    ASSERT_EQ(3.0f, result2.value); // 30 * 0.1
-    
-    auto result4 = device.readChannel(4);
-    ASSERT_TRUE(result4.isOk());
-    ASSERT_EQ(5.0f, result4.value); // 50 * 0.1
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+
+    ASSERT_TRUE(device.update().isOk());
+
+    auto raw = device.getRawValue(0);
+    ASSERT_TRUE(raw.isOk());
+    ASSERT_EQ(holding(0x0001), raw.value());
+
+    auto value = device.getFloat(0);
+    ASSERT_TRUE(value.isOk());
+    ASSERT_TRUE(value.value() == static_cast<float>(holding(0x0001)));
 }
 
 TEST(SimpleModbusDevice_ReadChannel_OutOfRange) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(3, 0x1000, 1.0f);
-    
-    // Try to read invalid channel
-    auto result = device.readChannel(5);
-    ASSERT_FALSE(result.isOk());
-    ASSERT_EQ(ModbusError::INVALID_PARAMETER, result.error);
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    ASSERT_TRUE(device.update().isOk());
+
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, device.getRawValue(4).error());
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, device.getFloat(10).error());
+    ASSERT_EQ(0, strcmp("", device.getChannelName(4)));
+    ASSERT_EQ(0, strcmp("", device.getChannelUnits(4)));
 }
 
 TEST(SimpleModbusDevice_ReadChannel_NotReady) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(3, 0x1000, 1.0f);
-    
-    // Device is still UNINITIALIZED
-    auto result = device.readChannel(0);
-    ASSERT_FALSE(result.isOk());
-    ASSERT_EQ(ModbusError::NOT_INITIALIZED, result.error);
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+
+    // Not initialized yet
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, device.update().error());
+    ASSERT_EQ(0u, simBus().getFrames());
+
+    // Initialized but never updated
+    ASSERT_TRUE(device.initialize());
+    ASSERT_EQ(ModbusError::NOT_INITIALIZED, device.getRawValue(0).error());
 }
 
 TEST(SimpleModbusDevice_ReadAllChannels) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(3, 0x1000, 0.5f);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    
-    // Simulate response
-    mockTickCount = 2000;
-    uint8_t responseData[] = {
-        0x00, 0x64,  // 100
-        0x00, 0xC8,  // 200
-        0x01, 0x2C   // 300
-    };
-    
-    device.testHandleModbusResponse(0x04, 0x1000, responseData, sizeof(responseData));
-    
-    // Read all channels
-    auto result = device.readAllChannels();
-    ASSERT_TRUE(result.isOk());
-    ASSERT_EQ(3, result.value.size());
-    ASSERT_EQ(50.0f, result.value[0]);   // 100 * 0.5
-    ASSERT_EQ(100.0f, result.value[1]);  // 200 * 0.5
-    ASSERT_EQ(150.0f, result.value[2]);  // 300 * 0.5
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    ASSERT_TRUE(device.update().isOk());
+
+    ASSERT_EQ(holding(0x0001), device.getRawValue(0).value());
+    ASSERT_EQ(holding(0x0002), device.getRawValue(1).value());
+    ASSERT_EQ(input(0x0010), device.getRawValue(2).value());   // FC04 channel
+    ASSERT_EQ(holding(0x0005), device.getRawValue(3).value());
 }
 
 TEST(SimpleModbusDevice_UpdateChannels_Success) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(2, 0x1000, 1.0f);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    device.registerDevice();
-    
-    // Mock successful read
-    auto result = device.updateChannels();
-    
-    // In a real test, we'd verify the read request was sent
-    // For now, just check the method runs
-    ASSERT_TRUE(result.isOk() || result.error == ModbusError::COMMUNICATION_ERROR);
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+
+    // Neighbouring FC03 channels share one request; 0x0005 and the FC04 channel need their own
+    ASSERT_EQ(3u, device.plannedRequests());
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(3u, simBus().getFrames());
+
+    // Later writes on the slave show up on the next update
+    ASSERT_TRUE(device.writeSingleRegister(0x0002, 1234).isOk());
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(1234, device.getRawValue(1).value());
+    ASSERT_TRUE(device.writeSingleRegister(0x0002, holding(0x0002)).isOk());
 }
 
-TEST(SimpleModbusDevice_DataFreshness) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(1, 0x1000, 1.0f);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    
-    // Initial state - no data
-    ASSERT_FALSE(device.isDataFresh(1000));
-    
-    // Simulate response
-    mockTickCount = 5000;
-    uint8_t responseData[] = {0x00, 0x0A};
-    device.testHandleModbusResponse(0x04, 0x1000, responseData, sizeof(responseData));
-    
-    // Data should be fresh
-    mockTickCount = 5500;
-    ASSERT_TRUE(device.isDataFresh(1000));  // 500ms < 1000ms threshold
-    
-    // Data should be stale
-    mockTickCount = 7000;
-    ASSERT_FALSE(device.isDataFresh(1000)); // 2000ms > 1000ms threshold
+TEST(SimpleModbusDevice_ReadGap) {
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+
+    // Bridging 0x0003..0x0004 lets one FC03 request serve all holding channels
+    device.testSetMaxReadGap(2);
+    ASSERT_EQ(2u, device.plannedRequests());
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(2u, simBus().getFrames());
+    ASSERT_EQ(holding(0x0005), device.getRawValue(3).value());
+
+    // A gap never merges across function codes
+    device.testSetMaxReadGap(100);
+    ASSERT_EQ(2u, device.plannedRequests());
+    device.testSetMaxReadGap(0);
+    ASSERT_EQ(3u, device.plannedRequests());
+}
+
+TEST(SimpleModbusDevice_ReadPlanFollowsChannels) {
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    ASSERT_EQ(3u, device.plannedRequests());
+
+    // A channel pushed straight into the vector still gets read
+    device.pushChannel(0x0020);
+    ASSERT_EQ(4u, device.plannedRequests());
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(4u, simBus().getFrames());
+    ASSERT_EQ(holding(0x0020), device.getRawValue(4).value());
+
+    // Moving it next to the first block merges the two after invalidateReadPlan()
+    device.moveChannel(4, 0x0003);
+    ASSERT_EQ(3u, device.plannedRequests());
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_EQ(holding(0x0003), device.getRawValue(4).value());
 }
 
-TEST(SimpleModbusDevice_HandleResponse_WrongAddress) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(2, 0x1000, 1.0f);
-    
-    // Response for wrong address
-    uint8_t responseData[] = {0x00, 0x0A, 0x00, 0x14};
-    device.testHandleModbusResponse(0x04, 0x2000, responseData, sizeof(responseData));
-    
-    // Values should remain unchanged (0)
-    auto values = device.getRawValues();
-    ASSERT_EQ(0, values[0]);
-    ASSERT_EQ(0, values[1]);
+TEST(SimpleModbusDevice_DataFreshness) {
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    ASSERT_EQ(UINT32_MAX, device.getDataAge());
+
+    ASSERT_TRUE(device.update().isOk());
+    ASSERT_TRUE(device.hasValidData());
+    uint32_t updatedAt = device.getLastUpdateTime();
+    ASSERT_EQ(xTaskGetTickCount() * portTICK_PERIOD_MS, updatedAt);
+    ASSERT_EQ(0u, device.getDataAge());
+
+    sim::advanceUs(250 * 1000);
+    ASSERT_EQ(250u, device.getDataAge());
+    ASSERT_EQ(updatedAt, device.getLastUpdateTime());
 }
 
-TEST(SimpleModbusDevice_HandleResponse_WrongSize) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(3, 0x1000, 1.0f);
-    
-    // Response with wrong size (expecting 6 bytes, got 4)
-    uint8_t responseData[] = {0x00, 0x0A, 0x00, 0x14};
-    device.testHandleModbusResponse(0x04, 0x1000, responseData, sizeof(responseData));
-    
-    // Should handle error
-    ASSERT_EQ(ModbusError::INVALID_RESPONSE, device.getLastError());
+TEST(SimpleModbusDevice_HandleResponse_Unsolicited) {
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    ASSERT_TRUE(device.update().isOk());
+
+    // A frame nobody asked for does not touch the channel values
+    const uint8_t frame[] = {0x00, 0x07, 0x00, 0x08};
+    mainHandleData(SENSOR_SLAVE, esp32Modbus::READ_HOLD_REGISTER, 0x0001, frame, sizeof(frame));
+    ASSERT_EQ(holding(0x0001), device.getRawValue(0).value());
+    ASSERT_EQ(holding(0x0002), device.getRawValue(1).value());
 }
 
 TEST(SimpleModbusDevice_HandleError) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(1, 0x1000, 1.0f);
-    
-    // Test error handling
-    device.testHandleModbusError(ModbusError::TIMEOUT);
+    resetBus();
+    TestSimpleModbusDevice device(ABSENT_SLAVE);
+    ASSERT_TRUE(device.initialize());
+
+    auto result = device.update();
+    ASSERT_TRUE(result.isError());
+    ASSERT_EQ(ModbusError::TIMEOUT, result.error());
     ASSERT_EQ(ModbusError::TIMEOUT, device.getLastError());
-    
-    device.testHandleModbusError(ModbusError::CRC_ERROR);
-    ASSERT_EQ(ModbusError::CRC_ERROR, device.getLastError());
+    ASSERT_FALSE(device.hasValidData());
+    ASSERT_EQ(1u, simBus().getFrames());   // Gave up after the first block
 }
 
 TEST(SimpleModbusDevice_IModbusInput_Interface) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(2, 0x1000, 1.0f);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    
-    // Test through IModbusInput interface
-    IModbusInput* input = &device;
-    
-    // Simulate data
-    mockTickCount = 3000;
-    uint8_t responseData[] = {0x00, 0x0A, 0x00, 0x14};
-    device.testHandleModbusResponse(0x04, 0x1000, responseData, sizeof(responseData));
-    
-    auto result = input->readInput(0);
-    ASSERT_TRUE(result.isOk());
-    ASSERT_EQ(10.0f, result.value);
-    
-    auto allResult = input->readAllInputs();
-    ASSERT_TRUE(allResult.isOk());
-    ASSERT_EQ(2, allResult.value.size());
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+
+    IModbusAnalogInput& sensor = device;
+    ValueLog log;
+    ASSERT_TRUE(sensor.subscribe(2, Deadband{}, &ValueLog::onChange, &log).isOk());
+
+    ASSERT_TRUE(sensor.update().isOk());
+    ASSERT_TRUE(sensor.hasValidData());
+    ASSERT_EQ(4u, sensor.getChannelCount());
+    ASSERT_TRUE(sensor.getScaleFactor(2) == 1.0f);
+    ASSERT_TRUE(sensor.getFloat(2).value() == static_cast<float>(input(0x0010)));
+
+    // Each update publishes the scaled value; unchanged values are not reported again
+    ASSERT_EQ(1u, log.values.size());
+    ASSERT_TRUE(log.values[0] == static_cast<float>(input(0x0010)));
+    ASSERT_TRUE(sensor.update().isOk());
+    ASSERT_EQ(1u, log.values.size());
 }
 
 TEST(SimpleModbusDevice_UpdateStatistics) {
-    TestSimpleModbusDevice device(0x01);
-    device.configureChannels(1, 0x1000, 1.0f);
-    device.setInitPhase(ModbusDevice::InitPhase::READY);
-    
-    // Get initial stats
-    auto stats1 = device.getStatistics();
-    uint32_t initialRequests = stats1.totalRequests;
-    
-    // Trigger update
-    device.updateChannels();
-    
-    // Stats should increment
-    auto stats2 = device.getStatistics();
-    ASSERT_EQ(initialRequests + 1, stats2.totalRequests);
-}
\ No newline at end of file
+    resetBus();
+    TestSimpleModbusDevice device(SENSOR_SLAVE);
+    ASSERT_TRUE(device.initialize());
+    device.resetStatistics();
+
+    ASSERT_TRUE(device.update().isOk());
+    auto stats = device.getStatistics();
+    ASSERT_EQ(3u, stats.totalRequests);
+    ASSERT_EQ(3u, stats.successfulRequests);
+    ASSERT_EQ(0u, stats.failedRequests);
+
+    TestSimpleModbusDevice absent(ABSENT_SLAVE);
+    ASSERT_TRUE(absent.initialize());
+    ASSERT_TRUE(absent.update().isError());
+    stats = absent.getStatistics();
+    ASSERT_EQ(1u, stats.totalRequests);
+    ASSERT_EQ(0u, stats.successfulRequests);
+    ASSERT_EQ(1u, stats.failedRequests);
+}
@@ -0,0 +1,147 @@
+#include "test_framework.h"
+#include "test_sim_bus.h"
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t PRESENT_SLAVE = 0x91;
+constexpr uint8_t FLAKY_SLAVE = 0x92;
+
+class StagingDevice : public ModbusDevice {
+public:
+    explicit StagingDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~StagingDevice() override { (void)unregisterDevice(); }
+};
+
+esp32ModbusRTU& resetBus() {
+    esp32ModbusRTU& rtu = simBus();
+    rtu.configureSlave(PRESENT_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    rtu.resetCounters();
+    return rtu;
+}
+
+bool frameIs(const esp32ModbusRTU& rtu, size_t index, esp32Modbus::FunctionCode fc, uint16_t address) {
+    const esp32ModbusRTU::FrameRecord frame = rtu.getFrame(index);
+    return frame.fc == fc && frame.address == address;
+}
+
+} // namespace
+
+TEST(StagedWrites_RegisterRunBoundaries) {
+    esp32ModbusRTU& rtu = resetBus();
+    StagingDevice device(PRESENT_SLAVE);
+
+    // Staged out of order: 0x10-0x12 and 0x20-0x21 are runs, 0x14 stands alone
+    ASSERT_TRUE(device.stageRegister(0x21, 0x2100).isOk());
+    ASSERT_TRUE(device.stageRegister(0x11, 0x1100).isOk());
+    ASSERT_TRUE(device.stageRegister(0x14, 0x1400).isOk());
+    ASSERT_TRUE(device.stageRegister(0x10, 0x1000).isOk());
+    ASSERT_TRUE(device.stageRegister(0x20, 0x2000).isOk());
+    ASSERT_TRUE(device.stageRegister(0x12, 0x1200).isOk());
+    ASSERT_TRUE(device.hasStagedWrites());
+    ASSERT_EQ(0u, rtu.getFrames());
+
+    ASSERT_TRUE(device.flushStagedWrites().isOk());
+    ASSERT_EQ(3u, rtu.getFrames());
+    ASSERT_TRUE(frameIs(rtu, 0, esp32Modbus::WRITE_MULT_REGISTERS, 0x10));
+    ASSERT_TRUE(frameIs(rtu, 1, esp32Modbus::WRITE_HOLD_REGISTER, 0x14));
+    ASSERT_TRUE(frameIs(rtu, 2, esp32Modbus::WRITE_MULT_REGISTERS, 0x20));
+    ASSERT_FALSE(device.hasStagedWrites());
+
+    // The registers in the gap kept their old contents
+    auto values = device.readHoldingRegisters(0x10, 5);
+    ASSERT_TRUE(values.isOk());
+    ASSERT_EQ(0x1000, values.value()[0]);
+    ASSERT_EQ(0x1200, values.value()[2]);
+    ASSERT_EQ((PRESENT_SLAVE << 8) | 0x13, values.value()[3]);
+    ASSERT_EQ(0x1400, values.value()[4]);
+    auto tail = device.readHoldingRegisters(0x20, 2);
+    ASSERT_TRUE(tail.isOk());
+    ASSERT_EQ(0x2100, tail.value()[1]);
+}
+
+TEST(StagedWrites_CoilRunBoundaries) {
+    esp32ModbusRTU& rtu = resetBus();
+    StagingDevice device(PRESENT_SLAVE);
+
+    ASSERT_TRUE(device.stageCoil(0x07, true).isOk());
+    ASSERT_TRUE(device.stageCoil(0x05, true).isOk());
+    ASSERT_TRUE(device.stageCoil(0x09, true).isOk());
+    ASSERT_TRUE(device.stageCoil(0x06, false).isOk());
+
+    ASSERT_TRUE(device.flushStagedWrites().isOk());
+    ASSERT_EQ(2u, rtu.getFrames());
+    ASSERT_TRUE(frameIs(rtu, 0, esp32Modbus::WRITE_MULT_COILS, 0x05));
+    ASSERT_TRUE(frameIs(rtu, 1, esp32Modbus::WRITE_COIL, 0x09));
+
+    auto coils = device.readCoils(0x05, 5);
+    ASSERT_TRUE(coils.isOk());
+    ASSERT_TRUE(coils.value()[0]);
+    ASSERT_FALSE(coils.value()[1]);
+    ASSERT_TRUE(coils.value()[2]);
+    ASSERT_FALSE(coils.value()[3]);
+    ASSERT_TRUE(coils.value()[4]);
+}
+
+TEST(StagedWrites_CoilsBeforeRegisters) {
+    esp32ModbusRTU& rtu = resetBus();
+    StagingDevice device(PRESENT_SLAVE);
+
+    ASSERT_TRUE(device.stageRegister(0x30, 0x0001).isOk());
+    ASSERT_TRUE(device.stageCoil(0x30, true).isOk());
+    ASSERT_TRUE(device.stageRegister(0x30, 0x0002).isOk());   // Last value wins
+
+    ASSERT_TRUE(device.flushStagedWrites().isOk());
+    ASSERT_EQ(2u, rtu.getFrames());
+    ASSERT_TRUE(frameIs(rtu, 0, esp32Modbus::WRITE_COIL, 0x30));
+    ASSERT_TRUE(frameIs(rtu, 1, esp32Modbus::WRITE_HOLD_REGISTER, 0x30));
+    ASSERT_EQ(0x0002, device.readHoldingRegisters(0x30, 1).value()[0]);
+}
+
+TEST(StagedWrites_FailedRunStaysStaged) {
+    esp32ModbusRTU& rtu = resetBus();
+    StagingDevice device(FLAKY_SLAVE);
+    esp32ModbusRTU::SlaveConfig offline;
+    offline.present = false;
+    rtu.configureSlave(FLAKY_SLAVE, offline);
+    ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(50);
+
+    ASSERT_TRUE(device.stageCoil(0x01, true).isOk());
+    ASSERT_TRUE(device.stageRegister(0x40, 0x4000).isOk());
+    ASSERT_TRUE(device.stageRegister(0x41, 0x4100).isOk());
+
+    // The coil frame fails: the register run is not attempted
+    auto failed = device.flushStagedWrites();
+    ModbusRegistry::getInstance().getDefaultBus().setResponseTimeout(1000);
+    ASSERT_EQ(ModbusError::TIMEOUT, failed.error());
+    ASSERT_EQ(1u, rtu.getFrames());
+    ASSERT_TRUE(device.hasStagedWrites());
+
+    rtu.configureSlave(FLAKY_SLAVE, esp32ModbusRTU::SlaveConfig{});
+    rtu.resetCounters();
+    ASSERT_TRUE(device.flushStagedWrites().isOk());
+    ASSERT_EQ(2u, rtu.getFrames());
+    ASSERT_TRUE(frameIs(rtu, 0, esp32Modbus::WRITE_COIL, 0x01));
+    ASSERT_TRUE(frameIs(rtu, 1, esp32Modbus::WRITE_MULT_REGISTERS, 0x40));
+    ASSERT_FALSE(device.hasStagedWrites());
+}
+
+TEST(StagedWrites_BufferFull) {
+    resetBus();
+    StagingDevice device(PRESENT_SLAVE);
+
+    for (uint16_t i = 0; i < MODBUS_WRITE_BUFFER_ENTRIES; i++) {
+        ASSERT_TRUE(device.stageRegister(static_cast<uint16_t>(i * 2), i).isOk());
+    }
+    ASSERT_EQ(ModbusError::QUEUE_FULL, device.stageRegister(0xFF, 0).error());
+    ASSERT_TRUE(device.stageRegister(0x02, 0xAAAA).isOk());   // Restaging needs no entry
+
+    device.discardStagedWrites();
+    ASSERT_FALSE(device.hasStagedWrites());
+    ASSERT_TRUE(device.flushStagedWrites().isOk());
+    ASSERT_EQ(0u, simBus().getFrames());
+}
@@ -0,0 +1,285 @@
+#include "test_framework.h"
+#include "ModbusSubscription.h"
+#include "IModbusInput.h"
+#include <cmath>
+#include <vector>
+
+using namespace modbus;
+
+// Collects every event delivered to a callback target
+struct Recorder {
+    std::vector<ChangeEvent> events;
+
+    static void onChange(const ChangeEvent& event, void* context) {
+        static_cast<Recorder*>(context)->events.push_back(event);
+    }
+
+    SubscriptionTable::Target target() {
+        SubscriptionTable::Target t;
+        t.callback = &Recorder::onChange;
+        t.context = this;
+        return t;
+    }
+};
+
+TEST(Subscription_RequiresTarget) {
+    SubscriptionTable table;
+    auto result = table.addAnalog(0, Deadband{}, SubscriptionTable::Target{}, true);
+    ASSERT_TRUE(result.isError());
+    ASSERT_EQ(ModbusError::NULL_POINTER, result.error());
+
+    Recorder rec;
+    Deadband negative;
+    negative.absolute = -1.0f;
+    ASSERT_EQ(ModbusError::INVALID_PARAMETER, table.addAnalog(0, negative, rec.target(), true).error());
+    ASSERT_EQ(0u, table.size());
+}
+
+TEST(Subscription_InitialValue) {
+    SubscriptionTable table;
+    Recorder withInitial;
+    Recorder withoutInitial;
+    table.addAnalog(1, Deadband{}, withInitial.target(), true);
+    table.addAnalog(1, Deadband{}, withoutInitial.target(), false);
+
+    table.publishAnalog(nullptr, 1, 20.0f);
+    ASSERT_EQ(1u, withInitial.events.size());
+    ASSERT_TRUE(withInitial.events[0].initial);
+    ASSERT_EQ(0u, withoutInitial.events.size());
+
+    // The suppressed initial value still becomes the baseline
+    table.publishAnalog(nullptr, 1, 21.0f);
+    ASSERT_EQ(1u, withoutInitial.events.size());
+    ASSERT_FALSE(withoutInitial.events[0].initial);
+    ASSERT_TRUE(withoutInitial.events[0].previous == 20.0f);
+}
+
+TEST(Subscription_AbsoluteDeadband) {
+    SubscriptionTable table;
+    Recorder rec;
+    Deadband band;
+    band.absolute = 0.5f;
+    table.addAnalog(0, band, rec.target(), true);
+
+    table.publishAnalog(nullptr, 0, 10.0f);   // initial
+    table.publishAnalog(nullptr, 0, 10.4f);   // below the deadband
+    table.publishAnalog(nullptr, 0, 10.5f);   // exactly the deadband from 10.0
+    table.publishAnalog(nullptr, 0, 10.2f);   // 0.3 from the last reported value
+
+    ASSERT_EQ(2u, rec.events.size());
+    ASSERT_TRUE(rec.events[1].value == 10.5f);
+    ASSERT_TRUE(rec.events[1].previous == 10.0f);
+}
+
+TEST(Subscription_PercentDeadband) {
+    SubscriptionTable table;
+    Recorder rec;
+    Deadband band;
+    band.absolute = 1.0f;
+    band.percent = 10.0f;   // 10 % of |last| wins above 10.0
+    table.addAnalog(0, band, rec.target(), false);
+
+    table.publishAnalog(nullptr, 0, 100.0f);  // baseline
+    table.publishAnalog(nullptr, 0, 105.0f);  // 5 < 10
+    table.publishAnalog(nullptr, 0, 90.0f);   // 10 >= 10
+
+    ASSERT_EQ(1u, rec.events.size());
+    ASSERT_TRUE(rec.events[0].value == 90.0f);
+
+    table.publishAnalog(nullptr, 0, 89.5f);   // 0.5 < max(1.0, 9.0)
+    ASSERT_EQ(1u, rec.events.size());
+}
+
+TEST(Subscription_ZeroDeadbandReportsChangesOnly) {
+    SubscriptionTable table;
+    Recorder rec;
+    table.addAnalog(0, Deadband{}, rec.target(), false);
+
+    table.publishAnalog(nullptr, 0, 1.0f);
+    table.publishAnalog(nullptr, 0, 1.0f);
+    table.publishAnalog(nullptr, 0, 1.5f);
+    ASSERT_EQ(1u, rec.events.size());
+}
+
+TEST(Subscription_NanTransitions) {
+    SubscriptionTable table;
+    Recorder rec;
+    Deadband band;
+    band.absolute = 100.0f;
+    table.addAnalog(0, band, rec.target(), false);
+
+    table.publishAnalog(nullptr, 0, 5.0f);
+    table.publishAnalog(nullptr, 0, NAN);      // value lost: reported
+    table.publishAnalog(nullptr, 0, NAN);      // still lost: not reported
+    table.publishAnalog(nullptr, 0, 5.0f);     // value back: reported
+
+    ASSERT_EQ(2u, rec.events.size());
+    ASSERT_TRUE(std::isnan(rec.events[0].value));
+    ASSERT_TRUE(rec.events[1].value == 5.0f);
+}
+
+TEST(Subscription_DigitalEdges) {
+    SubscriptionTable table;
+    Recorder rising;
+    Recorder both;
+    table.addDigital(3, Edge::RISING, rising.target(), false);
+    table.addDigital(3, Edge::BOTH, both.target(), false);
+
+    table.publishDigital(nullptr, 3, false);  // baseline
+    table.publishDigital(nullptr, 3, true);
+    table.publishDigital(nullptr, 3, true);   // no transition
+    table.publishDigital(nullptr, 3, false);
+    table.publishDigital(nullptr, 3, true);
+
+    ASSERT_EQ(2u, rising.events.size());
+    ASSERT_TRUE(rising.events[0].state);
+    ASSERT_TRUE(rising.events[1].state);
+    ASSERT_EQ(3u, both.events.size());
+    ASSERT_FALSE(both.events[1].state);
+}
+
+TEST(Subscription_ChannelAndKindFilter) {
+    SubscriptionTable table;
+    Recorder rec;
+    table.addAnalog(2, Deadband{}, rec.target(), true);
+
+    table.publishAnalog(nullptr, 1, 1.0f);    // other channel
+    table.publishDigital(nullptr, 2, true);   // same channel, digital
+    ASSERT_EQ(0u, rec.events.size());
+
+    table.publishAnalog(nullptr, 2, 1.0f);
+    ASSERT_EQ(1u, rec.events.size());
+    ASSERT_EQ(2, rec.events[0].channel);
+}
+
+TEST(Subscription_RemoveAndStaleHandle) {
+    SubscriptionTable table;
+    Recorder rec;
+    auto handle = table.addAnalog(0, Deadband{}, rec.target(), true);
+    ASSERT_TRUE(handle.isOk());
+    ASSERT_EQ(1u, table.size());
+
+    ASSERT_TRUE(table.remove(handle.value()));
+    ASSERT_FALSE(table.remove(handle.value()));
+    ASSERT_EQ(0u, table.size());
+
+    // The slot is reused with a new handle; the old one still misses
+    auto again = table.addAnalog(0, Deadband{}, rec.target(), true);
+    ASSERT_TRUE(again.isOk());
+    ASSERT_NE(handle.value(), again.value());
+    ASSERT_FALSE(table.remove(handle.value()));
+
+    table.publishAnalog(nullptr, 0, 1.0f);
+    ASSERT_EQ(1u, rec.events.size());
+    ASSERT_EQ(again.value(), rec.events[0].subscription);
+}
+
+TEST(Subscription_TableFull) {
+    SubscriptionTable table;
+    Recorder rec;
+    for (size_t i = 0; i < MODBUS_SUBSCRIPTION_MAX; i++) {
+        ASSERT_TRUE(table.addDigital(0, Edge::BOTH, rec.target(), true).isOk());
+    }
+    ASSERT_EQ(ModbusError::QUEUE_FULL, table.addDigital(0, Edge::BOTH, rec.target(), true).error());
+}
+
+TEST(Subscription_FullQueueKeepsBaseline) {
+    SubscriptionTable table;
+    QueueHandle_t queue = xQueueCreate(1, sizeof(ChangeEvent));
+    ASSERT_NOT_NULL(queue);
+
+    SubscriptionTable::Target target;
+    target.queue = queue;
+    Deadband band;
+    band.absolute = 1.0f;
+    table.addAnalog(0, band, target, true);
+
+    table.publishAnalog(nullptr, 0, 0.0f);    // fills the queue
+    table.publishAnalog(nullptr, 0, 5.0f);    // dropped
+    ASSERT_EQ(1u, table.getDropped());
+
+    ChangeEvent event;
+    ASSERT_EQ(pdTRUE, xQueueReceive(queue, &event, 0));
+    ASSERT_TRUE(event.initial);
+
+    // Compared against 0.0 (last delivered), not 5.0
+    table.publishAnalog(nullptr, 0, 4.5f);
+    ASSERT_EQ(pdTRUE, xQueueReceive(queue, &event, 0));
+    ASSERT_TRUE(event.value == 4.5f);
+    ASSERT_TRUE(event.previous == 0.0f);
+
+    vQueueDelete(queue);
+}
+
+TEST(Subscription_LazyTableCreatedOnFirstAdd) {
+    LazySubscriptionTable table;
+    ASSERT_FALSE(table.isCreated());
+
+    // Publishing and removing without subscribers do not create it
+    table.publishAnalog(nullptr, 0, 1.0f);
+    table.publishDigital(nullptr, 0, true);
+    ASSERT_FALSE(table.remove(0x100));
+    ASSERT_EQ(0u, table.size());
+    ASSERT_EQ(0u, table.getDropped());
+    ASSERT_FALSE(table.isCreated());
+
+    Recorder rec;
+    ASSERT_TRUE(table.addAnalog(0, Deadband{}, rec.target(), true).isOk());
+    ASSERT_TRUE(table.isCreated());
+    ASSERT_EQ(1u, table.size());
+
+    table.publishAnalog(nullptr, 0, 2.0f);
+    ASSERT_EQ(1u, rec.events.size());
+}
+
+namespace {
+
+// Minimal digital source: update() publishes every state it "reads"
+class TestDigitalInput : public IModbusDigitalInput {
+public:
+    uint32_t inputs = 0;
+
+    ModbusResult<void> update() override {
+        for (size_t ch = 0; ch < 4; ch++) {
+            publishState(ch, (inputs >> ch) & 1u);
+        }
+        return ModbusResult<void>::ok();
+    }
+    bool hasValidData() const override { return true; }
+    uint32_t getLastUpdateTime() const override { return 0; }
+    uint32_t getDataAge() const override { return 0; }
+    size_t getChannelCount() const override { return 4; }
+    const char* getChannelName(size_t) const override { return ""; }
+    const char* getChannelUnits(size_t) const override { return ""; }
+    ModbusResult<bool> getState(size_t channel) const override {
+        return ModbusResult<bool>::ok(((inputs >> channel) & 1u) != 0);
+    }
+    ModbusResult<uint32_t> getStates(size_t, size_t) const override {
+        return ModbusResult<uint32_t>::ok(inputs);
+    }
+    bool hasActiveAlarm() const override { return false; }
+    std::vector<uint16_t> getActiveAlarms() const override { return {}; }
+};
+
+} // namespace
+
+TEST(Subscription_DigitalInputPublishState) {
+    TestDigitalInput input;
+    Recorder rec;
+    auto handle = input.subscribe(2, Edge::RISING, &Recorder::onChange, &rec, false);
+    ASSERT_TRUE(handle.isOk());
+
+    input.update();                 // baseline: channel 2 low
+    input.inputs = 0x4;
+    input.update();
+    input.inputs = 0x0;
+    input.update();
+
+    ASSERT_EQ(1u, rec.events.size());
+    ASSERT_EQ(2, rec.events[0].channel);
+    ASSERT_TRUE(rec.events[0].state);
+    ASSERT_TRUE(rec.events[0].source == &input);
+
+    ASSERT_TRUE(input.unsubscribe(handle.value()));
+    ASSERT_EQ(0u, input.getDroppedChangeEvents());
+}
@@ -0,0 +1,192 @@
+#include "test_framework.h"
+#include "ModbusTcpGateway.h"
+#include "ModbusDevice.h"
+#include "ModbusRegistry.h"
+#include <cstring>
+
+using namespace modbus;
+
+namespace {
+
+constexpr uint8_t SLAVE = 0x21;
+
+class GatewayTestDevice : public ModbusDevice {
+public:
+    explicit GatewayTestDevice(uint8_t addr) : ModbusDevice(addr) {
+        (void)registerDevice();
+        setInitPhase(InitPhase::READY);
+    }
+    ~GatewayTestDevice() override { (void)unregisterDevice(); }
+};
+
+// Simulated bus with one slave; its registers read as (address << 8) | register
+void attachBus() {
+    static esp32ModbusRTU rtu(115200);
+    static bool attached = false;
+    if (!attached) {
+        rtu.configureSlave(SLAVE, esp32ModbusRTU::SlaveConfig{});
+        rtu.onData(mainHandleData);
+        rtu.onError(handleError);
+        attached = true;
+    }
+    ModbusRegistry::getInstance().setModbusRTU(&rtu);
+}
+
+// FC03/FC04 read request ADU
+size_t readFrame(uint8_t* frame, uint16_t transaction, uint8_t unit, uint8_t fc,
+                 uint16_t address, uint16_t count) {
+    const uint8_t adu[] = {
+        static_cast<uint8_t>(transaction >> 8), static_cast<uint8_t>(transaction),
+        0x00, 0x00,                 // Protocol id
+        0x00, 0x06,                 // Unit id + 5 byte PDU
+        unit, fc,
+        static_cast<uint8_t>(address >> 8), static_cast<uint8_t>(address),
+        static_cast<uint8_t>(count >> 8), static_cast<uint8_t>(count),
+    };
+    std::memcpy(frame, adu, sizeof(adu));
+    return sizeof(adu);
+}
+
+uint16_t be16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+} // namespace
+
+TEST(TcpGateway_DropsMalformedFrames) {
+    ModbusTcpGateway gateway;
+    uint8_t request[ModbusTcpGateway::MAX_ADU];
+    uint8_t response[ModbusTcpGateway::MAX_ADU];
+    size_t length = readFrame(request, 1, 1, 0x03, 0, 1);
+
+    // Shorter than MBAP header + function code
+    ASSERT_EQ(0u, gateway.processFrame(0, request, 7, response, sizeof(response)));
+
+    // Protocol id other than 0
+    request[3] = 0x01;
+    ASSERT_EQ(0u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    request[3] = 0x00;
+
+    // MBAP length field disagrees with the frame
+    request[5] = 0x07;
+    ASSERT_EQ(0u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    request[5] = 0x06;
+    ASSERT_EQ(0u, gateway.processFrame(0, request, length - 1, response, sizeof(response)));
+
+    // Reply buffer below the minimum
+    ASSERT_EQ(0u, gateway.processFrame(0, request, length, response, 11));
+
+    ASSERT_EQ(0u, gateway.getStats().requests);
+}
+
+TEST(TcpGateway_UnmappedUnit) {
+    ModbusTcpGateway gateway;
+    uint8_t request[ModbusTcpGateway::MAX_ADU];
+    uint8_t response[ModbusTcpGateway::MAX_ADU];
+    size_t length = readFrame(request, 0xBEEF, 0x42, 0x03, 0, 1);
+
+    size_t n = gateway.processFrame(0, request, length, response, sizeof(response));
+    ASSERT_EQ(9u, n);
+    ASSERT_EQ(0xBEEF, be16(response));          // Transaction id echoed
+    ASSERT_EQ(0x0000, be16(response + 2));
+    ASSERT_EQ(3, be16(response + 4));           // Unit id + exception PDU
+    ASSERT_EQ(0x42, response[6]);
+    ASSERT_EQ(0x83, response[7]);
+    ASSERT_EQ(0x0A, response[8]);               // Gateway path unavailable
+
+    auto stats = gateway.getStats();
+    ASSERT_EQ(1u, stats.requests);
+    ASSERT_EQ(1u, stats.exceptions);
+    ASSERT_EQ(0u, stats.busRequests);
+}
+
+TEST(TcpGateway_ReadThroughAndCache) {
+    attachBus();
+    GatewayTestDevice device(SLAVE);
+    ModbusTcpGateway gateway;
+    ASSERT_TRUE(gateway.mapUnit(7, device).isOk());
+
+    uint8_t request[ModbusTcpGateway::MAX_ADU];
+    uint8_t response[ModbusTcpGateway::MAX_ADU];
+    size_t length = readFrame(request, 0x0102, 7, 0x03, 0x0010, 2);
+
+    size_t n = gateway.processFrame(0, request, length, response, sizeof(response));
+    ASSERT_EQ(13u, n);
+    ASSERT_EQ(0x0102, be16(response));
+    ASSERT_EQ(7, be16(response + 4));           // Unit id + FC + byte count + 4 bytes
+    ASSERT_EQ(7, response[6]);                  // Unit id, not the RTU address
+    ASSERT_EQ(0x03, response[7]);
+    ASSERT_EQ(4, response[8]);
+    ASSERT_EQ((SLAVE << 8) | 0x10, be16(response + 9));
+    ASSERT_EQ((SLAVE << 8) | 0x11, be16(response + 11));
+    ASSERT_EQ(1u, gateway.getStats().busRequests);
+
+    // The same read from another client is served from the cache
+    request[1] = 0x03;
+    uint8_t cached[ModbusTcpGateway::MAX_ADU];
+    ASSERT_EQ(13u, gateway.processFrame(1, request, length, cached, sizeof(cached)));
+    ASSERT_EQ(0x0103, be16(cached));
+    ASSERT_EQ(0, std::memcmp(response + 4, cached + 4, 9));
+
+    auto stats = gateway.getStats();
+    ASSERT_EQ(1u, stats.busRequests);
+    ASSERT_EQ(1u, stats.cacheHits);
+    ASSERT_EQ(2u, stats.requests);
+}
+
+TEST(TcpGateway_PduValidation) {
+    attachBus();
+    GatewayTestDevice device(SLAVE);
+    ModbusTcpGateway gateway;
+    ASSERT_TRUE(gateway.mapUnit(1, device).isOk());
+
+    uint8_t request[ModbusTcpGateway::MAX_ADU];
+    uint8_t response[ModbusTcpGateway::MAX_ADU];
+
+    // Unsupported function code
+    size_t length = readFrame(request, 1, 1, 0x07, 0, 1);
+    ASSERT_EQ(9u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    ASSERT_EQ(0x87, response[7]);
+    ASSERT_EQ(0x01, response[8]);
+
+    // Register count out of range
+    length = readFrame(request, 2, 1, 0x03, 0, MODBUS_MAX_REGISTER_COUNT + 1);
+    ASSERT_EQ(9u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    ASSERT_EQ(0x83, response[7]);
+    ASSERT_EQ(0x03, response[8]);
+
+    // Reply would not fit the caller's buffer
+    length = readFrame(request, 3, 1, 0x03, 0, 10);
+    ASSERT_EQ(9u, gateway.processFrame(0, request, length, response, 12 + 7));
+    ASSERT_EQ(0x04, response[8]);
+
+    ASSERT_EQ(0u, gateway.getStats().busRequests);
+}
+
+TEST(TcpGateway_RateLimit) {
+    attachBus();
+    GatewayTestDevice device(SLAVE);
+    ModbusTcpGateway gateway;
+    ASSERT_TRUE(gateway.mapUnit(1, device).isOk());
+    gateway.setCacheTtl(0);
+    gateway.setRateLimit(1, 1);
+
+    uint8_t request[ModbusTcpGateway::MAX_ADU];
+    uint8_t response[ModbusTcpGateway::MAX_ADU];
+    size_t length = readFrame(request, 1, 1, 0x04, 0x0020, 1);
+
+    ASSERT_EQ(11u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    ASSERT_EQ(0x04, response[7]);
+
+    // Burst used up: server busy without touching the bus
+    ASSERT_EQ(9u, gateway.processFrame(0, request, length, response, sizeof(response)));
+    ASSERT_EQ(0x84, response[7]);
+    ASSERT_EQ(0x06, response[8]);
+
+    // Buckets are per client
+    ASSERT_EQ(11u, gateway.processFrame(1, request, length, response, sizeof(response)));
+
+    auto stats = gateway.getStats();
+    ASSERT_EQ(1u, stats.rateLimited);
+    ASSERT_EQ(2u, stats.busRequests);
+}
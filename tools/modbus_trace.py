@@ -0,0 +1,193 @@
+#!/usr/bin/env python3
+# modbus_trace.py - part of the ESP32-ModbusDevice library
+#
+# Copyright (C) 2025-2026 packerlschupfer
+#
+# This program is free software: you can redistribute it and/or modify it
+# under the terms of the GNU General Public License as published by the Free
+# Software Foundation, either version 3 of the License, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful, but WITHOUT
+# ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+# FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+# more details.
+#
+# You should have received a copy of the GNU General Public License along
+# with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+"""Decode a ModbusTrace::dump() image into Chrome trace JSON.
+
+    python3 tools/modbus_trace.py trace.bin -o trace.json
+    python3 tools/modbus_trace.py trace.bin --text
+
+Open the JSON in chrome://tracing or https://ui.perfetto.dev. Each bus is a
+process and each slave a thread; a transaction is a slice from the moment
+the request went to the RTU for its round trip, preceded by a "wait" slice
+for the bus arbitration wait. Failed transactions are coloured red.
+"""
+
+import argparse
+import json
+import struct
+import sys
+
+HEADER = struct.Struct("<4sBBHII")
+RECORD = struct.Struct("<IIIIHHBBBBBBH")
+
+KINDS = ["sync", "async", "scheduled", "broadcast", "group", "probe"]
+PRIORITIES = ["EMERGENCY", "SENSOR", "RELAY", "STATUS"]
+
+# ModbusError values (ModbusTypes.h)
+OUTCOMES = {
+    0x00: "SUCCESS",
+    0x01: "ILLEGAL_FUNCTION",
+    0x02: "ILLEGAL_DATA_ADDRESS",
+    0x03: "ILLEGAL_DATA_VALUE",
+    0x04: "SLAVE_DEVICE_FAILURE",
+    0x80: "TIMEOUT",
+    0x81: "CRC_ERROR",
+    0x82: "INVALID_RESPONSE",
+    0x83: "QUEUE_FULL",
+    0x84: "NOT_INITIALIZED",
+    0x85: "COMMUNICATION_ERROR",
+    0x86: "INVALID_PARAMETER",
+    0x87: "RESOURCE_ERROR",
+    0x88: "NULL_POINTER",
+    0x89: "NOT_SUPPORTED",
+    0x8A: "MUTEX_ERROR",
+    0x8B: "INVALID_DATA_LENGTH",
+    0x8C: "DEVICE_NOT_FOUND",
+    0x8D: "RESOURCE_CREATION_FAILED",
+    0x8E: "INVALID_ADDRESS",
+}
+
+
+def parse(blob):
+    """Return (records, overwritten); records are dicts in sequence order."""
+    if len(blob) < HEADER.size:
+        raise ValueError("dump shorter than its header")
+    magic, version, size, _, count, overwritten = HEADER.unpack_from(blob)
+    if magic != b"MBTR":
+        raise ValueError("not a ModbusTrace dump (magic %r)" % magic)
+    if version != 1 or size != RECORD.size:
+        raise ValueError("unsupported dump version %d / record size %d" % (version, size))
+
+    records = []
+    offset = HEADER.size
+    high = 0
+    last = None
+    for _ in range(count):
+        if offset + RECORD.size > len(blob):
+            break  # Truncated dump; keep what arrived
+        (seq, ts, wait, rtt, address, n, bus, slave, fc, outcome, priority, kind,
+         _) = RECORD.unpack_from(blob, offset)
+        offset += RECORD.size
+        if seq == 0:
+            continue  # Overwritten while the dump ran
+
+        # Timestamps are the low 32 bits of esp_timer; unwrap them assuming
+        # consecutive records are less than ~35 minutes apart
+        if last is not None and ts < last and last - ts > 0x80000000:
+            high += 1 << 32
+        last = ts
+        records.append({
+            "seq": seq, "ts": high + ts, "wait": wait, "rtt": rtt,
+            "address": address, "count": n, "bus": bus, "slave": slave, "fc": fc,
+            "outcome": outcome, "priority": priority, "kind": kind,
+        })
+    return records, overwritten
+
+
+def name_of(table, index, fmt="%d"):
+    return table[index] if 0 <= index < len(table) else fmt % index
+
+
+def to_chrome(records):
+    events = []
+    buses = sorted({r["bus"] for r in records})
+    for bus in buses:
+        events.append({"name": "process_name", "ph": "M", "pid": bus,
+                       "args": {"name": "Modbus bus %d" % bus}})
+    for bus, slave in sorted({(r["bus"], r["slave"]) for r in records}):
+        label = "broadcast" if slave == 0 else "slave %d" % slave
+        events.append({"name": "thread_name", "ph": "M", "pid": bus, "tid": slave,
+                       "args": {"name": label}})
+
+    origin = records[0]["ts"] if records else 0
+    for r in records:
+        ts = r["ts"] - origin
+        outcome = OUTCOMES.get(r["outcome"], "0x%02X" % r["outcome"])
+        args = {
+            "seq": r["seq"],
+            "address": "0x%04X" % r["address"],
+            "count": r["count"],
+            "outcome": outcome,
+            "priority": name_of(PRIORITIES, r["priority"]),
+            "kind": name_of(KINDS, r["kind"]),
+            "wait_us": r["wait"],
+            "round_trip_us": r["rtt"],
+        }
+        if r["wait"]:
+            events.append({"name": "wait", "cat": "arbiter", "ph": "X",
+                           "ts": ts - r["wait"], "dur": r["wait"],
+                           "pid": r["bus"], "tid": r["slave"], "cname": "grey",
+                           "args": {"priority": args["priority"]}})
+        event = {"name": "FC%02X 0x%04X x%d" % (r["fc"], r["address"], r["count"]),
+                 "cat": args["kind"], "ph": "X", "ts": ts, "dur": max(r["rtt"], 1),
+                 "pid": r["bus"], "tid": r["slave"], "args": args}
+        if r["outcome"] != 0:
+            event["cname"] = "terrible"
+        events.append(event)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def to_text(records, out):
+    origin = records[0]["ts"] if records else 0
+    out.write("%10s %12s %3s %5s %4s %6s %5s %-9s %-9s %8s %8s  %s\n" % (
+        "seq", "t [us]", "bus", "slave", "fc", "addr", "count", "kind", "priority",
+        "wait", "rtt", "outcome"))
+    for r in records:
+        out.write("%10d %12d %3d %5d %4s %6s %5d %-9s %-9s %8d %8d  %s\n" % (
+            r["seq"], r["ts"] - origin, r["bus"], r["slave"], "%02X" % r["fc"],
+            "%04X" % r["address"], r["count"], name_of(KINDS, r["kind"]),
+            name_of(PRIORITIES, r["priority"]), r["wait"], r["rtt"],
+            OUTCOMES.get(r["outcome"], "0x%02X" % r["outcome"])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("dump", help="binary dump from ModbusTrace::dump() ('-' = stdin)")
+    parser.add_argument("-o", "--output", help="output file (default stdout)")
+    parser.add_argument("--text", action="store_true", help="print a table instead of JSON")
+    args = parser.parse_args()
+
+    if args.dump == "-":
+        blob = sys.stdin.buffer.read()
+    else:
+        with open(args.dump, "rb") as f:
+            blob = f.read()
+
+    try:
+        records, overwritten = parse(blob)
+    except ValueError as e:
+        sys.exit("modbus_trace: %s" % e)
+    if overwritten:
+        sys.stderr.write("modbus_trace: %d older records were overwritten\n" % overwritten)
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    try:
+        if args.text:
+            to_text(records, out)
+        else:
+            json.dump(to_chrome(records), out, indent=1)
+            out.write("\n")
+    finally:
+        if args.output:
+            out.close()
+
+
+if __name__ == "__main__":
+    main()